@@ -1,31 +1,141 @@
-// #include "AST.h"
+#include "AST.h"
+
+// Moves every child `stmt` owns onto `out`, leaving the node childless.
+static void detachChildren(Stmt &stmt, vector<unique_ptr<Stmt>> &out) {
+  auto take = [&out](auto &child) {
+    if (child) {
+      out.push_back(move(child));
+    }
+  };
+  auto takeAll = [&take](auto &nodes) {
+    for (auto &node : nodes) {
+      take(node);
+    }
+    nodes.clear();
+  };
+
+  switch (stmt.kind) {
+  case NodeType::Program:
+    takeAll(static_cast<Program &>(stmt).body);
+    break;
+  case NodeType::VarDeclaration:
+    take(static_cast<VarDeclaration &>(stmt).value);
+    break;
+  case NodeType::FunctionDeclaration: {
+    auto &node = static_cast<FunctionDeclaration &>(stmt);
+    for (Stmt *child : node.body) {
+      out.emplace_back(child);
+    }
+    node.body.clear();
+    take(node.returnStatement);
+    break;
+  }
+  case NodeType::StructDeclaration:
+    takeAll(static_cast<StructDeclaration &>(stmt).structBody);
+    break;
+  case NodeType::IfStatement: {
+    auto &node = static_cast<IfStatement &>(stmt);
+    take(node.condition);
+    takeAll(node.ifBody);
+    takeAll(node.elseBody);
+    break;
+  }
+  case NodeType::WhileLoop: {
+    auto &node = static_cast<WhileLoop &>(stmt);
+    take(node.condition);
+    takeAll(node.loopBody);
+    break;
+  }
+  case NodeType::ReturnStatement:
+    take(static_cast<ReturnStatement &>(stmt).returnValue);
+    break;
+  case NodeType::AssignmentExpr: {
+    auto &node = static_cast<AssignmentExpr &>(stmt);
+    take(node.assigne);
+    take(node.value);
+    break;
+  }
+  case NodeType::BinaryExpr: {
+    auto &node = static_cast<BinaryExpr &>(stmt);
+    take(node.left);
+    take(node.right);
+    break;
+  }
+  case NodeType::LogicalExpr: {
+    auto &node = static_cast<LogicalExpr &>(stmt);
+    take(node.left);
+    take(node.right);
+    break;
+  }
+  case NodeType::UnaryExpr:
+    take(static_cast<UnaryExpr &>(stmt).right);
+    break;
+  case NodeType::CallExpr: {
+    auto &node = static_cast<CallExpr &>(stmt);
+    take(node.caller);
+    takeAll(node.args);
+    break;
+  }
+  case NodeType::MemberAccessExpr:
+    take(static_cast<MemberAccessExpr &>(stmt).object);
+    break;
+  case NodeType::ArrayLiteral:
+    takeAll(static_cast<ArrayLiteral &>(stmt).elements);
+    break;
+  case NodeType::IndexExpr: {
+    auto &node = static_cast<IndexExpr &>(stmt);
+    take(node.object);
+    take(node.index);
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+// Called from the destructor of every node with children. Each node popped
+// off the worklist has its own children detached first, so its destructor
+// finds nothing left to recurse into.
+static void destroyChildren(Stmt &stmt) {
+  vector<unique_ptr<Stmt>> pending;
+  detachChildren(stmt, pending);
+  while (!pending.empty()) {
+    unique_ptr<Stmt> node = move(pending.back());
+    pending.pop_back();
+    detachChildren(*node, pending);
+  }
+}
 
 Stmt::Stmt(NodeType kind) { this->kind = kind; }
 Expr::Expr(NodeType kind) : Stmt(kind) {}
 
 Program::Program() : Stmt(NodeType::Program) {}
+Program::~Program() { destroyChildren(*this); }
 
 VarDeclaration::VarDeclaration(bool isConst, const string &id,
                                unique_ptr<Expr> val)
     : Stmt(NodeType::VarDeclaration), constant(isConst), identifier(id),
       value(move(val)) {}
+VarDeclaration::~VarDeclaration() { destroyChildren(*this); }
 
 BinaryExpr::BinaryExpr(unique_ptr<Expr> left, unique_ptr<Expr> right,
                        const string &op)
     : Expr(NodeType::BinaryExpr), left(move(left)),
       right(move(right)), binaryOperator(op) {}
+BinaryExpr::~BinaryExpr() { destroyChildren(*this); }
 
 UnaryExpr::UnaryExpr(unique_ptr<Expr> right, const string &op)
     : Expr(NodeType::UnaryExpr), right(move(right)), op(op) {}
+UnaryExpr::~UnaryExpr() { destroyChildren(*this); }
 
 IdentifierExpr::IdentifierExpr(const string &symbol)
     : Expr(NodeType::Identifier), symbol(symbol) {}
 
-NumericLiteral::NumericLiteral(double value)
+NumericLiteral::NumericLiteral(int64_t value)
     : Expr(NodeType::NumericLiteral), value(value) {}
 
 FloatLiteral::FloatLiteral(double value)
-    : Expr(NodeType::NumericLiteral), value(value) {}
+    : Expr(NodeType::FloatLiteral), value(value) {}
 
 StrLiteral::StrLiteral(string value)
     : Expr(NodeType::StrLiteral), value(value) {}
@@ -37,47 +147,63 @@ AssignmentExpr::AssignmentExpr(unique_ptr<Expr> assigne,
                                unique_ptr<Expr> val)
     : Expr(NodeType::AssignmentExpr), assigne(move(assigne)),
       value(move(val)) {}
+AssignmentExpr::~AssignmentExpr() { destroyChildren(*this); }
 
 CallExpr::CallExpr(unique_ptr<Expr> caller,
                    vector<unique_ptr<Expr>> args)
     : Expr(NodeType::CallExpr), caller(move(caller)),
       args(move(args)) {}
+CallExpr::~CallExpr() { destroyChildren(*this); }
 
 MemberAccessExpr::MemberAccessExpr(unique_ptr<Expr> obj,
                                    const string &member)
     : Expr(NodeType::MemberAccessExpr), object(move(obj)),
       memberName(member) {}
+MemberAccessExpr::~MemberAccessExpr() { destroyChildren(*this); }
+
+ArrayLiteral::ArrayLiteral(vector<unique_ptr<Expr>> elements)
+    : Expr(NodeType::ArrayLiteral), elements(move(elements)) {}
+ArrayLiteral::~ArrayLiteral() { destroyChildren(*this); }
+
+IndexExpr::IndexExpr(unique_ptr<Expr> object, unique_ptr<Expr> index)
+    : Expr(NodeType::IndexExpr), object(move(object)), index(move(index)) {}
+IndexExpr::~IndexExpr() { destroyChildren(*this); }
 
 FunctionDeclaration::FunctionDeclaration(
     vector<string> param, string n, vector<Stmt *> b,
     unique_ptr<ReturnStatement> retStmt)
-    : Stmt(NodeType::FunctionDeclaration), parameters(param), name(n), body(b),
-      returnStatement(move(retStmt)) {}
+    : Stmt(NodeType::FunctionDeclaration), parameters(move(param)),
+      name(move(n)), body(move(b)), returnStatement(move(retStmt)) {}
 
-FunctionDeclaration::~FunctionDeclaration() {
-  for (auto &stmt : body) {
-    delete stmt;
-  }
-}
+FunctionDeclaration::~FunctionDeclaration() { destroyChildren(*this); }
 
 IfStatement::IfStatement(unique_ptr<Expr> cond,
                          vector<unique_ptr<Stmt>> ifB,
                          vector<unique_ptr<Stmt>> elseB)
     : Stmt(NodeType::IfStatement), condition(move(cond)),
       ifBody(move(ifB)), elseBody(move(elseB)) {}
+IfStatement::~IfStatement() { destroyChildren(*this); }
 
 WhileLoop::WhileLoop(unique_ptr<Expr> cond,
                      vector<unique_ptr<Stmt>> bd)
     : Stmt(NodeType::WhileLoop), condition(move(cond)),
       loopBody(move(bd)) {}
+WhileLoop::~WhileLoop() { destroyChildren(*this); }
 
 ReturnStatement::ReturnStatement(unique_ptr<Stmt> value)
     : Stmt(NodeType::ReturnStatement), returnValue(move(value)) {}
+ReturnStatement::~ReturnStatement() { destroyChildren(*this); }
 
 StructDeclaration::StructDeclaration(const string &name,
                                      vector<unique_ptr<Stmt>> body)
     : Stmt(NodeType::StructDeclaration), structName(name),
       structBody(move(body)) {}
+StructDeclaration::~StructDeclaration() { destroyChildren(*this); }
+
+ErrorStmt::ErrorStmt(const string &message)
+    : Stmt(NodeType::Error), message(message) {}
 
 LogicalExpr::LogicalExpr(unique_ptr<Expr> left, unique_ptr<Expr> right, const string& logicalOperator)
-        : Expr(NodeType::LogicalExpr), left(move(left)), right(move(right)), logicalOperator(logicalOperator) {}
\ No newline at end of file
+        : Expr(NodeType::LogicalExpr), left(move(left)), right(move(right)), logicalOperator(logicalOperator) {}
+
+LogicalExpr::~LogicalExpr() { destroyChildren(*this); }
@@ -1,10 +1,12 @@
 #ifndef AST_H
 #define AST_H
 
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <vector>
+using namespace std;
 
 enum class NodeType {
   // Statements
@@ -15,10 +17,12 @@ enum class NodeType {
   IfStatement,
   WhileLoop,
   ReturnStatement,
+  Error,
 
   // Expressions
   AssignmentExpr,
   NumericLiteral,
+  FloatLiteral,
   StrLiteral,
   Null,
   Identifier,
@@ -27,13 +31,32 @@ enum class NodeType {
   MemberAccessExpr,
   UnaryExpr,
   LogicalExpr,
+  ArrayLiteral,
+  IndexExpr,
+};
+
+// Where a declared name lives at run time, filled in by name resolution
+// (passes/Resolver.h). Local slots index the frame of the function the
+// declaration belongs to; global slots index the program's globals.
+class Binding {
+public:
+  enum class Scope : uint8_t { Unresolved, Global, Local };
+  Scope scope = Scope::Unresolved;
+  uint32_t slot = 0;
+
+  bool resolved() const { return scope != Scope::Unresolved; }
 };
 
 class Node {
 public:
   NodeType kind;
+  // Byte offset of the node's first token in the source.
+  uint32_t offset = 0;
 };
 
+// Nodes with children free them through an explicit worklist instead of
+// nested destructor calls, so dropping a very deep tree cannot overflow the
+// stack.
 class Stmt : public Node {
 public:
   Stmt(NodeType kind);
@@ -50,6 +73,7 @@ class Program : public Stmt {
 public:
   vector<unique_ptr<Stmt>> body;
   Program();
+  ~Program();
 };
 
 class AssignmentExpr : public Expr {
@@ -57,6 +81,7 @@ public:
   unique_ptr<Expr> assigne;
   unique_ptr<Expr> value;
   AssignmentExpr(unique_ptr<Expr> assigne, unique_ptr<Expr> value);
+  ~AssignmentExpr();
 };
 
 class VarDeclaration : public Stmt {
@@ -64,14 +89,20 @@ public:
   bool constant;
   string identifier;
   unique_ptr<Expr> value;
+  Binding binding;
   VarDeclaration(bool isConst, const string &id,
                  unique_ptr<Expr> val = nullptr);
+  ~VarDeclaration();
 };
 
 class ReturnStatement : public Stmt {
 public:
   unique_ptr<Stmt> returnValue;
+  // Whether the value is a call in tail position of a function
+  // (passes/TailCalls.h).
+  bool tailCall = false;
   ReturnStatement(unique_ptr<Stmt> value);
+  ~ReturnStatement();
 };
 
 class FunctionDeclaration : public Stmt {
@@ -80,6 +111,10 @@ public:
   string name;
   vector<Stmt *> body;
   unique_ptr<ReturnStatement> returnStatement;
+  Binding binding;
+  // Slots a call needs: the parameters, in slots 0..n-1, then every local
+  // declared anywhere in the body.
+  uint32_t frameSize = 0;
   FunctionDeclaration(vector<string> param, string n,
                       vector<Stmt *> b,
                       unique_ptr<ReturnStatement> retStmt = nullptr);
@@ -91,8 +126,12 @@ public:
   unique_ptr<Expr> left;
   unique_ptr<Expr> right;
   string binaryOperator;
+  // The expression's quickening state in the interpreter
+  // (passes/CacheSites.h).
+  int32_t cacheSlot = -1;
   BinaryExpr(unique_ptr<Expr> left, unique_ptr<Expr> right,
              const string &op);
+  ~BinaryExpr();
 };
 
 class UnaryExpr : public Expr {
@@ -100,26 +139,39 @@ public:
   unique_ptr<Expr> right;
   string op;
   UnaryExpr(unique_ptr<Expr> right, const string &op);
+  ~UnaryExpr();
 };
 
 class CallExpr : public Expr {
 public:
   unique_ptr<Expr> caller;
   vector<unique_ptr<Expr>> args;
+  // For a constructor call whose instance never leaves the calling function,
+  // the frame slot where the instance is placed instead of the heap;
+  // otherwise -1 (passes/EscapeAnalysis.h).
+  int32_t frameSlot = -1;
+  // The call's inline cache in the interpreter (passes/CacheSites.h).
+  int32_t cacheSlot = -1;
+  // When the caller names a builtin, its index among the builtins, which
+  // the call is bound to; otherwise -1 (passes/Resolver.h).
+  int32_t builtin = -1;
   CallExpr(unique_ptr<Expr> caller,
            vector<unique_ptr<Expr>> args);
+  ~CallExpr();
 };
 
 class IdentifierExpr : public Expr {
 public:
   string symbol;
+  Binding binding;
   IdentifierExpr(const string &symbol);
 };
 
+// Integer literal.
 class NumericLiteral : public Expr {
 public:
-  double value;
-  NumericLiteral(double value);
+  int64_t value;
+  NumericLiteral(int64_t value);
 };
 
 class StrLiteral : public Expr {
@@ -148,28 +200,42 @@ public:
   IfStatement(unique_ptr<Expr> cond,
               vector<unique_ptr<Stmt>> ifB,
               vector<unique_ptr<Stmt>> elseB = {});
+  ~IfStatement();
 };
 
 class WhileLoop : public Stmt {
 public:
   unique_ptr<Expr> condition;
   vector<unique_ptr<Stmt>> loopBody;
+  // `parallel while`: the iterations may run at the same time, on several
+  // threads (passes/ParallelLoops.h).
+  bool parallel = false;
   WhileLoop(unique_ptr<Expr> cond, vector<unique_ptr<Stmt>> bd);
+  ~WhileLoop();
 };
 
 class StructDeclaration : public Stmt {
 public:
   string structName;
   vector<unique_ptr<Stmt>> structBody;
+  Binding binding;
   StructDeclaration(const string &name,
                     vector<unique_ptr<Stmt>> body);
+  ~StructDeclaration();
 };
 
 class MemberAccessExpr : public Expr {
 public:
   unique_ptr<Expr> object;
   string memberName;
+  // Index of the field in the struct's layout when the object is known to
+  // be an instance of one struct, otherwise -1 (passes/StructLayout.h).
+  int32_t fieldIndex = -1;
+  // When fieldIndex is -1, the access's inline cache in the interpreter
+  // (passes/CacheSites.h); otherwise -1.
+  int32_t cacheSlot = -1;
   MemberAccessExpr(unique_ptr<Expr> obj, const string &member);
+  ~MemberAccessExpr();
 };
 
 class LogicalExpr : public Expr {
@@ -179,12 +245,37 @@ public:
     string logicalOperator;
 
     LogicalExpr(unique_ptr<Expr> left, unique_ptr<Expr> right, const string& logicalOperator);
+    ~LogicalExpr();
+};
+
+// `[a, b, c]`.
+class ArrayLiteral : public Expr {
+public:
+  vector<unique_ptr<Expr>> elements;
+  ArrayLiteral(vector<unique_ptr<Expr>> elements);
+  ~ArrayLiteral();
+};
+
+// `object[index]`.
+class IndexExpr : public Expr {
+public:
+  unique_ptr<Expr> object;
+  unique_ptr<Expr> index;
+  IndexExpr(unique_ptr<Expr> object, unique_ptr<Expr> index);
+  ~IndexExpr();
+};
+
+// Stands in for a statement the parser could not make sense of.
+class ErrorStmt : public Stmt {
+public:
+  string message;
+  ErrorStmt(const string &message);
 };
 
 string NodeTypeToString(NodeType type);
 
-void printProgram(unique_ptr<Program> program, const string &indent);
+void printProgram(const Program &program, ostream &out, const string &indent);
 
-void printStatement(const Stmt &stmt, const string &indent);
+void printStatement(const Stmt &stmt, ostream &out, const string &indent);
 
 #endif
\ No newline at end of file
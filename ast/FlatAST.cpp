@@ -0,0 +1,255 @@
+#include "FlatAST.h"
+#include "Folding.h"
+#include "Visitor.h"
+
+namespace {
+
+// Builds nodes in preorder from an explicit stack rather than by recursion,
+// so arbitrarily deep trees flatten without growing the native stack. A node
+// reserves its whole block in `children` when it is built, and each child
+// fills in its slot once it gets an id.
+class FlatBuilder : public ConstASTVisitor<FlatBuilder> {
+public:
+  FlatAST ast;
+
+  void build(const Program &program);
+
+  bool visitProgram(const Program &program) { return finish(program); }
+  bool visitVarDeclaration(const VarDeclaration &varDecl) {
+    return finish(varDecl, intern(varDecl.identifier), varDecl.constant);
+  }
+  bool visitFunctionDeclaration(const FunctionDeclaration &funcDecl);
+  bool visitStructDeclaration(const StructDeclaration &structDecl) {
+    return finish(structDecl, intern(structDecl.structName));
+  }
+  bool visitIfStatement(const IfStatement &ifStmt) {
+    return finish(ifStmt, 0, static_cast<uint32_t>(ifStmt.ifBody.size()));
+  }
+  bool visitWhileLoop(const WhileLoop &whileLoop) {
+    return finish(whileLoop, 0, whileLoop.parallel);
+  }
+  bool visitReturnStatement(const ReturnStatement &returnStmt) {
+    return finish(returnStmt);
+  }
+  bool visitError(const ErrorStmt &error) {
+    return finish(error, intern(error.message));
+  }
+  bool visitAssignmentExpr(const AssignmentExpr &assignmentExpr) {
+    return finish(assignmentExpr);
+  }
+  bool visitNumericLiteral(const NumericLiteral &numLit) {
+    return finish(numLit, integer(numLit.value));
+  }
+  bool visitFloatLiteral(const FloatLiteral &floatLit) {
+    return finish(floatLit, number(floatLit.value));
+  }
+  bool visitStrLiteral(const StrLiteral &strLit) {
+    return finish(strLit, intern(strLit.value));
+  }
+  bool visitNullLiteral(const NullLiteral &nullNode) {
+    return finish(nullNode, intern(nullNode.value));
+  }
+  bool visitIdentifier(const IdentifierExpr &identifier) {
+    return finish(identifier, intern(identifier.symbol));
+  }
+  bool visitBinaryExpr(const BinaryExpr &binaryExpr) {
+    return finish(binaryExpr, intern(binaryExpr.binaryOperator));
+  }
+  bool visitLogicalExpr(const LogicalExpr &logicalExpr) {
+    return finish(logicalExpr, intern(logicalExpr.logicalOperator));
+  }
+  bool visitUnaryExpr(const UnaryExpr &unaryExpr) {
+    return finish(unaryExpr, intern(unaryExpr.op));
+  }
+  bool visitCallExpr(const CallExpr &callExpr) { return finish(callExpr); }
+  bool visitMemberAccessExpr(const MemberAccessExpr &memberAccessExpr) {
+    return finish(memberAccessExpr, intern(memberAccessExpr.memberName));
+  }
+  bool visitArrayLiteral(const ArrayLiteral &arrayLiteral) {
+    return finish(arrayLiteral);
+  }
+  bool visitIndexExpr(const IndexExpr &indexExpr) { return finish(indexExpr); }
+
+private:
+  // A node still to be built and the `children` entry waiting for its id.
+  class Pending {
+  public:
+    const Stmt *node;
+    size_t slot;
+  };
+  static constexpr size_t noSlot = SIZE_MAX;
+
+  unordered_map<string, uint32_t> interned;
+  vector<Pending> stack;
+  // Slot of the node being visited.
+  size_t slot = noSlot;
+  // Children of the node being visited, before they are pushed.
+  vector<const Stmt *> kids;
+
+  NodeId newNode(NodeType kind, uint32_t offset, uint32_t payload,
+                 uint32_t extra);
+  bool finish(const Stmt &stmt, uint32_t payload = 0, uint32_t extra = 0);
+  void addChildren(NodeId id, const Stmt &stmt, uint32_t leading = 0);
+  uint32_t intern(const string &value);
+  uint32_t integer(int64_t value);
+  uint32_t number(double value);
+};
+
+uint32_t FlatBuilder::intern(const string &value) {
+  auto it = interned.find(value);
+  if (it != interned.end()) {
+    return it->second;
+  }
+  uint32_t id = static_cast<uint32_t>(ast.strings.size());
+  ast.strings.push_back(value);
+  interned.emplace(value, id);
+  return id;
+}
+
+uint32_t FlatBuilder::integer(int64_t value) {
+  ast.integers.push_back(value);
+  return static_cast<uint32_t>(ast.integers.size() - 1);
+}
+
+uint32_t FlatBuilder::number(double value) {
+  ast.numbers.push_back(value);
+  return static_cast<uint32_t>(ast.numbers.size() - 1);
+}
+
+NodeId FlatBuilder::newNode(NodeType kind, uint32_t offset, uint32_t payload,
+                            uint32_t extra) {
+  NodeId id = static_cast<NodeId>(ast.kinds.size());
+  if (slot != noSlot) {
+    ast.children[slot] = id;
+    slot = noSlot;
+  }
+  ast.kinds.push_back(kind);
+  ast.offsets.push_back(offset);
+  ast.firstChild.push_back(0);
+  ast.childCount.push_back(0);
+  ast.payload.push_back(payload);
+  ast.extra.push_back(extra);
+  return id;
+}
+
+void FlatBuilder::build(const Program &program) {
+  stack.push_back({&program, noSlot});
+  while (!stack.empty()) {
+    Pending next = stack.back();
+    stack.pop_back();
+    slot = next.slot;
+    visit(*next.node);
+  }
+}
+
+bool FlatBuilder::finish(const Stmt &stmt, uint32_t payload, uint32_t extra) {
+  addChildren(newNode(stmt.kind, stmt.offset, payload, extra), stmt);
+  return true;
+}
+
+// Reserves the block for `leading` children the caller already placed plus
+// the children of `stmt`, and queues the latter so the first one is built
+// next.
+void FlatBuilder::addChildren(NodeId id, const Stmt &stmt, uint32_t leading) {
+  kids.clear();
+  forEachChild(stmt, [this](const Stmt &child) {
+    kids.push_back(&child);
+    return true;
+  });
+  size_t first = ast.children.size() - leading;
+  ast.firstChild[id] = static_cast<uint32_t>(first);
+  ast.childCount[id] = static_cast<uint32_t>(leading + kids.size());
+  ast.children.resize(first + leading + kids.size());
+  for (size_t i = kids.size(); i-- > 0;) {
+    stack.push_back({kids[i], first + leading + i});
+  }
+}
+
+// Parameters are plain strings in the tree; here they become Identifier
+// children ahead of the body.
+bool FlatBuilder::visitFunctionDeclaration(
+    const FunctionDeclaration &funcDecl) {
+  NodeId id = newNode(funcDecl.kind, funcDecl.offset, intern(funcDecl.name),
+                      static_cast<uint32_t>(funcDecl.parameters.size()));
+  // The parameter ids must sit in `children` before the body is reserved
+  // after them.
+  size_t first = ast.children.size();
+  ast.children.resize(first + funcDecl.parameters.size());
+  for (size_t i = 0; i < funcDecl.parameters.size(); i++) {
+    ast.children[first + i] = newNode(NodeType::Identifier, funcDecl.offset,
+                                      intern(funcDecl.parameters[i]), 0);
+  }
+  addChildren(id, funcDecl,
+              static_cast<uint32_t>(funcDecl.parameters.size()));
+  return true;
+}
+
+} // namespace
+
+FlatAST flatten(const Program &program) {
+  FlatBuilder builder;
+  builder.build(program);
+  return move(builder.ast);
+}
+
+size_t foldConstants(FlatAST &ast) {
+  size_t folded = 0;
+  auto isInteger = [&](NodeId id) {
+    return ast.kinds[id] == NodeType::NumericLiteral;
+  };
+  auto isNumber = [&](NodeId id) {
+    return isInteger(id) || ast.kinds[id] == NodeType::FloatLiteral;
+  };
+  auto asDouble = [&](NodeId id) {
+    return isInteger(id) ? static_cast<double>(ast.integer(id))
+                         : ast.number(id);
+  };
+  auto replaceWithInteger = [&](NodeId id, int64_t value) {
+    ast.kinds[id] = NodeType::NumericLiteral;
+    ast.payload[id] = static_cast<uint32_t>(ast.integers.size());
+    ast.integers.push_back(value);
+    ast.childCount[id] = 0;
+    folded++;
+  };
+  auto replaceWithNumber = [&](NodeId id, double value) {
+    ast.kinds[id] = NodeType::FloatLiteral;
+    ast.payload[id] = static_cast<uint32_t>(ast.numbers.size());
+    ast.numbers.push_back(value);
+    ast.childCount[id] = 0;
+    folded++;
+  };
+
+  // Children always get larger ids than their parent, so walking the ids
+  // backwards sees operands folded before the expressions that use them.
+  for (NodeId id = static_cast<NodeId>(ast.size()); id-- > 0;) {
+    if (ast.kinds[id] == NodeType::BinaryExpr) {
+      NodeId left = ast.children[ast.firstChild[id]];
+      NodeId right = ast.children[ast.firstChild[id] + 1];
+      if (!isNumber(left) || !isNumber(right)) {
+        continue;
+      }
+      const string &op = ast.text(id);
+      if (isInteger(left) && isInteger(right)) {
+        int64_t result;
+        if (foldIntegers(op, ast.integer(left), ast.integer(right), result)) {
+          replaceWithInteger(id, result);
+        }
+        continue;
+      }
+      double result;
+      if (foldNumbers(op, asDouble(left), asDouble(right), result)) {
+        replaceWithNumber(id, result);
+      }
+    } else if (ast.kinds[id] == NodeType::UnaryExpr && ast.text(id) == "-") {
+      NodeId operand = ast.children[ast.firstChild[id]];
+      if (isInteger(operand)) {
+        if (ast.integer(operand) != INT64_MIN) {
+          replaceWithInteger(id, -ast.integer(operand));
+        }
+      } else if (isNumber(operand)) {
+        replaceWithNumber(id, -ast.number(operand));
+      }
+    }
+  }
+  return folded;
+}
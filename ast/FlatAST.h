@@ -0,0 +1,126 @@
+#ifndef FLAT_AST_H
+#define FLAT_AST_H
+
+#include "AST.h"
+#include <cstdint>
+#include <unordered_map>
+
+using NodeId = uint32_t;
+
+// Contiguous run of child ids inside FlatAST::children.
+class ChildRange {
+public:
+  ChildRange(const NodeId *first, const NodeId *last)
+      : first(first), last(last) {}
+  const NodeId *begin() const { return first; }
+  const NodeId *end() const { return last; }
+  size_t size() const { return last - first; }
+  NodeId operator[](size_t i) const { return first[i]; }
+
+private:
+  const NodeId *first;
+  const NodeId *last;
+};
+
+// Structure-of-arrays form of a Program. Node i is described by the i-th
+// entry of every per-node array; node 0 is the Program. Children of a node
+// are stored next to each other in `children`, and the meaning of
+// `payload`/`extra` depends on the kind:
+//
+//   Program             children: body
+//   VarDeclaration      payload: identifier  extra: 1 if const
+//                       children: [value]
+//   FunctionDeclaration payload: name  extra: parameter count
+//                       children: parameters (Identifier) then body
+//   StructDeclaration   payload: name  children: fields
+//   IfStatement         extra: if body length
+//                       children: condition, if body, else body
+//   WhileLoop           extra: 1 if parallel  children: condition, body
+//   ReturnStatement     children: [value]
+//   AssignmentExpr      children: assignee, value
+//   NumericLiteral      payload: index into `integers`
+//   FloatLiteral        payload: index into `numbers`
+//   StrLiteral, Null, Identifier, Error
+//                       payload: value / symbol / message
+//   BinaryExpr, LogicalExpr
+//                       payload: operator  children: left, right
+//   UnaryExpr           payload: operator  children: operand
+//   CallExpr            children: caller, arguments
+//   MemberAccessExpr    payload: member name  children: object
+//   ArrayLiteral        children: elements
+//   IndexExpr           children: object, index
+//
+// Every name, operator and string payload is an index into `strings`, where
+// each distinct string is stored once.
+class FlatAST {
+public:
+  vector<NodeType> kinds;
+  vector<uint32_t> offsets;
+  vector<uint32_t> firstChild;
+  vector<uint32_t> childCount;
+  vector<uint32_t> payload;
+  vector<uint32_t> extra;
+
+  vector<NodeId> children;
+  vector<int64_t> integers;
+  vector<double> numbers;
+  vector<string> strings;
+
+  static constexpr NodeId root = 0;
+
+  size_t size() const { return kinds.size(); }
+  NodeType kind(NodeId id) const { return kinds[id]; }
+  ChildRange childrenOf(NodeId id) const {
+    const NodeId *first = children.data() + firstChild[id];
+    return ChildRange(first, first + childCount[id]);
+  }
+  const string &text(NodeId id) const { return strings[payload[id]]; }
+  int64_t integer(NodeId id) const { return integers[payload[id]]; }
+  double number(NodeId id) const { return numbers[payload[id]]; }
+
+  // Visits every node in source order without recursion. The visitor needs
+  // `bool enter(NodeId)`, returning false to skip the node's children, and
+  // `void leave(NodeId)`.
+  template <typename Visitor> void walk(Visitor &visitor) const;
+};
+
+FlatAST flatten(const Program &program);
+
+// Replaces arithmetic on numeric literals with its result and returns how
+// many nodes were folded. Integer operands fold to an integer (division
+// truncates) unless the result would overflow; a float operand makes the
+// result a float. Operands of a folded node stay in the arrays but
+// are no longer reachable from the root.
+size_t foldConstants(FlatAST &ast);
+
+void printFlatProgram(const FlatAST &ast, ostream &out, const string &indent);
+
+template <typename Visitor> void FlatAST::walk(Visitor &visitor) const {
+  if (kinds.empty()) {
+    return;
+  }
+  // Each entry is a node plus how many of its children were pushed already.
+  vector<pair<NodeId, uint32_t>> stack;
+  if (visitor.enter(root)) {
+    stack.push_back({root, 0});
+  } else {
+    visitor.leave(root);
+  }
+  while (!stack.empty()) {
+    auto &top = stack.back();
+    if (top.second == childCount[top.first]) {
+      NodeId done = top.first;
+      stack.pop_back();
+      visitor.leave(done);
+      continue;
+    }
+    NodeId child = children[firstChild[top.first] + top.second++];
+    if (visitor.enter(child)) {
+      stack.push_back({child, 0});
+    } else {
+      visitor.leave(child);
+    }
+  }
+}
+
+#endif
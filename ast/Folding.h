@@ -0,0 +1,46 @@
+#ifndef FOLDING_H
+#define FOLDING_H
+
+#include <cstdint>
+#include <string>
+using namespace std;
+
+// Arithmetic as the constant folders see it, shared by the flat and the
+// pointer AST so both fold exactly the same expressions. Each returns false
+// when the operation is not foldable or, for integers, when the result is
+// not representable; the operation is then left for the runtime to report.
+
+inline bool foldIntegers(const string &op, int64_t l, int64_t r,
+                         int64_t &result) {
+  if (op == "+") {
+    return !__builtin_add_overflow(l, r, &result);
+  }
+  if (op == "-") {
+    return !__builtin_sub_overflow(l, r, &result);
+  }
+  if (op == "*") {
+    return !__builtin_mul_overflow(l, r, &result);
+  }
+  if (op == "/" && r != 0 && !(l == INT64_MIN && r == -1)) {
+    result = l / r;
+    return true;
+  }
+  return false;
+}
+
+inline bool foldNumbers(const string &op, double l, double r, double &result) {
+  if (op == "+") {
+    result = l + r;
+  } else if (op == "-") {
+    result = l - r;
+  } else if (op == "*") {
+    result = l * r;
+  } else if (op == "/" && r != 0) {
+    result = l / r;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+#endif
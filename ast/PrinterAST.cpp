@@ -1,21 +1,15 @@
-// #include "AST.h"
-// #include<fstream>
-// using namespace std;
-
-ofstream out("Parsed_AST.txt");
-void printProgram (unique_ptr<Program> program, const string &indent) {
-  
-  
-  if(!out.is_open()){
-    cerr << "Error in File Opening...";
-    return;
-  }
+#include "AST.h"
+#include "Visitor.h"
+#include <algorithm>
+#include <iterator>
+#include <sstream>
 
+void printProgram(const Program &program, ostream &out, const string &indent) {
   out << '{' << endl;
   out << indent << " \"Program\": [\n";
-  for (const auto &stmt : program->body) {
-    printStatement(*stmt, indent + "  ");
-    if (stmt != program->body.back()) {
+  for (const auto &stmt : program.body) {
+    printStatement(*stmt, out, indent + "  ");
+    if (stmt != program.body.back()) {
       out << ',';
     }
     out << '\n';
@@ -24,71 +18,116 @@ void printProgram (unique_ptr<Program> program, const string &indent) {
   out << "\n}\n";
 }
 
-void printStatement(const Stmt &stmt, const string &indent) {
-  out << indent << "{\n";
-  out << indent << "  \"Statement\": \"" << NodeTypeToString(stmt.kind)
-            << "\",\n";
+namespace {
+
+// The visit methods below read like a recursive printer, but printChild only
+// queues the child: print() runs the queue from an explicit stack, so deeply
+// nested input cannot overflow the native stack.
+class ASTPrinter : public ConstASTVisitor<ASTPrinter> {
+public:
+  ASTPrinter(ostream &sink, const string &base)
+      : sink(sink), base(base), indent{marks} {}
+
+  void print(const Stmt &root) {
+    stack.push_back({&root, 0, "", {}});
+    while (!stack.empty()) {
+      Task task = move(stack.back());
+      stack.pop_back();
+      if (!task.node) {
+        writeText(task.text, task.marks, task.columns);
+        continue;
+      }
+      columns = task.columns;
+      visit(*task.node);
+      for (auto it = expansion.rbegin(); it != expansion.rend(); ++it) {
+        stack.push_back(move(*it));
+      }
+      expansion.clear();
+    }
+  }
 
-  switch (stmt.kind) {
-  case NodeType::Identifier: {
-    const auto &id = static_cast<const IdentifierExpr &>(stmt);
+  // Every node is wrapped in braces and tagged with its kind.
+  bool visit(const Stmt &stmt) {
+    out << indent << "{\n";
+    out << indent << "  \"Statement\": \"" << NodeTypeToString(stmt.kind)
+        << "\",\n";
+    ConstASTVisitor<ASTPrinter>::visit(stmt);
+    out << "\n" << indent << "}";
+    flushText();
+    return true;
+  }
+
+  bool visitIdentifier(const IdentifierExpr &id) {
     out << indent << "  \"Symbol\": \"" << id.symbol << "\"";
-    break;
+    return true;
   }
-  case NodeType::NumericLiteral: {
-    const auto &numLit = static_cast<const NumericLiteral &>(stmt);
+
+  bool visitNumericLiteral(const NumericLiteral &numLit) {
     out << indent << "  \"Value\": " << numLit.value;
-    break;
+    return true;
   }
-  case NodeType::StrLiteral: {
-    const auto &strLit = static_cast<const StrLiteral &>(stmt);
+
+  bool visitFloatLiteral(const FloatLiteral &floatLit) {
+    out << indent << "  \"Value\": " << floatLit.value;
+    return true;
+  }
+
+  bool visitStrLiteral(const StrLiteral &strLit) {
     out << indent << "  \"Value\": \"" << strLit.value << "\"";
-    break;
+    return true;
   }
-  case NodeType::BinaryExpr: {
-    const auto &binaryExpr = static_cast<const BinaryExpr &>(stmt);
-    out << indent << "  \"BinaryOperator\": \""
-              << binaryExpr.binaryOperator << "\",\n";
-    out << indent << "  \"Left\": ";
-    printStatement(*binaryExpr.left, indent + "    ");
-    out << ",\n";
+
+  bool visitNullLiteral(const NullLiteral &nullNode) {
+    out << indent << "  \"Value\": \"" << nullNode.value << "\"";
+    return true;
+  }
+
+  bool visitError(const ErrorStmt &error) {
+    out << indent << "  \"Message\": \"" << error.message << "\"";
+    return true;
+  }
+
+  bool visitBinaryExpr(const BinaryExpr &binaryExpr) {
+    out << indent << "  \"BinaryOperator\": \"" << binaryExpr.binaryOperator
+        << "\",\n";
+    printOperands(*binaryExpr.left, *binaryExpr.right);
+    return true;
+  }
+
+  bool visitLogicalExpr(const LogicalExpr &logicalExpr) {
+    out << indent << "  \"LogicalOperator\": \""
+        << logicalExpr.logicalOperator << "\",\n";
+    printOperands(*logicalExpr.left, *logicalExpr.right);
+    return true;
+  }
+
+  bool visitUnaryExpr(const UnaryExpr &unaryExpr) {
+    out << indent << "  \"Operator\": \"" << unaryExpr.op << "\",\n";
     out << indent << "  \"Right\": ";
-    printStatement(*binaryExpr.right, indent + "    ");
-    break;
+    printChild(*unaryExpr.right);
+    return true;
   }
-  case NodeType::VarDeclaration: {
-    const auto &varDecl = static_cast<const VarDeclaration &>(stmt);
-    out << indent
-              << "  \"Constant\": " << (varDecl.constant ? "true" : "false")
-              << ",\n";
-    out << indent << "  \"Identifier\": \"" << varDecl.identifier
-              << "\",\n";
+
+  bool visitVarDeclaration(const VarDeclaration &varDecl) {
+    out << indent << "  \"Constant\": " << (varDecl.constant ? "true" : "false")
+        << ",\n";
+    out << indent << "  \"Identifier\": \"" << varDecl.identifier << "\",\n";
     out << indent << "  \"Value\": ";
-    if (varDecl.value) {
-      printStatement(*varDecl.value, indent + "    ");
-    } else {
-      out << "null";
-    }
-    break;
+    printOptionalChild(varDecl.value.get());
+    return true;
   }
-  case NodeType::CallExpr: {
-    const auto &callExpr = static_cast<const CallExpr &>(stmt);
+
+  bool visitCallExpr(const CallExpr &callExpr) {
     out << indent << "  \"Caller\": ";
-    printStatement(*callExpr.caller, indent + "    ");
+    printChild(*callExpr.caller);
     out << ",\n";
     out << indent << "  \"Arguments\": [\n";
-    for (const auto &arg : callExpr.args) {
-      printStatement(*arg, indent + "    ");
-      if (&arg != &callExpr.args.back()) {
-        out << ",";
-      }
-      out << "\n";
-    }
+    printList(callExpr.args);
     out << indent << "  ]";
-    break;
+    return true;
   }
-  case NodeType::FunctionDeclaration: {
-    const auto &funcDecl = static_cast<const FunctionDeclaration &>(stmt);
+
+  bool visitFunctionDeclaration(const FunctionDeclaration &funcDecl) {
     out << indent << "  \"Name\": \"" << funcDecl.name << "\",\n";
     out << indent << "  \"Parameters\": [\n";
     for (const auto &param : funcDecl.parameters) {
@@ -100,129 +139,191 @@ void printStatement(const Stmt &stmt, const string &indent) {
     }
     out << indent << "  ],\n";
     out << indent << "  \"Body\": [\n";
-    for (const auto &bodyStmt : funcDecl.body) {
-      printStatement(*bodyStmt, indent + "    ");
-      if (&bodyStmt != &funcDecl.body.back()) {
-        out << ",";
-      }
-      out << "\n";
-    }
+    printList(funcDecl.body);
     out << indent << "  ]";
-    break;
+    return true;
   }
-  case NodeType::IfStatement: {
-    const auto &ifStmt = static_cast<const IfStatement &>(stmt);
+
+  bool visitIfStatement(const IfStatement &ifStmt) {
     out << indent << "  \"Condition\": ";
-    printStatement(*ifStmt.condition, indent + "    ");
+    printChild(*ifStmt.condition);
     out << ",\n";
     out << indent << "  \"IfBody\": [\n";
-    for (const auto &ifBodyStmt : ifStmt.ifBody) {
-      printStatement(*ifBodyStmt, indent + "    ");
-      if (&ifBodyStmt != &ifStmt.ifBody.back()) {
-        out << ",";
-      }
-      out << "\n";
-    }
+    printList(ifStmt.ifBody);
     out << indent << "  ],\n";
     out << indent << "  \"ElseBody\": [\n";
-    for (const auto &elseBodyStmt : ifStmt.elseBody) {
-      printStatement(*elseBodyStmt, indent + "    ");
-      if (&elseBodyStmt != &ifStmt.elseBody.back()) {
-        out << ",";
-      }
-      out << "\n";
-    }
+    printList(ifStmt.elseBody);
     out << indent << "  ]";
-    break;
+    return true;
   }
-  case NodeType::WhileLoop: {
-    const auto &whileLoop = static_cast<const WhileLoop &>(stmt);
+
+  bool visitWhileLoop(const WhileLoop &whileLoop) {
+    if (whileLoop.parallel) {
+      out << indent << "  \"Parallel\": true,\n";
+    }
     out << indent << "  \"Condition\": ";
-    printStatement(*whileLoop.condition, indent + "    ");
+    printChild(*whileLoop.condition);
     out << ",\n";
     out << indent << "  \"LoopBody\": [\n";
-    for (const auto &loopBodyStmt : whileLoop.loopBody) {
-      printStatement(*loopBodyStmt, indent + "    ");
-      if (&loopBodyStmt != &whileLoop.loopBody.back()) {
-        out << ",";
-      }
-      out << "\n";
-    }
+    printList(whileLoop.loopBody);
     out << indent << "  ]";
-    break;
+    return true;
   }
-  case NodeType::StructDeclaration: {
-    const StructDeclaration &structDecl =
-        static_cast<const StructDeclaration &>(stmt);
-    out << indent << "  \"StructName\": \"" << structDecl.structName
-              << "\"";
-    for (const auto &stmt : structDecl.structBody) {
-      printStatement(*stmt, indent + "  ");
+
+  bool visitStructDeclaration(const StructDeclaration &structDecl) {
+    out << indent << "  \"StructName\": \"" << structDecl.structName << "\"";
+    for (const auto &field : structDecl.structBody) {
+      printChild(*field, 2);
     }
-    break;
+    return true;
   }
-  case NodeType::MemberAccessExpr: {
-    const auto &memberAccessExpr = static_cast<const MemberAccessExpr &>(stmt);
+
+  bool visitMemberAccessExpr(const MemberAccessExpr &memberAccessExpr) {
     out << indent << "  \"Object\": ";
-    printStatement(*memberAccessExpr.object, indent + "    ");
+    printChild(*memberAccessExpr.object);
     out << ",\n";
     out << indent << "  \"MemberName\": \"" << memberAccessExpr.memberName
-              << "\"";
-    break;
+        << "\"";
+    return true;
   }
-  case NodeType::LogicalExpr: {
-	const auto &logicalExpr = static_cast<const LogicalExpr &>(stmt);
-	out << indent << "  \"LogicalOperator\": \"" << logicalExpr.logicalOperator << "\",\n";
-	out << indent << "  \"Left\": ";
-	printStatement(*logicalExpr.left, indent + "    ");
-	out << ",\n";
-	out << indent << "  \"Right\": ";
-	printStatement(*logicalExpr.right, indent + "    ");
-	break;
+
+  bool visitArrayLiteral(const ArrayLiteral &arrayLiteral) {
+    out << indent << "  \"Elements\": [\n";
+    printList(arrayLiteral.elements);
+    out << indent << "  ]";
+    return true;
+  }
+
+  bool visitIndexExpr(const IndexExpr &indexExpr) {
+    out << indent << "  \"Object\": ";
+    printChild(*indexExpr.object);
+    out << ",\n";
+    out << indent << "  \"Index\": ";
+    printChild(*indexExpr.index);
+    return true;
   }
-  case NodeType::ReturnStatement: {
-    const auto &returnStmt = static_cast<const ReturnStatement &>(stmt);
+
+  bool visitReturnStatement(const ReturnStatement &returnStmt) {
     out << indent << "  \"ReturnValue\": ";
-    printStatement(*returnStmt.returnValue, indent + "    ");
-    break;
+    printOptionalChild(returnStmt.returnValue.get());
+    return true;
   }
-  case NodeType::AssignmentExpr: {
-    const auto &assignmentExpr = static_cast<const AssignmentExpr &>(stmt);
+
+  bool visitAssignmentExpr(const AssignmentExpr &assignmentExpr) {
     out << indent << "  \"Assignee\": ";
-    printStatement(*assignmentExpr.assigne, indent + "    ");
+    printChild(*assignmentExpr.assigne);
     out << ",\n";
     out << indent << "  \"Value\": ";
-    printStatement(*assignmentExpr.value, indent + "    ");
-    break;
+    printChild(*assignmentExpr.value);
+    return true;
   }
-  case NodeType::Program: {
-    const auto &program = static_cast<const Program &>(stmt);
+
+  bool visitProgram(const Program &program) {
     out << indent << "  \"Body\": [\n";
-    for (const auto &bodyStmt : program.body) {
-      printStatement(*bodyStmt, indent + "    ");
-      if (&bodyStmt != &program.body.back()) {
-        out << ",";
-      }
-      out << "\n";
-    }
+    printList(program.body);
     out << indent << "  ]";
-    break;
+    return true;
   }
-  case NodeType::Null: {
-    const auto &nullNode = static_cast<const NullLiteral &>(stmt);
-    out << indent << "  \"Value\": \"" << nullNode.value << "\"";
-    break;
+
+private:
+  // Either a node to print `columns` past the base indentation, or literal
+  // `text` when node is null. Queued text keeps only the offsets where its
+  // indentation goes, so a task's size does not grow with its depth.
+  struct Task {
+    const Stmt *node;
+    size_t columns;
+    string text;
+    vector<size_t> marks;
+  };
+
+  // Written as `out << indent`: records where the current node's
+  // indentation goes instead of writing it.
+  class Indent {
+  public:
+    vector<size_t> &marks;
+
+    friend ostream &operator<<(ostream &os, const Indent &indent) {
+      indent.marks.push_back(static_cast<size_t>(os.tellp()));
+      return os;
+    }
+  };
+
+  ostream &sink;
+  const string base;
+  // Output of the node being expanded that may still have to wait for one
+  // of its children, and the offsets in it of its indentation.
+  ostringstream out;
+  vector<size_t> marks;
+  Indent indent;
+  // Indentation of the node being expanded, past the base.
+  size_t columns = 0;
+  vector<Task> stack;
+  // Tasks produced by the node being expanded, in output order.
+  vector<Task> expansion;
+
+  void writeText(const string &text, const vector<size_t> &marks,
+                 size_t columns) {
+    size_t written = 0;
+    for (size_t mark : marks) {
+      sink.write(text.data() + written, mark - written);
+      sink << base;
+      fill_n(ostreambuf_iterator<char>(sink), columns, ' ');
+      written = mark;
+    }
+    sink.write(text.data() + written, text.size() - written);
   }
-  case NodeType::UnaryExpr: {
-    const auto &unaryExpr = static_cast<const UnaryExpr &>(stmt);
-    out << indent << "  \"Operator\": \"" << unaryExpr.op << "\",\n";
+
+  // Text written before a node's first child can go straight out; after
+  // that it has to be queued behind the child.
+  void flushText() {
+    if (out.tellp() == 0) {
+      return;
+    }
+    if (expansion.empty()) {
+      writeText(out.str(), marks, columns);
+    } else {
+      expansion.push_back({nullptr, columns, out.str(), move(marks)});
+    }
+    out.str("");
+    marks.clear();
+  }
+
+  void printChild(const Stmt &child, size_t extra = 4) {
+    flushText();
+    expansion.push_back({&child, columns + extra, "", {}});
+  }
+
+  void printOptionalChild(const Stmt *child) {
+    if (child) {
+      printChild(*child);
+    } else {
+      out << "null";
+    }
+  }
+
+  void printOperands(const Stmt &left, const Stmt &right) {
+    out << indent << "  \"Left\": ";
+    printChild(left);
+    out << ",\n";
     out << indent << "  \"Right\": ";
-    printStatement(*unaryExpr.right, indent + "    ");
-    break;
+    printChild(right);
   }
+
+  template <typename List> void printList(const List &stmts) {
+    for (auto it = stmts.begin(); it != stmts.end(); ++it) {
+      printChild(**it);
+      if (next(it) != stmts.end()) {
+        out << ",";
+      }
+      out << "\n";
+    }
   }
+};
+
+} // namespace
 
-  out << "\n" << indent << "}";
+void printStatement(const Stmt &stmt, ostream &out, const string &indent) {
+  ASTPrinter(out, indent).print(stmt);
 }
 
 string NodeTypeToString(NodeType type) {
@@ -231,6 +332,8 @@ string NodeTypeToString(NodeType type) {
     return "Program";
   case NodeType::NumericLiteral:
     return "NumericLiteral";
+  case NodeType::FloatLiteral:
+    return "FloatLiteral";
   case NodeType::StrLiteral:
     return "StrLiteral";
   case NodeType::Identifier:
@@ -247,6 +350,10 @@ string NodeTypeToString(NodeType type) {
     return "MemberAccessExpr";
   case NodeType::LogicalExpr:
     return "LogicalExpr";
+  case NodeType::ArrayLiteral:
+    return "ArrayLiteral";
+  case NodeType::IndexExpr:
+    return "IndexExpr";
   case NodeType::FunctionDeclaration:
     return "FunctionDeclaration";
   case NodeType::IfStatement:
@@ -259,6 +366,8 @@ string NodeTypeToString(NodeType type) {
     return "ReturnStatement";
   case NodeType::Null:
     return "Null";
+  case NodeType::Error:
+    return "Error";
   default:
     return "Unknown";
   }
@@ -0,0 +1,277 @@
+#include "FlatAST.h"
+#include <sstream>
+
+// Same output as printProgram, produced from the flat representation.
+// Indentation is tracked as a width and written from one shared run of
+// spaces instead of building a new string per node.
+
+namespace {
+
+class Indent {
+public:
+  Indent(const string &base) : base(base), width(0) {}
+  Indent(const Indent &parent, size_t extra)
+      : base(parent.base), width(parent.width + extra) {}
+
+  const string &base;
+  size_t width;
+};
+
+ostream &operator<<(ostream &out, const Indent &indent) {
+  static const string spaces(256, ' ');
+  out << indent.base;
+  size_t left = indent.width;
+  while (left > 0) {
+    size_t chunk = min(left, spaces.size());
+    out.write(spaces.data(), chunk);
+    left -= chunk;
+  }
+  return out;
+}
+
+// Like the pointer-tree printer, children are queued rather than printed
+// recursively, so nesting depth is bounded by memory, not the native stack.
+class FlatPrinter {
+public:
+  FlatPrinter(const FlatAST &ast, ostream &sink, const Indent &indent)
+      : ast(ast), sink(sink), rootIndent(indent) {}
+
+  void print(NodeId root);
+
+private:
+  // Either a node to print at `indent`, or literal `text` when `isNode` is
+  // false.
+  class Task {
+  public:
+    bool isNode;
+    NodeId id;
+    Indent indent;
+    string text;
+  };
+
+  const FlatAST &ast;
+  ostream &sink;
+  Indent rootIndent;
+  // Output of the node being expanded that may have to wait for a child.
+  ostringstream out;
+  vector<Task> stack;
+  // Tasks produced by the node being expanded, in output order.
+  vector<Task> expansion;
+
+  void expand(NodeId id, const Indent &indent);
+  void flushText();
+  void printChild(NodeId id, const Indent &indent) {
+    flushText();
+    expansion.push_back({true, id, indent, ""});
+  }
+  void printList(const NodeId *first, const NodeId *last,
+                 const Indent &indent) {
+    for (const NodeId *it = first; it != last; ++it) {
+      printChild(*it, indent);
+      if (it + 1 != last) {
+        out << ",";
+      }
+      out << "\n";
+    }
+  }
+};
+
+void FlatPrinter::print(NodeId root) {
+  stack.push_back({true, root, rootIndent, ""});
+  while (!stack.empty()) {
+    Task task = move(stack.back());
+    stack.pop_back();
+    if (!task.isNode) {
+      sink << task.text;
+      continue;
+    }
+    expand(task.id, task.indent);
+    for (auto it = expansion.rbegin(); it != expansion.rend(); ++it) {
+      stack.push_back(move(*it));
+    }
+    expansion.clear();
+  }
+}
+
+// Text written before a node's first child goes straight out; after that it
+// is queued behind the child.
+void FlatPrinter::flushText() {
+  if (out.tellp() == 0) {
+    return;
+  }
+  if (expansion.empty()) {
+    sink << out.str();
+  } else {
+    expansion.push_back({false, 0, rootIndent, out.str()});
+  }
+  out.str("");
+}
+
+void FlatPrinter::expand(NodeId id, const Indent &indent) {
+  ChildRange kids = ast.childrenOf(id);
+
+  out << indent << "{\n";
+  out << indent << "  \"Statement\": \"" << NodeTypeToString(ast.kind(id))
+      << "\",\n";
+
+  switch (ast.kind(id)) {
+  case NodeType::Identifier:
+    out << indent << "  \"Symbol\": \"" << ast.text(id) << "\"";
+    break;
+  case NodeType::NumericLiteral:
+    out << indent << "  \"Value\": " << ast.integer(id);
+    break;
+  case NodeType::FloatLiteral:
+    out << indent << "  \"Value\": " << ast.number(id);
+    break;
+  case NodeType::StrLiteral:
+  case NodeType::Null:
+    out << indent << "  \"Value\": \"" << ast.text(id) << "\"";
+    break;
+  case NodeType::Error:
+    out << indent << "  \"Message\": \"" << ast.text(id) << "\"";
+    break;
+  case NodeType::BinaryExpr:
+  case NodeType::LogicalExpr:
+    out << indent
+        << (ast.kind(id) == NodeType::BinaryExpr ? "  \"BinaryOperator\": \""
+                                                 : "  \"LogicalOperator\": \"")
+        << ast.text(id) << "\",\n";
+    out << indent << "  \"Left\": ";
+    printChild(kids[0], Indent(indent, 4));
+    out << ",\n";
+    out << indent << "  \"Right\": ";
+    printChild(kids[1], Indent(indent, 4));
+    break;
+  case NodeType::VarDeclaration:
+    out << indent << "  \"Constant\": " << (ast.extra[id] ? "true" : "false")
+        << ",\n";
+    out << indent << "  \"Identifier\": \"" << ast.text(id) << "\",\n";
+    out << indent << "  \"Value\": ";
+    if (kids.size() > 0) {
+      printChild(kids[0], Indent(indent, 4));
+    } else {
+      out << "null";
+    }
+    break;
+  case NodeType::CallExpr:
+    out << indent << "  \"Caller\": ";
+    printChild(kids[0], Indent(indent, 4));
+    out << ",\n";
+    out << indent << "  \"Arguments\": [\n";
+    printList(kids.begin() + 1, kids.end(), Indent(indent, 4));
+    out << indent << "  ]";
+    break;
+  case NodeType::FunctionDeclaration: {
+    const NodeId *bodyStart = kids.begin() + ast.extra[id];
+    out << indent << "  \"Name\": \"" << ast.text(id) << "\",\n";
+    out << indent << "  \"Parameters\": [\n";
+    for (const NodeId *it = kids.begin(); it != bodyStart; ++it) {
+      out << indent << "    \"" << ast.text(*it) << "\"";
+      if (it + 1 != bodyStart) {
+        out << ",";
+      }
+      out << "\n";
+    }
+    out << indent << "  ],\n";
+    out << indent << "  \"Body\": [\n";
+    printList(bodyStart, kids.end(), Indent(indent, 4));
+    out << indent << "  ]";
+    break;
+  }
+  case NodeType::IfStatement: {
+    const NodeId *elseStart = kids.begin() + 1 + ast.extra[id];
+    out << indent << "  \"Condition\": ";
+    printChild(kids[0], Indent(indent, 4));
+    out << ",\n";
+    out << indent << "  \"IfBody\": [\n";
+    printList(kids.begin() + 1, elseStart, Indent(indent, 4));
+    out << indent << "  ],\n";
+    out << indent << "  \"ElseBody\": [\n";
+    printList(elseStart, kids.end(), Indent(indent, 4));
+    out << indent << "  ]";
+    break;
+  }
+  case NodeType::WhileLoop:
+    if (ast.extra[id]) {
+      out << indent << "  \"Parallel\": true,\n";
+    }
+    out << indent << "  \"Condition\": ";
+    printChild(kids[0], Indent(indent, 4));
+    out << ",\n";
+    out << indent << "  \"LoopBody\": [\n";
+    printList(kids.begin() + 1, kids.end(), Indent(indent, 4));
+    out << indent << "  ]";
+    break;
+  case NodeType::StructDeclaration:
+    out << indent << "  \"StructName\": \"" << ast.text(id) << "\"";
+    for (NodeId field : kids) {
+      printChild(field, Indent(indent, 2));
+    }
+    break;
+  case NodeType::MemberAccessExpr:
+    out << indent << "  \"Object\": ";
+    printChild(kids[0], Indent(indent, 4));
+    out << ",\n";
+    out << indent << "  \"MemberName\": \"" << ast.text(id) << "\"";
+    break;
+  case NodeType::ArrayLiteral:
+    out << indent << "  \"Elements\": [\n";
+    printList(kids.begin(), kids.end(), Indent(indent, 4));
+    out << indent << "  ]";
+    break;
+  case NodeType::IndexExpr:
+    out << indent << "  \"Object\": ";
+    printChild(kids[0], Indent(indent, 4));
+    out << ",\n";
+    out << indent << "  \"Index\": ";
+    printChild(kids[1], Indent(indent, 4));
+    break;
+  case NodeType::ReturnStatement:
+    out << indent << "  \"ReturnValue\": ";
+    if (kids.size() > 0) {
+      printChild(kids[0], Indent(indent, 4));
+    } else {
+      out << "null";
+    }
+    break;
+  case NodeType::AssignmentExpr:
+    out << indent << "  \"Assignee\": ";
+    printChild(kids[0], Indent(indent, 4));
+    out << ",\n";
+    out << indent << "  \"Value\": ";
+    printChild(kids[1], Indent(indent, 4));
+    break;
+  case NodeType::Program:
+    out << indent << "  \"Body\": [\n";
+    printList(kids.begin(), kids.end(), Indent(indent, 4));
+    out << indent << "  ]";
+    break;
+  case NodeType::UnaryExpr:
+    out << indent << "  \"Operator\": \"" << ast.text(id) << "\",\n";
+    out << indent << "  \"Right\": ";
+    printChild(kids[0], Indent(indent, 4));
+    break;
+  }
+
+  out << "\n" << indent << "}";
+  flushText();
+}
+
+} // namespace
+
+void printFlatProgram(const FlatAST &ast, ostream &out, const string &indent) {
+  out << '{' << endl;
+  out << indent << " \"Program\": [\n";
+  ChildRange body = ast.childrenOf(FlatAST::root);
+  FlatPrinter printer(ast, out, Indent(Indent(indent), 2));
+  for (const NodeId *it = body.begin(); it != body.end(); ++it) {
+    printer.print(*it);
+    if (it + 1 != body.end()) {
+      out << ',';
+    }
+    out << '\n';
+  }
+  out << indent << ']';
+  out << "\n}\n";
+}
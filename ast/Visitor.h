@@ -0,0 +1,303 @@
+#ifndef VISITOR_H
+#define VISITOR_H
+
+#include "AST.h"
+#include <type_traits>
+
+// Calls `f` on each direct child of `stmt` in source order. `StmtT` is Stmt
+// or const Stmt, and `f` receives children with the same constness. Stops
+// and returns false as soon as `f` does.
+template <typename StmtT, typename F> bool forEachChild(StmtT &stmt, F &&f) {
+  constexpr bool isConst = is_const<StmtT>::value;
+  auto each = [&f](auto &nodes) {
+    for (auto &node : nodes) {
+      if (!f(*node)) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  switch (stmt.kind) {
+  case NodeType::Program:
+    return each(static_cast<conditional_t<isConst, const Program, Program> &>(
+                    stmt)
+                    .body);
+  case NodeType::VarDeclaration: {
+    auto &node = static_cast<
+        conditional_t<isConst, const VarDeclaration, VarDeclaration> &>(stmt);
+    return !node.value || f(*node.value);
+  }
+  case NodeType::FunctionDeclaration:
+    return each(static_cast<conditional_t<isConst, const FunctionDeclaration,
+                                          FunctionDeclaration> &>(stmt)
+                    .body);
+  case NodeType::StructDeclaration:
+    return each(static_cast<conditional_t<isConst, const StructDeclaration,
+                                          StructDeclaration> &>(stmt)
+                    .structBody);
+  case NodeType::IfStatement: {
+    auto &node =
+        static_cast<conditional_t<isConst, const IfStatement, IfStatement> &>(
+            stmt);
+    return f(*node.condition) && each(node.ifBody) && each(node.elseBody);
+  }
+  case NodeType::WhileLoop: {
+    auto &node =
+        static_cast<conditional_t<isConst, const WhileLoop, WhileLoop> &>(stmt);
+    return f(*node.condition) && each(node.loopBody);
+  }
+  case NodeType::ReturnStatement: {
+    auto &node = static_cast<
+        conditional_t<isConst, const ReturnStatement, ReturnStatement> &>(stmt);
+    return !node.returnValue || f(*node.returnValue);
+  }
+  case NodeType::AssignmentExpr: {
+    auto &node = static_cast<
+        conditional_t<isConst, const AssignmentExpr, AssignmentExpr> &>(stmt);
+    return f(*node.assigne) && f(*node.value);
+  }
+  case NodeType::BinaryExpr: {
+    auto &node =
+        static_cast<conditional_t<isConst, const BinaryExpr, BinaryExpr> &>(
+            stmt);
+    return f(*node.left) && f(*node.right);
+  }
+  case NodeType::LogicalExpr: {
+    auto &node =
+        static_cast<conditional_t<isConst, const LogicalExpr, LogicalExpr> &>(
+            stmt);
+    return f(*node.left) && f(*node.right);
+  }
+  case NodeType::UnaryExpr:
+    return f(*static_cast<conditional_t<isConst, const UnaryExpr, UnaryExpr> &>(
+                  stmt)
+                  .right);
+  case NodeType::CallExpr: {
+    auto &node =
+        static_cast<conditional_t<isConst, const CallExpr, CallExpr> &>(stmt);
+    return f(*node.caller) && each(node.args);
+  }
+  case NodeType::MemberAccessExpr:
+    return f(*static_cast<conditional_t<isConst, const MemberAccessExpr,
+                                        MemberAccessExpr> &>(stmt)
+                  .object);
+  case NodeType::ArrayLiteral:
+    return each(
+        static_cast<conditional_t<isConst, const ArrayLiteral, ArrayLiteral> &>(
+            stmt)
+            .elements);
+  case NodeType::IndexExpr: {
+    auto &node =
+        static_cast<conditional_t<isConst, const IndexExpr, IndexExpr> &>(stmt);
+    return f(*node.object) && f(*node.index);
+  }
+  default:
+    return true;
+  }
+}
+
+// Calls `f` on the owning pointer of each direct child of `stmt` in source
+// order, so a pass can replace children in place. A pointer is either a
+// unique_ptr<Expr> or a unique_ptr<Stmt>, so `f` is generic; empty ones are
+// skipped. FunctionDeclaration bodies hold raw pointers and are left out:
+// walk them with forEachChild.
+template <typename F> void forEachChildSlot(Stmt &stmt, F &&f) {
+  auto one = [&f](auto &slot) {
+    if (slot) {
+      f(slot);
+    }
+  };
+  auto each = [&one](auto &slots) {
+    for (auto &slot : slots) {
+      one(slot);
+    }
+  };
+
+  switch (stmt.kind) {
+  case NodeType::Program:
+    each(static_cast<Program &>(stmt).body);
+    break;
+  case NodeType::VarDeclaration:
+    one(static_cast<VarDeclaration &>(stmt).value);
+    break;
+  case NodeType::StructDeclaration:
+    each(static_cast<StructDeclaration &>(stmt).structBody);
+    break;
+  case NodeType::IfStatement: {
+    auto &node = static_cast<IfStatement &>(stmt);
+    one(node.condition);
+    each(node.ifBody);
+    each(node.elseBody);
+    break;
+  }
+  case NodeType::WhileLoop: {
+    auto &node = static_cast<WhileLoop &>(stmt);
+    one(node.condition);
+    each(node.loopBody);
+    break;
+  }
+  case NodeType::ReturnStatement:
+    one(static_cast<ReturnStatement &>(stmt).returnValue);
+    break;
+  case NodeType::AssignmentExpr: {
+    auto &node = static_cast<AssignmentExpr &>(stmt);
+    one(node.assigne);
+    one(node.value);
+    break;
+  }
+  case NodeType::BinaryExpr: {
+    auto &node = static_cast<BinaryExpr &>(stmt);
+    one(node.left);
+    one(node.right);
+    break;
+  }
+  case NodeType::LogicalExpr: {
+    auto &node = static_cast<LogicalExpr &>(stmt);
+    one(node.left);
+    one(node.right);
+    break;
+  }
+  case NodeType::UnaryExpr:
+    one(static_cast<UnaryExpr &>(stmt).right);
+    break;
+  case NodeType::CallExpr: {
+    auto &node = static_cast<CallExpr &>(stmt);
+    one(node.caller);
+    each(node.args);
+    break;
+  }
+  case NodeType::MemberAccessExpr:
+    one(static_cast<MemberAccessExpr &>(stmt).object);
+    break;
+  case NodeType::ArrayLiteral:
+    each(static_cast<ArrayLiteral &>(stmt).elements);
+    break;
+  case NodeType::IndexExpr: {
+    auto &node = static_cast<IndexExpr &>(stmt);
+    one(node.object);
+    one(node.index);
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+// Compile-time visitor over the pointer AST. `Derived` hides the visitX
+// methods it cares about; the defaults visit the node's children. Every
+// method returns false to stop the whole traversal. Dispatch is a switch on
+// `kind` plus static calls into `Derived`, so there is no virtual call per
+// node and the compiler can inline whole walks.
+//
+// A `Derived::visit` of its own runs around every node, which is where
+// pre/post actions shared by all kinds go; call ASTVisitor::visit from it.
+template <typename Derived, bool IsConst = false> class ASTVisitor {
+public:
+  template <typename T> using Ref = conditional_t<IsConst, const T &, T &>;
+
+  bool visit(Ref<Stmt> stmt) {
+    switch (stmt.kind) {
+    case NodeType::Program:
+      return derived().visitProgram(static_cast<Ref<Program>>(stmt));
+    case NodeType::VarDeclaration:
+      return derived().visitVarDeclaration(
+          static_cast<Ref<VarDeclaration>>(stmt));
+    case NodeType::FunctionDeclaration:
+      return derived().visitFunctionDeclaration(
+          static_cast<Ref<FunctionDeclaration>>(stmt));
+    case NodeType::StructDeclaration:
+      return derived().visitStructDeclaration(
+          static_cast<Ref<StructDeclaration>>(stmt));
+    case NodeType::IfStatement:
+      return derived().visitIfStatement(static_cast<Ref<IfStatement>>(stmt));
+    case NodeType::WhileLoop:
+      return derived().visitWhileLoop(static_cast<Ref<WhileLoop>>(stmt));
+    case NodeType::ReturnStatement:
+      return derived().visitReturnStatement(
+          static_cast<Ref<ReturnStatement>>(stmt));
+    case NodeType::Error:
+      return derived().visitError(static_cast<Ref<ErrorStmt>>(stmt));
+    case NodeType::AssignmentExpr:
+      return derived().visitAssignmentExpr(
+          static_cast<Ref<AssignmentExpr>>(stmt));
+    case NodeType::NumericLiteral:
+      return derived().visitNumericLiteral(
+          static_cast<Ref<NumericLiteral>>(stmt));
+    case NodeType::FloatLiteral:
+      // `class` because TokenType::FloatLiteral hides the node type wherever
+      // Lexer.h is included as well.
+      return derived().visitFloatLiteral(
+          static_cast<Ref<class FloatLiteral>>(stmt));
+    case NodeType::StrLiteral:
+      return derived().visitStrLiteral(static_cast<Ref<StrLiteral>>(stmt));
+    case NodeType::Null:
+      return derived().visitNullLiteral(static_cast<Ref<NullLiteral>>(stmt));
+    case NodeType::Identifier:
+      return derived().visitIdentifier(static_cast<Ref<IdentifierExpr>>(stmt));
+    case NodeType::BinaryExpr:
+      return derived().visitBinaryExpr(static_cast<Ref<BinaryExpr>>(stmt));
+    case NodeType::CallExpr:
+      return derived().visitCallExpr(static_cast<Ref<CallExpr>>(stmt));
+    case NodeType::MemberAccessExpr:
+      return derived().visitMemberAccessExpr(
+          static_cast<Ref<MemberAccessExpr>>(stmt));
+    case NodeType::UnaryExpr:
+      return derived().visitUnaryExpr(static_cast<Ref<UnaryExpr>>(stmt));
+    case NodeType::LogicalExpr:
+      return derived().visitLogicalExpr(static_cast<Ref<LogicalExpr>>(stmt));
+    case NodeType::ArrayLiteral:
+      return derived().visitArrayLiteral(static_cast<Ref<ArrayLiteral>>(stmt));
+    case NodeType::IndexExpr:
+      return derived().visitIndexExpr(static_cast<Ref<IndexExpr>>(stmt));
+    }
+    return true;
+  }
+
+  bool visitChildren(Ref<Stmt> stmt) {
+    return forEachChild(stmt, [this](Ref<Stmt> child) {
+      return derived().visit(child);
+    });
+  }
+
+  bool visitProgram(Ref<Program> node) { return visitChildren(node); }
+  bool visitVarDeclaration(Ref<VarDeclaration> node) {
+    return visitChildren(node);
+  }
+  bool visitFunctionDeclaration(Ref<FunctionDeclaration> node) {
+    return visitChildren(node);
+  }
+  bool visitStructDeclaration(Ref<StructDeclaration> node) {
+    return visitChildren(node);
+  }
+  bool visitIfStatement(Ref<IfStatement> node) { return visitChildren(node); }
+  bool visitWhileLoop(Ref<WhileLoop> node) { return visitChildren(node); }
+  bool visitReturnStatement(Ref<ReturnStatement> node) {
+    return visitChildren(node);
+  }
+  bool visitError(Ref<ErrorStmt>) { return true; }
+  bool visitAssignmentExpr(Ref<AssignmentExpr> node) {
+    return visitChildren(node);
+  }
+  bool visitNumericLiteral(Ref<NumericLiteral>) { return true; }
+  bool visitFloatLiteral(Ref<class FloatLiteral>) { return true; }
+  bool visitStrLiteral(Ref<StrLiteral>) { return true; }
+  bool visitNullLiteral(Ref<NullLiteral>) { return true; }
+  bool visitIdentifier(Ref<IdentifierExpr>) { return true; }
+  bool visitBinaryExpr(Ref<BinaryExpr> node) { return visitChildren(node); }
+  bool visitCallExpr(Ref<CallExpr> node) { return visitChildren(node); }
+  bool visitMemberAccessExpr(Ref<MemberAccessExpr> node) {
+    return visitChildren(node);
+  }
+  bool visitUnaryExpr(Ref<UnaryExpr> node) { return visitChildren(node); }
+  bool visitLogicalExpr(Ref<LogicalExpr> node) { return visitChildren(node); }
+  bool visitArrayLiteral(Ref<ArrayLiteral> node) { return visitChildren(node); }
+  bool visitIndexExpr(Ref<IndexExpr> node) { return visitChildren(node); }
+
+protected:
+  Derived &derived() { return static_cast<Derived &>(*this); }
+};
+
+template <typename Derived> using ConstASTVisitor = ASTVisitor<Derived, true>;
+
+#endif
@@ -0,0 +1,499 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+using namespace std;
+
+#include "../ast/AST.h"
+#include "../ast/FlatAST.h"
+#include "../compiler/Compiler.h"
+#include "../lexer/Lexer.h"
+#include "../parser/Parser.h"
+#include "../runtime/Interpreter.h"
+#include "ProgramGenerator.h"
+
+// Usage: bench [--scale N] [--reps N] [--filter NAME] [--out FILE]
+//              [--emit-corpus DIR]
+//        bench --help
+//
+// --emit-corpus saves each generated program in DIR, creating it if need
+// be, for the PGO training run.
+//
+// Results are written as tab separated rows in a fixed order, one row per
+// case and phase, so two runs can be compared with a plain diff. Front end
+// cases come first; runtime cases follow in a second table, one row per
+// case and interpreter configuration, with what the collector did during
+// the last run. A third table gives, for each case built around one loop,
+// what loop optimization did to it and the speedup over running it with
+// loop optimization off. A fourth runs each case built around a parallel
+// loop with 1, 2, 4, ... workers, up to one per hardware thread, and gives
+// the speedup over a single worker.
+
+struct BenchCase {
+  string name;
+  size_t size;
+  function<string(ProgramGenerator &, size_t)> generate;
+};
+
+// A program that is run, under each configuration in runConfigs().
+struct RunCase {
+  string name;
+  size_t size;
+  function<string(ProgramGenerator &, size_t)> generate;
+  // Whether the program is one hot loop, reported in the loop table.
+  bool loop = false;
+  // Whether the program is one parallel loop, reported in the scaling
+  // table.
+  bool parallel = false;
+};
+
+struct RunConfig {
+  string name;
+  bool frameAllocation;
+  bool inlining;
+  bool loopOptimization;
+  bool inlineCaches;
+  bool tailCalls;
+  bool profile;
+  bool quickening;
+};
+
+// One row of the loop table.
+struct LoopResult {
+  string name;
+  size_t size;
+  LoopSummary loops;
+  long long ns;
+  long long baselineNs;
+};
+
+struct BenchOptions {
+  size_t scale = 1;
+  size_t reps = 5;
+  string filter;
+  string outFile;
+  string corpusDir;
+};
+
+static vector<BenchCase> benchCases(size_t scale) {
+  return {
+      {"deep_if_else", 64 * scale,
+       [](ProgramGenerator &g, size_t n) { return g.deepIfElse(n); }},
+      {"long_while", 2000 * scale,
+       [](ProgramGenerator &g, size_t n) { return g.longWhile(n); }},
+      {"wide_struct", 2000 * scale,
+       [](ProgramGenerator &g, size_t n) { return g.wideStruct(n); }},
+      {"call_member_chains", 200 * scale,
+       [](ProgramGenerator &g, size_t n) { return g.callMemberChains(n); }},
+      {"literal_expression", 1000 * scale,
+       [](ProgramGenerator &g, size_t n) { return g.literalExpression(n); }},
+  };
+}
+
+static vector<RunCase> runCases(size_t scale) {
+  return {
+      {"struct_temporaries", 20000 * scale,
+       [](ProgramGenerator &g, size_t n) { return g.structTemporaries(n); }},
+      {"small_helpers", 20000 * scale,
+       [](ProgramGenerator &g, size_t n) { return g.smallHelpers(n); }},
+      // Work doubles with every step of n, so this one ignores the scale.
+      {"recursive_calls", 22,
+       [](ProgramGenerator &g, size_t n) { return g.recursiveCalls(n); }},
+      {"loop_invariants", 20000 * scale,
+       [](ProgramGenerator &g, size_t n) { return g.loopInvariants(n); },
+       true},
+      {"induction_products", 20000 * scale,
+       [](ProgramGenerator &g, size_t n) { return g.inductionProducts(n); },
+       true},
+      {"tail_recursion", 200 * scale,
+       [](ProgramGenerator &g, size_t n) { return g.tailRecursion(n); }},
+      {"polymorphic_fields", 20000 * scale,
+       [](ProgramGenerator &g, size_t n) { return g.polymorphicFields(n); }},
+      {"allocation_churn", 100000 * scale,
+       [](ProgramGenerator &g, size_t n) { return g.allocationChurn(n); }},
+      {"array_scan", 300 * scale,
+       [](ProgramGenerator &g, size_t n) { return g.arrayScan(n); }},
+      {"parallel_tasks", 40 * scale,
+       [](ProgramGenerator &g, size_t n) { return g.parallelTasks(n); },
+       false, true},
+      {"builtin_calls", 20000 * scale,
+       [](ProgramGenerator &g, size_t n) { return g.builtinCalls(n); }},
+  };
+}
+
+static vector<RunConfig> runConfigs() {
+  return {
+      {"default", true, true, true, true, true, false, true},
+      {"no_frame_alloc", false, true, true, true, true, false, true},
+      {"no_inline", true, false, true, true, true, false, true},
+      {"no_loop_opt", true, true, false, true, true, false, true},
+      {"no_inline_cache", true, true, true, false, true, false, true},
+      {"no_tail_calls", true, true, true, true, false, false, true},
+      {"profiled", true, true, true, true, true, true, true},
+      {"no_quicken", true, true, true, true, true, false, false},
+  };
+}
+
+static long long elapsedNs(const function<void()> &body) {
+  auto start = chrono::steady_clock::now();
+  body();
+  auto end = chrono::steady_clock::now();
+  return chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+}
+
+// Runs `body` `reps` times and returns the fastest run in nanoseconds.
+static long long bestOf(size_t reps, const function<void()> &body) {
+  long long best = -1;
+  for (size_t i = 0; i < reps; i++) {
+    long long ns = elapsedNs(body);
+    if (best < 0 || ns < best) {
+      best = ns;
+    }
+  }
+  return best;
+}
+
+// With --emit-corpus, saves a case's program as DIR/NAME.tl.
+static void writeCorpus(const BenchOptions &options, const string &name,
+                        const string &source) {
+  if (options.corpusDir.empty()) {
+    return;
+  }
+  string path = options.corpusDir + "/" + name + ".tl";
+  ofstream corpus(path);
+  if (!corpus.is_open()) {
+    cerr << "Error: Unable to write corpus file " << path << endl;
+    exit(1);
+  }
+  corpus << source;
+}
+
+static void printRow(ostream &out, const BenchCase &c, size_t bytes,
+                     size_t tokens, const string &phase, long long ns) {
+  double mbPerSec = ns > 0 ? (bytes * 1e3) / ns : 0.0;
+  out << c.name << '\t' << c.size << '\t' << bytes << '\t' << tokens << '\t'
+      << phase << '\t' << ns << '\t' << fixed << setprecision(2) << mbPerSec
+      << '\n';
+}
+
+static void runCase(ostream &out, const BenchCase &c,
+                    const BenchOptions &options) {
+  ProgramGenerator generator;
+  string source = c.generate(generator, c.size);
+
+  writeCorpus(options, c.name, source);
+
+  vector<Token> tokens;
+  long long lexNs = bestOf(options.reps, [&]() {
+    Lexer lex(source);
+    tokens = lex.takeTokens();
+  });
+
+  unique_ptr<Program> program;
+  long long parseNs = -1;
+  for (size_t i = 0; i < options.reps; i++) {
+    Parser parser;
+    long long ns = elapsedNs([&]() { program = parser.produceAST(tokens); });
+    if (parseNs < 0 || ns < parseNs) {
+      parseNs = ns;
+    }
+    if (i == 0 && !parser.getErrors().empty()) {
+      cerr << "Warning: " << c.name << " does not parse cleanly: "
+           << parser.getErrors()[0].what() << endl;
+    }
+  }
+
+  long long printNs = bestOf(options.reps, [&]() {
+    ostringstream printed;
+    printProgram(*program, printed, "      ");
+  });
+
+  FlatAST flat;
+  long long flattenNs =
+      bestOf(options.reps, [&]() { flat = flatten(*program); });
+
+  long long printFlatNs = bestOf(options.reps, [&]() {
+    ostringstream printed;
+    printFlatProgram(flat, printed, "      ");
+  });
+
+  long long foldFlatNs = -1;
+  for (size_t i = 0; i < options.reps; i++) {
+    FlatAST copy = flat;
+    long long ns = elapsedNs([&]() { foldConstants(copy); });
+    if (foldFlatNs < 0 || ns < foldFlatNs) {
+      foldFlatNs = ns;
+    }
+  }
+
+  printRow(out, c, source.size(), tokens.size(), "lex", lexNs);
+  printRow(out, c, source.size(), tokens.size(), "parse", parseNs);
+  printRow(out, c, source.size(), tokens.size(), "print", printNs);
+  printRow(out, c, source.size(), tokens.size(), "flatten", flattenNs);
+  printRow(out, c, source.size(), tokens.size(), "print_flat", printFlatNs);
+  printRow(out, c, source.size(), tokens.size(), "fold_flat", foldFlatNs);
+}
+
+static void runProgram(ostream &out, const RunCase &c,
+                       const BenchOptions &options,
+                       vector<LoopResult> &loopResults) {
+  ProgramGenerator generator;
+  string source = c.generate(generator, c.size);
+  writeCorpus(options, c.name, source);
+
+  string expected;
+  LoopResult loopResult{c.name, c.size, LoopSummary(), -1, -1};
+  for (const RunConfig &config : runConfigs()) {
+    CompilerContext context;
+    context.setBuiltins(Interpreter::builtinNames());
+    context.setFrameAllocation(config.frameAllocation);
+    context.setInlining(config.inlining);
+    context.setLoopOptimization(config.loopOptimization);
+    context.setTailCalls(config.tailCalls);
+    CompileResult result = context.compile(source);
+    if (result.ok()) {
+      context.analyze(result);
+    }
+    if (!result.ok()) {
+      cerr << "Warning: " << c.name << " does not compile cleanly: "
+           << result.diagnostics[0].message << endl;
+      return;
+    }
+
+    string printed;
+    RuntimeStats stats;
+    long long ns = -1;
+    for (size_t i = 0; i < options.reps; i++) {
+      ostringstream output;
+      Profiler profiler;
+      InterpreterOptions interpreterOptions;
+      interpreterOptions.inlineCaches = config.inlineCaches;
+      interpreterOptions.quickening = config.quickening;
+      if (config.profile) {
+        interpreterOptions.profiler = &profiler;
+      }
+      Interpreter interpreter(result, output, interpreterOptions);
+      long long runNs = elapsedNs([&]() {
+        try {
+          interpreter.run();
+        } catch (const RuntimeError &e) {
+          output << "runtime error: " << e.what() << '\n';
+        }
+      });
+      if (ns < 0 || runNs < ns) {
+        ns = runNs;
+      }
+      stats = interpreter.stats();
+      printed = output.str();
+    }
+    if (expected.empty()) {
+      expected = printed;
+    } else if (printed != expected) {
+      cerr << "Warning: " << c.name << " prints different output under "
+           << config.name << endl;
+    }
+
+    out << c.name << '\t' << c.size << '\t' << source.size() << '\t'
+        << config.name << '\t' << ns << '\t' << stats.calls << '\t'
+        << stats.heap.allocations << '\t' << stats.heap.bytesAllocated
+        << '\t' << stats.frameInstances << '\t' << stats.tailCalls << '\t'
+        << stats.heap.minorCollections << '\t'
+        << stats.heap.majorCollections << '\t' << stats.heap.pauseNs << '\t'
+        << stats.heap.maxPauseNs << '\t' << stats.heap.peakOldBytes << '\t'
+        << stats.fieldCacheHits << '\t' << stats.fieldCacheMisses << '\t'
+        << stats.callCacheHits << '\t' << stats.callCacheMisses << '\n';
+    if (config.name == "default") {
+      loopResult.loops = result.analysis->loops;
+      loopResult.ns = ns;
+    } else if (!config.loopOptimization) {
+      loopResult.baselineNs = ns;
+    }
+  }
+  if (c.loop) {
+    loopResults.push_back(loopResult);
+  }
+}
+
+// Worker counts for the scaling table: powers of two below the hardware
+// thread count, then that count.
+static vector<size_t> workerCounts() {
+  size_t threads = max(thread::hardware_concurrency(), 1u);
+  vector<size_t> counts;
+  for (size_t workers = 1; workers < threads; workers *= 2) {
+    counts.push_back(workers);
+  }
+  counts.push_back(threads);
+  return counts;
+}
+
+static void runScaling(ostream &out, const RunCase &c,
+                       const BenchOptions &options) {
+  ProgramGenerator generator;
+  string source = c.generate(generator, c.size);
+  CompilerContext context;
+  context.setBuiltins(Interpreter::builtinNames());
+  CompileResult result = context.compile(source);
+  if (result.ok()) {
+    context.analyze(result);
+  }
+  if (!result.ok()) {
+    return;
+  }
+
+  string expected;
+  long long singleNs = -1;
+  for (size_t workers : workerCounts()) {
+    InterpreterOptions interpreterOptions;
+    interpreterOptions.workers = workers;
+    string printed;
+    RuntimeStats stats;
+    long long ns = -1;
+    for (size_t i = 0; i < options.reps; i++) {
+      ostringstream output;
+      Interpreter interpreter(result, output, interpreterOptions);
+      long long runNs = elapsedNs([&]() {
+        try {
+          interpreter.run();
+        } catch (const RuntimeError &e) {
+          output << "runtime error: " << e.what() << '\n';
+        }
+      });
+      if (ns < 0 || runNs < ns) {
+        ns = runNs;
+      }
+      stats = interpreter.stats();
+      printed = output.str();
+    }
+    if (expected.empty()) {
+      expected = printed;
+      singleNs = ns;
+    } else if (printed != expected) {
+      cerr << "Warning: " << c.name << " prints different output with "
+           << workers << " workers" << endl;
+    }
+    double speedup = ns > 0 ? static_cast<double>(singleNs) / ns : 0.0;
+    out << c.name << '\t' << c.size << '\t' << workers << '\t' << ns << '\t'
+        << stats.parallelIterations << '\t' << stats.steals << '\t' << fixed
+        << setprecision(2) << speedup << '\n';
+  }
+}
+
+static void printUsage(ostream &out) {
+  out << "Usage: tlc-bench [--scale N] [--reps N] [--filter NAME] "
+         "[--out FILE]\n"
+         "                 [--emit-corpus DIR]\n"
+         "\n"
+         "  --scale N          multiply every case's size by N (default 1)\n"
+         "  --reps N           keep the fastest of N runs (default 5)\n"
+         "  --filter NAME      only run cases whose name contains NAME\n"
+         "  --out FILE         write the results to FILE, not stdout\n"
+         "  --emit-corpus DIR  save each case's program as DIR/<case>.tl\n";
+}
+
+[[noreturn]] static void usageError(const string &message) {
+  cerr << "Error: " << message << "\n\n";
+  printUsage(cerr);
+  exit(1);
+}
+
+static BenchOptions parseOptions(int argc, char **argv) {
+  BenchOptions options;
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg == "--help" || arg == "-h") {
+      printUsage(cout);
+      exit(0);
+    }
+    if (arg != "--scale" && arg != "--reps" && arg != "--filter" &&
+        arg != "--out" && arg != "--emit-corpus") {
+      usageError("Unknown option " + arg);
+    }
+    if (i + 1 >= argc) {
+      usageError("Missing value for " + arg);
+    }
+    string value = argv[++i];
+    if (arg == "--scale") {
+      options.scale = max(1, atoi(value.c_str()));
+    } else if (arg == "--reps") {
+      options.reps = max(1, atoi(value.c_str()));
+    } else if (arg == "--filter") {
+      options.filter = value;
+    } else if (arg == "--out") {
+      options.outFile = value;
+    } else {
+      options.corpusDir = value;
+    }
+  }
+  return options;
+}
+
+int main(int argc, char **argv) {
+  BenchOptions options = parseOptions(argc, argv);
+
+  if (!options.corpusDir.empty()) {
+    error_code error;
+    filesystem::create_directories(options.corpusDir, error);
+    if (error) {
+      cerr << "Error: Unable to create " << options.corpusDir << ": "
+           << error.message() << endl;
+      return 1;
+    }
+  }
+
+  ofstream file;
+  if (!options.outFile.empty()) {
+    file.open(options.outFile);
+    if (!file.is_open()) {
+      cerr << "Error: Unable to open " << options.outFile << endl;
+      return 1;
+    }
+  }
+  ostream &out = options.outFile.empty() ? cout : file;
+
+  out << "# tlc-bench format=7 scale=" << options.scale
+      << " reps=" << options.reps << '\n';
+  out << "case\tsize\tbytes\ttokens\tphase\tns\tMB/s\n";
+
+  for (const BenchCase &c : benchCases(options.scale)) {
+    if (!options.filter.empty() && c.name.find(options.filter) == string::npos) {
+      continue;
+    }
+    runCase(out, c, options);
+  }
+
+  vector<LoopResult> loopResults;
+  out << "run_case\tsize\tbytes\tconfig\tns\tcalls\theap_allocs\t"
+         "heap_bytes\tframe_instances\ttail_calls\tminor_gcs\tmajor_gcs\t"
+         "gc_ns\tmax_pause_ns\tpeak_old_bytes\tfield_hits\tfield_misses\t"
+         "call_hits\tcall_misses\n";
+  for (const RunCase &c : runCases(options.scale)) {
+    if (!options.filter.empty() && c.name.find(options.filter) == string::npos) {
+      continue;
+    }
+    runProgram(out, c, options, loopResults);
+  }
+
+  out << "loop_case\tsize\thoisted\treduced\tns\tno_opt_ns\tspeedup\n";
+  for (const LoopResult &r : loopResults) {
+    double speedup = r.ns > 0 ? static_cast<double>(r.baselineNs) / r.ns : 0.0;
+    out << r.name << '\t' << r.size << '\t' << r.loops.hoisted << '\t'
+        << r.loops.reduced << '\t' << r.ns << '\t' << r.baselineNs << '\t'
+        << fixed << setprecision(2) << speedup << '\n';
+  }
+
+  out << "parallel_case\tsize\tworkers\tns\titerations\tsteals\tspeedup\n";
+  for (const RunCase &c : runCases(options.scale)) {
+    if (!c.parallel || (!options.filter.empty() &&
+                        c.name.find(options.filter) == string::npos)) {
+      continue;
+    }
+    runScaling(out, c, options);
+  }
+  return 0;
+}
@@ -0,0 +1,386 @@
+#include "ProgramGenerator.h"
+
+ProgramGenerator::ProgramGenerator(uint32_t seed) : rng(seed) {}
+
+// mt19937's output sequence is fixed by the standard, the distributions are
+// not, so reduce the raw output ourselves to keep sources identical everywhere.
+size_t ProgramGenerator::pick(size_t bound) { return rng() % bound; }
+
+string ProgramGenerator::identifier(const string &prefix, size_t bound) {
+  return prefix + to_string(pick(bound));
+}
+
+string ProgramGenerator::literal() {
+  switch (pick(4)) {
+  case 0:
+    return to_string(pick(100000));
+  case 1:
+    return to_string(pick(1000)) + "." + to_string(pick(100));
+  case 2:
+    return "\"str" + to_string(pick(1000)) + "\"";
+  default:
+    return "null";
+  }
+}
+
+string ProgramGenerator::operand() {
+  switch (pick(3)) {
+  case 0:
+    return identifier("v", 16);
+  case 1:
+    return to_string(pick(1000));
+  default:
+    return identifier("v", 16) + "." + identifier("f", 8);
+  }
+}
+
+string ProgramGenerator::condition() {
+  static const char *comparisons[] = {"<", "<=", ">", ">=", "==", "!="};
+  string cond = operand() + " " + comparisons[pick(6)] + " " + operand();
+  if (pick(2) == 0) {
+    cond += pick(2) == 0 ? " && " : " || ";
+    cond += operand() + " " + comparisons[pick(6)] + " " + operand();
+  }
+  return cond;
+}
+
+string ProgramGenerator::arithmetic(size_t terms) {
+  static const char *operators[] = {"+", "-", "*", "/", "%"};
+  string expr = operand();
+  for (size_t i = 1; i < terms; i++) {
+    expr += " ";
+    expr += operators[pick(5)];
+    expr += " ";
+    expr += operand();
+  }
+  return expr;
+}
+
+string ProgramGenerator::deepIfElse(size_t depth) {
+  string head;
+  string tail;
+  for (size_t i = 0; i < depth; i++) {
+    string level = to_string(i);
+    head += "if (" + condition() + ") {\n";
+    head += "let a" + level + " = " + arithmetic(3) + ";\n";
+
+    string close = "} else {\n";
+    close += "let b" + level + " = " + literal() + ";\n";
+    close += "}\n";
+    tail = close + tail;
+  }
+  return head + "return " + operand() + ";\n" + tail;
+}
+
+string ProgramGenerator::longWhile(size_t statements) {
+  string source = "let i = 0;\n";
+  source += "while (i < 1000000 && v0 != null) {\n";
+  for (size_t i = 0; i < statements; i++) {
+    switch (pick(3)) {
+    case 0:
+      source += "let t" + to_string(i) + " = " + arithmetic(4) + ";\n";
+      break;
+    case 1:
+      source += identifier("v", 16) + " = " + arithmetic(3) + ";\n";
+      break;
+    default:
+      source += "const c" + to_string(i) + " = " + literal() + ";\n";
+      break;
+    }
+  }
+  source += "i = i + 1;\n";
+  source += "}\n";
+  return source;
+}
+
+string ProgramGenerator::wideStruct(size_t fields) {
+  string source = "struct Wide {\n";
+  for (size_t i = 0; i < fields; i++) {
+    string name = "f" + to_string(i);
+    switch (pick(3)) {
+    case 0:
+      source += "let " + name + ";\n";
+      break;
+    case 1:
+      source += "let " + name + " = " + literal() + ";\n";
+      break;
+    default:
+      source += "const " + name + " = " + literal() + ";\n";
+      break;
+    }
+  }
+  source += "}\n";
+  return source;
+}
+
+string ProgramGenerator::callMemberChains(size_t length) {
+  string source;
+  for (size_t line = 0; line < 16; line++) {
+    string chain = identifier("v", 16);
+    for (size_t i = 0; i < length; i++) {
+      chain += "." + identifier("m", 32);
+      if (pick(2) == 0) {
+        chain += "(" + operand();
+        if (pick(2) == 0) {
+          chain += ", " + literal();
+        }
+        chain += ")";
+      }
+    }
+    source += "let r" + to_string(line) + " = " + chain + ";\n";
+  }
+  return source;
+}
+
+string ProgramGenerator::literalExpression(size_t terms) {
+  static const char *operators[] = {"+", "-", "*", "/"};
+  string expr = literal();
+  for (size_t i = 1; i < terms; i++) {
+    expr += " ";
+    expr += operators[pick(4)];
+    expr += " ";
+    if (pick(8) == 0) {
+      expr += "(" + literal() + " + " + literal() + ")";
+    } else {
+      expr += literal();
+    }
+  }
+  return "let huge = " + expr + ";\n";
+}
+
+string ProgramGenerator::structTemporaries(size_t iterations) {
+  string source = "struct Vec { let x; let y; }\n";
+  source += "func step(i) {\n";
+  source += "let a = Vec(i, i + " + to_string(1 + pick(9)) + ");\n";
+  source += "let b = Vec(a.y, a.x * " + to_string(2 + pick(8)) + ");\n";
+  source += "b.x = b.x + a.y;\n";
+  source += "return a.x + b.x + b.y;\n";
+  source += "}\n";
+  source += "let total = 0;\n";
+  source += "let i = 0;\n";
+  source += "while (i < " + to_string(iterations) + ") {\n";
+  source += "total = total + step(i);\n";
+  source += "i = i + 1;\n";
+  source += "}\n";
+  source += "print(total);\n";
+  return source;
+}
+
+string ProgramGenerator::smallHelpers(size_t iterations) {
+  string source = "func sq(x) { return x * x; }\n";
+  source += "func lerp(a, b, t) { return a + (b - a) * t / 100; }\n";
+  source += "func norm2(x, y) { return sq(x) + sq(y); }\n";
+  source += "func wrap(v) { let m = v % " + to_string(1000 + pick(9000)) +
+            "; return m; }\n";
+  source += "func run(n) {\n";
+  source += "let i = 0;\n";
+  source += "let acc = 0;\n";
+  source += "while (i < n) {\n";
+  source += "let d = norm2(i, i + " + to_string(1 + pick(9)) + ");\n";
+  source += "acc = acc + lerp(d, i, " + to_string(pick(100)) + ");\n";
+  source += "acc = wrap(acc);\n";
+  source += "i = i + 1;\n";
+  source += "}\n";
+  source += "return acc;\n";
+  source += "}\n";
+  source += "print(run(" + to_string(iterations) + "));\n";
+  return source;
+}
+
+string ProgramGenerator::recursiveCalls(size_t n) {
+  string source = "func fib(n) {\n";
+  source += "if (n < 2) { return n; }\n";
+  source += "return fib(n - 1) + fib(n - 2);\n";
+  source += "}\n";
+  source += "print(fib(" + to_string(n) + "));\n";
+  return source;
+}
+
+string ProgramGenerator::loopInvariants(size_t iterations) {
+  string source = "struct Grid { let width; let height; let scale; }\n";
+  source += "func weight(h) { return h * " + to_string(2 + pick(8)) +
+            " + 1; }\n";
+  source += "func fill(g, n) {\n";
+  source += "let i = 0;\n";
+  source += "let acc = 0;\n";
+  source += "while (i < n) {\n";
+  source += "acc = (acc + g.width * g.scale + i * " + to_string(2 + pick(8)) +
+            " + weight(g.height)) % 1000003;\n";
+  source += "i = i + 1;\n";
+  source += "}\n";
+  source += "return acc;\n";
+  source += "}\n";
+  source += "print(fill(Grid(" + to_string(1 + pick(99)) + ", " +
+            to_string(1 + pick(99)) + ", " + to_string(1 + pick(9)) + "), " +
+            to_string(iterations) + "));\n";
+  return source;
+}
+
+string ProgramGenerator::inductionProducts(size_t iterations) {
+  string stride = to_string(8 + pick(8));
+  string source = "func scan(n) {\n";
+  source += "let i = 0;\n";
+  source += "let total = 0;\n";
+  source += "let check = 0;\n";
+  source += "while (i < n) {\n";
+  source += "total = (total + i * " + stride + " + i * " +
+            to_string(2 + pick(6)) + ") % 65521;\n";
+  source += "check = (check + i * " + stride + ") % 65521;\n";
+  source += "i = i + 1;\n";
+  source += "}\n";
+  source += "return total + check;\n";
+  source += "}\n";
+  source += "print(scan(" + to_string(iterations) + "));\n";
+  return source;
+}
+
+string ProgramGenerator::tailRecursion(size_t rounds) {
+  string source = "func sum(n, acc) {\n";
+  source += "if (n == 0) { return acc; }\n";
+  source += "return sum(n - 1, (acc + n * " + to_string(1 + pick(9)) +
+            ") % 65521);\n";
+  source += "}\n";
+  source += "let total = 0;\n";
+  source += "let i = 0;\n";
+  source += "while (i < " + to_string(rounds) + ") {\n";
+  source += "total = (total + sum(1000, i)) % 65521;\n";
+  source += "i = i + 1;\n";
+  source += "}\n";
+  source += "print(total);\n";
+  return source;
+}
+
+string ProgramGenerator::polymorphicFields(size_t iterations) {
+  string source = "struct A { let x; let y; }\n";
+  source += "struct B { let tag; let y; let x; }\n";
+  source += "struct C { let name; let weight; let x; let y; }\n";
+  source += "func area(p) { return p.x * p.y; }\n";
+  source += "func grow(p, d) { p.x = p.x + d; return p.x; }\n";
+  source += "func run(n) {\n";
+  source += "let a = A(1, " + to_string(2 + pick(8)) + ");\n";
+  source += "let b = B(0, 3, " + to_string(1 + pick(9)) + ");\n";
+  source += "let c = C(\"c\", 7, 2, 5);\n";
+  source += "let total = 0;\n";
+  source += "let i = 0;\n";
+  source += "while (i < n) {\n";
+  source += "total = (total + area(a) + area(b) + area(c)) % 65521;\n";
+  source += "total = (total + grow(a, 1) + grow(b, 2) + grow(c, 3)) % 65521;\n";
+  source += "a.x = a.x % 1000;\n";
+  source += "b.x = b.x % 1000;\n";
+  source += "c.x = c.x % 1000;\n";
+  source += "i = i + 1;\n";
+  source += "}\n";
+  source += "return total;\n";
+  source += "}\n";
+  source += "print(run(" + to_string(iterations) + "));\n";
+  return source;
+}
+
+string ProgramGenerator::allocationChurn(size_t iterations) {
+  string source = "struct Node { let value; let label; let next; }\n";
+  source += "func churn(n) {\n";
+  source += "let kept = null;\n";
+  source += "let total = 0;\n";
+  source += "let i = 0;\n";
+  source += "while (i < n) {\n";
+  source += "let node = Node(i % " + to_string(100 + pick(900)) +
+            ", \"item\" + i, null);\n";
+  source += "if (kept != null) { kept.label = node.label; }\n";
+  source += "if (i % 100 == 0) { node.next = kept; kept = node; }\n";
+  source += "if (i % " + to_string(20000 + pick(10000)) +
+            " == 0) { kept = null; }\n";
+  source += "total = (total + node.value) % 65521;\n";
+  source += "i = i + 1;\n";
+  source += "}\n";
+  source += "let p = kept;\n";
+  source += "while (p != null) {\n";
+  source += "total = (total + p.value) % 65521;\n";
+  source += "p = p.next;\n";
+  source += "}\n";
+  source += "return total;\n";
+  source += "}\n";
+  source += "print(churn(" + to_string(iterations) + "));\n";
+  return source;
+}
+
+string ProgramGenerator::arrayScan(size_t rounds) {
+  string ints = "[";
+  string floats = "[";
+  for (size_t i = 0; i < 64; i++) {
+    ints += (i ? ", " : "") + to_string(pick(1000));
+    floats += (i ? ", " : "") + to_string(pick(100)) + ".5";
+  }
+  string source = "func scan(rounds) {\n";
+  source += "let xs = " + ints + "];\n";
+  source += "let ws = " + floats + "];\n";
+  source += "let total = 0;\n";
+  source += "let r = 0;\n";
+  source += "while (r < rounds) {\n";
+  source += "let i = 0;\n";
+  source += "while (i < len(xs)) {\n";
+  source += "total = (total + xs[i] * " + to_string(1 + pick(9)) +
+            ") % 65521;\n";
+  source += "ws[i] = ws[i] * 0.5 + xs[i];\n";
+  source += "i = i + 1;\n";
+  source += "}\n";
+  source += "r = r + 1;\n";
+  source += "}\n";
+  source += "return total + ws[0];\n";
+  source += "}\n";
+  source += "print(scan(" + to_string(rounds) + "));\n";
+  return source;
+}
+
+string ProgramGenerator::parallelTasks(size_t rounds) {
+  string costs = "[";
+  string zeros = "[";
+  for (size_t i = 0; i < 256; i++) {
+    costs += (i ? ", " : "") + to_string(1 + pick(64));
+    zeros += i ? ", 0" : "0";
+  }
+  string source = "func task(seed, steps) {\n";
+  source += "let h = seed;\n";
+  source += "let k = 0;\n";
+  source += "while (k < steps) {\n";
+  source += "h = (h * 31 + k) % 65521;\n";
+  source += "k = k + 1;\n";
+  source += "}\n";
+  source += "return h;\n";
+  source += "}\n";
+  source += "func run(rounds) {\n";
+  source += "let costs = " + costs + "];\n";
+  source += "let results = " + zeros + "];\n";
+  source += "let i = 0;\n";
+  source += "parallel while (i < len(costs)) {\n";
+  source += "results[i] = task(i, costs[i] * rounds);\n";
+  source += "i = i + 1;\n";
+  source += "}\n";
+  source += "let total = 0;\n";
+  source += "let j = 0;\n";
+  source += "while (j < len(results)) {\n";
+  source += "total = (total + results[j]) % 65521;\n";
+  source += "j = j + 1;\n";
+  source += "}\n";
+  source += "return total;\n";
+  source += "}\n";
+  source += "print(run(" + to_string(rounds) + "));\n";
+  return source;
+}
+
+string ProgramGenerator::builtinCalls(size_t iterations) {
+  string source = "func run(n) {\n";
+  source += "let total = 0;\n";
+  source += "let x = 0.0;\n";
+  source += "let i = 0;\n";
+  source += "while (i < n) {\n";
+  source += "x = x + sqrt(i) * 0." + to_string(1 + pick(9)) + ";\n";
+  source += "total = (total + abs(i - " + to_string(pick(1000)) +
+            ") + min(i % " + to_string(50 + pick(50)) + ", " +
+            to_string(10 + pick(40)) + ") + len(str(i))) % 65521;\n";
+  source += "i = i + 1;\n";
+  source += "}\n";
+  source += "return total + floor(x);\n";
+  source += "}\n";
+  source += "print(run(" + to_string(iterations) + "));\n";
+  return source;
+}
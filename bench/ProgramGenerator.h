@@ -0,0 +1,71 @@
+#ifndef PROGRAM_GENERATOR_H
+#define PROGRAM_GENERATOR_H
+
+#include <cstdint>
+#include <random>
+#include <string>
+using namespace std;
+
+// Builds synthetic TL sources that only use constructs the parser accepts.
+// Output is fully determined by the seed so runs can be compared.
+class ProgramGenerator {
+public:
+  ProgramGenerator(uint32_t seed = 1);
+
+  // if/else chains nested `depth` levels deep.
+  string deepIfElse(size_t depth);
+  // One while loop whose body holds `statements` statements.
+  string longWhile(size_t statements);
+  // One struct declaration with `fields` fields.
+  string wideStruct(size_t fields);
+  // Declarations initialised with `a.b(1).c...` chains of `length` links.
+  string callMemberChains(size_t length);
+  // A single declaration whose value is an expression of `terms` literals.
+  string literalExpression(size_t terms);
+
+  // Programs meant to be run rather than only compiled. Each ends by
+  // printing a checksum so a broken runtime shows up in the output.
+
+  // A loop of `iterations` calls that each build short-lived structs.
+  string structTemporaries(size_t iterations);
+  // A loop of `iterations` steps made of calls to tiny helper functions.
+  string smallHelpers(size_t iterations);
+  // Naive recursive fibonacci of `n`.
+  string recursiveCalls(size_t n);
+  // A loop of `iterations` steps recomputing field reads, arithmetic and a
+  // pure call that never change while it runs.
+  string loopInvariants(size_t iterations);
+  // A loop of `iterations` steps multiplying its counter by constants, one
+  // of them twice.
+  string inductionProducts(size_t iterations);
+  // `rounds` runs of a function that recurses through a tail call a
+  // thousand times.
+  string tailRecursion(size_t rounds);
+  // A loop of `iterations` steps reading fields of parameters that hold
+  // instances of three structs with the fields in different places.
+  string polymorphicFields(size_t iterations);
+  // A loop of `iterations` steps that each allocate an instance and a
+  // string, keeping one instance in a hundred in a list it drops now and
+  // then, so the collector sees both garbage and survivors.
+  string allocationChurn(size_t iterations);
+  // `rounds` passes over an int array and a float array of 64 elements
+  // each, reading both and writing the float one back.
+  string arrayScan(size_t rounds);
+  // A parallel loop over 256 tasks of uneven cost, each a hashing loop of
+  // up to 64 * `rounds` steps whose result goes into an int array.
+  string parallelTasks(size_t rounds);
+  // A loop of `iterations` steps that each call math and string builtins.
+  string builtinCalls(size_t iterations);
+
+private:
+  mt19937 rng;
+
+  size_t pick(size_t bound);
+  string identifier(const string &prefix, size_t bound);
+  string literal();
+  string operand();
+  string condition();
+  string arithmetic(size_t terms);
+};
+
+#endif
@@ -0,0 +1,150 @@
+#include "Batch.h"
+#include <charconv>
+#include <sstream>
+
+namespace {
+
+class BatchRunner {
+public:
+  BatchRunner(istream &in, ostream &out) : in(in), out(out) {}
+
+  BatchStats run(BatchFormat format);
+
+private:
+  istream &in;
+  ostream &out;
+  CompilerContext context;
+  BatchStats stats;
+  // Reused across records so steady state does no buffer allocation.
+  string line;
+  string source;
+  string record;
+
+  bool readNdjson(JsonValue &id, bool &wantAst);
+  bool readLength();
+  void compile(JsonValue id, bool wantAst);
+  void reject(JsonValue id, const string &message);
+  void write(const JsonValue &result);
+};
+
+BatchStats BatchRunner::run(BatchFormat format) {
+  while (getline(in, line)) {
+    if (line.find_first_not_of(" \t\r") == string::npos) {
+      continue;
+    }
+    if (format == BatchFormat::Ndjson) {
+      // An index could collide with another record's explicit id, so a
+      // record without one gets null.
+      JsonValue id;
+      bool wantAst = false;
+      if (readNdjson(id, wantAst)) {
+        compile(move(id), wantAst);
+      }
+    } else {
+      if (!readLength()) {
+        // Without a valid length there is no telling where the next record
+        // starts.
+        break;
+      }
+      compile(JsonValue(stats.records), false);
+    }
+    if (in.rdbuf()->in_avail() <= 0) {
+      out.flush();
+    }
+  }
+  out.flush();
+  return stats;
+}
+
+bool BatchRunner::readNdjson(JsonValue &id, bool &wantAst) {
+  JsonValue request;
+  try {
+    request = parseJson(line);
+    if (request.has("id")) {
+      id = request.get("id");
+    }
+    if (!request.get("source").isString()) {
+      throw JsonError("Record has no \"source\" string");
+    }
+    source = request.get("source").asString();
+    wantAst = request.get("ast").isNull() ? false : request.get("ast").asBool();
+  } catch (const JsonError &e) {
+    reject(move(id), e.what());
+    return false;
+  }
+  return true;
+}
+
+bool BatchRunner::readLength() {
+  size_t length = 0;
+  size_t start = line.find_first_not_of(" \t");
+  size_t end = line.find_last_not_of(" \t\r") + 1;
+  from_chars_result parsed =
+      from_chars(line.data() + start, line.data() + end, length);
+  if (parsed.ec != errc() || parsed.ptr != line.data() + end) {
+    reject(JsonValue(stats.records), "Invalid record length: " + line);
+    return false;
+  }
+  source.resize(length);
+  in.read(&source[0], static_cast<streamsize>(length));
+  if (static_cast<size_t>(in.gcount()) != length) {
+    reject(JsonValue(stats.records), "Truncated record: expected " +
+                                         to_string(length) + " bytes");
+    return false;
+  }
+  return true;
+}
+
+void BatchRunner::compile(JsonValue id, bool wantAst) {
+  CompileResult result = context.compile(source);
+  stats.records++;
+  if (!result.ok()) {
+    stats.failed++;
+  }
+
+  JsonValue diagnostics = JsonValue::array();
+  for (const Diagnostic &diagnostic : result.diagnostics) {
+    JsonValue entry = JsonValue::object();
+    entry.set("severity", severityName(diagnostic.severity));
+    entry.set("line", diagnostic.line);
+    entry.set("column", diagnostic.column);
+    entry.set("offset", diagnostic.offset);
+    entry.set("message", diagnostic.message);
+    diagnostics.push(move(entry));
+  }
+
+  JsonValue response = JsonValue::object();
+  response.set("id", move(id));
+  response.set("ok", result.ok());
+  response.set("tokens", result.tokens.size());
+  response.set("diagnostics", move(diagnostics));
+  if (wantAst) {
+    ostringstream ast;
+    printProgram(*result.program, ast, "");
+    response.set("ast", ast.str());
+  }
+  write(response);
+}
+
+void BatchRunner::reject(JsonValue id, const string &message) {
+  stats.records++;
+  stats.malformed++;
+  JsonValue response = JsonValue::object();
+  response.set("id", move(id));
+  response.set("ok", false);
+  response.set("error", message);
+  write(response);
+}
+
+void BatchRunner::write(const JsonValue &result) {
+  record.clear();
+  writeJson(result, record);
+  record += '\n';
+  out.write(record.data(), static_cast<streamsize>(record.size()));
+}
+
+} // namespace
+
+BatchStats runBatch(istream &in, ostream &out, BatchFormat format) {
+  return BatchRunner(in, out).run(format);
+}
@@ -0,0 +1,33 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "Compiler.h"
+#include "../support/Json.h"
+#include <iostream>
+
+// How batch input is framed.
+//  Ndjson: one JSON object per line, {"id": any, "source": "...", "ast": bool}.
+//          "id" is echoed back, null when absent, and "ast" asks for the
+//          printed tree in the result. Results come in input order, so a
+//          record without an id is still matched by position.
+//  Length: a line holding the decimal byte count of the source, followed by
+//          exactly that many bytes of source. Results are keyed by index.
+enum class BatchFormat { Ndjson, Length };
+
+class BatchStats {
+public:
+  size_t records = 0;
+  // Records whose compilation reported errors.
+  size_t failed = 0;
+  // Records that could not be read; they still get a result with "error".
+  size_t malformed = 0;
+};
+
+// Compiles every record on `in` with one CompilerContext and writes one
+// result per record to `out`, one JSON object per line, in input order:
+//   {"id": ..., "ok": bool, "tokens": N, "diagnostics": [...], "ast": "..."}
+// Output is flushed whenever the input has nothing buffered, so a driver
+// that waits for each result before sending the next one does not stall.
+BatchStats runBatch(istream &in, ostream &out, BatchFormat format);
+
+#endif
@@ -0,0 +1,138 @@
+#include "Compiler.h"
+#include <algorithm>
+
+bool CompileResult::ok() const {
+  for (const Diagnostic &diagnostic : diagnostics) {
+    if (diagnostic.severity == DiagnosticSeverity::Error) {
+      return false;
+    }
+  }
+  return true;
+}
+
+const LineTable &CompileResult::lines() const {
+  if (!lineTable) {
+    lineTable = make_unique<LineTable>(source);
+  }
+  return *lineTable;
+}
+
+// Orders diagnostics by position and resolves their line and column.
+static void sortDiagnostics(CompileResult &result) {
+  stable_sort(result.diagnostics.begin(), result.diagnostics.end(),
+              [](const Diagnostic &a, const Diagnostic &b) {
+                return a.offset < b.offset;
+              });
+  for (Diagnostic &diagnostic : result.diagnostics) {
+    LineColumn position = result.lines().locate(diagnostic.offset);
+    diagnostic.line = position.line;
+    diagnostic.column = position.column;
+  }
+}
+
+CompileResult CompilerContext::compile(string_view source) {
+  CompileResult result;
+  result.source = string(source);
+
+  Lexer lex(result.source);
+  result.tokens = lex.takeTokens();
+  for (const LexerError &e : lex.getErrors()) {
+    result.diagnostics.push_back(
+        {DiagnosticSeverity::Error, e.what(), e.offset, 0, 0});
+  }
+
+  result.program = parser.produceAST(result.tokens);
+  for (const ParserError &e : parser.getErrors()) {
+    result.diagnostics.push_back(
+        {DiagnosticSeverity::Error, e.what(), e.offset, 0, 0});
+  }
+
+  sortDiagnostics(result);
+  return result;
+}
+
+void CompilerContext::analyze(CompileResult &result) {
+  auto analysis = make_unique<ProgramAnalysis>();
+  vector<AnalysisError> depthErrors =
+      checkTreeDepth(*result.program, maxTreeDepth);
+  if (!depthErrors.empty()) {
+    for (const AnalysisError &e : depthErrors) {
+      result.diagnostics.push_back(
+          {DiagnosticSeverity::Error, e.what(), e.offset, 0, 0});
+    }
+    result.analysis = move(analysis);
+    sortDiagnostics(result);
+    return;
+  }
+  analysis->names = resolveNames(*result.program, builtins);
+  // Before the passes that move code in and out of loops, so errors point
+  // at what the program says.
+  if (analysis->names.errors.empty()) {
+    analysis->parallel = checkParallelLoops(*result.program);
+  }
+  if (inlining && analysis->names.errors.empty()) {
+    analysis->inlining = inlineCalls(*result.program, inlineOptions);
+    if (analysis->inlining.sites > 0) {
+      analysis->names = resolveNames(*result.program, builtins);
+    }
+  }
+  if (loopOptimization && analysis->names.errors.empty()) {
+    analysis->loops = optimizeLoops(*result.program);
+    if (analysis->loops.loops > 0) {
+      analysis->names = resolveNames(*result.program, builtins);
+    }
+  }
+  analysis->layouts = computeLayouts(*result.program);
+  if (frameAllocation) {
+    analysis->escapes = analyzeEscapes(*result.program, analysis->layouts);
+  }
+  if (tailCalls) {
+    analysis->tailCalls = markTailCalls(*result.program);
+  }
+  analysis->caches = numberCacheSites(*result.program);
+  for (const auto *errors :
+       {&analysis->names.errors, &analysis->parallel.errors,
+        &analysis->layouts.errors}) {
+    for (const AnalysisError &e : *errors) {
+      result.diagnostics.push_back(
+          {DiagnosticSeverity::Error, e.what(), e.offset, 0, 0});
+    }
+  }
+  result.analysis = move(analysis);
+  sortDiagnostics(result);
+}
+
+void CompilerContext::setMaxNestingDepth(size_t limit) {
+  parser.setMaxNestingDepth(limit);
+}
+
+void CompilerContext::setMaxTreeDepth(size_t limit) { maxTreeDepth = limit; }
+
+void CompilerContext::setBuiltins(vector<string> names) {
+  builtins = move(names);
+}
+
+void CompilerContext::setFrameAllocation(bool enabled) {
+  frameAllocation = enabled;
+}
+
+void CompilerContext::setInlining(bool enabled, InlineOptions options) {
+  inlining = enabled;
+  inlineOptions = options;
+}
+
+void CompilerContext::setLoopOptimization(bool enabled) {
+  loopOptimization = enabled;
+}
+
+void CompilerContext::setTailCalls(bool enabled) { tailCalls = enabled; }
+
+string severityName(DiagnosticSeverity severity) {
+  switch (severity) {
+  case DiagnosticSeverity::Error:
+    return "error";
+  case DiagnosticSeverity::Warning:
+    return "warning";
+  }
+  return "unknown";
+}
@@ -0,0 +1,115 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include "../ast/AST.h"
+#include "../lexer/Lexer.h"
+#include "../lexer/LineTable.h"
+#include "../parser/Parser.h"
+#include "../passes/CacheSites.h"
+#include "../passes/EscapeAnalysis.h"
+#include "../passes/Inliner.h"
+#include "../passes/LoopOptimizer.h"
+#include "../passes/ParallelLoops.h"
+#include "../passes/Resolver.h"
+#include "../passes/TailCalls.h"
+#include "../passes/StructLayout.h"
+#include "../passes/TreeDepth.h"
+#include <string_view>
+
+enum class DiagnosticSeverity { Error, Warning };
+
+class Diagnostic {
+public:
+  DiagnosticSeverity severity;
+  string message;
+  uint32_t offset;
+  // 1-based, resolved from `offset` through the result's line table.
+  uint32_t line;
+  uint32_t column;
+};
+
+// What the semantic passes learned about a program; see
+// CompilerContext::analyze.
+class ProgramAnalysis {
+public:
+  Resolution names;
+  ParallelSummary parallel;
+  InlineSummary inlining;
+  LoopSummary loops;
+  LayoutTable layouts;
+  EscapeSummary escapes;
+  CacheSites caches;
+  // Returns marked as tail calls.
+  size_t tailCalls = 0;
+};
+
+// Everything one compilation produced. The program always exists; parts the
+// parser could not read are ErrorStmt nodes with a matching diagnostic.
+class CompileResult {
+public:
+  string source;
+  vector<Token> tokens;
+  unique_ptr<Program> program;
+  vector<Diagnostic> diagnostics;
+  // Set by CompilerContext::analyze.
+  unique_ptr<ProgramAnalysis> analysis;
+
+  bool ok() const;
+  // Built on first use, so compilations nobody asks positions of never pay
+  // for it. Not safe to call concurrently on the same result.
+  const LineTable &lines() const;
+
+private:
+  mutable unique_ptr<LineTable> lineTable;
+};
+
+// Entry point for embedding the compiler. A context keeps its parser state
+// warm between calls and shares nothing with other contexts, so separate
+// contexts can compile concurrently; a single context is not reentrant.
+class CompilerContext {
+public:
+  CompileResult compile(string_view source);
+  // Runs name resolution, the parallel loop checks, inlining and loop
+  // optimization (when enabled), struct layout, escape analysis, tail call
+  // marking (when enabled) and cache site numbering over `result.program`,
+  // which they annotate in place, and adds their diagnostics to the result.
+  // compile() leaves this out, so tools that only need the syntax tree do
+  // not pay for it. A tree deeper than the limit set by setMaxTreeDepth
+  // gets a diagnostic instead, and none of the passes run.
+  void analyze(CompileResult &result);
+
+  // See Parser::setMaxNestingDepth.
+  void setMaxNestingDepth(size_t limit);
+  // Deepest tree, in levels, analyze() accepts; see checkTreeDepth. The
+  // default leaves room for sanitizer builds on an 8 MB stack.
+  void setMaxTreeDepth(size_t limit);
+  // Names analyze() declares ahead of the program's globals, for the
+  // runtime that will run the result to provide.
+  void setBuiltins(vector<string> names);
+  // Whether analyze() places struct instances that never escape in frames
+  // instead of the heap. On by default.
+  void setFrameAllocation(bool enabled);
+  // Whether analyze() inlines small functions into their callers, and how
+  // small. Off by default, since it rewrites the tree that tools inspect.
+  void setInlining(bool enabled, InlineOptions options = InlineOptions());
+  // Whether analyze() moves invariant code out of loops and strength
+  // reduces induction variables. Off by default, for the same reason.
+  void setLoopOptimization(bool enabled);
+  // Whether analyze() marks calls in tail position, which the interpreter
+  // then runs without growing the stack. On by default.
+  void setTailCalls(bool enabled);
+
+private:
+  Parser parser;
+  size_t maxTreeDepth = 2000;
+  vector<string> builtins;
+  bool frameAllocation = true;
+  bool inlining = false;
+  InlineOptions inlineOptions;
+  bool loopOptimization = false;
+  bool tailCalls = true;
+};
+
+string severityName(DiagnosticSeverity severity);
+
+#endif
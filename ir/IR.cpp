@@ -0,0 +1,251 @@
+#include "IR.h"
+#include <algorithm>
+#include <unordered_set>
+
+static void removeOneUse(Instruction *value, Instruction *user) {
+  auto it = find(value->users.begin(), value->users.end(), user);
+  if (it != value->users.end()) {
+    *it = value->users.back();
+    value->users.pop_back();
+  }
+}
+
+void Instruction::addOperand(Instruction *value) {
+  operands.push_back(value);
+  value->users.push_back(this);
+}
+
+void Instruction::setOperand(size_t i, Instruction *value) {
+  removeOneUse(operands[i], this);
+  operands[i] = value;
+  value->users.push_back(this);
+}
+
+void Instruction::replaceAllUsesWith(Instruction *value) {
+  vector<Instruction *> oldUsers = move(users);
+  users.clear();
+  for (Instruction *user : oldUsers) {
+    for (Instruction *&operand : user->operands) {
+      if (operand == this) {
+        operand = value;
+      }
+    }
+  }
+  // A user listed twice uses this value twice and moves both uses.
+  for (Instruction *user : oldUsers) {
+    value->users.push_back(user);
+  }
+}
+
+void Instruction::dropOperands() {
+  for (Instruction *operand : operands) {
+    removeOneUse(operand, this);
+  }
+  operands.clear();
+}
+
+void BasicBlock::erase(Instruction *instruction) {
+  instruction->dropOperands();
+  for (auto it = instructions.begin(); it != instructions.end(); ++it) {
+    if (it->get() == instruction) {
+      instructions.erase(it);
+      return;
+    }
+  }
+}
+
+BasicBlock *Function::addBlock() {
+  blocks.push_back(make_unique<BasicBlock>());
+  BasicBlock *block = blocks.back().get();
+  block->id = static_cast<uint32_t>(blocks.size() - 1);
+  block->function = this;
+  return block;
+}
+
+void Function::renumber() {
+  uint32_t next = 0;
+  for (size_t i = 0; i < blocks.size(); i++) {
+    blocks[i]->id = static_cast<uint32_t>(i);
+    for (auto &instruction : blocks[i]->instructions) {
+      instruction->id = next++;
+    }
+  }
+}
+
+size_t Function::instructionCount() const {
+  size_t count = 0;
+  for (const auto &block : blocks) {
+    count += block->instructions.size();
+  }
+  return count;
+}
+
+void addEdge(BasicBlock *from, BasicBlock *to) {
+  from->successors.push_back(to);
+  to->predecessors.push_back(from);
+}
+
+void computeDominators(Function &function) {
+  // Reverse postorder from an explicit stack, so long chains of blocks
+  // cannot overflow the native one.
+  vector<BasicBlock *> postorder;
+  unordered_set<BasicBlock *> seen;
+  vector<pair<BasicBlock *, size_t>> stack;
+  stack.emplace_back(function.entry(), 0);
+  seen.insert(function.entry());
+  while (!stack.empty()) {
+    auto &[block, next] = stack.back();
+    if (next < block->successors.size()) {
+      BasicBlock *successor = block->successors[next++];
+      if (seen.insert(successor).second) {
+        stack.emplace_back(successor, 0);
+      }
+      continue;
+    }
+    postorder.push_back(block);
+    stack.pop_back();
+  }
+  for (auto &block : function.blocks) {
+    block->idom = nullptr;
+    block->dominated.clear();
+  }
+  vector<BasicBlock *> rpo(postorder.rbegin(), postorder.rend());
+  for (size_t i = 0; i < rpo.size(); i++) {
+    rpo[i]->order = static_cast<uint32_t>(i);
+  }
+
+  auto intersect = [](BasicBlock *a, BasicBlock *b) {
+    while (a != b) {
+      while (a->order > b->order) {
+        a = a->idom;
+      }
+      while (b->order > a->order) {
+        b = b->idom;
+      }
+    }
+    return a;
+  };
+
+  BasicBlock *entry = function.entry();
+  entry->idom = entry;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t i = 1; i < rpo.size(); i++) {
+      BasicBlock *block = rpo[i];
+      BasicBlock *idom = nullptr;
+      for (BasicBlock *predecessor : block->predecessors) {
+        if (!predecessor->idom) {
+          continue;
+        }
+        idom = idom ? intersect(predecessor, idom) : predecessor;
+      }
+      if (idom != block->idom) {
+        block->idom = idom;
+        changed = true;
+      }
+    }
+  }
+  entry->idom = nullptr;
+  for (size_t i = 1; i < rpo.size(); i++) {
+    rpo[i]->idom->dominated.push_back(rpo[i]);
+  }
+}
+
+bool dominates(const BasicBlock *a, const BasicBlock *b) {
+  while (b && b != a) {
+    b = b->idom;
+  }
+  return b == a;
+}
+
+vector<string> verify(const Function &function) {
+  vector<string> problems;
+  auto problem = [&](const Instruction &instruction, const string &message) {
+    problems.push_back(function.name + ": %" + to_string(instruction.id) +
+                       " (" + opcodeName(instruction.op) + ") " + message);
+  };
+
+  unordered_set<const Instruction *> all;
+  for (const auto &block : function.blocks) {
+    for (const auto &instruction : block->instructions) {
+      all.insert(instruction.get());
+    }
+  }
+  auto before = [](const Instruction *a, const Instruction *b) {
+    for (const auto &instruction : a->block->instructions) {
+      if (instruction.get() == a) {
+        return true;
+      }
+      if (instruction.get() == b) {
+        return false;
+      }
+    }
+    return false;
+  };
+
+  for (const auto &block : function.blocks) {
+    if (block.get() != function.entry() && !block->idom) {
+      problems.push_back(function.name + ": bb" + to_string(block->id) +
+                         " is unreachable");
+      continue;
+    }
+    bool pastPhis = false;
+    for (size_t i = 0; i < block->instructions.size(); i++) {
+      const Instruction &instruction = *block->instructions[i];
+      bool last = i + 1 == block->instructions.size();
+      if (instruction.block != block.get()) {
+        problem(instruction, "has the wrong block");
+      }
+      if (instruction.isTerminator() != last) {
+        problem(instruction, last ? "ends a block without being a terminator"
+                                  : "is a terminator inside a block");
+      }
+      if (instruction.op == Opcode::Phi) {
+        if (pastPhis) {
+          problem(instruction, "comes after a non-phi");
+        }
+        if (instruction.operands.size() != block->predecessors.size()) {
+          problem(instruction, "has " +
+                                   to_string(instruction.operands.size()) +
+                                   " operands for " +
+                                   to_string(block->predecessors.size()) +
+                                   " predecessors");
+          continue;
+        }
+      } else {
+        pastPhis = true;
+      }
+      for (size_t k = 0; k < instruction.operands.size(); k++) {
+        const Instruction *operand = instruction.operands[k];
+        if (!all.count(operand)) {
+          problem(instruction, "uses a value outside the function");
+          continue;
+        }
+        if (count(operand->users.begin(), operand->users.end(),
+                  &instruction) == 0) {
+          problem(instruction, "is missing from the users of %" +
+                                   to_string(operand->id));
+        }
+        // A phi's operand only has to be available at the end of the
+        // matching predecessor.
+        const BasicBlock *use = instruction.op == Opcode::Phi
+                                    ? block->predecessors[k]
+                                    : block.get();
+        bool available =
+            operand->block == use
+                ? instruction.op == Opcode::Phi || before(operand, &instruction)
+                : dominates(operand->block, use);
+        if (!available) {
+          problem(instruction,
+                  "uses %" + to_string(operand->id) + " before it is defined");
+        }
+      }
+    }
+    if (!block->terminator()) {
+      problems.push_back(function.name + ": bb" + to_string(block->id) +
+                         " has no terminator");
+    }
+  }
+  return problems;
+}
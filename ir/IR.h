@@ -0,0 +1,193 @@
+#ifndef IR_H
+#define IR_H
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+using namespace std;
+
+// A static single assignment form of TL programs, lowered from the resolved
+// AST (ir/Lowering.h). Each function is a control-flow graph of basic
+// blocks; every local variable of the source becomes a chain of values, with
+// phi nodes where control flow merges. Globals and fields stay in memory and
+// are reached through loads and stores, since any call may change them.
+
+enum class Opcode : uint8_t {
+  // Constants; the value is in the instruction's payload.
+  ConstNull,
+  ConstBool,
+  ConstInt,
+  ConstFloat,
+  ConstString,
+
+  // The function's `index`th parameter. Only in the entry block.
+  Param,
+  // Merges one operand per predecessor of its block, in predecessor order.
+  // Only at the start of a block.
+  Phi,
+
+  // Arithmetic and comparisons, with the operand rules of the runtime: they
+  // may fail (overflow, division by zero, bad operand types) but have no
+  // other effect.
+  Add,
+  Sub,
+  Mul,
+  Div,
+  Mod,
+  Lt,
+  Le,
+  Gt,
+  Ge,
+  Eq,
+  Ne,
+  Neg,
+  Not,
+  // Truthiness of the operand as a bool; what `&&` and `||` produce.
+  ToBool,
+
+  // Memory: global slot `index`, and field `name` (at layout index `index`
+  // when known, otherwise -1) of the first operand.
+  LoadGlobal,
+  StoreGlobal,
+  GetField,
+  SetField,
+  // A new array holding the operands, in order. Indexing reads or writes
+  // the element of the first operand at the second; a store's value is the
+  // third operand.
+  NewArray,
+  GetIndex,
+  SetIndex,
+  // Calls the first operand with the rest as arguments; constructs an
+  // instance when the callee is a struct.
+  Call,
+
+  // Terminators, one at the end of every block.
+  Jump,
+  Branch,
+  Return,
+};
+
+class BasicBlock;
+class Function;
+
+class Instruction {
+public:
+  Opcode op;
+  // Numbers values within a function; reassigned by Function::renumber.
+  uint32_t id = 0;
+  // Byte offset of the AST node the instruction was lowered from.
+  uint32_t offset = 0;
+  BasicBlock *block = nullptr;
+  vector<Instruction *> operands;
+  // Every instruction that uses this one, once per use.
+  vector<Instruction *> users;
+
+  // Payload, depending on `op`.
+  int64_t integer = 0;
+  double number = 0;
+  // Text of a string constant, or the name of a global or field.
+  string text;
+  // Parameter, global slot or field index.
+  int32_t index = -1;
+
+  Instruction(Opcode op) : op(op) {}
+
+  bool isTerminator() const { return op >= Opcode::Jump; }
+  bool isConstant() const { return op <= Opcode::ConstString; }
+  // Has an effect beyond computing its value and possibly failing; such
+  // instructions are never removed or moved.
+  bool hasSideEffects() const {
+    return op == Opcode::StoreGlobal || op == Opcode::SetField ||
+           op == Opcode::SetIndex || op == Opcode::Call || isTerminator();
+  }
+  // May stop the program with a runtime error, so removing it when unused
+  // would change what the program does.
+  bool canFail() const {
+    return (op >= Opcode::Add && op <= Opcode::Ge) || op == Opcode::Neg ||
+           op == Opcode::GetField || op == Opcode::GetIndex ||
+           hasSideEffects();
+  }
+  // Reads memory something else may write.
+  bool readsMemory() const {
+    return op == Opcode::LoadGlobal || op == Opcode::GetField ||
+           op == Opcode::GetIndex;
+  }
+
+  void addOperand(Instruction *value);
+  void setOperand(size_t i, Instruction *value);
+  // Points every user of this instruction at `value` instead.
+  void replaceAllUsesWith(Instruction *value);
+  // Drops this instruction's own operands, unlinking it from their users.
+  void dropOperands();
+};
+
+class BasicBlock {
+public:
+  uint32_t id = 0;
+  Function *function = nullptr;
+  // Phis first, the terminator last.
+  vector<unique_ptr<Instruction>> instructions;
+  vector<BasicBlock *> predecessors;
+  // Targets of the terminator: the jump target, or the true then the false
+  // target of a branch.
+  vector<BasicBlock *> successors;
+
+  // Set by computeDominators: the immediate dominator (null for the entry
+  // block) and the blocks it immediately dominates.
+  BasicBlock *idom = nullptr;
+  vector<BasicBlock *> dominated;
+  // Position in reverse postorder, also from computeDominators.
+  uint32_t order = 0;
+
+  Instruction *terminator() const {
+    return instructions.empty() || !instructions.back()->isTerminator()
+               ? nullptr
+               : instructions.back().get();
+  }
+  // Removes `instruction`, which must have no users left.
+  void erase(Instruction *instruction);
+};
+
+class Function {
+public:
+  string name;
+  vector<string> parameters;
+  // blocks[0] is the entry block.
+  vector<unique_ptr<BasicBlock>> blocks;
+
+  BasicBlock *entry() const { return blocks.front().get(); }
+  BasicBlock *addBlock();
+  // Gives blocks and instructions consecutive ids in block order.
+  void renumber();
+  size_t instructionCount() const;
+};
+
+// Every function of a program, plus the top-level code as a function named
+// `<main>` that comes first.
+class Module {
+public:
+  vector<unique_ptr<Function>> functions;
+};
+
+// Links `from` to `to` as successor and predecessor.
+void addEdge(BasicBlock *from, BasicBlock *to);
+
+// Fills in idom, dominated and order for every block, by the iterative
+// algorithm of Cooper, Harvey and Kennedy. Every block must be reachable
+// from the entry.
+void computeDominators(Function &function);
+// Whether `a` dominates `b`, from the last computeDominators.
+bool dominates(const BasicBlock *a, const BasicBlock *b);
+
+// Checks the structural rules above and that every value is defined in a
+// block dominating its use. Returns a description of each violation; needs
+// up to date dominators.
+vector<string> verify(const Function &function);
+
+string opcodeName(Opcode op);
+void printFunction(const Function &function, ostream &out);
+void printModule(const Module &module, ostream &out);
+
+#endif
@@ -0,0 +1,581 @@
+#include "Lowering.h"
+#include "../ast/Visitor.h"
+#include <unordered_map>
+
+namespace {
+
+class Lowering {
+public:
+  Module module;
+
+  void lowerMain(const Program &program);
+  void lowerFunction(const FunctionDeclaration &funcDecl);
+
+private:
+  Function *function = nullptr;
+  // The block code is being added to; null after a `return`, until control
+  // flow merges again.
+  BasicBlock *current = nullptr;
+
+  // Per block, by id: the value each local slot last got in it, whether all
+  // predecessors are known, and the phis made before they were.
+  vector<unordered_map<uint32_t, Instruction *>> definitions;
+  vector<bool> sealed;
+  vector<vector<pair<uint32_t, Instruction *>>> incompletePhis;
+  // Trivial phis removed during construction and what replaced them. They
+  // are kept alive so stale entries in `definitions` can be forwarded.
+  unordered_map<Instruction *, Instruction *> replaced;
+  vector<unique_ptr<Instruction>> removed;
+  // The value of a local read before any assignment reaches it.
+  Instruction *undefined = nullptr;
+
+  void begin(const string &name, const vector<string> &parameters);
+  void end();
+
+  BasicBlock *newBlock();
+  Instruction *add(Opcode op, uint32_t offset,
+                   initializer_list<Instruction *> operands = {});
+  Instruction *constant(Opcode op, uint32_t offset);
+  void jump(BasicBlock *target, uint32_t offset);
+  void branch(Instruction *condition, BasicBlock *ifTrue, BasicBlock *ifFalse,
+              uint32_t offset);
+
+  void writeVariable(uint32_t slot, BasicBlock *block, Instruction *value);
+  Instruction *readVariable(uint32_t slot, BasicBlock *block);
+  Instruction *readVariableRecursive(uint32_t slot, BasicBlock *block);
+  Instruction *newPhi(BasicBlock *block);
+  Instruction *addPhiOperands(uint32_t slot, Instruction *phi);
+  Instruction *tryRemoveTrivialPhi(Instruction *phi);
+  Instruction *undefinedValue();
+  void seal(BasicBlock *block);
+
+  template <typename Body> void lowerBlock(const Body &body);
+  void lowerStmt(const Stmt &stmt);
+  void lowerIf(const IfStatement &ifStmt);
+  void lowerWhile(const WhileLoop &whileLoop);
+  void store(const Binding &binding, const string &name, Instruction *value,
+             uint32_t offset);
+  Instruction *lowerExpr(const Expr &expr);
+  Instruction *lowerLogical(const LogicalExpr &logicalExpr);
+};
+
+void Lowering::begin(const string &name, const vector<string> &parameters) {
+  module.functions.push_back(make_unique<Function>());
+  function = module.functions.back().get();
+  function->name = name;
+  function->parameters = parameters;
+  definitions.clear();
+  sealed.clear();
+  incompletePhis.clear();
+  replaced.clear();
+  removed.clear();
+  undefined = nullptr;
+
+  current = newBlock();
+  seal(current);
+  for (size_t i = 0; i < parameters.size(); i++) {
+    Instruction *param = add(Opcode::Param, 0);
+    param->index = static_cast<int32_t>(i);
+    writeVariable(static_cast<uint32_t>(i), current, param);
+  }
+}
+
+void Lowering::end() {
+  if (current) {
+    add(Opcode::Return, 0, {constant(Opcode::ConstNull, 0)});
+  }
+  // Blocks no control flow reached, such as the join of an `if` whose
+  // branches both return, never got code; drop them.
+  vector<unique_ptr<BasicBlock>> blocks;
+  for (auto &block : function->blocks) {
+    if (block.get() == function->entry() || !block->predecessors.empty()) {
+      blocks.push_back(move(block));
+    }
+  }
+  function->blocks = move(blocks);
+  function->renumber();
+  computeDominators(*function);
+}
+
+BasicBlock *Lowering::newBlock() {
+  BasicBlock *block = function->addBlock();
+  definitions.emplace_back();
+  sealed.push_back(false);
+  incompletePhis.emplace_back();
+  return block;
+}
+
+Instruction *Lowering::add(Opcode op, uint32_t offset,
+                           initializer_list<Instruction *> operands) {
+  auto instruction = make_unique<Instruction>(op);
+  instruction->offset = offset;
+  instruction->block = current;
+  for (Instruction *operand : operands) {
+    instruction->addOperand(operand);
+  }
+  current->instructions.push_back(move(instruction));
+  return current->instructions.back().get();
+}
+
+Instruction *Lowering::constant(Opcode op, uint32_t offset) {
+  return add(op, offset);
+}
+
+void Lowering::jump(BasicBlock *target, uint32_t offset) {
+  add(Opcode::Jump, offset);
+  addEdge(current, target);
+}
+
+void Lowering::branch(Instruction *condition, BasicBlock *ifTrue,
+                      BasicBlock *ifFalse, uint32_t offset) {
+  add(Opcode::Branch, offset, {condition});
+  addEdge(current, ifTrue);
+  addEdge(current, ifFalse);
+}
+
+void Lowering::writeVariable(uint32_t slot, BasicBlock *block,
+                             Instruction *value) {
+  definitions[block->id][slot] = value;
+}
+
+Instruction *Lowering::readVariable(uint32_t slot, BasicBlock *block) {
+  auto it = definitions[block->id].find(slot);
+  if (it == definitions[block->id].end()) {
+    return readVariableRecursive(slot, block);
+  }
+  Instruction *value = it->second;
+  for (auto next = replaced.find(value); next != replaced.end();
+       next = replaced.find(value)) {
+    value = next->second;
+  }
+  return it->second = value;
+}
+
+Instruction *Lowering::readVariableRecursive(uint32_t slot,
+                                             BasicBlock *block) {
+  Instruction *value;
+  if (!sealed[block->id]) {
+    // More predecessors may come; fill the phi in once they have.
+    value = newPhi(block);
+    incompletePhis[block->id].emplace_back(slot, value);
+  } else if (block->predecessors.size() == 1) {
+    value = readVariable(slot, block->predecessors[0]);
+  } else if (block->predecessors.empty()) {
+    value = undefinedValue();
+  } else {
+    // Recorded before the operands are looked up, so a loop that leads
+    // back here finds the phi and stops.
+    value = newPhi(block);
+    writeVariable(slot, block, value);
+    value = addPhiOperands(slot, value);
+  }
+  writeVariable(slot, block, value);
+  return value;
+}
+
+Instruction *Lowering::newPhi(BasicBlock *block) {
+  auto phi = make_unique<Instruction>(Opcode::Phi);
+  phi->block = block;
+  auto &instructions = block->instructions;
+  auto position = instructions.begin();
+  while (position != instructions.end() && (*position)->op == Opcode::Phi) {
+    ++position;
+  }
+  return instructions.insert(position, move(phi))->get();
+}
+
+Instruction *Lowering::addPhiOperands(uint32_t slot, Instruction *phi) {
+  for (BasicBlock *predecessor : phi->block->predecessors) {
+    phi->addOperand(readVariable(slot, predecessor));
+  }
+  return tryRemoveTrivialPhi(phi);
+}
+
+// A phi whose operands are all one value, or itself, is that value.
+Instruction *Lowering::tryRemoveTrivialPhi(Instruction *phi) {
+  Instruction *same = nullptr;
+  for (Instruction *operand : phi->operands) {
+    if (operand == same || operand == phi) {
+      continue;
+    }
+    if (same) {
+      return phi;
+    }
+    same = operand;
+  }
+  if (!same) {
+    same = undefinedValue();
+  }
+
+  vector<Instruction *> users;
+  for (Instruction *user : phi->users) {
+    if (user != phi) {
+      users.push_back(user);
+    }
+  }
+  phi->replaceAllUsesWith(same);
+  replaced.emplace(phi, same);
+  BasicBlock *block = phi->block;
+  phi->dropOperands();
+  phi->block = nullptr;
+  for (auto it = block->instructions.begin(); it != block->instructions.end();
+       ++it) {
+    if (it->get() == phi) {
+      removed.push_back(move(*it));
+      block->instructions.erase(it);
+      break;
+    }
+  }
+
+  // Removing this phi may have made the phis using it trivial as well.
+  for (Instruction *user : users) {
+    if (user->op == Opcode::Phi && user->block) {
+      tryRemoveTrivialPhi(user);
+    }
+  }
+  return same;
+}
+
+Instruction *Lowering::undefinedValue() {
+  if (undefined) {
+    return undefined;
+  }
+  // Locals start out null. The constant goes after the parameters, where it
+  // dominates everything.
+  auto null = make_unique<Instruction>(Opcode::ConstNull);
+  BasicBlock *entry = function->entry();
+  null->block = entry;
+  auto &instructions = entry->instructions;
+  auto position = instructions.begin();
+  while (position != instructions.end() && (*position)->op == Opcode::Param) {
+    ++position;
+  }
+  undefined = instructions.insert(position, move(null))->get();
+  return undefined;
+}
+
+void Lowering::seal(BasicBlock *block) {
+  // By index: filling one phi in never adds to this block's list, since
+  // the phi is already the block's value for its slot, but stay safe.
+  for (size_t i = 0; i < incompletePhis[block->id].size(); i++) {
+    auto [slot, phi] = incompletePhis[block->id][i];
+    addPhiOperands(slot, phi);
+  }
+  incompletePhis[block->id].clear();
+  sealed[block->id] = true;
+}
+
+template <typename Body> void Lowering::lowerBlock(const Body &body) {
+  for (const auto &stmt : body) {
+    if (!current) {
+      return;
+    }
+    lowerStmt(*stmt);
+  }
+}
+
+void Lowering::lowerStmt(const Stmt &stmt) {
+  switch (stmt.kind) {
+  case NodeType::VarDeclaration: {
+    auto &varDecl = static_cast<const VarDeclaration &>(stmt);
+    Instruction *value = varDecl.value
+                             ? lowerExpr(*varDecl.value)
+                             : constant(Opcode::ConstNull, varDecl.offset);
+    store(varDecl.binding, varDecl.identifier, value, varDecl.offset);
+    break;
+  }
+  case NodeType::FunctionDeclaration:
+  case NodeType::StructDeclaration:
+    break;
+  case NodeType::IfStatement:
+    lowerIf(static_cast<const IfStatement &>(stmt));
+    break;
+  case NodeType::WhileLoop:
+    lowerWhile(static_cast<const WhileLoop &>(stmt));
+    break;
+  case NodeType::ReturnStatement: {
+    auto &returnStmt = static_cast<const ReturnStatement &>(stmt);
+    Instruction *value =
+        returnStmt.returnValue
+            ? lowerExpr(static_cast<const Expr &>(*returnStmt.returnValue))
+            : constant(Opcode::ConstNull, returnStmt.offset);
+    add(Opcode::Return, returnStmt.offset, {value});
+    current = nullptr;
+    break;
+  }
+  default:
+    lowerExpr(static_cast<const Expr &>(stmt));
+    break;
+  }
+}
+
+void Lowering::lowerIf(const IfStatement &ifStmt) {
+  Instruction *condition = lowerExpr(*ifStmt.condition);
+  BasicBlock *thenBlock = newBlock();
+  BasicBlock *join = newBlock();
+  BasicBlock *elseBlock = ifStmt.elseBody.empty() ? join : newBlock();
+  branch(condition, thenBlock, elseBlock, ifStmt.offset);
+
+  seal(thenBlock);
+  current = thenBlock;
+  lowerBlock(ifStmt.ifBody);
+  if (current) {
+    jump(join, ifStmt.offset);
+  }
+  if (elseBlock != join) {
+    seal(elseBlock);
+    current = elseBlock;
+    lowerBlock(ifStmt.elseBody);
+    if (current) {
+      jump(join, ifStmt.offset);
+    }
+  }
+  seal(join);
+  current = join->predecessors.empty() ? nullptr : join;
+}
+
+void Lowering::lowerWhile(const WhileLoop &whileLoop) {
+  // The header stays unsealed until the back edge exists.
+  BasicBlock *header = newBlock();
+  jump(header, whileLoop.offset);
+  current = header;
+  Instruction *condition = lowerExpr(*whileLoop.condition);
+  BasicBlock *body = newBlock();
+  BasicBlock *exit = newBlock();
+  branch(condition, body, exit, whileLoop.offset);
+
+  seal(body);
+  current = body;
+  lowerBlock(whileLoop.loopBody);
+  if (current) {
+    jump(header, whileLoop.offset);
+  }
+  seal(header);
+  seal(exit);
+  current = exit;
+}
+
+void Lowering::store(const Binding &binding, const string &name,
+                     Instruction *value, uint32_t offset) {
+  if (binding.scope == Binding::Scope::Local) {
+    writeVariable(binding.slot, current, value);
+    return;
+  }
+  Instruction *store = add(Opcode::StoreGlobal, offset, {value});
+  store->text = name;
+  store->index = static_cast<int32_t>(binding.slot);
+}
+
+static Opcode binaryOpcode(const string &op) {
+  if (op == "+") {
+    return Opcode::Add;
+  }
+  if (op == "-") {
+    return Opcode::Sub;
+  }
+  if (op == "*") {
+    return Opcode::Mul;
+  }
+  if (op == "/") {
+    return Opcode::Div;
+  }
+  if (op == "%") {
+    return Opcode::Mod;
+  }
+  if (op == "<") {
+    return Opcode::Lt;
+  }
+  if (op == "<=") {
+    return Opcode::Le;
+  }
+  if (op == ">") {
+    return Opcode::Gt;
+  }
+  if (op == ">=") {
+    return Opcode::Ge;
+  }
+  if (op == "==") {
+    return Opcode::Eq;
+  }
+  return Opcode::Ne;
+}
+
+Instruction *Lowering::lowerExpr(const Expr &expr) {
+  switch (expr.kind) {
+  case NodeType::NumericLiteral: {
+    Instruction *value = constant(Opcode::ConstInt, expr.offset);
+    value->integer = static_cast<const NumericLiteral &>(expr).value;
+    return value;
+  }
+  case NodeType::FloatLiteral: {
+    Instruction *value = constant(Opcode::ConstFloat, expr.offset);
+    value->number = static_cast<const class FloatLiteral &>(expr).value;
+    return value;
+  }
+  case NodeType::StrLiteral: {
+    Instruction *value = constant(Opcode::ConstString, expr.offset);
+    value->text = static_cast<const StrLiteral &>(expr).value;
+    return value;
+  }
+  case NodeType::Null:
+    return constant(Opcode::ConstNull, expr.offset);
+  case NodeType::Identifier: {
+    auto &identifier = static_cast<const IdentifierExpr &>(expr);
+    if (identifier.binding.scope == Binding::Scope::Local) {
+      return readVariable(identifier.binding.slot, current);
+    }
+    Instruction *load = add(Opcode::LoadGlobal, expr.offset);
+    load->text = identifier.symbol;
+    load->index = static_cast<int32_t>(identifier.binding.slot);
+    return load;
+  }
+  case NodeType::BinaryExpr: {
+    auto &binaryExpr = static_cast<const BinaryExpr &>(expr);
+    Instruction *left = lowerExpr(*binaryExpr.left);
+    Instruction *right = lowerExpr(*binaryExpr.right);
+    return add(binaryOpcode(binaryExpr.binaryOperator), expr.offset,
+               {left, right});
+  }
+  case NodeType::UnaryExpr: {
+    auto &unaryExpr = static_cast<const UnaryExpr &>(expr);
+    Instruction *operand = lowerExpr(*unaryExpr.right);
+    return add(unaryExpr.op == "!" ? Opcode::Not : Opcode::Neg, expr.offset,
+               {operand});
+  }
+  case NodeType::LogicalExpr:
+    return lowerLogical(static_cast<const LogicalExpr &>(expr));
+  case NodeType::AssignmentExpr: {
+    auto &assignmentExpr = static_cast<const AssignmentExpr &>(expr);
+    const Expr &target = *assignmentExpr.assigne;
+    if (target.kind == NodeType::Identifier) {
+      auto &identifier = static_cast<const IdentifierExpr &>(target);
+      Instruction *value = lowerExpr(*assignmentExpr.value);
+      store(identifier.binding, identifier.symbol, value, expr.offset);
+      return value;
+    }
+    // The object is evaluated before the value, as the runtime does.
+    if (target.kind == NodeType::IndexExpr) {
+      auto &indexExpr = static_cast<const IndexExpr &>(target);
+      Instruction *array = lowerExpr(*indexExpr.object);
+      Instruction *index = lowerExpr(*indexExpr.index);
+      Instruction *value = lowerExpr(*assignmentExpr.value);
+      add(Opcode::SetIndex, expr.offset, {array, index, value});
+      return value;
+    }
+    auto &access = static_cast<const MemberAccessExpr &>(target);
+    Instruction *object = lowerExpr(*access.object);
+    Instruction *value = lowerExpr(*assignmentExpr.value);
+    Instruction *set = add(Opcode::SetField, expr.offset, {object, value});
+    set->text = access.memberName;
+    set->index = access.fieldIndex;
+    return value;
+  }
+  case NodeType::CallExpr: {
+    auto &callExpr = static_cast<const CallExpr &>(expr);
+    auto call = make_unique<Instruction>(Opcode::Call);
+    call->addOperand(lowerExpr(*callExpr.caller));
+    for (const auto &arg : callExpr.args) {
+      call->addOperand(lowerExpr(*arg));
+    }
+    call->offset = expr.offset;
+    call->block = current;
+    current->instructions.push_back(move(call));
+    return current->instructions.back().get();
+  }
+  case NodeType::MemberAccessExpr: {
+    auto &access = static_cast<const MemberAccessExpr &>(expr);
+    Instruction *get =
+        add(Opcode::GetField, expr.offset, {lowerExpr(*access.object)});
+    get->text = access.memberName;
+    get->index = access.fieldIndex;
+    return get;
+  }
+  case NodeType::ArrayLiteral: {
+    auto &arrayLiteral = static_cast<const ArrayLiteral &>(expr);
+    auto array = make_unique<Instruction>(Opcode::NewArray);
+    for (const auto &element : arrayLiteral.elements) {
+      array->addOperand(lowerExpr(*element));
+    }
+    array->offset = expr.offset;
+    array->block = current;
+    current->instructions.push_back(move(array));
+    return current->instructions.back().get();
+  }
+  case NodeType::IndexExpr: {
+    auto &indexExpr = static_cast<const IndexExpr &>(expr);
+    Instruction *array = lowerExpr(*indexExpr.object);
+    Instruction *index = lowerExpr(*indexExpr.index);
+    return add(Opcode::GetIndex, expr.offset, {array, index});
+  }
+  default:
+    // Parse errors; a program with any is never lowered.
+    return constant(Opcode::ConstNull, expr.offset);
+  }
+}
+
+Instruction *Lowering::lowerLogical(const LogicalExpr &logicalExpr) {
+  bool isAnd = logicalExpr.logicalOperator == "&&";
+  Instruction *left = lowerExpr(*logicalExpr.left);
+  // What the expression is when the right side is skipped.
+  Instruction *shortCircuit = constant(Opcode::ConstBool, logicalExpr.offset);
+  shortCircuit->integer = isAnd ? 0 : 1;
+
+  BasicBlock *right = newBlock();
+  BasicBlock *join = newBlock();
+  if (isAnd) {
+    branch(left, right, join, logicalExpr.offset);
+  } else {
+    branch(left, join, right, logicalExpr.offset);
+  }
+
+  seal(right);
+  current = right;
+  Instruction *rightValue = add(Opcode::ToBool, logicalExpr.offset,
+                                {lowerExpr(*logicalExpr.right)});
+  jump(join, logicalExpr.offset);
+  seal(join);
+
+  current = join;
+  Instruction *phi = newPhi(join);
+  phi->offset = logicalExpr.offset;
+  phi->addOperand(shortCircuit);
+  phi->addOperand(rightValue);
+  return phi;
+}
+
+void Lowering::lowerMain(const Program &program) {
+  begin("<main>", {});
+  lowerBlock(program.body);
+  end();
+}
+
+void Lowering::lowerFunction(const FunctionDeclaration &funcDecl) {
+  begin(funcDecl.name, funcDecl.parameters);
+  for (const Stmt *stmt : funcDecl.body) {
+    if (!current) {
+      break;
+    }
+    lowerStmt(*stmt);
+  }
+  end();
+}
+
+} // namespace
+
+Module lowerProgram(const Program &program) {
+  class Functions : public ConstASTVisitor<Functions> {
+  public:
+    Lowering &lowering;
+    Functions(Lowering &lowering) : lowering(lowering) {}
+
+    bool visitFunctionDeclaration(const FunctionDeclaration &funcDecl) {
+      lowering.lowerFunction(funcDecl);
+      return visitChildren(funcDecl);
+    }
+  };
+
+  Lowering lowering;
+  lowering.lowerMain(program);
+  Functions(lowering).visit(program);
+  return move(lowering.module);
+}
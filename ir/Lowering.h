@@ -0,0 +1,28 @@
+#ifndef LOWERING_H
+#define LOWERING_H
+
+#include "../ast/AST.h"
+#include "IR.h"
+
+// Lowers a program to SSA form. The program must have been bound by
+// resolveNames() without errors; layouts, when computed, give field
+// accesses their index. Every function declaration, nested ones included,
+// becomes a function of the module, after `<main>` for the top-level code.
+// Struct field initializers are not lowered: they run as part of the
+// constructing call.
+//
+// SSA form is built directly while walking the tree, following Braun et
+// al., "Simple and Efficient Construction of Static Single Assignment
+// Form": each block records the value each local last got in it, a use
+// looks the value up through the predecessors, and a block only gets phis
+// once all its predecessors are known (it is sealed). Phis that turn out to
+// merge a single value are removed on the spot, so the result has no
+// trivial phis. Code after a `return` is unreachable and not lowered; every
+// block of the result is reachable and dominators are computed.
+//
+// `&&` and `||` become control flow, since their right side may not run:
+// a branch on the left side and a phi of the constant outcome with the
+// truthiness of the right side.
+Module lowerProgram(const Program &program);
+
+#endif
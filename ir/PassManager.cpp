@@ -0,0 +1,93 @@
+#include "PassManager.h"
+#include "Passes.h"
+#include <chrono>
+
+const char *const defaultPipeline = "simplify-phis,gvn,dce";
+
+const vector<Pass> &registeredPasses() {
+  static const vector<Pass> passes = {
+      {"simplify-phis", "replace phis that merge a single value",
+       simplifyPhis},
+      {"gvn", "merge values computed again in a dominated block",
+       numberValues},
+      {"dce", "remove unused values that cannot fail", eliminateDeadCode},
+  };
+  return passes;
+}
+
+const Pass *findPass(const string &name) {
+  for (const Pass &pass : registeredPasses()) {
+    if (name == pass.name) {
+      return &pass;
+    }
+  }
+  return nullptr;
+}
+
+void PassManager::add(const Pass &pass) {
+  passes.push_back(pass);
+  PassStats entry;
+  entry.name = pass.name;
+  passStats.push_back(move(entry));
+}
+
+void PassManager::addPipeline(const string &names) {
+  size_t start = 0;
+  while (start <= names.size()) {
+    size_t end = names.find(',', start);
+    if (end == string::npos) {
+      end = names.size();
+    }
+    string name = names.substr(start, end - start);
+    start = end + 1;
+    if (name.empty()) {
+      continue;
+    }
+    if (name == "default") {
+      addPipeline(defaultPipeline);
+      continue;
+    }
+    const Pass *pass = findPass(name);
+    if (!pass) {
+      throw IRError("Unknown pass '" + name + "'");
+    }
+    add(*pass);
+  }
+}
+
+void PassManager::check(const Function &function, const string &after) {
+  vector<string> problems = verify(function);
+  if (problems.empty()) {
+    return;
+  }
+  string message = "Invalid IR in " + function.name + " " + after + ":";
+  for (const string &problem : problems) {
+    message += "\n  " + problem;
+  }
+  throw IRError(message);
+}
+
+void PassManager::run(Module &module) {
+  for (auto &function : module.functions) {
+    if (verifyEach) {
+      check(*function, "before the first pass");
+    }
+    for (size_t i = 0; i < passes.size(); i++) {
+      auto start = chrono::steady_clock::now();
+      bool changed = passes[i].run(*function);
+      if (changed) {
+        computeDominators(*function);
+        function->renumber();
+      }
+      auto end = chrono::steady_clock::now();
+      PassStats &entry = passStats[i];
+      entry.runs++;
+      entry.changed += changed;
+      entry.ns +=
+          chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+      if (changed && verifyEach) {
+        check(*function, string("after ") + passes[i].name);
+      }
+    }
+  }
+}
@@ -0,0 +1,63 @@
+#ifndef PASS_MANAGER_H
+#define PASS_MANAGER_H
+
+#include "IR.h"
+#include <stdexcept>
+
+class IRError : public runtime_error {
+public:
+  IRError(const string &message) : runtime_error(message) {}
+};
+
+// A transformation of one function. Returns whether it changed anything.
+// Passes may rely on the dominators being current when they start, and
+// must leave every block reachable.
+using PassFunction = bool (*)(Function &function);
+
+class Pass {
+public:
+  const char *name;
+  const char *description;
+  PassFunction run;
+};
+
+// Every pass that can be named in a pipeline, in a fixed order.
+const vector<Pass> &registeredPasses();
+const Pass *findPass(const string &name);
+// What addPipeline("default") adds.
+extern const char *const defaultPipeline;
+
+class PassStats {
+public:
+  string name;
+  // Functions the pass ran over, and how many it changed.
+  size_t runs = 0;
+  size_t changed = 0;
+  long long ns = 0;
+};
+
+// Runs a sequence of passes over every function of a module, one function
+// at a time.
+class PassManager {
+public:
+  void add(const Pass &pass);
+  // Adds the passes of a comma separated list of names, where "default"
+  // stands for defaultPipeline. Throws IRError on an unknown name.
+  void addPipeline(const string &names);
+  // Verifies each function before the first pass and after every pass that
+  // changed it, throwing IRError with the problems found. Off by default.
+  void setVerifyEach(bool enabled) { verifyEach = enabled; }
+
+  void run(Module &module);
+  // One entry per pass added, in order.
+  const vector<PassStats> &stats() const { return passStats; }
+
+private:
+  vector<Pass> passes;
+  vector<PassStats> passStats;
+  bool verifyEach = false;
+
+  void check(const Function &function, const string &after);
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include "Passes.h"
+#include <unordered_map>
+
+bool simplifyPhis(Function &function) {
+  bool changed = false;
+  bool again = true;
+  while (again) {
+    again = false;
+    for (auto &block : function.blocks) {
+      for (size_t i = 0; i < block->instructions.size(); i++) {
+        Instruction *phi = block->instructions[i].get();
+        if (phi->op != Opcode::Phi) {
+          break;
+        }
+        Instruction *same = nullptr;
+        bool trivial = true;
+        for (Instruction *operand : phi->operands) {
+          if (operand == phi || operand == same) {
+            continue;
+          }
+          if (same) {
+            trivial = false;
+            break;
+          }
+          same = operand;
+        }
+        if (!trivial || !same) {
+          continue;
+        }
+        phi->replaceAllUsesWith(same);
+        block->erase(phi);
+        i--;
+        again = changed = true;
+      }
+    }
+  }
+  return changed;
+}
+
+// Whether `instruction`'s value is determined by its opcode, payload and
+// operands alone.
+static bool isNumberable(const Instruction &instruction) {
+  return instruction.isConstant() || instruction.op == Opcode::Phi ||
+         (instruction.op >= Opcode::Add && instruction.op <= Opcode::ToBool);
+}
+
+// Identifies the value an instruction computes; equal keys, equal values.
+static string valueKey(const Instruction &instruction) {
+  string key;
+  auto append = [&key](const void *data, size_t size) {
+    key.append(static_cast<const char *>(data), size);
+  };
+  append(&instruction.op, sizeof(instruction.op));
+  append(&instruction.integer, sizeof(instruction.integer));
+  append(&instruction.number, sizeof(instruction.number));
+  // Phis only merge the same values when they sit in the same block.
+  if (instruction.op == Opcode::Phi) {
+    append(&instruction.block, sizeof(instruction.block));
+  }
+  vector<Instruction *> operands = instruction.operands;
+  if ((instruction.op == Opcode::Eq || instruction.op == Opcode::Ne) &&
+      operands[0] > operands[1]) {
+    swap(operands[0], operands[1]);
+  }
+  for (Instruction *operand : operands) {
+    append(&operand, sizeof(operand));
+  }
+  key += instruction.text;
+  return key;
+}
+
+bool numberValues(Function &function) {
+  bool changed = false;
+  unordered_map<string, Instruction *> available;
+  // Keys added in the dominator tree scopes still open, innermost last.
+  vector<string> added;
+
+  class Scope {
+  public:
+    BasicBlock *block;
+    size_t nextChild;
+    size_t firstAdded;
+  };
+  vector<Scope> scopes;
+  auto enter = [&](BasicBlock *block) {
+    scopes.push_back(Scope{block, 0, added.size()});
+    vector<Instruction *> redundant;
+    for (auto &instruction : block->instructions) {
+      if (!isNumberable(*instruction)) {
+        continue;
+      }
+      string key = valueKey(*instruction);
+      auto found = available.find(key);
+      if (found != available.end()) {
+        instruction->replaceAllUsesWith(found->second);
+        redundant.push_back(instruction.get());
+        continue;
+      }
+      available.emplace(key, instruction.get());
+      added.push_back(move(key));
+    }
+    for (Instruction *instruction : redundant) {
+      block->erase(instruction);
+    }
+    changed = changed || !redundant.empty();
+  };
+
+  enter(function.entry());
+  while (!scopes.empty()) {
+    Scope &scope = scopes.back();
+    if (scope.nextChild < scope.block->dominated.size()) {
+      enter(scope.block->dominated[scope.nextChild++]);
+      continue;
+    }
+    for (size_t i = scope.firstAdded; i < added.size(); i++) {
+      available.erase(added[i]);
+    }
+    added.resize(scope.firstAdded);
+    scopes.pop_back();
+  }
+  return changed;
+}
+
+bool eliminateDeadCode(Function &function) {
+  auto removable = [](const Instruction &instruction) {
+    return instruction.users.empty() && !instruction.canFail() &&
+           instruction.op != Opcode::Param;
+  };
+
+  vector<Instruction *> worklist;
+  for (auto &block : function.blocks) {
+    for (auto &instruction : block->instructions) {
+      if (removable(*instruction)) {
+        worklist.push_back(instruction.get());
+      }
+    }
+  }
+  bool changed = false;
+  while (!worklist.empty()) {
+    Instruction *instruction = worklist.back();
+    worklist.pop_back();
+    if (!instruction->block || !removable(*instruction)) {
+      continue;
+    }
+    vector<Instruction *> operands = instruction->operands;
+    instruction->block->erase(instruction);
+    changed = true;
+    for (Instruction *operand : operands) {
+      if (removable(*operand)) {
+        worklist.push_back(operand);
+      }
+    }
+  }
+  return changed;
+}
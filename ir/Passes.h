@@ -0,0 +1,26 @@
+#ifndef PASSES_H
+#define PASSES_H
+
+#include "IR.h"
+
+// The transformations the pass manager runs by name (ir/PassManager.h).
+// Each returns whether it changed the function.
+
+// "simplify-phis": replaces every phi whose operands are one value, apart
+// from the phi itself, by that value. Lowering leaves none of these behind,
+// but other passes can make them; this is copy propagation in SSA form.
+bool simplifyPhis(Function &function);
+
+// "gvn": global value numbering over the dominator tree. An instruction that
+// computes the same operation on the same operands as one dominating it is
+// replaced by that one. Only instructions whose result depends on nothing
+// but their operands take part: constants, arithmetic, comparisons and
+// phis of one block. One that may fail can still be merged, since the
+// dominating copy has failed first.
+bool numberValues(Function &function);
+
+// "dce": removes instructions whose value is unused and that can neither
+// fail nor have side effects.
+bool eliminateDeadCode(Function &function);
+
+#endif
@@ -0,0 +1,194 @@
+#include "../support/Json.h"
+#include "IR.h"
+#include <charconv>
+
+string opcodeName(Opcode op) {
+  switch (op) {
+  case Opcode::ConstNull:
+  case Opcode::ConstBool:
+  case Opcode::ConstInt:
+  case Opcode::ConstFloat:
+  case Opcode::ConstString:
+    return "const";
+  case Opcode::Param:
+    return "param";
+  case Opcode::Phi:
+    return "phi";
+  case Opcode::Add:
+    return "add";
+  case Opcode::Sub:
+    return "sub";
+  case Opcode::Mul:
+    return "mul";
+  case Opcode::Div:
+    return "div";
+  case Opcode::Mod:
+    return "mod";
+  case Opcode::Lt:
+    return "lt";
+  case Opcode::Le:
+    return "le";
+  case Opcode::Gt:
+    return "gt";
+  case Opcode::Ge:
+    return "ge";
+  case Opcode::Eq:
+    return "eq";
+  case Opcode::Ne:
+    return "ne";
+  case Opcode::Neg:
+    return "neg";
+  case Opcode::Not:
+    return "not";
+  case Opcode::ToBool:
+    return "tobool";
+  case Opcode::LoadGlobal:
+    return "load";
+  case Opcode::StoreGlobal:
+    return "store";
+  case Opcode::GetField:
+    return "getfield";
+  case Opcode::SetField:
+    return "setfield";
+  case Opcode::NewArray:
+    return "array";
+  case Opcode::GetIndex:
+    return "getindex";
+  case Opcode::SetIndex:
+    return "setindex";
+  case Opcode::Call:
+    return "call";
+  case Opcode::Jump:
+    return "jump";
+  case Opcode::Branch:
+    return "branch";
+  case Opcode::Return:
+    return "return";
+  }
+  return "unknown";
+}
+
+static void printBlockList(const vector<BasicBlock *> &blocks, ostream &out) {
+  for (size_t i = 0; i < blocks.size(); i++) {
+    out << (i ? ", bb" : "bb") << blocks[i]->id;
+  }
+}
+
+static void printPayload(const Instruction &instruction, ostream &out) {
+  switch (instruction.op) {
+  case Opcode::ConstNull:
+    out << " null";
+    break;
+  case Opcode::ConstBool:
+    out << (instruction.integer ? " true" : " false");
+    break;
+  case Opcode::ConstInt:
+    out << ' ' << instruction.integer;
+    break;
+  case Opcode::ConstFloat: {
+    char buffer[32];
+    auto result = to_chars(buffer, buffer + sizeof(buffer), instruction.number);
+    string_view text(buffer, result.ptr - buffer);
+    out << ' ' << text;
+    // Keep floats with integral values apart from integer constants.
+    if (text.find_first_not_of("-0123456789") == string_view::npos) {
+      out << ".0";
+    }
+    break;
+  }
+  case Opcode::ConstString:
+    out << ' ' << toJson(JsonValue(instruction.text));
+    break;
+  case Opcode::Param:
+    out << ' ' << instruction.index;
+    break;
+  case Opcode::LoadGlobal:
+  case Opcode::StoreGlobal:
+    out << " @" << instruction.text;
+    break;
+  default:
+    break;
+  }
+}
+
+static void printInstruction(const Instruction &instruction, ostream &out) {
+  out << "  ";
+  if (!instruction.isTerminator() && instruction.op != Opcode::StoreGlobal &&
+      instruction.op != Opcode::SetField &&
+      instruction.op != Opcode::SetIndex) {
+    out << '%' << instruction.id << " = ";
+  }
+  out << opcodeName(instruction.op);
+  printPayload(instruction, out);
+
+  const vector<Instruction *> &operands = instruction.operands;
+  const BasicBlock &block = *instruction.block;
+  switch (instruction.op) {
+  case Opcode::Phi:
+    for (size_t i = 0; i < operands.size(); i++) {
+      out << (i ? ", [%" : " [%") << operands[i]->id << ", bb"
+          << block.predecessors[i]->id << ']';
+    }
+    break;
+  case Opcode::GetField:
+  case Opcode::SetField:
+    out << " %" << operands[0]->id << '.' << instruction.text;
+    if (instruction.index >= 0) {
+      out << '#' << instruction.index;
+    }
+    for (size_t i = 1; i < operands.size(); i++) {
+      out << ", %" << operands[i]->id;
+    }
+    break;
+  case Opcode::Jump:
+  case Opcode::Branch:
+    for (Instruction *operand : operands) {
+      out << " %" << operand->id << ',';
+    }
+    out << ' ';
+    printBlockList(block.successors, out);
+    break;
+  default:
+    for (size_t i = 0; i < operands.size(); i++) {
+      out << (i || instruction.op == Opcode::StoreGlobal ? ", %" : " %")
+          << operands[i]->id;
+    }
+    break;
+  }
+  if (instruction.op == Opcode::Param) {
+    out << "  ; " << block.function->parameters[instruction.index];
+  }
+  out << '\n';
+}
+
+void printFunction(const Function &function, ostream &out) {
+  out << "func " << function.name << '(';
+  for (size_t i = 0; i < function.parameters.size(); i++) {
+    out << (i ? ", " : "") << function.parameters[i];
+  }
+  out << ") {\n";
+  for (const auto &block : function.blocks) {
+    out << "bb" << block->id << ':';
+    if (!block->predecessors.empty()) {
+      out << "  ; preds ";
+      printBlockList(block->predecessors, out);
+      if (block->idom) {
+        out << ", idom bb" << block->idom->id;
+      }
+    }
+    out << '\n';
+    for (const auto &instruction : block->instructions) {
+      printInstruction(*instruction, out);
+    }
+  }
+  out << "}\n";
+}
+
+void printModule(const Module &module, ostream &out) {
+  for (size_t i = 0; i < module.functions.size(); i++) {
+    if (i > 0) {
+      out << '\n';
+    }
+    printFunction(*module.functions[i], out);
+  }
+}
@@ -1,25 +1,41 @@
-// #include "Lexer.h"
+#include "Lexer.h"
+#include <algorithm>
 #include <cctype>
+#include <charconv>
 #include <exception>
 #include <iostream>
 #include <unordered_map>
-#include<fstream>
 using namespace std;
 
-unordered_map< string, TokenType> KEYWORDS = {
+static const unordered_map< string, TokenType> KEYWORDS = {
     {"null", Null},   {"let", Let},       {"const", Const},
     {"func", Func},   {"if", If},         {"else", Else},
-    {"while", While}, {"return", Return}, {"struct", StructToken}};
+    {"while", While}, {"return", Return}, {"struct", StructToken},
+    {"parallel", Parallel}};
 
-Token::Token(const  string &value, TokenType type)
-    : value(value), type(type) {}
+Token::Token(string value, TokenType type, uint32_t offset)
+    : value(move(value)), type(type), offset(offset), intValue(0) {}
 
- string Token::getValue() const { return value; }
+Token::Token(string value, TokenType type, uint32_t offset, int64_t intValue)
+    : value(move(value)), type(type), offset(offset), intValue(intValue) {}
+
+Token::Token(string value, TokenType type, uint32_t offset, double floatValue)
+    : value(move(value)), type(type), offset(offset), floatValue(floatValue) {}
+
+const string &Token::getValue() const { return value; }
 
 TokenType Token::getType() const { return type; }
 
-Lexer::Lexer(const  string &sourceCode)
-    : sourceCode(sourceCode), currentChar(sourceCode[0]) {
+uint32_t Token::getOffset() const { return offset; }
+
+int64_t Token::getInt() const { return intValue; }
+
+double Token::getFloat() const { return floatValue; }
+
+Lexer::Lexer(string_view sourceCode)
+    : sourceCode(sourceCode),
+      currentChar(sourceCode.empty() ? '\0' : sourceCode[0]), pos(0),
+      tokenOffset(0) {
   try {
     this->tokenize();
   }
@@ -34,7 +50,7 @@ void Lexer::createNumberToken() {
 
   int amountOfDots = 0;
 
-  while (!this->src.empty() &&
+  while (!atEnd() &&
          ( isdigit(this->peek()) || this->peek() == '.')) {
     if (this->peek() == '.')
       amountOfDots++;
@@ -42,31 +58,58 @@ void Lexer::createNumberToken() {
       this->unrecognizedChar(currentChar);
     num += this->eat();
   }
+
+  // from_chars ignores the locale and reports overflow instead of throwing.
+  // An out of range literal is reported but still becomes a token, so the
+  // parser does not pile follow-up errors on top.
+  const char *first = num.data();
+  const char *last = num.data() + num.size();
   if (amountOfDots == 0) {
-    tokens.push_back(Token(num, NumberLiteral));
+    int64_t value = 0;
+    from_chars_result result = from_chars(first, last, value);
+    if (result.ec == errc::result_out_of_range) {
+      errors.push_back(LexerError(
+          "Integer literal out of range: " + num, tokenOffset));
+      value = 0;
+    }
+    tokens.push_back(Token(move(num), NumberLiteral, tokenOffset, value));
   } else {
-    tokens.push_back(Token(num, FloatLiteral));
+    double value = 0;
+    from_chars_result result =
+        from_chars(first, last, value, chars_format::fixed);
+    if (result.ec == errc::result_out_of_range) {
+      // Too small to represent is simply zero; only too large is an error.
+      // The integer part tells which one happened.
+      const char *dot = find(first, last, '.');
+      if (find_if(first, dot, [](char c) { return c >= '1' && c <= '9'; }) !=
+          dot) {
+        errors.push_back(LexerError(
+            "Float literal out of range: " + num, tokenOffset));
+      }
+      value = 0;
+    }
+    tokens.push_back(Token(move(num), FloatLiteral, tokenOffset, value));
   }
 }
 
 void Lexer::createStringToken() {
    string stringLiteral;
 
-  while (!src.empty() && peek() != '"') {
+  while (!atEnd() && peek() != '"') {
     stringLiteral += eat();
   }
 
-  if (!src.empty() && peek() == '"') {
+  if (!atEnd() && peek() == '"') {
     eat();
-    tokens.push_back(Token(stringLiteral, TokenType::StringLiteral));
+    tokens.push_back(Token(move(stringLiteral), TokenType::StringLiteral, tokenOffset));
   } else {
     this->unrecognizedChar(currentChar);
   }
 }
 
 void Lexer::createAndToken() {
-  if (!src.empty() && this->peek() == '&') {
-    tokens.push_back(Token("&&", TokenType::And));
+  if (!atEnd() && this->peek() == '&') {
+    tokens.push_back(Token("&&", TokenType::And, tokenOffset));
     this->eat();
   } else {
     this->unrecognizedChar(currentChar);
@@ -74,8 +117,8 @@ void Lexer::createAndToken() {
 }
 
 void Lexer::createOrToken() {
-  if (!src.empty() && this->peek() == '|') {
-    tokens.push_back(Token("||", TokenType::Or));
+  if (!atEnd() && this->peek() == '|') {
+    tokens.push_back(Token("||", TokenType::Or, tokenOffset));
     this->eat();
   } else {
     this->unrecognizedChar(currentChar);
@@ -83,58 +126,66 @@ void Lexer::createOrToken() {
 }
 
 void Lexer::createBinaryOperatorToken() {
-  tokens.push_back(Token( string(1, currentChar), BinaryOperator));
+  tokens.push_back(Token( string(1, currentChar), BinaryOperator, tokenOffset));
 }
 
 void Lexer::createCompareToken( string firstChar,  string secondChar,
                                TokenType firstToken, TokenType secondToken) {
    string z = firstChar + secondChar;
   char c = secondChar[0];
-  if (!src.empty() && peek() == c) {
-    tokens.push_back(Token(z, firstToken));
+  if (!atEnd() && peek() == c) {
+    tokens.push_back(Token(move(z), firstToken, tokenOffset));
     this->eat();
   } else {
-    tokens.push_back(Token(firstChar, secondToken));
+    tokens.push_back(Token(move(firstChar), secondToken, tokenOffset));
   }
 }
 
 void Lexer::createOneCharToken( string tokenChar, TokenType charType) {
-  tokens.push_back(Token(tokenChar, charType));
+  tokens.push_back(Token(move(tokenChar), charType, tokenOffset));
 }
 
 void Lexer::createIdentifierToken() {
    string ident;
   ident += currentChar;
-  while (!src.empty() && ( isalnum(peek()) || peek() == '_')) {
+  while (!atEnd() && ( isalnum(peek()) || peek() == '_')) {
     ident += this->eat();
   }
 
   auto it = KEYWORDS.find(ident);
   if (it != KEYWORDS.end()) {
-    tokens.push_back(Token(ident, it->second));
+    tokens.push_back(Token(move(ident), it->second, tokenOffset));
   } else {
-    tokens.push_back(Token(ident, Identifier));
+    tokens.push_back(Token(move(ident), Identifier, tokenOffset));
   }
 }
 
 void Lexer::skipComments() {
-    while (!src.empty() && this->peek() != '\n') {
+    while (!atEnd() && this->peek() != '\n') {
         this->eat();
     }
 }
 
 void Lexer::tokenize() {
-  src =  vector<char>(sourceCode.begin(), sourceCode.end());
+  if (sourceCode.size() > UINT32_MAX) {
+    errors.push_back(
+        LexerError("Source files larger than 4 GiB are not supported", 0));
+    createOneCharToken("EndOfFile", TokenType::EOFToken);
+    return;
+  }
 
   try {
 
   
-  while (!src.empty()) {
+  while (!atEnd()) {
+    tokenOffset = pos;
     currentChar = this->eat();
 
     if (this->isSkippable(currentChar)) {
       continue;
     }
+    // A bad character is reported and skipped so one pass finds them all.
+    try {
     if ( isdigit(currentChar)) {
       createNumberToken();
     } else if (this->isAlpha(currentChar)) {
@@ -209,12 +260,28 @@ void Lexer::tokenize() {
         }
         break;
       default:
+        if (static_cast<unsigned char>(currentChar) >= 0x80) {
+          // Report a multi-byte UTF-8 character once, as a whole.
+          string character(1, currentChar);
+          while (!atEnd() &&
+                 (static_cast<unsigned char>(peek()) & 0xC0) == 0x80) {
+            character += eat();
+          }
+          throw LexerError(
+              "Unrecognized character found in source: " + character,
+              tokenOffset);
+        }
         this->unrecognizedChar(currentChar);
         break;
       }
     }
+    }
+    catch (const LexerError& e) {
+      errors.push_back(e);
+    }
   }
 
+  tokenOffset = pos;
   createOneCharToken("EndOfFile", TokenType::EOFToken);
   }
   catch (const  exception& e) {        
@@ -222,13 +289,11 @@ void Lexer::tokenize() {
   }
 }
 
-char Lexer::eat() {
-  char currentChar = this->src[0];
-  this->src.erase(this->src.begin());
-  return currentChar;
-}
+char Lexer::eat() { return this->sourceCode[pos++]; }
 
-char Lexer::peek() const { return this->src[0]; }
+char Lexer::peek() const { return atEnd() ? '\0' : this->sourceCode[pos]; }
+
+bool Lexer::atEnd() const { return pos >= this->sourceCode.size(); }
 
 bool Lexer::isAlpha(char c) const { return  isalpha(c) || c == '_'; }
 
@@ -241,10 +306,10 @@ bool Lexer::isInt(char c) const { return  isdigit(c); }
 void Lexer::unrecognizedChar(char c) const {
    string message = "Unrecognized character found in source: ";
   message += c;
-  throw LexerError(message);
+  throw LexerError(message, tokenOffset);
 }
 
- string Token::getTokenTypeName  () {
+ string Token::getTokenTypeName  () const {
   static const  map<TokenType,  string> tokenTypeNames = {
       {Null, "Null"},
       {NumberLiteral, "NumberLiteral"},
@@ -258,6 +323,7 @@ void Lexer::unrecognizedChar(char c) const {
       {If, "If"},
       {Else, "Else"},
       {While, "While"},
+      {Parallel, "Parallel"},
       {Return, "Return"},
       {EqualEqual, "EqualEqual"},
       {NotEqual, "NotEqual"},
@@ -288,26 +354,24 @@ void Lexer::unrecognizedChar(char c) const {
   }
 }
 
- vector<Token> Lexer::getTokens() { return this->tokens; }
+const vector<Token> &Lexer::getTokens() const { return tokens; }
+
+vector<Token> Lexer::takeTokens() { return move(tokens); }
 
-void Lexer::printTokens() {
-   cout << "[ " <<  endl;
-   vector<Token> tokens(this->getTokens());
-  for (int i=0;i<tokens.size();i++) {
-     cout<<" ["<< tokens[i].getValue()<<", " << tokens[i].getTokenTypeName  () <<"]";
-    if(i != tokens.size()-1 )  cout<<",";
-     cout<< endl;
+const vector<LexerError> &Lexer::getErrors() const { return errors; }
+
+void printTokens(const vector<Token> &tokens, ostream &out) {
+   out << "[ " <<  endl;
+  for (size_t i=0;i<tokens.size();i++) {
+     out<<" ["<< tokens[i].getValue()<<", " << tokens[i].getTokenTypeName  () <<"]";
+    if(i != tokens.size()-1 )  out<<",";
+     out<< endl;
   }
-   cout << "]" <<  endl;
+   out << "]" <<  endl;
 }
 
-void Lexer::saveTokensInFile(string filename){
-  ofstream out(filename);
-  if(!out.is_open()){
-    cerr << "Error in File Opening...";
-    
-  }
-  for(int i=0;i<tokens.size();i++){
+void writeTokens(const vector<Token> &tokens, ostream &out) {
+  for(size_t i=0;i<tokens.size();i++){
     out << tokens[i].getValue() << " " << tokens[i].getTokenTypeName  ()<<endl;
   }
 }
\ No newline at end of file
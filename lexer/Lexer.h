@@ -1,10 +1,13 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include <cstdint>
 #include <iostream>
 #include <stdexcept>
 #include <map>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 using namespace std;
 
@@ -26,6 +29,7 @@ enum TokenType {
   If,
   Else,
   While,
+  Parallel,
   Return,
   StructToken,
 
@@ -63,37 +67,75 @@ enum TokenType {
   EOFToken,
 };
 
+// Tokens are move-only: the lexer creates each one once, the compile result
+// owns them and everything downstream borrows them.
 class Token {
 public:
-  Token(const  string &value, TokenType type);
-   string getValue() const;
+  Token(string value, TokenType type, uint32_t offset = 0);
+  // Number tokens also carry their parsed value.
+  Token(string value, TokenType type, uint32_t offset, int64_t intValue);
+  Token(string value, TokenType type, uint32_t offset, double floatValue);
+  Token(Token &&) = default;
+  Token &operator=(Token &&) = default;
+  Token(const Token &) = delete;
+  Token &operator=(const Token &) = delete;
+
+  const string &getValue() const;
   TokenType getType() const;
-   string getTokenTypeName  ();
+  uint32_t getOffset() const;
+  // Only meaningful for NumberLiteral and FloatLiteral tokens respectively.
+  int64_t getInt() const;
+  double getFloat() const;
+   string getTokenTypeName  () const;
 
 private:
    string value;
   TokenType type;
+  // Byte offset of the first character in the source. Use a LineTable to
+  // turn it into a line and column.
+  uint32_t offset;
+  union {
+    int64_t intValue;
+    double floatValue;
+  };
+};
+
+static_assert(!is_copy_constructible<Token>::value &&
+                  !is_copy_assignable<Token>::value,
+              "tokens must be moved or borrowed, never copied");
+
+class LexerError : public  runtime_error {
+  public:
+      LexerError(const  string& message, uint32_t offset = 0)
+          :  runtime_error(message), offset(offset) {}
+      uint32_t offset;
 };
 
 class Lexer {
 public:
-  Lexer(const  string &sourceCode);
+  // Only reads `sourceCode` while constructing; it need not outlive the
+  // lexer.
+  Lexer(string_view sourceCode);
   void tokenize();
-  vector<Token> getTokens();
-  void printTokens();
-  void saveTokensInFile(string filename);
+  const vector<Token> &getTokens() const;
+  // Hands the tokens over, leaving the lexer empty.
+  vector<Token> takeTokens();
+  const vector<LexerError> &getErrors() const;
 
 private:
-  string sourceCode;
+  string_view sourceCode;
   char currentChar;
   vector<Token> tokens;
-  vector<char> src;
+  vector<LexerError> errors;
+  size_t pos;
+  uint32_t tokenOffset;
 
   bool isAlpha(char c) const;
   bool isSkippable(char c) const;
   bool isInt(char c) const;
   void unrecognizedChar(char c) const;
   char peek() const;
+  bool atEnd() const;
   char eat();
 
   void createNumberToken();
@@ -109,9 +151,7 @@ private:
   void skipComments();
 };
 
-class LexerError : public  runtime_error {
-  public:
-      LexerError(const  string& message) :  runtime_error(message) {}
-};
+void printTokens(const vector<Token> &tokens, ostream &out);
+void writeTokens(const vector<Token> &tokens, ostream &out);
 
 #endif
\ No newline at end of file
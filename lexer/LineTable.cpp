@@ -0,0 +1,32 @@
+#include "LineTable.h"
+#include <algorithm>
+
+LineTable::LineTable(string_view source) {
+  lineStarts.push_back(0);
+  for (size_t i = 0; i < source.size(); i++) {
+    if (source[i] == '\n') {
+      lineStarts.push_back(static_cast<uint32_t>(i + 1));
+    }
+  }
+}
+
+LineColumn LineTable::locate(uint32_t offset) const {
+  // The last line start that is <= offset.
+  auto it = upper_bound(lineStarts.begin(), lineStarts.end(), offset) - 1;
+  uint32_t line = static_cast<uint32_t>(it - lineStarts.begin());
+  return {line + 1, offset - *it + 1};
+}
+
+uint32_t LineTable::lineStart(uint32_t line) const {
+  if (line == 0) {
+    return 0;
+  }
+  if (line > lineStarts.size()) {
+    return lineStarts.back();
+  }
+  return lineStarts[line - 1];
+}
+
+uint32_t LineTable::lineCount() const {
+  return static_cast<uint32_t>(lineStarts.size());
+}
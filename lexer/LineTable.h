@@ -0,0 +1,31 @@
+#ifndef LINE_TABLE_H
+#define LINE_TABLE_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+using namespace std;
+
+class LineColumn {
+public:
+  // Both 1-based. Columns count bytes.
+  uint32_t line;
+  uint32_t column;
+};
+
+// Start offsets of every line in a source text. Tokens and nodes only store
+// a byte offset; this turns one into a line and column in O(log lines).
+class LineTable {
+public:
+  LineTable(string_view source);
+
+  LineColumn locate(uint32_t offset) const;
+  // Offset of the first byte of the 1-based `line`.
+  uint32_t lineStart(uint32_t line) const;
+  uint32_t lineCount() const;
+
+private:
+  vector<uint32_t> lineStarts;
+};
+
+#endif
@@ -0,0 +1,609 @@
+#include "LanguageServer.h"
+#include "../ast/Visitor.h"
+#include <algorithm>
+#include <charconv>
+
+// JSON-RPC and LSP error codes.
+static const int ParseErrorCode = -32700;
+static const int MethodNotFoundCode = -32601;
+static const int InvalidParamsCode = -32602;
+
+// SymbolKind values from the LSP specification.
+static const int FieldSymbol = 8;
+static const int FunctionSymbol = 12;
+static const int StructSymbol = 23;
+
+static const char *const SemanticTokenTypes[] = {"keyword", "variable",
+                                                 "number", "string",
+                                                 "operator"};
+
+// Index into SemanticTokenTypes, or -1 for tokens that are not highlighted.
+static int semanticTokenType(TokenType type) {
+  switch (type) {
+  case Null:
+  case Let:
+  case Const:
+  case Func:
+  case If:
+  case Else:
+  case While:
+  case Parallel:
+  case Return:
+  case StructToken:
+    return 0;
+  case Identifier:
+    return 1;
+  case NumberLiteral:
+  case FloatLiteral:
+    return 2;
+  case StringLiteral:
+    return 3;
+  case Equals:
+  case EqualEqual:
+  case NotEqual:
+  case LessThan:
+  case LessEqual:
+  case GreaterThan:
+  case GreaterEqual:
+  case BinaryOperator:
+  case And:
+  case Or:
+  case Not:
+    return 4;
+  default:
+    return -1;
+  }
+}
+
+// UTF-16 code units taken by the UTF-8 text in `bytes`.
+static uint32_t utf16Length(string_view bytes) {
+  uint32_t units = 0;
+  for (char c : bytes) {
+    unsigned char byte = static_cast<unsigned char>(c);
+    if ((byte & 0xC0) != 0x80) {
+      // Four byte sequences are outside the BMP and need a surrogate pair.
+      units += byte >= 0xF0 ? 2 : 1;
+    }
+  }
+  return units;
+}
+
+// Index of the first token at or after `offset`.
+static size_t tokenIndexAt(const vector<Token> &tokens, uint32_t offset) {
+  return lower_bound(tokens.begin(), tokens.end(), offset,
+                     [](const Token &token, uint32_t offset) {
+                       return token.getOffset() < offset;
+                     }) -
+         tokens.begin();
+}
+
+// Offset just past `token` in the source. String tokens do not keep their
+// quotes.
+static uint32_t tokenEnd(const Token &token) {
+  uint32_t length = static_cast<uint32_t>(token.getValue().size());
+  if (token.getType() == TokenType::StringLiteral) {
+    length += 2;
+  }
+  return token.getOffset() + length;
+}
+
+static void appendPosition(string &out, Position position) {
+  char buffer[16];
+  out += "{\"line\":";
+  out.append(buffer,
+             to_chars(buffer, buffer + sizeof(buffer), position.line).ptr);
+  out += ",\"character\":";
+  out.append(buffer,
+             to_chars(buffer, buffer + sizeof(buffer), position.character).ptr);
+  out += '}';
+}
+
+static Position readPosition(const JsonValue &value) {
+  return {static_cast<uint32_t>(value.get("line").asInt()),
+          static_cast<uint32_t>(value.get("character").asInt())};
+}
+
+// Ranges are the bulk of symbol and diagnostic replies, so they are
+// written straight to text rather than built as nested objects.
+static JsonValue rangeJson(const Document &document, uint32_t start,
+                           uint32_t end) {
+  string range = "{\"start\":";
+  appendPosition(range, document.positionAt(start));
+  range += ",\"end\":";
+  appendPosition(range, document.positionAt(end));
+  range += '}';
+  return JsonValue::raw(move(range));
+}
+
+Document::Document(string text, int64_t version)
+    : text(move(text)), version(version), lines(this->text) {}
+
+const string &Document::getText() const { return text; }
+
+int64_t Document::getVersion() const { return version; }
+
+void Document::applyChange(const JsonValue &change, int64_t version) {
+  const JsonValue &range = change.get("range");
+  const string &newText = change.get("text").asString();
+  if (range.isNull()) {
+    text = newText;
+  } else {
+    uint32_t start = offsetAt(readPosition(range.get("start")));
+    uint32_t end = offsetAt(readPosition(range.get("end")));
+    if (end < start) {
+      swap(start, end);
+    }
+    text.replace(start, end - start, newText);
+  }
+  lines = LineTable(text);
+  result.reset();
+  this->version = version;
+}
+
+const CompileResult &Document::compiled(CompilerContext &context) {
+  if (!result) {
+    result = make_unique<CompileResult>(context.compile(text));
+  }
+  return *result;
+}
+
+Position Document::positionAt(uint32_t offset) const {
+  offset = min(offset, static_cast<uint32_t>(text.size()));
+  LineColumn location = lines.locate(offset);
+  uint32_t start = lines.lineStart(location.line);
+  return {location.line - 1,
+          utf16Length(string_view(text).substr(start, offset - start))};
+}
+
+uint32_t Document::offsetAt(Position position) const {
+  if (position.line >= lines.lineCount()) {
+    return static_cast<uint32_t>(text.size());
+  }
+  size_t i = lines.lineStart(position.line + 1);
+  uint32_t units = 0;
+  while (i < text.size() && text[i] != '\n' && units < position.character) {
+    unsigned char byte = static_cast<unsigned char>(text[i]);
+    size_t length = byte < 0xC0 ? 1 : byte < 0xE0 ? 2 : byte < 0xF0 ? 3 : 4;
+    units += length == 4 ? 2 : 1;
+    i += length;
+  }
+  return static_cast<uint32_t>(min(i, text.size()));
+}
+
+namespace {
+
+// Builds the DocumentSymbol tree: functions and structs wherever they are
+// declared, with nested declarations and struct fields as children.
+class SymbolCollector : public ConstASTVisitor<SymbolCollector> {
+public:
+  SymbolCollector(const Document &document, const vector<Token> &tokens)
+      : document(document), tokens(tokens) {}
+
+  JsonValue symbols = JsonValue::array();
+
+  bool visitProgram(const Program &program) { return visitBlock(program.body); }
+
+  bool visitFunctionDeclaration(const FunctionDeclaration &funcDecl) {
+    JsonValue outer = move(symbols);
+    symbols = JsonValue::array();
+    visitBlock(funcDecl.body);
+    JsonValue symbol =
+        declaration(funcDecl.offset, funcDecl.name, FunctionSymbol, true);
+    symbol.set("children", move(symbols));
+    symbols = move(outer);
+    symbols.push(move(symbol));
+    return true;
+  }
+
+  bool visitIfStatement(const IfStatement &ifStmt) {
+    return visitBlock(ifStmt.ifBody) && visitBlock(ifStmt.elseBody);
+  }
+
+  bool visitWhileLoop(const WhileLoop &whileLoop) {
+    return visitBlock(whileLoop.loopBody);
+  }
+
+  bool visitStructDeclaration(const StructDeclaration &structDecl) {
+    JsonValue fields = JsonValue::array();
+    for (const auto &field : structDecl.structBody) {
+      if (field->kind == NodeType::VarDeclaration) {
+        fields.push(declaration(
+            field->offset, static_cast<const VarDeclaration &>(*field).identifier,
+            FieldSymbol, false));
+      }
+    }
+    JsonValue symbol = declaration(structDecl.offset, structDecl.structName,
+                                   StructSymbol, true);
+    symbol.set("children", move(fields));
+    symbols.push(move(symbol));
+    return true;
+  }
+
+private:
+  const Document &document;
+  const vector<Token> &tokens;
+
+  // Declarations only sit directly in blocks, so the walk enters the
+  // statements that hold blocks and never an expression.
+  template <typename List> bool visitBlock(const List &stmts) {
+    for (const auto &stmt : stmts) {
+      switch (stmt->kind) {
+      case NodeType::FunctionDeclaration:
+      case NodeType::StructDeclaration:
+      case NodeType::IfStatement:
+      case NodeType::WhileLoop:
+        visit(*stmt);
+        break;
+      default:
+        break;
+      }
+    }
+    return true;
+  }
+
+  // The declaration starting at `offset` runs to its closing brace when it
+  // has a body, otherwise to its ';'. Its name is the first identifier after
+  // the keyword.
+  JsonValue declaration(uint32_t offset, const string &name, int kind,
+                        bool hasBody) {
+    size_t first = tokenIndexAt(tokens, offset);
+    size_t nameIndex = first;
+    while (nameIndex < tokens.size() &&
+           tokens[nameIndex].getType() != TokenType::Identifier &&
+           tokens[nameIndex].getType() != TokenType::EOFToken) {
+      nameIndex++;
+    }
+    uint32_t nameStart = offset;
+    uint32_t nameEnd = offset;
+    if (nameIndex < tokens.size() &&
+        tokens[nameIndex].getType() == TokenType::Identifier) {
+      nameStart = tokens[nameIndex].getOffset();
+      nameEnd = tokenEnd(tokens[nameIndex]);
+    }
+
+    uint32_t end = nameEnd;
+    size_t depth = 0;
+    for (size_t i = nameIndex; i < tokens.size(); i++) {
+      TokenType type = tokens[i].getType();
+      if (type == TokenType::EOFToken) {
+        break;
+      }
+      end = tokenEnd(tokens[i]);
+      if (type == TokenType::OpenBrace) {
+        depth++;
+      } else if (type == TokenType::CloseBrace) {
+        if (depth <= 1) {
+          break;
+        }
+        depth--;
+      } else if (!hasBody && type == TokenType::Semicolon) {
+        break;
+      }
+    }
+
+    JsonValue symbol = JsonValue::object();
+    symbol.set("name", name);
+    symbol.set("kind", kind);
+    symbol.set("range", rangeJson(document, offset, end));
+    symbol.set("selectionRange", rangeJson(document, nameStart, nameEnd));
+    return symbol;
+  }
+};
+
+} // namespace
+
+int LanguageServer::run(istream &in, ostream &out) {
+  this->out = &out;
+  string body;
+  while (true) {
+    // Edits typed in a burst arrive back to back; their diagnostics are
+    // published once, for the last of them, when no more input is waiting,
+    // or before the first message of another kind; see handle().
+    if (in.rdbuf()->in_avail() <= 0) {
+      publishStaleDiagnostics();
+    }
+    if (!readMessage(in, body)) {
+      publishStaleDiagnostics();
+      break;
+    }
+    JsonValue message;
+    try {
+      message = parseJson(body);
+    } catch (const JsonError &e) {
+      respondError(nullptr, ParseErrorCode, e.what());
+      continue;
+    }
+    if (!handle(message)) {
+      return shutdownRequested ? 0 : 1;
+    }
+  }
+  return shutdownRequested ? 0 : 1;
+}
+
+bool LanguageServer::readMessage(istream &in, string &body) {
+  static const string lengthHeader = "content-length:";
+  string line;
+  size_t length = 0;
+  bool sawLength = false;
+  while (getline(in, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (line.empty()) {
+      if (sawLength) {
+        break;
+      }
+      continue;
+    }
+    string lower = line.substr(0, lengthHeader.size());
+    transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    if (lower == lengthHeader) {
+      length = strtoul(line.c_str() + lengthHeader.size(), nullptr, 10);
+      sawLength = true;
+    }
+  }
+  if (!in || !sawLength) {
+    return false;
+  }
+  body.resize(length);
+  in.read(&body[0], length);
+  return static_cast<size_t>(in.gcount()) == length;
+}
+
+void LanguageServer::send(const JsonValue &message) {
+  string body = ::toJson(message);
+  *out << "Content-Length: " << body.size() << "\r\n\r\n" << body;
+  out->flush();
+}
+
+void LanguageServer::respond(const JsonValue &id, JsonValue result) {
+  JsonValue message = JsonValue::object();
+  message.set("jsonrpc", "2.0");
+  message.set("id", id);
+  message.set("result", move(result));
+  send(message);
+}
+
+void LanguageServer::respondError(const JsonValue &id, int code,
+                                  const string &text) {
+  JsonValue error = JsonValue::object();
+  error.set("code", code);
+  error.set("message", text);
+  JsonValue message = JsonValue::object();
+  message.set("jsonrpc", "2.0");
+  message.set("id", id);
+  message.set("error", move(error));
+  send(message);
+}
+
+void LanguageServer::notify(const string &method, JsonValue params) {
+  JsonValue message = JsonValue::object();
+  message.set("jsonrpc", "2.0");
+  message.set("method", method);
+  message.set("params", move(params));
+  send(message);
+}
+
+bool LanguageServer::handle(const JsonValue &message) {
+  if (!message.get("method").isString()) {
+    // A response to something the server never sends; nothing to do.
+    return true;
+  }
+  const string &method = message.get("method").asString();
+  const JsonValue &id = message.get("id");
+  const JsonValue &params = message.get("params");
+  bool isRequest = message.has("id");
+  // A client that never lets input go idle, or a script that ends with
+  // `shutdown`, still gets diagnostics for its last edit.
+  if (method != "textDocument/didChange") {
+    publishStaleDiagnostics();
+  }
+
+  try {
+    if (method == "initialize") {
+      respond(id, initialize());
+    } else if (method == "shutdown") {
+      shutdownRequested = true;
+      respond(id, nullptr);
+    } else if (method == "exit") {
+      return false;
+    } else if (method == "textDocument/didOpen") {
+      didOpen(params);
+    } else if (method == "textDocument/didChange") {
+      didChange(params);
+    } else if (method == "textDocument/didClose") {
+      didClose(params);
+    } else if (method == "textDocument/documentSymbol") {
+      respond(id, documentSymbols(params));
+    } else if (method == "textDocument/semanticTokens/full") {
+      respond(id, semanticTokens(params));
+    } else if (isRequest) {
+      respondError(id, MethodNotFoundCode, "Method not found: " + method);
+    }
+  } catch (const JsonError &e) {
+    if (isRequest) {
+      respondError(id, InvalidParamsCode, e.what());
+    }
+  }
+  return true;
+}
+
+JsonValue LanguageServer::initialize() {
+  JsonValue sync = JsonValue::object();
+  sync.set("openClose", true);
+  sync.set("change", 2); // Incremental
+
+  JsonValue tokenTypes = JsonValue::array();
+  for (const char *type : SemanticTokenTypes) {
+    tokenTypes.push(type);
+  }
+  JsonValue legend = JsonValue::object();
+  legend.set("tokenTypes", move(tokenTypes));
+  legend.set("tokenModifiers", JsonValue::array());
+  JsonValue semanticTokens = JsonValue::object();
+  semanticTokens.set("legend", move(legend));
+  semanticTokens.set("full", true);
+
+  JsonValue capabilities = JsonValue::object();
+  capabilities.set("textDocumentSync", move(sync));
+  capabilities.set("documentSymbolProvider", true);
+  capabilities.set("semanticTokensProvider", move(semanticTokens));
+
+  JsonValue serverInfo = JsonValue::object();
+  serverInfo.set("name", "tlc-lsp");
+
+  JsonValue result = JsonValue::object();
+  result.set("capabilities", move(capabilities));
+  result.set("serverInfo", move(serverInfo));
+  return result;
+}
+
+Document &LanguageServer::document(const JsonValue &params) {
+  const string &uri = params.get("textDocument").get("uri").asString();
+  auto it = documents.find(uri);
+  if (it == documents.end()) {
+    throw JsonError("Unknown document: " + uri);
+  }
+  return it->second;
+}
+
+void LanguageServer::didOpen(const JsonValue &params) {
+  const JsonValue &item = params.get("textDocument");
+  const string &uri = item.get("uri").asString();
+  documents.erase(uri);
+  Document &opened =
+      documents
+          .emplace(uri, Document(item.get("text").asString(),
+                                 item.get("version").asInt()))
+          .first->second;
+  publishDiagnostics(uri, opened);
+}
+
+void LanguageServer::didChange(const JsonValue &params) {
+  Document &changed = document(params);
+  int64_t version = params.get("textDocument").get("version").asInt();
+  for (const JsonValue &change : params.get("contentChanges").items()) {
+    changed.applyChange(change, version);
+  }
+  stale.insert(params.get("textDocument").get("uri").asString());
+}
+
+void LanguageServer::didClose(const JsonValue &params) {
+  const string &uri = params.get("textDocument").get("uri").asString();
+  documents.erase(uri);
+  stale.erase(uri);
+  JsonValue cleared = JsonValue::object();
+  cleared.set("uri", uri);
+  cleared.set("diagnostics", JsonValue::array());
+  notify("textDocument/publishDiagnostics", move(cleared));
+}
+
+void LanguageServer::publishStaleDiagnostics() {
+  for (const string &uri : stale) {
+    auto it = documents.find(uri);
+    if (it != documents.end()) {
+      publishDiagnostics(uri, it->second);
+    }
+  }
+  stale.clear();
+}
+
+void LanguageServer::publishDiagnostics(const string &uri,
+                                        Document &document) {
+  const CompileResult &result = document.compiled(context);
+  const string &text = document.getText();
+
+  JsonValue diagnostics = JsonValue::array();
+  for (const Diagnostic &diagnostic : result.diagnostics) {
+    // Underline the token the diagnostic points at, or one character when
+    // there is none.
+    uint32_t end = diagnostic.offset;
+    size_t index = tokenIndexAt(result.tokens, diagnostic.offset);
+    if (index < result.tokens.size() &&
+        result.tokens[index].getOffset() == diagnostic.offset &&
+        result.tokens[index].getType() != TokenType::EOFToken) {
+      end = tokenEnd(result.tokens[index]);
+    } else if (end < text.size() && text[end] != '\n') {
+      end++;
+    }
+
+    JsonValue entry = JsonValue::object();
+    entry.set("range", rangeJson(document, diagnostic.offset, end));
+    entry.set("severity",
+              diagnostic.severity == DiagnosticSeverity::Error ? 1 : 2);
+    entry.set("source", "tlc");
+    entry.set("message", diagnostic.message);
+    diagnostics.push(move(entry));
+  }
+
+  JsonValue params = JsonValue::object();
+  params.set("uri", uri);
+  params.set("version", document.getVersion());
+  params.set("diagnostics", move(diagnostics));
+  notify("textDocument/publishDiagnostics", move(params));
+}
+
+JsonValue LanguageServer::documentSymbols(const JsonValue &params) {
+  Document &doc = document(params);
+  const CompileResult &result = doc.compiled(context);
+  SymbolCollector collector(doc, result.tokens);
+  collector.visit(*result.program);
+  return move(collector.symbols);
+}
+
+// Encoded as LSP expects: five integers per token, with line and start
+// relative to the previous token. Tokens come in source order, so lines are
+// found by walking forward instead of a lookup per token.
+JsonValue LanguageServer::semanticTokens(const JsonValue &params) {
+  Document &doc = document(params);
+  const CompileResult &result = doc.compiled(context);
+  const LineTable &lines = result.lines();
+  string_view text = result.source;
+
+  string data = "[";
+  auto append = [&data](uint32_t value) {
+    char buffer[16];
+    if (data.size() > 1) {
+      data += ',';
+    }
+    data.append(buffer, to_chars(buffer, buffer + sizeof(buffer), value).ptr);
+  };
+
+  uint32_t line = 0;
+  uint32_t lineStart = 0;
+  uint32_t nextLineStart = lines.lineStart(2);
+  bool lastLine = lines.lineCount() == 1;
+  Position previous = {0, 0};
+  for (const Token &token : result.tokens) {
+    int type = semanticTokenType(token.getType());
+    if (type < 0) {
+      continue;
+    }
+    uint32_t offset = token.getOffset();
+    while (!lastLine && offset >= nextLineStart) {
+      line++;
+      lineStart = nextLineStart;
+      lastLine = line + 1 == lines.lineCount();
+      nextLineStart = lines.lineStart(line + 2);
+    }
+    uint32_t end = tokenEnd(token);
+    // Tokens may not span lines unless the client opts in.
+    if (!lastLine && end > nextLineStart) {
+      continue;
+    }
+    Position start = {line,
+                      utf16Length(text.substr(lineStart, offset - lineStart))};
+    append(start.line - previous.line);
+    append(start.line == previous.line ? start.character - previous.character
+                                       : start.character);
+    append(utf16Length(text.substr(offset, end - offset)));
+    append(static_cast<uint32_t>(type));
+    append(0);
+    previous = start;
+  }
+  data += ']';
+
+  JsonValue tokens = JsonValue::object();
+  tokens.set("data", JsonValue::raw(move(data)));
+  return tokens;
+}
@@ -0,0 +1,84 @@
+#ifndef LANGUAGE_SERVER_H
+#define LANGUAGE_SERVER_H
+
+#include "../compiler/Compiler.h"
+#include "../lexer/LineTable.h"
+#include "../support/Json.h"
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+// A place in a document the way LSP counts: 0-based line, and a character
+// offset in UTF-16 code units within that line.
+class Position {
+public:
+  uint32_t line;
+  uint32_t character;
+};
+
+// An open document and the compilation of its current text. The text is
+// compiled on first use after each edit, and the result serves every request
+// until the next edit.
+class Document {
+public:
+  Document(string text, int64_t version);
+
+  const string &getText() const;
+  int64_t getVersion() const;
+
+  // Applies one entry of didChange's contentChanges: a ranged replacement,
+  // or the whole text when the entry has no range.
+  void applyChange(const JsonValue &change, int64_t version);
+  const CompileResult &compiled(CompilerContext &context);
+
+  Position positionAt(uint32_t offset) const;
+  uint32_t offsetAt(Position position) const;
+
+private:
+  string text;
+  int64_t version;
+  LineTable lines;
+  unique_ptr<CompileResult> result;
+};
+
+// Language server speaking JSON-RPC with Content-Length framing, as editors
+// run it over stdio. Supports incremental text sync, diagnostics, document
+// symbols for functions and structs, and semantic tokens derived from the
+// lexer's token types.
+class LanguageServer {
+public:
+  // Serves one client until it sends `exit` or closes `in`. Returns the
+  // process exit code the protocol asks for.
+  int run(istream &in, ostream &out);
+
+private:
+  CompilerContext context;
+  unordered_map<string, Document> documents;
+  // Documents edited since their diagnostics were last published.
+  unordered_set<string> stale;
+  ostream *out = nullptr;
+  bool shutdownRequested = false;
+
+  bool readMessage(istream &in, string &body);
+  void send(const JsonValue &message);
+  void respond(const JsonValue &id, JsonValue result);
+  void respondError(const JsonValue &id, int code, const string &message);
+  void notify(const string &method, JsonValue params);
+
+  // Returns false once the client asked the server to exit.
+  bool handle(const JsonValue &message);
+  JsonValue initialize();
+  void didOpen(const JsonValue &params);
+  void didChange(const JsonValue &params);
+  void didClose(const JsonValue &params);
+  JsonValue documentSymbols(const JsonValue &params);
+  JsonValue semanticTokens(const JsonValue &params);
+  void publishStaleDiagnostics();
+  void publishDiagnostics(const string &uri, Document &document);
+
+  Document &document(const JsonValue &params);
+};
+
+#endif
@@ -0,0 +1,9 @@
+#include "LanguageServer.h"
+
+// Editors start this with the protocol on stdin/stdout; nothing else may be
+// written to stdout.
+int main() {
+  ios::sync_with_stdio(false);
+  LanguageServer server;
+  return server.run(cin, cout);
+}
@@ -1,49 +1,362 @@
 #include<iostream>
 #include<fstream>
+#include<chrono>
+#include<cctype>
+#include<cerrno>
+#include<cstdlib>
+#include<iomanip>
+#include<sstream>
 using namespace std;
 
-#include "ast/AST.h"
-#include "lexer/Lexer.h"
-#include "parser/Parser.h"
+#include "compiler/Batch.h"
+#include "compiler/Compiler.h"
+#include "ir/Lowering.h"
+#include "ir/PassManager.h"
+#include "runtime/Interpreter.h"
 
-#include "lexer/Lexer.cpp"
-#include "ast/AST.cpp"
-#include "ast/PrinterAST.cpp"
-#include "parser/Parser.cpp"
-#include "parser/ParserExpr.cpp"
-#include "parser/ParserStml.cpp"
+static bool readSource(const string &filename, string &source) {
+    ifstream file(filename);
+    if (!file.is_open()) {
+        cerr << "Error: Unable to open the file." << endl;
+        return false;
+    }
+    string line;
+    while (getline(file, line)) {
+        source += line;
+        source += '\n';
+    }
+    return true;
+}
 
-int main(){
+static void printDiagnostics(const string &filename,
+                             const CompileResult &result) {
+    for (const Diagnostic &diagnostic : result.diagnostics) {
+        cerr << filename << ":" << diagnostic.line << ":" << diagnostic.column
+             << ": " << severityName(diagnostic.severity) << ": "
+             << diagnostic.message << endl;
+    }
+}
 
-    // const  string str=" int main() { \nint a=10,b=20;\n a = a+b;\n printf(a); \n} #this is commment.\n";
-     ifstream file("code.tl");
+// A byte count with an optional k, m or g suffix, as in 64m.
+static size_t parseBytes(const char *text) {
+    char *end;
+    size_t bytes = strtoull(text, &end, 10);
+    switch (*end) {
+    case 'k':
+    case 'K':
+        return bytes << 10;
+    case 'm':
+    case 'M':
+        return bytes << 20;
+    case 'g':
+    case 'G':
+        return bytes << 30;
+    default:
+        return bytes;
+    }
+}
 
-    if (!file.is_open()) {
-         cout << "Error: Unable to open the file." <<  endl;
-        return 0; 
+// Bounds for the numeric options, well past any useful setting.
+static const size_t maxWorkers = 1024;
+static const size_t maxInlineThreshold = 1000000;
+static const size_t maxProfileInterval = 1000000000;
+
+// The decimal value of an option such as --workers=N, which must lie in
+// [min, max]. Reports a usage error and returns false otherwise.
+static bool parseCount(const string &arg, size_t min, size_t max,
+                       size_t &count) {
+    size_t equals = arg.find('=');
+    const char *text = arg.c_str() + equals + 1;
+    char *end;
+    errno = 0;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (!isdigit(static_cast<unsigned char>(*text)) || *end != '\0' ||
+        errno == ERANGE || value < min || value > max) {
+        cerr << "Error: " << arg.substr(0, equals)
+             << " expects an integer from " << min << " to " << max
+             << ", not '" << text << "'." << endl;
+        return false;
     }
-     string sourceCode="";
-     string line="";
-    while( getline(file,line)){
-        //  cout<<"inside"<< endl;
-        sourceCode+=line;
-        sourceCode+='\n';
+    count = value;
+    return true;
+}
+
+// "H hits, M misses (R% hit rate)" for an inline cache.
+static string hitRate(size_t hits, size_t misses) {
+    size_t lookups = hits + misses;
+    ostringstream text;
+    text << hits << " hits, " << misses << " misses (" << fixed
+         << setprecision(1) << (lookups ? 100.0 * hits / lookups : 0.0)
+         << "% hit rate)";
+    return text.str();
+}
+
+// tlc --run [--stats] [--no-frame-alloc] [--no-inline]
+//           [--inline-threshold=N] [--no-loop-opt] [--heap-limit=BYTES]
+//           [--nursery=BYTES] [--no-inline-cache] [--no-tail-calls]
+//           [--profile=FILE] [--profile-interval=N] [--no-quicken]
+//           [--workers=N] file
+//
+// --profile writes a folded stack profile of the run to FILE, for flame
+// graph tools, and prints the hottest functions and lines. --workers sets
+// how many threads run parallel loops; by default, one per hardware thread.
+// The program's readLine() reads standard input.
+static int runFile(int argc, char **argv) {
+    bool showStats = false;
+    InterpreterOptions options;
+    options.input = &cin;
+    bool frameAllocation = true;
+    bool inlining = true;
+    InlineOptions inlineOptions;
+    bool loopOptimization = true;
+    bool tailCalls = true;
+    string profileFile;
+    ProfilerOptions profilerOptions;
+    string filename;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--stats") {
+            showStats = true;
+        } else if (arg == "--no-frame-alloc") {
+            frameAllocation = false;
+        } else if (arg == "--no-inline") {
+            inlining = false;
+        } else if (arg.rfind("--inline-threshold=", 0) == 0) {
+            if (!parseCount(arg, 0, maxInlineThreshold,
+                            inlineOptions.maxSize)) {
+                return 1;
+            }
+        } else if (arg == "--no-loop-opt") {
+            loopOptimization = false;
+        } else if (arg.rfind("--heap-limit=", 0) == 0) {
+            options.heap.maxHeapBytes = parseBytes(arg.c_str() + 13);
+        } else if (arg.rfind("--nursery=", 0) == 0) {
+            options.heap.nurseryBytes = parseBytes(arg.c_str() + 10);
+        } else if (arg == "--no-inline-cache") {
+            options.inlineCaches = false;
+        } else if (arg == "--no-quicken") {
+            options.quickening = false;
+        } else if (arg.rfind("--workers=", 0) == 0) {
+            if (!parseCount(arg, 0, maxWorkers, options.workers)) {
+                return 1;
+            }
+        } else if (arg == "--no-tail-calls") {
+            tailCalls = false;
+        } else if (arg.rfind("--profile=", 0) == 0) {
+            profileFile = arg.substr(10);
+        } else if (arg.rfind("--profile-interval=", 0) == 0) {
+            if (!parseCount(arg, 1, maxProfileInterval,
+                            profilerOptions.interval)) {
+                return 1;
+            }
+        } else {
+            filename = arg;
+        }
+    }
+    string source;
+    if (filename.empty() || !readSource(filename, source)) {
+        return 1;
     }
 
-    Lexer *lex=new Lexer(sourceCode);
-    lex->printTokens();
+    CompilerContext context;
+    context.setBuiltins(Interpreter::builtinNames());
+    context.setFrameAllocation(frameAllocation);
+    context.setInlining(inlining, inlineOptions);
+    context.setLoopOptimization(loopOptimization);
+    context.setTailCalls(tailCalls);
+    CompileResult result = context.compile(source);
+    if (result.ok()) {
+        context.analyze(result);
+    }
+    printDiagnostics(filename, result);
+    if (!result.ok()) {
+        return 1;
+    }
 
-    lex->saveTokensInFile("Tokenized.txt");
-    // ofstream output("output.txt");
-    // if(!output){
-    //     cerr<< "Error opening files... ";
-    // }
-    // for(int i=0;i<){
+    Profiler profiler(profilerOptions);
+    if (!profileFile.empty()) {
+        options.profiler = &profiler;
+    }
+    Interpreter interpreter(result, cout, options);
+    int status = 0;
+    auto start = chrono::steady_clock::now();
+    try {
+        interpreter.run();
+    } catch (const RuntimeError &e) {
+        cout.flush();
+        LineColumn position = result.lines().locate(e.offset);
+        cerr << filename << ":" << position.line << ":" << position.column
+             << ": runtime error: " << e.what() << endl;
+        status = 1;
+    }
+    auto end = chrono::steady_clock::now();
+    if (options.profiler) {
+        ofstream profile(profileFile);
+        if (!profile.is_open()) {
+            cerr << "Error: Unable to write the profile." << endl;
+            return 1;
+        }
+        profiler.writeFolded(profile, result.lines());
+        profiler.writeSummary(cerr, result.lines());
+    }
+    if (showStats) {
+        const RuntimeStats &stats = interpreter.stats();
+        const HeapStats &heap = stats.heap;
+        long long runNs =
+            chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+        const ProgramAnalysis &analysis = *result.analysis;
+        cerr << "inlined call sites: " << analysis.inlining.sites << "\n"
+             << "folded constants: " << analysis.inlining.folded << "\n"
+             << "optimized loops: " << analysis.loops.loops << "\n"
+             << "hoisted expressions: " << analysis.loops.hoisted << "\n"
+             << "reduced products: " << analysis.loops.reduced << "\n"
+             << "calls: " << stats.calls << "\n"
+             << "tail call sites: " << analysis.tailCalls << "\n"
+             << "tail calls: " << stats.tailCalls << "\n"
+             << "heap allocations: " << heap.allocations << "\n"
+             << "heap bytes: " << heap.bytesAllocated << "\n"
+             << "frame instances: " << stats.frameInstances << "\n"
+             << "field cache: " << hitRate(stats.fieldCacheHits,
+                                           stats.fieldCacheMisses)
+             << "\n"
+             << "call cache: " << hitRate(stats.callCacheHits,
+                                          stats.callCacheMisses)
+             << "\n"
+             << "quickened binary sites: " << stats.quickenedSites
+             << " (" << stats.deoptimizedSites << " deoptimized)\n"
+             << "parallel loops: " << stats.parallelLoops << " ("
+             << stats.parallelIterations << " iterations, " << stats.steals
+             << " steals)\n"
+             << "minor collections: " << heap.minorCollections << "\n"
+             << "major collections: " << heap.majorCollections << "\n"
+             << "promoted bytes: " << heap.bytesPromoted << "\n"
+             << "old space bytes: " << heap.oldBytes << " (peak "
+             << heap.peakOldBytes << ")\n"
+             << "gc pause: " << heap.pauseNs / 1000 << " us total, "
+             << heap.maxPauseNs / 1000 << " us max\n"
+             << "gc time: " << fixed << setprecision(1)
+             << (runNs > 0 ? 100.0 * heap.pauseNs / runNs : 0.0) << "% of "
+             << runNs / 1000 << " us" << endl;
+    }
+    return status;
+}
 
-    // }
+// tlc --emit-ir [--passes=LIST] [--verify] [--stats] [--no-inline]
+//               [--inline-threshold=N] [--no-loop-opt] file
+// Prints the program in SSA form after the passes of LIST (comma separated,
+// "default" for the default pipeline, empty for none).
+static int emitIR(int argc, char **argv) {
+    bool showStats = false;
+    bool verifyEach = false;
+    bool inlining = true;
+    InlineOptions inlineOptions;
+    bool loopOptimization = true;
+    string pipeline = "default";
+    string filename;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--stats") {
+            showStats = true;
+        } else if (arg == "--verify") {
+            verifyEach = true;
+        } else if (arg == "--no-inline") {
+            inlining = false;
+        } else if (arg.rfind("--inline-threshold=", 0) == 0) {
+            if (!parseCount(arg, 0, maxInlineThreshold,
+                            inlineOptions.maxSize)) {
+                return 1;
+            }
+        } else if (arg == "--no-loop-opt") {
+            loopOptimization = false;
+        } else if (arg.rfind("--passes=", 0) == 0) {
+            pipeline = arg.substr(9);
+        } else {
+            filename = arg;
+        }
+    }
+    string source;
+    if (filename.empty() || !readSource(filename, source)) {
+        return 1;
+    }
 
-    Parser *parse = new Parser();
+    CompilerContext context;
+    context.setBuiltins(Interpreter::builtinNames());
+    context.setInlining(inlining, inlineOptions);
+    context.setLoopOptimization(loopOptimization);
+    CompileResult result = context.compile(source);
+    if (result.ok()) {
+        context.analyze(result);
+    }
+    printDiagnostics(filename, result);
+    if (!result.ok()) {
+        return 1;
+    }
 
-    printProgram(parse->produceAST(lex->getTokens()),"      ");
+    Module module = lowerProgram(*result.program);
+    PassManager passes;
+    passes.setVerifyEach(verifyEach);
+    try {
+        passes.addPipeline(pipeline);
+        passes.run(module);
+    } catch (const IRError &e) {
+        cerr << filename << ": error: " << e.what() << endl;
+        return 1;
+    }
+    printModule(module, cout);
+    if (showStats) {
+        for (const PassStats &stats : passes.stats()) {
+            cerr << stats.name << ": changed " << stats.changed << " of "
+                 << stats.runs << " functions in " << stats.ns << " ns"
+                 << endl;
+        }
+    }
     return 0;
-}
\ No newline at end of file
+}
+
+// tlc [file]                   compile one file (code.tl by default)
+// tlc --batch[=ndjson|length]  compile every record on stdin, see Batch.h
+// tlc --run [options] file     compile and run a program, see runFile
+// tlc --emit-ir [options] file print the program in SSA form, see emitIR
+int main(int argc, char **argv){
+
+    string mode = argc > 1 ? argv[1] : "";
+    if (mode == "--batch" || mode == "--batch=ndjson" ||
+        mode == "--batch=length") {
+        ios::sync_with_stdio(false);
+        BatchFormat format = mode == "--batch=length" ? BatchFormat::Length
+                                                      : BatchFormat::Ndjson;
+        BatchStats stats = runBatch(cin, cout, format);
+        return stats.failed == 0 && stats.malformed == 0 ? 0 : 1;
+    }
+    if (mode == "--run") {
+        ios::sync_with_stdio(false);
+        return runFile(argc, argv);
+    }
+    if (mode == "--emit-ir") {
+        ios::sync_with_stdio(false);
+        return emitIR(argc, argv);
+    }
+
+     string filename = argc > 1 ? argv[1] : "code.tl";
+     string sourceCode="";
+    if (!readSource(filename, sourceCode)) {
+        return 1;
+    }
+
+    CompilerContext context;
+    CompileResult result = context.compile(sourceCode);
+    printDiagnostics(filename, result);
+
+    printTokens(result.tokens, cout);
+
+    ofstream tokensFile("Tokenized.txt");
+    writeTokens(result.tokens, tokensFile);
+
+    ofstream astFile("Parsed_AST.txt");
+    if (!astFile.is_open()) {
+        cerr << "Error in File Opening..." << endl;
+        return 1;
+    }
+    printProgram(*result.program, astFile, "      ");
+    return result.ok() ? 0 : 1;
+}
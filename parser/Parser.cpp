@@ -1,44 +1,131 @@
-// #include "Parser.h"
+#include "Parser.h"
 #include <string>
 
-unique_ptr<Program> Parser::produceAST(vector<Token> tokens) {
-  this->tokens = tokens;
+unique_ptr<Program> Parser::produceAST(const vector<Token> &tokens) {
+  this->tokens = &tokens;
+  this->errors.clear();
+  this->consumed = 0;
+  this->depth = 0;
 
   unique_ptr<Program> program = make_unique<Program>();
   program->kind = NodeType::Program;
 
   while (!eof()) {
-    program->body.push_back(parse_stmt());
+    program->body.push_back(parse_stmt_or_recover());
   }
 
+  this->tokens = nullptr;
   return program;
 }
 
-bool Parser::eof() { return tokens[0].getType() == TokenType::EOFToken; }
+const vector<ParserError> &Parser::getErrors() const { return errors; }
 
-Token Parser::at() { return tokens[0]; }
+void Parser::setMaxNestingDepth(size_t limit) { maxNestingDepth = limit; }
 
-Token Parser::eat() {
-  Token prev = tokens[0];
-  tokens.erase(tokens.begin());
-  return prev;
+size_t Parser::getMaxNestingDepth() const { return maxNestingDepth; }
+
+Parser::NestingGuard::NestingGuard(Parser &parser) : parser(parser) {
+  if (parser.depth >= parser.maxNestingDepth) {
+    throw ParserError("Nesting depth exceeds the limit of " +
+                          to_string(parser.maxNestingDepth) + ".",
+                      parser.at());
+  }
+  parser.depth++;
 }
 
-Token Parser::lookahead(size_t num) {
-  if (num >= tokens.size()) {
-    return Token("", TokenType::EOFToken);
+StmtPtr Parser::parse_stmt_or_recover() {
+  size_t start = consumed;
+  try {
+    return parse_stmt();
   }
-  return tokens[num];
+  catch (const ParserError& e) {
+    return recover(e, start);
+  }
+}
+
+// Records the error, skips to the next statement boundary and hands back
+// the node that takes the failed statement's place in the AST.
+StmtPtr Parser::recover(const ParserError &error, size_t start) {
+  errors.push_back(error);
+  synchronize(start);
+  return make_node<ErrorStmt>(error.offset, error.what());
 }
 
-Token Parser::expect(TokenType type, const string &err) {
-  Token prev = this->eat();
-  if (prev.getType() != type) {
-    throw ParserError(err + prev.getValue() + " - Expecting: " + to_string(static_cast<int>(type)));
+// Panic mode: discard tokens up to and including the next ';', or up to the
+// next '}' or statement keyword, whichever comes first. Blocks met on the way
+// are skipped whole, so the statement they belong to is dropped as a unit. A
+// '}' is left for the enclosing block unless nothing has been consumed yet,
+// which would otherwise spin forever on a stray brace.
+void Parser::synchronize(size_t start) {
+  size_t depth = 0;
+  while (!eof()) {
+    TokenType type = at().getType();
+    if (type == TokenType::OpenBrace) {
+      depth++;
+    } else if (type == TokenType::CloseBrace) {
+      if (depth > 0) {
+        eat();
+        if (--depth == 0) {
+          return;
+        }
+        continue;
+      }
+      if (consumed == start) {
+        eat();
+      }
+      return;
+    } else if (depth == 0) {
+      if (type == TokenType::Semicolon) {
+        eat();
+        return;
+      }
+      if (consumed != start && is_statement_start(type)) {
+        return;
+      }
+    }
+    eat();
+  }
+}
+
+bool Parser::is_statement_start(TokenType type) {
+  return type == TokenType::Let || type == TokenType::Const ||
+         type == TokenType::Func || type == TokenType::If ||
+         type == TokenType::While || type == TokenType::Parallel ||
+         type == TokenType::Return || type == TokenType::StructToken;
+}
+
+// Stands in for the EOF token when the input does not end with one.
+static const Token endOfFile("EndOfFile", TokenType::EOFToken);
+
+bool Parser::eof() { return at().getType() == TokenType::EOFToken; }
+
+const Token &Parser::at() { return lookahead(0); }
+
+const Token &Parser::eat() {
+  const Token &prev = at();
+  // The EOF token is never consumed so at() keeps returning it.
+  if (prev.getType() != TokenType::EOFToken) {
+    consumed++;
   }
   return prev;
 }
 
+const Token &Parser::lookahead(size_t num) {
+  if (consumed + num >= tokens->size()) {
+    return endOfFile;
+  }
+  return (*tokens)[consumed + num];
+}
+
+// A mismatched token is left in place so recovery can see it; skipping it
+// here would let an unexpected '{' open a block recovery cannot balance.
+const Token &Parser::expect(TokenType type, const string &err) {
+  if (at().getType() != type) {
+    throw ParserError(err + " Found: '" + at().getValue() + "'", at());
+  }
+  return this->eat();
+}
+
 bool Parser::is_comparison_operator(TokenType type) {
   return type == TokenType::LessThan || type == TokenType::LessEqual ||
          type == TokenType::GreaterThan || type == TokenType::GreaterEqual ||
@@ -1,24 +1,70 @@
 #ifndef PARSER_H
 #define PARSER_H
 
-// #include "../ast/AST.cpp"
-// #include "../lexer/Lexer.cpp"
+#include "../ast/AST.h"
+#include "../lexer/Lexer.h"
 #include <memory>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
+using ExprPtr = unique_ptr<Expr>;
+using StmtPtr = unique_ptr<Stmt>;
+
+class ParserError : public runtime_error {
+  public:
+      ParserError(const string& message, uint32_t offset = 0)
+          : runtime_error(message), offset(offset) {}
+      ParserError(const string& message, const Token& token)
+          : ParserError(message, token.getOffset()) {}
+      uint32_t offset;
+};
+
 class Parser {
 private:
-  vector<Token> tokens;
+  // Borrowed from the caller of produceAST for the duration of the call.
+  const vector<Token> *tokens = nullptr;
+  vector<ParserError> errors;
+  // Index of the current token, which is also how many were consumed; lets
+  // recovery tell whether it moved.
+  size_t consumed = 0;
+  // Statements, assignments and unary operators currently open.
+  size_t depth = 0;
+  size_t maxNestingDepth = 1000;
   bool eof();
 
-  Token at();
-  Token eat();
-  Token expect(TokenType type, const string &err);
-  Token lookahead(size_t num);
+  const Token &at();
+  const Token &eat();
+  const Token &expect(TokenType type, const string &err);
+  const Token &lookahead(size_t num);
+
+  template <typename T, typename... Args>
+  unique_ptr<T> make_node(uint32_t offset, Args &&...args) {
+    unique_ptr<T> node = make_unique<T>(forward<Args>(args)...);
+    node->offset = offset;
+    return node;
+  }
+
+  // Holds one level of nesting while it lives. Past the limit it throws
+  // instead, so hostile input gets a diagnostic rather than a stack overflow.
+  class NestingGuard {
+  public:
+    NestingGuard(Parser &parser);
+    ~NestingGuard() { parser.depth--; }
+    NestingGuard(const NestingGuard &) = delete;
+    NestingGuard &operator=(const NestingGuard &) = delete;
+
+  private:
+    Parser &parser;
+  };
+
+  StmtPtr recover(const ParserError &error, size_t start);
+  void synchronize(size_t start);
+  bool is_statement_start(TokenType type);
 
   unique_ptr<Stmt> parse_stmt();
+  unique_ptr<Stmt> parse_stmt_or_recover();
+  vector<unique_ptr<Stmt>> parse_block(const string &owner);
   unique_ptr<Stmt> parse_if_statement();
   unique_ptr<Stmt> parse_while_statement();
   unique_ptr<Stmt> parse_return_statement();
@@ -45,12 +91,16 @@ private:
   bool is_logical_operator(TokenType type);
 
 public:
-  unique_ptr<Program> produceAST(vector<Token> tokens);
-};
+  // Never throws on malformed input: each bad statement is replaced by an
+  // ErrorStmt and reported through getErrors().
+  // `tokens` is only read, and only during the call.
+  unique_ptr<Program> produceAST(const vector<Token> &tokens);
+  const vector<ParserError> &getErrors() const;
 
-class ParserError : public runtime_error {
-  public:
-      ParserError(const string& message) : runtime_error(message) {}
+  // Deepest nesting of blocks, parentheses, call arguments and unary
+  // operators accepted before the parser reports an error.
+  void setMaxNestingDepth(size_t limit);
+  size_t getMaxNestingDepth() const;
 };
 
 #endif
\ No newline at end of file
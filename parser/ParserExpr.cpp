@@ -1,7 +1,4 @@
-// #include "Parser.cpp"
-
-using ExprPtr = unique_ptr<Expr>;
-using StmtPtr = unique_ptr<Stmt>;
+#include "Parser.h"
 
 ExprPtr Parser::parse_expr() { 
   try {
@@ -20,7 +17,7 @@ ExprPtr Parser::parse_logical_expr() {
     while (is_logical_operator(at().getType())) {
         string logicalOperator = eat().getValue();
         ExprPtr right = parse_comparision_expr();
-        left = make_unique<LogicalExpr>(move(left), move(right), logicalOperator);
+        left = make_node<LogicalExpr>(left->offset, move(left), move(right), logicalOperator);
     }
 
     return left;
@@ -37,7 +34,7 @@ ExprPtr Parser::parse_comparision_expr() {
     if (is_comparison_operator(at().getType())) {
         string comparisonOperator = eat().getValue();
         ExprPtr right = parse_additive_expr();
-        left = make_unique<BinaryExpr>(move(left), move(right), comparisonOperator);
+        left = make_node<BinaryExpr>(left->offset, move(left), move(right), comparisonOperator);
     }
 
     return left;
@@ -50,33 +47,50 @@ ExprPtr Parser::parse_comparision_expr() {
 ExprPtr Parser::parse_primary_expr() {
   try {
   TokenType tk = at().getType();
+  uint32_t start = at().getOffset();
   ExprPtr value = nullptr;
 
   if (tk == TokenType::Not) {
     this->eat();
-    value = make_unique<UnaryExpr>(parse_primary_expr(), "!");
+    NestingGuard guard(*this);
+    value = make_node<UnaryExpr>(start, parse_primary_expr(), "!");
   } else if (tk == TokenType::BinaryOperator && at().getValue() == "-") {
     this->eat();
-    value = make_unique<UnaryExpr>(parse_primary_expr(), "-");
+    NestingGuard guard(*this);
+    value = make_node<UnaryExpr>(start, parse_primary_expr(), "-");
   } else {
     switch (tk) {
     case TokenType::Identifier:
       value = parse_member_access(
-          make_unique<IdentifierExpr>(eat().getValue()));
+          make_node<IdentifierExpr>(start, eat().getValue()));
       break;
     case TokenType::NumberLiteral:
-      value = make_unique<NumericLiteral>(stod(eat().getValue()));
+      value = make_node<NumericLiteral>(start, eat().getInt());
       break;
     case TokenType::FloatLiteral:
-      value = make_unique<NumericLiteral>(stod(eat().getValue()));
+      // `class` because TokenType::FloatLiteral hides the node type here.
+      value = make_node<class FloatLiteral>(start, eat().getFloat());
       break;
     case TokenType::StringLiteral:
-      value = make_unique<StrLiteral>(eat().getValue());
+      value = make_node<StrLiteral>(start, eat().getValue());
       break;
     case TokenType::Null:
       eat();
-      value = make_unique<NullLiteral>("null");
+      value = make_node<NullLiteral>(start, "null");
+      break;
+    case TokenType::OpenBracket: {
+      eat();
+      NestingGuard guard(*this);
+      vector<ExprPtr> elements;
+      if (at().getType() != TokenType::CloseBracket) {
+        elements = parse_arguments_list();
+      }
+      expect(TokenType::CloseBracket,
+             "Expected a closing bracket at the end of the array literal");
+      value = parse_member_access(
+          make_node<ArrayLiteral>(start, move(elements)));
       break;
+    }
     case TokenType::OpenParen:
       eat();
       value = parse_expr();
@@ -85,10 +99,8 @@ ExprPtr Parser::parse_primary_expr() {
              "closing parenthesis.");
       break;
     default:
-      value = nullptr;
-      cerr << "Unexpected token found during parsing! " << at().getValue()
-                << endl;
-      exit(1);
+      throw ParserError("Unexpected token found during parsing! " +
+                        at().getValue(), at());
     }
   }
 
@@ -107,7 +119,7 @@ ExprPtr Parser::parse_additive_expr() {
     while (is_additive_operator(at().getValue())) {
       string binaryOperator = eat().getValue();
       ExprPtr right = parse_multiplicative_expr();
-      left = make_unique<BinaryExpr>(move(left), move(right),
+      left = make_node<BinaryExpr>(left->offset, move(left), move(right),
                                           binaryOperator);
     }
 
@@ -125,7 +137,7 @@ ExprPtr Parser::parse_multiplicative_expr() {
     while (is_multiplicative_operator(at().getValue())) {
       string binaryOperator = eat().getValue();
       ExprPtr right = parse_primary_expr();
-      left = make_unique<BinaryExpr>(move(left), move(right),
+      left = make_node<BinaryExpr>(left->offset, move(left), move(right),
                                           binaryOperator);
     }
 
@@ -138,6 +150,7 @@ ExprPtr Parser::parse_multiplicative_expr() {
 
 ExprPtr Parser::parse_assignment_expr() {
   try {
+    NestingGuard guard(*this);
     ExprPtr left = parse_additive_expr();
 
     if (at().getType() == TokenType::Equals) {
@@ -145,7 +158,7 @@ ExprPtr Parser::parse_assignment_expr() {
       ExprPtr value = parse_assignment_expr();
       expect(TokenType::Semicolon,
              "Expected semicolon at the end of assignment expression");
-      return make_unique<AssignmentExpr>(move(left), move(value));
+      return make_node<AssignmentExpr>(left->offset, move(left), move(value));
     }
 
     return left;
@@ -170,7 +183,7 @@ ExprPtr Parser::parse_call_member_expr() {
       expect(TokenType::CloseParen,
              "Expected a closing parenthesis in the function call");
       caller =
-          make_unique<CallExpr>(move(caller), move(arguments));
+          make_node<CallExpr>(caller->offset, move(caller), move(arguments));
     }
 
     return caller;
@@ -183,17 +196,24 @@ ExprPtr Parser::parse_call_member_expr() {
 ExprPtr Parser::parse_member_access(ExprPtr left) {
   try {
     while (at().getType() == TokenType::Dot ||
-           at().getType() == TokenType::OpenParen) {
+           at().getType() == TokenType::OpenParen ||
+           at().getType() == TokenType::OpenBracket) {
       if (at().getType() == TokenType::Dot) {
         eat(); // Consume the '.'
-        string memberName =
+        const string &memberName =
             expect(TokenType::Identifier, "Expected identifier after '.'")
                 .getValue();
-        left = make_unique<MemberAccessExpr>(move(left),
-                                                  move(memberName));
+        left = make_node<MemberAccessExpr>(left->offset, move(left),
+                                                  memberName);
       } else if (at().getType() == TokenType::OpenParen) {
         vector<ExprPtr> arguments = parse_args();
-        left = make_unique<CallExpr>(move(left), move(arguments));
+        left = make_node<CallExpr>(left->offset, move(left), move(arguments));
+      } else {
+        eat(); // Consume the '['
+        NestingGuard guard(*this);
+        ExprPtr index = parse_expr();
+        expect(TokenType::CloseBracket, "Expected ']' after index");
+        left = make_node<IndexExpr>(left->offset, move(left), move(index));
       }
     }
     return left;
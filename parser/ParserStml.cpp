@@ -1,10 +1,9 @@
-// #include "Parser.cpp"
-
-using ExprPtr = unique_ptr<Expr>;
-using StmtPtr = unique_ptr<Stmt>;
+#include "Parser.h"
 
 StmtPtr Parser::parse_stmt() {
   try {
+    NestingGuard guard(*this);
+
     if (at().getType() == TokenType::Let || at().getType() == TokenType::Const) {
       return parse_var_declaration();
     }
@@ -21,7 +20,8 @@ StmtPtr Parser::parse_stmt() {
       return parse_if_statement();
     }
 
-    if (at().getType() == TokenType::While) {
+    if (at().getType() == TokenType::While ||
+        at().getType() == TokenType::Parallel) {
       return parse_while_statement();
     }
 
@@ -29,7 +29,13 @@ StmtPtr Parser::parse_stmt() {
       return parse_return_statement();
     }
 
-    return parse_expr();
+    ExprPtr expr = parse_expr();
+    // Assignments consume their own ';'; any other expression statement
+    // may be terminated by one.
+    if (at().getType() == TokenType::Semicolon) {
+      eat();
+    }
+    return expr;
   }
   catch (const ParserError& e) {
     throw;
@@ -38,7 +44,11 @@ StmtPtr Parser::parse_stmt() {
 
 StmtPtr Parser::parse_while_statement() {
   try {
-    eat();
+    uint32_t start = at().getOffset();
+    bool parallel = eat().getType() == TokenType::Parallel;
+    if (parallel) {
+      expect(TokenType::While, "Expected 'while' after 'parallel'");
+    }
 
     expect(TokenType::OpenParen, "Expected '(' after 'while'");
 
@@ -46,16 +56,11 @@ StmtPtr Parser::parse_while_statement() {
 
     expect(TokenType::CloseParen, "Expected ')' after 'while' condition");
 
-    expect(TokenType::OpenBrace, "Expected '{' open 'while' body");
+    vector<StmtPtr> loopBody = parse_block("'while'");
 
-    vector<StmtPtr> loopBody;
-    while (at().getType() != TokenType::CloseBrace) {
-      loopBody.push_back(parse_stmt());
-    }
-
-    expect(TokenType::CloseBrace, "Expected '}' close 'while' body");
-
-    return make_unique<WhileLoop>(move(condition), move(loopBody));
+    auto loop = make_node<WhileLoop>(start, move(condition), move(loopBody));
+    loop->parallel = parallel;
+    return loop;
   }
   catch (const ParserError& e) {
     throw;
@@ -64,17 +69,18 @@ StmtPtr Parser::parse_while_statement() {
 
 StmtPtr Parser::parse_return_statement() {
   try {
+    uint32_t start = at().getOffset();
     eat(); // Consume the "return" keyword
 
     if (at().getType() == TokenType::Semicolon) {
       // Return statement without a value
       eat(); // Consume the semicolon
-      return make_unique<ReturnStatement>(nullptr);
+      return make_node<ReturnStatement>(start, nullptr);
     } else {
       // Return statement with a value
-      unique_ptr<Stmt> value = parse_stmt();
+      unique_ptr<Stmt> value = parse_expr();
       expect(TokenType::Semicolon, "Return statement must end with a semicolon.");
-      return make_unique<ReturnStatement>(move(value));
+      return make_node<ReturnStatement>(start, move(value));
     }
   }
   catch (const ParserError& e) {
@@ -84,6 +90,7 @@ StmtPtr Parser::parse_return_statement() {
 
 StmtPtr Parser::parse_if_statement() {
   try {
+    uint32_t start = at().getOffset();
     eat(); // Consume the "if" keyword
     expect(TokenType::OpenParen, "Expected '(' after 'if'");
 
@@ -91,29 +98,16 @@ StmtPtr Parser::parse_if_statement() {
 
     expect(TokenType::CloseParen, "Expected ')' after 'if' condition");
 
-    vector<StmtPtr> ifBody;
-
-    expect(TokenType::OpenBrace, "Expected '{' open 'if' body");
-
-    while (at().getType() != TokenType::CloseBrace) {
-      ifBody.push_back(parse_stmt());
-    }
-
-    expect(TokenType::CloseBrace, "Expected '}' close 'if' body");
+    vector<StmtPtr> ifBody = parse_block("'if'");
 
     vector<StmtPtr> elseBody;
 
     if (at().getType() == TokenType::Else) {
       eat();
-
-      expect(TokenType::OpenBrace, "Expected '{' open 'else' body");
-      while (at().getType() != TokenType::CloseBrace) {
-        elseBody.push_back(parse_stmt());
-      }
-      expect(TokenType::CloseBrace, "Expected '}' close 'else' body");
+      elseBody = parse_block("'else'");
     }
 
-    return make_unique<IfStatement>(move(condition), move(ifBody),
+    return make_node<IfStatement>(start, move(condition), move(ifBody),
                                          move(elseBody));
   }
   catch (const ParserError& e) {
@@ -123,23 +117,23 @@ StmtPtr Parser::parse_if_statement() {
 
 StmtPtr Parser::parse_var_declaration() {
   try {
+  uint32_t start = at().getOffset();
   bool isConstant = this->eat().getType() == TokenType::Const;
 
-  string identifier =
+  const string &identifier =
       expect(TokenType::Identifier,
              "Expected identifier name following let | const keywords.")
           .getValue();
 
   if (this->at().getType() == TokenType::Semicolon) {
-    this->eat();
     if (isConstant) {
-      cerr
-          << "Must assign value to constant expression. No value provided."
-          << endl;
-      exit(1);
+      throw ParserError(
+          "Must assign value to constant expression. No value provided.",
+          at());
     }
+    this->eat();
 
-    return make_unique<VarDeclaration>(false, identifier);
+    return make_node<VarDeclaration>(start, false, identifier);
   }
 
   expect(TokenType::Equals,
@@ -149,7 +143,7 @@ StmtPtr Parser::parse_var_declaration() {
 
   expect(TokenType::Semicolon, "Var declaration must end with a semicolon.");
 
-  return make_unique<VarDeclaration>(isConstant, identifier,
+  return make_node<VarDeclaration>(start, isConstant, identifier,
                                           move(value));
   }
   catch (const ParserError& e) {
@@ -159,10 +153,11 @@ StmtPtr Parser::parse_var_declaration() {
 
 StmtPtr Parser::parse_function_declaration() {
   try {
+    uint32_t start = at().getOffset();
     this->eat();
-    string name = this->expect(TokenType::Identifier,
-                                    "Expected function name following fn keyword")
-                           .getValue();
+    const Token &nameToken = this->expect(TokenType::Identifier,
+                                    "Expected function name following fn keyword");
+    const string &name = nameToken.getValue();
     vector<ExprPtr> args = this->parse_args();
 
     vector<string> params;
@@ -171,10 +166,10 @@ StmtPtr Parser::parse_function_declaration() {
       if (arg->kind == NodeType::Identifier) {
         params.push_back(static_cast<IdentifierExpr *>(arg.get())->symbol);
       } else {
-        cerr << "Inside function declaration expected parameters to be of "
-                     "type Identifier."
-                  << endl;
-        exit(1);
+        // Not fatal: the body is still parsed so its errors are reported too.
+        errors.push_back(ParserError("Inside function declaration expected "
+                                     "parameters to be of type Identifier.",
+                                     nameToken));
       }
     }
 
@@ -184,13 +179,13 @@ StmtPtr Parser::parse_function_declaration() {
 
     while (this->at().getType() != TokenType::EOFToken &&
            this->at().getType() != TokenType::CloseBrace) {
-      body.push_back(parse_stmt().release());
+      body.push_back(parse_stmt_or_recover().release());
     }
 
     expect(TokenType::CloseBrace,
            "Closing brace expected inside function declaration");
 
-    return make_unique<FunctionDeclaration>(move(params), name, body);
+    return make_node<FunctionDeclaration>(start, move(params), name, body);
   }
   catch (const ParserError& e) {
     throw;
@@ -199,9 +194,10 @@ StmtPtr Parser::parse_function_declaration() {
 
 StmtPtr Parser::parse_struct_declaration() {
   try {
+    uint32_t start = at().getOffset();
     eat(); // Consume the "struct" keyword
 
-    string structName =
+    const string &structName =
         expect(TokenType::Identifier,
                "Expected struct name following 'struct' keyword")
             .getValue();
@@ -210,15 +206,42 @@ StmtPtr Parser::parse_struct_declaration() {
 
     vector<unique_ptr<Stmt>> structBody;
 
-    while (at().getType() != TokenType::CloseBrace) {
-      structBody.push_back(parse_var_declaration());
+    while (!eof() && at().getType() != TokenType::CloseBrace) {
+      size_t start = consumed;
+      try {
+        // parse_var_declaration eats its first token unchecked.
+        if (at().getType() != TokenType::Let &&
+            at().getType() != TokenType::Const) {
+          throw ParserError("Expected field declaration. Found: '" +
+                                at().getValue() + "'",
+                            at());
+        }
+        structBody.push_back(parse_var_declaration());
+      }
+      catch (const ParserError& e) {
+        structBody.push_back(recover(e, start));
+      }
     }
 
     expect(TokenType::CloseBrace, "Expected '}' after struct body");
 
-    return make_unique<StructDeclaration>(structName, move(structBody));
+    return make_node<StructDeclaration>(start, structName, move(structBody));
   }
   catch (const ParserError& e) {
     throw;
   }
-}
\ No newline at end of file
+}
+
+// Parses `{ stmt* }`, recovering inside the block so one bad statement does
+// not discard its siblings.
+vector<StmtPtr> Parser::parse_block(const string &owner) {
+  expect(TokenType::OpenBrace, "Expected '{' open " + owner + " body");
+
+  vector<StmtPtr> body;
+  while (!eof() && at().getType() != TokenType::CloseBrace) {
+    body.push_back(parse_stmt_or_recover());
+  }
+
+  expect(TokenType::CloseBrace, "Expected '}' close " + owner + " body");
+  return body;
+}
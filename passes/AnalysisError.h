@@ -0,0 +1,18 @@
+#ifndef ANALYSIS_ERROR_H
+#define ANALYSIS_ERROR_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+using namespace std;
+
+// A problem one of the semantic passes found, at the byte offset of the node
+// it is about. Collected, not thrown, so a pass reports everything at once.
+class AnalysisError : public runtime_error {
+public:
+  AnalysisError(const string &message, uint32_t offset = 0)
+      : runtime_error(message), offset(offset) {}
+  uint32_t offset;
+};
+
+#endif
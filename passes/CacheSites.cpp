@@ -0,0 +1,34 @@
+#include "CacheSites.h"
+#include "../ast/Visitor.h"
+
+namespace {
+
+class SiteNumberer : public ASTVisitor<SiteNumberer> {
+public:
+  CacheSites sites;
+
+  bool visitMemberAccessExpr(MemberAccessExpr &memberAccessExpr) {
+    memberAccessExpr.cacheSlot =
+        memberAccessExpr.fieldIndex < 0
+            ? static_cast<int32_t>(sites.memberSites++)
+            : -1;
+    return visitChildren(memberAccessExpr);
+  }
+  bool visitBinaryExpr(BinaryExpr &binaryExpr) {
+    binaryExpr.cacheSlot = static_cast<int32_t>(sites.binarySites++);
+    return visitChildren(binaryExpr);
+  }
+  bool visitCallExpr(CallExpr &callExpr) {
+    callExpr.cacheSlot =
+        callExpr.builtin < 0 ? static_cast<int32_t>(sites.callSites++) : -1;
+    return visitChildren(callExpr);
+  }
+};
+
+} // namespace
+
+CacheSites numberCacheSites(Program &program) {
+  SiteNumberer numberer;
+  numberer.visit(program);
+  return numberer.sites;
+}
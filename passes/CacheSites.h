@@ -0,0 +1,22 @@
+#ifndef CACHE_SITES_H
+#define CACHE_SITES_H
+
+#include "../ast/AST.h"
+
+class CacheSites {
+public:
+  // Member accesses computeLayouts() could not resolve, calls not bound to
+  // a builtin and binary expressions; each numbered from 0.
+  size_t memberSites = 0;
+  size_t callSites = 0;
+  size_t binarySites = 0;
+};
+
+// Gives every call not bound to a builtin, every member access without a
+// fieldIndex and every binary expression a slot for the inline cache the
+// interpreter keeps for it: what the site saw last, so the next run of it
+// can skip the lookup or checks that found it. Must run after every pass
+// that adds or copies nodes.
+CacheSites numberCacheSites(Program &program);
+
+#endif
@@ -0,0 +1,98 @@
+#include "ConstantFolding.h"
+#include "../ast/Folding.h"
+#include "../ast/Visitor.h"
+
+namespace {
+
+class Folder {
+public:
+  size_t folded = 0;
+
+  // Folds everything below `stmt`, children before their parents.
+  void fold(Stmt &stmt);
+
+private:
+  template <typename Slot> void foldSlot(Slot &slot);
+  unique_ptr<Expr> replacement(const Stmt &node);
+};
+
+template <typename Slot> void Folder::foldSlot(Slot &slot) {
+  fold(*slot);
+  if (unique_ptr<Expr> literal = replacement(*slot)) {
+    literal->offset = slot->offset;
+    slot = move(literal);
+    folded++;
+  }
+}
+
+void Folder::fold(Stmt &stmt) {
+  if (stmt.kind == NodeType::FunctionDeclaration) {
+    // The body holds raw pointers, so its statements fold in place.
+    for (Stmt *child : static_cast<FunctionDeclaration &>(stmt).body) {
+      fold(*child);
+    }
+    return;
+  }
+  forEachChildSlot(stmt, [this](auto &child) { foldSlot(child); });
+}
+
+// The literal `node` folds to, once its operands are folded, or nullptr.
+unique_ptr<Expr> Folder::replacement(const Stmt &node) {
+  auto isInteger = [](const Expr &e) {
+    return e.kind == NodeType::NumericLiteral;
+  };
+  auto isNumber = [&](const Expr &e) {
+    return isInteger(e) || e.kind == NodeType::FloatLiteral;
+  };
+  auto integer = [](const Expr &e) {
+    return static_cast<const NumericLiteral &>(e).value;
+  };
+  auto asDouble = [&](const Expr &e) {
+    return isInteger(e) ? static_cast<double>(integer(e))
+                        : static_cast<const class FloatLiteral &>(e).value;
+  };
+
+  if (node.kind == NodeType::BinaryExpr) {
+    auto &binary = static_cast<const BinaryExpr &>(node);
+    const Expr &left = *binary.left;
+    const Expr &right = *binary.right;
+    if (!isNumber(left) || !isNumber(right)) {
+      return nullptr;
+    }
+    if (isInteger(left) && isInteger(right)) {
+      int64_t result;
+      if (foldIntegers(binary.binaryOperator, integer(left), integer(right),
+                       result)) {
+        return make_unique<NumericLiteral>(result);
+      }
+      return nullptr;
+    }
+    double result;
+    if (foldNumbers(binary.binaryOperator, asDouble(left), asDouble(right),
+                    result)) {
+      return make_unique<class FloatLiteral>(result);
+    }
+  } else if (node.kind == NodeType::UnaryExpr) {
+    auto &unary = static_cast<const UnaryExpr &>(node);
+    const Expr &operand = *unary.right;
+    if (unary.op != "-") {
+      return nullptr;
+    }
+    if (isInteger(operand)) {
+      if (integer(operand) != INT64_MIN) {
+        return make_unique<NumericLiteral>(-integer(operand));
+      }
+    } else if (isNumber(operand)) {
+      return make_unique<class FloatLiteral>(-asDouble(operand));
+    }
+  }
+  return nullptr;
+}
+
+} // namespace
+
+size_t foldConstants(Program &program) {
+  Folder folder;
+  folder.fold(program);
+  return folder.folded;
+}
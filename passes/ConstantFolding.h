@@ -0,0 +1,13 @@
+#ifndef CONSTANT_FOLDING_H
+#define CONSTANT_FOLDING_H
+
+#include "../ast/AST.h"
+
+// Replaces arithmetic on numeric literals in `program` with its result and
+// returns how many nodes were folded. Follows the same rules as folding the
+// flat AST (ast/Folding.h): integer operations that would overflow or divide
+// by zero are left for the runtime to report. Bindings are untouched, so
+// this may run before or after name resolution.
+size_t foldConstants(Program &program);
+
+#endif
@@ -0,0 +1,125 @@
+#include "EscapeAnalysis.h"
+#include "../ast/Visitor.h"
+#include <unordered_map>
+
+namespace {
+
+class Candidate {
+public:
+  CallExpr *call;
+  const StructLayout *layout;
+  bool escapes = false;
+};
+
+// Looks at one function body at a time; nested functions and structs are
+// analyzed on their own since they cannot see the enclosing frame.
+class EscapeFinder : public ASTVisitor<EscapeFinder> {
+public:
+  EscapeFinder(const LayoutTable &layouts) : layouts(layouts) {}
+
+  EscapeSummary summary;
+
+  bool visitFunctionDeclaration(FunctionDeclaration &funcDecl);
+  bool visitStructDeclaration(StructDeclaration &structDecl);
+  bool visitVarDeclaration(VarDeclaration &varDecl);
+  bool visitCallExpr(CallExpr &callExpr);
+  bool visitMemberAccessExpr(MemberAccessExpr &memberAccessExpr);
+  bool visitIdentifier(IdentifierExpr &identifier);
+
+private:
+  const LayoutTable &layouts;
+  FunctionDeclaration *function = nullptr;
+  // Local slot of each variable initialized by a constructor call.
+  unordered_map<uint32_t, Candidate> candidates;
+
+  const StructLayout *constructed(const CallExpr &callExpr) const;
+};
+
+const StructLayout *
+EscapeFinder::constructed(const CallExpr &callExpr) const {
+  if (callExpr.caller->kind != NodeType::Identifier) {
+    return nullptr;
+  }
+  const Binding &binding =
+      static_cast<const IdentifierExpr &>(*callExpr.caller).binding;
+  return binding.scope == Binding::Scope::Global ? layouts.forSlot(binding.slot)
+                                                 : nullptr;
+}
+
+bool EscapeFinder::visitFunctionDeclaration(FunctionDeclaration &funcDecl) {
+  FunctionDeclaration *outer = function;
+  auto outerCandidates = move(candidates);
+  function = &funcDecl;
+  candidates.clear();
+
+  visitChildren(funcDecl);
+  for (auto &entry : candidates) {
+    Candidate &candidate = entry.second;
+    if (candidate.escapes) {
+      continue;
+    }
+    candidate.call->frameSlot = static_cast<int32_t>(funcDecl.frameSize);
+    funcDecl.frameSize +=
+        1 + static_cast<uint32_t>(candidate.layout->fields.size());
+    summary.frameAllocated++;
+  }
+
+  function = outer;
+  candidates = move(outerCandidates);
+  return true;
+}
+
+// Field initializers run at construction time, in whatever frame that is.
+bool EscapeFinder::visitStructDeclaration(StructDeclaration &structDecl) {
+  FunctionDeclaration *outer = function;
+  function = nullptr;
+  visitChildren(structDecl);
+  function = outer;
+  return true;
+}
+
+bool EscapeFinder::visitVarDeclaration(VarDeclaration &varDecl) {
+  if (function && varDecl.value &&
+      varDecl.binding.scope == Binding::Scope::Local &&
+      varDecl.value->kind == NodeType::CallExpr) {
+    auto &call = static_cast<CallExpr &>(*varDecl.value);
+    if (const StructLayout *layout = constructed(call)) {
+      candidates.emplace(varDecl.binding.slot, Candidate{&call, layout});
+    }
+  }
+  return visitChildren(varDecl);
+}
+
+bool EscapeFinder::visitCallExpr(CallExpr &callExpr) {
+  callExpr.frameSlot = -1;
+  if (function && constructed(callExpr)) {
+    summary.constructorSites++;
+  }
+  return visitChildren(callExpr);
+}
+
+// The one use that keeps an instance confined: reading or writing a field.
+bool EscapeFinder::visitMemberAccessExpr(MemberAccessExpr &memberAccessExpr) {
+  if (memberAccessExpr.object->kind == NodeType::Identifier) {
+    return true;
+  }
+  return visitChildren(memberAccessExpr);
+}
+
+bool EscapeFinder::visitIdentifier(IdentifierExpr &identifier) {
+  if (identifier.binding.scope == Binding::Scope::Local) {
+    auto it = candidates.find(identifier.binding.slot);
+    if (it != candidates.end()) {
+      it->second.escapes = true;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+EscapeSummary analyzeEscapes(Program &program, const LayoutTable &layouts) {
+  EscapeFinder finder(layouts);
+  finder.visit(program);
+  return finder.summary;
+}
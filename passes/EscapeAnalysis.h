@@ -0,0 +1,32 @@
+#ifndef ESCAPE_ANALYSIS_H
+#define ESCAPE_ANALYSIS_H
+
+#include "../ast/AST.h"
+#include "StructLayout.h"
+
+class EscapeSummary {
+public:
+  // Constructor calls inside functions, and how many of them were given a
+  // place in the frame.
+  size_t constructorSites = 0;
+  size_t frameAllocated = 0;
+};
+
+// Finds the constructor calls inside functions whose instance can never
+// outlive the call of the function that creates it, and reserves frame
+// space for each: CallExpr::frameSlot marks where the instance goes, and
+// FunctionDeclaration::frameSize grows by its header slot plus one slot per
+// field. Needs the bindings and layouts of resolveNames() and
+// computeLayouts(), and must run after anything else that resizes frames.
+//
+// An instance stays in the frame when it initializes a local `let`/`const`
+// that is then only ever used as the object of a member access (`v.x`,
+// `v.x = e`). Any other use of the variable: passing it to a call,
+// returning it, storing it in another variable or a field, comparing it or
+// assigning the variable, counts as an escape. A variable confined this way
+// holds the only reference to its instance, so when the declaration runs
+// again (in a loop) the previous instance is already unreachable and the
+// same frame slots can be reused.
+EscapeSummary analyzeEscapes(Program &program, const LayoutTable &layouts);
+
+#endif
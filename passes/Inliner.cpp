@@ -0,0 +1,694 @@
+#include "Inliner.h"
+#include "../ast/Visitor.h"
+#include "ConstantFolding.h"
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+class FunctionInfo {
+public:
+  FunctionDeclaration *declaration = nullptr;
+  // Functions this one calls directly, as indices into Inliner::functions.
+  vector<size_t> callees = {};
+  bool recursive = false;
+
+  // Known once the function's own call sites have been inlined.
+  bool inlinable = false;
+  // The body is a single `return e;`, so a call can become a copy of `e`
+  // wherever it appears.
+  bool expression = false;
+  // Names of the globals the body uses; inlining must not put them in reach
+  // of a caller's local of the same name.
+  unordered_set<string> globals = {};
+  // Which parameters the body assigns to.
+  vector<bool> assigned = {};
+
+  // Tarjan's strongly connected components.
+  int index = -1;
+  int lowLink = 0;
+  bool onStack = false;
+};
+
+// What makes a body fit to inline, gathered in one walk.
+class BodyScan : public ConstASTVisitor<BodyScan> {
+public:
+  FunctionInfo &info;
+  size_t size = 0;
+  // Levels of the deepest path through the body.
+  size_t depth = 0;
+  bool declaresTypes = false;
+  size_t returns = 0;
+
+  BodyScan(FunctionInfo &info) : info(info) {}
+
+  bool visit(const Stmt &stmt) {
+    size++;
+    level++;
+    depth = max(depth, level);
+    bool result = ASTVisitor::visit(stmt);
+    level--;
+    return result;
+  }
+  bool visitFunctionDeclaration(const FunctionDeclaration &) {
+    declaresTypes = true;
+    return true;
+  }
+  bool visitStructDeclaration(const StructDeclaration &) {
+    declaresTypes = true;
+    return true;
+  }
+  bool visitReturnStatement(const ReturnStatement &returnStmt) {
+    returns++;
+    return visitChildren(returnStmt);
+  }
+  bool visitAssignmentExpr(const AssignmentExpr &assignmentExpr) {
+    const Expr &target = *assignmentExpr.assigne;
+    if (target.kind == NodeType::Identifier) {
+      const Binding &binding =
+          static_cast<const IdentifierExpr &>(target).binding;
+      if (binding.scope == Binding::Scope::Local &&
+          binding.slot < info.assigned.size()) {
+        info.assigned[binding.slot] = true;
+      }
+    }
+    return visitChildren(assignmentExpr);
+  }
+  bool visitIdentifier(const IdentifierExpr &identifier) {
+    if (identifier.binding.scope == Binding::Scope::Global) {
+      info.globals.insert(identifier.symbol);
+    }
+    return true;
+  }
+
+private:
+  size_t level = 0;
+};
+
+// Names a block of code declares for itself, not counting nested functions
+// and structs, which have scopes of their own.
+class DeclaredNames : public ConstASTVisitor<DeclaredNames> {
+public:
+  unordered_set<string> names;
+
+  bool visitVarDeclaration(const VarDeclaration &varDecl) {
+    names.insert(varDecl.identifier);
+    return visitChildren(varDecl);
+  }
+  bool visitFunctionDeclaration(const FunctionDeclaration &) { return true; }
+  bool visitStructDeclaration(const StructDeclaration &) { return true; }
+};
+
+// Copies a callee's body for one call site, renaming its parameters and
+// locals and substituting the parameters bound to literals.
+class Cloner {
+public:
+  string suffix;
+  // Parameter slot to the literal argument that replaces it.
+  unordered_map<uint32_t, const Expr *> substituted;
+
+  unique_ptr<Stmt> clone(const Stmt &stmt);
+  unique_ptr<Expr> cloneExpr(const Expr &expr) {
+    return unique_ptr<Expr>(static_cast<Expr *>(clone(expr).release()));
+  }
+
+private:
+  template <typename Body>
+  vector<unique_ptr<Stmt>> cloneBlock(const Body &body) {
+    vector<unique_ptr<Stmt>> copy;
+    copy.reserve(body.size());
+    for (const auto &stmt : body) {
+      copy.push_back(clone(*stmt));
+    }
+    return copy;
+  }
+};
+
+unique_ptr<Stmt> Cloner::clone(const Stmt &stmt) {
+  unique_ptr<Stmt> copy;
+  switch (stmt.kind) {
+  case NodeType::VarDeclaration: {
+    auto &node = static_cast<const VarDeclaration &>(stmt);
+    copy = make_unique<VarDeclaration>(
+        node.constant, node.identifier + suffix,
+        node.value ? cloneExpr(*node.value) : nullptr);
+    break;
+  }
+  case NodeType::IfStatement: {
+    auto &node = static_cast<const IfStatement &>(stmt);
+    copy = make_unique<IfStatement>(cloneExpr(*node.condition),
+                                    cloneBlock(node.ifBody),
+                                    cloneBlock(node.elseBody));
+    break;
+  }
+  case NodeType::WhileLoop: {
+    auto &node = static_cast<const WhileLoop &>(stmt);
+    auto loop = make_unique<WhileLoop>(cloneExpr(*node.condition),
+                                       cloneBlock(node.loopBody));
+    loop->parallel = node.parallel;
+    copy = move(loop);
+    break;
+  }
+  case NodeType::ReturnStatement: {
+    auto &node = static_cast<const ReturnStatement &>(stmt);
+    copy = make_unique<ReturnStatement>(
+        node.returnValue ? clone(*node.returnValue) : nullptr);
+    break;
+  }
+  case NodeType::AssignmentExpr: {
+    auto &node = static_cast<const AssignmentExpr &>(stmt);
+    copy = make_unique<AssignmentExpr>(cloneExpr(*node.assigne),
+                                       cloneExpr(*node.value));
+    break;
+  }
+  case NodeType::NumericLiteral:
+    copy = make_unique<NumericLiteral>(
+        static_cast<const NumericLiteral &>(stmt).value);
+    break;
+  case NodeType::FloatLiteral:
+    copy = make_unique<class FloatLiteral>(
+        static_cast<const class FloatLiteral &>(stmt).value);
+    break;
+  case NodeType::StrLiteral:
+    copy = make_unique<StrLiteral>(static_cast<const StrLiteral &>(stmt).value);
+    break;
+  case NodeType::Null:
+    copy = make_unique<NullLiteral>(
+        static_cast<const NullLiteral &>(stmt).value);
+    break;
+  case NodeType::Identifier: {
+    // Globals keep their binding, which is how a later copy of this copy
+    // still tells them apart from locals. Anything else is a local, either
+    // of the callee or of code inlined into it earlier, which has no binding
+    // yet.
+    auto &node = static_cast<const IdentifierExpr &>(stmt);
+    if (node.binding.scope == Binding::Scope::Global) {
+      auto identifier = make_unique<IdentifierExpr>(node.symbol);
+      identifier->binding = node.binding;
+      copy = move(identifier);
+      break;
+    }
+    auto it = node.binding.scope == Binding::Scope::Local
+                  ? substituted.find(node.binding.slot)
+                  : substituted.end();
+    if (it != substituted.end() &&
+        it->second->kind == NodeType::Identifier) {
+      // A name of the caller's, which must not be renamed.
+      auto &argument = static_cast<const IdentifierExpr &>(*it->second);
+      auto identifier = make_unique<IdentifierExpr>(argument.symbol);
+      identifier->binding = argument.binding;
+      copy = move(identifier);
+    } else if (it != substituted.end()) {
+      copy = clone(*it->second);
+    } else {
+      copy = make_unique<IdentifierExpr>(node.symbol + suffix);
+    }
+    break;
+  }
+  case NodeType::BinaryExpr: {
+    auto &node = static_cast<const BinaryExpr &>(stmt);
+    copy = make_unique<BinaryExpr>(cloneExpr(*node.left),
+                                   cloneExpr(*node.right), node.binaryOperator);
+    break;
+  }
+  case NodeType::LogicalExpr: {
+    auto &node = static_cast<const LogicalExpr &>(stmt);
+    copy = make_unique<LogicalExpr>(cloneExpr(*node.left),
+                                    cloneExpr(*node.right),
+                                    node.logicalOperator);
+    break;
+  }
+  case NodeType::UnaryExpr: {
+    auto &node = static_cast<const UnaryExpr &>(stmt);
+    copy = make_unique<UnaryExpr>(cloneExpr(*node.right), node.op);
+    break;
+  }
+  case NodeType::CallExpr: {
+    auto &node = static_cast<const CallExpr &>(stmt);
+    vector<unique_ptr<Expr>> args;
+    for (const auto &arg : node.args) {
+      args.push_back(cloneExpr(*arg));
+    }
+    copy = make_unique<CallExpr>(cloneExpr(*node.caller), move(args));
+    break;
+  }
+  case NodeType::MemberAccessExpr: {
+    auto &node = static_cast<const MemberAccessExpr &>(stmt);
+    copy = make_unique<MemberAccessExpr>(cloneExpr(*node.object),
+                                         node.memberName);
+    break;
+  }
+  case NodeType::ArrayLiteral: {
+    vector<unique_ptr<Expr>> elements;
+    for (const auto &element :
+         static_cast<const ArrayLiteral &>(stmt).elements) {
+      elements.push_back(cloneExpr(*element));
+    }
+    copy = make_unique<ArrayLiteral>(move(elements));
+    break;
+  }
+  case NodeType::IndexExpr: {
+    auto &node = static_cast<const IndexExpr &>(stmt);
+    copy = make_unique<IndexExpr>(cloneExpr(*node.object),
+                                  cloneExpr(*node.index));
+    break;
+  }
+  default:
+    // Declarations and parse errors never reach an inlinable body.
+    copy = make_unique<ErrorStmt>("Cannot inline " +
+                                  NodeTypeToString(stmt.kind));
+    break;
+  }
+  copy->offset = stmt.offset;
+  return copy;
+}
+
+// An argument that can stand in for the parameter at every use: evaluating
+// it has no effects, and nothing the callee does can change its value, since
+// a function never sees its caller's locals. Globals are out because the
+// callee may assign them, directly or through calls.
+bool isTrivial(const Expr &expr) {
+  switch (expr.kind) {
+  case NodeType::NumericLiteral:
+  case NodeType::FloatLiteral:
+  case NodeType::StrLiteral:
+  case NodeType::Null:
+    return true;
+  case NodeType::Identifier:
+    // Unresolved names were made by inlining, as locals of the caller.
+    return static_cast<const IdentifierExpr &>(expr).binding.scope !=
+           Binding::Scope::Global;
+  default:
+    return false;
+  }
+}
+
+class Inliner {
+public:
+  Inliner(const InlineOptions &options) : options(options) {}
+
+  InlineSummary summary;
+
+  void run(Program &program);
+
+private:
+  const InlineOptions &options;
+  vector<FunctionInfo> functions;
+  unordered_map<uint32_t, size_t> bySlot;
+  // Functions whose strongly connected component is complete, callees
+  // before callers.
+  vector<size_t> order;
+  vector<size_t> tarjanStack;
+  int nextIndex = 0;
+  // Numbers the copies, for their `#n` suffix.
+  size_t copies = 0;
+
+  // Names the code being rewritten declares locally.
+  unordered_set<string> callerNames;
+
+  void collect(Program &program);
+  void connect(size_t function);
+  void finish(FunctionInfo &info);
+
+  const FunctionInfo *inlinableCallee(const CallExpr &call) const;
+  void rewriteBlock(vector<unique_ptr<Stmt>> &body);
+  template <typename Slot> void inlineNested(Slot &slot);
+  unique_ptr<Expr> inlineExpression(CallExpr &call);
+  bool expand(unique_ptr<Stmt> &stmt, vector<unique_ptr<Stmt>> &out);
+};
+
+void Inliner::collect(Program &program) {
+  class Declarations : public ASTVisitor<Declarations> {
+  public:
+    Inliner &inliner;
+    Declarations(Inliner &inliner) : inliner(inliner) {}
+
+    bool visitFunctionDeclaration(FunctionDeclaration &funcDecl) {
+      inliner.bySlot.emplace(funcDecl.binding.slot, inliner.functions.size());
+      inliner.functions.push_back(FunctionInfo{&funcDecl});
+      return visitChildren(funcDecl);
+    }
+  };
+
+  // Direct calls from each function body; code outside functions calls too,
+  // but nothing can call it back.
+  class Calls : public ASTVisitor<Calls> {
+  public:
+    Inliner &inliner;
+    FunctionInfo *caller = nullptr;
+    Calls(Inliner &inliner) : inliner(inliner) {}
+
+    bool visitFunctionDeclaration(FunctionDeclaration &funcDecl) {
+      FunctionInfo *outer = caller;
+      caller = &inliner.functions[inliner.bySlot.at(funcDecl.binding.slot)];
+      visitChildren(funcDecl);
+      caller = outer;
+      return true;
+    }
+    bool visitStructDeclaration(StructDeclaration &structDecl) {
+      FunctionInfo *outer = caller;
+      caller = nullptr;
+      visitChildren(structDecl);
+      caller = outer;
+      return true;
+    }
+    bool visitCallExpr(CallExpr &callExpr) {
+      if (caller && callExpr.caller->kind == NodeType::Identifier) {
+        const Binding &binding =
+            static_cast<const IdentifierExpr &>(*callExpr.caller).binding;
+        auto it = inliner.bySlot.find(binding.slot);
+        if (binding.scope == Binding::Scope::Global &&
+            it != inliner.bySlot.end()) {
+          caller->callees.push_back(it->second);
+        }
+      }
+      return visitChildren(callExpr);
+    }
+  };
+
+  Declarations(*this).visit(program);
+  Calls(*this).visit(program);
+}
+
+// Tarjan's algorithm; a component is complete only after every component it
+// calls into, which is the order functions are rewritten in.
+void Inliner::connect(size_t function) {
+  FunctionInfo &info = functions[function];
+  info.index = info.lowLink = nextIndex++;
+  tarjanStack.push_back(function);
+  info.onStack = true;
+
+  for (size_t callee : info.callees) {
+    FunctionInfo &next = functions[callee];
+    if (callee == function) {
+      info.recursive = true;
+    }
+    if (next.index < 0) {
+      connect(callee);
+      info.lowLink = min(info.lowLink, next.lowLink);
+    } else if (next.onStack) {
+      info.lowLink = min(info.lowLink, next.index);
+    }
+  }
+
+  if (info.lowLink != info.index) {
+    return;
+  }
+  size_t first = tarjanStack.size();
+  do {
+    first--;
+  } while (tarjanStack[first] != function);
+  bool cycle = tarjanStack.size() - first > 1;
+  for (size_t i = first; i < tarjanStack.size(); i++) {
+    FunctionInfo &member = functions[tarjanStack[i]];
+    member.onStack = false;
+    member.recursive = member.recursive || cycle;
+    order.push_back(tarjanStack[i]);
+  }
+  tarjanStack.resize(first);
+}
+
+// Decides whether `info`'s function can be inlined now that its own body is
+// final.
+void Inliner::finish(FunctionInfo &info) {
+  const FunctionDeclaration &function = *info.declaration;
+  info.assigned.assign(function.parameters.size(), false);
+  BodyScan scan(info);
+  for (const Stmt *stmt : function.body) {
+    scan.visit(*stmt);
+  }
+  bool returnsLast =
+      scan.returns == 0 ||
+      (scan.returns == 1 &&
+       function.body.back()->kind == NodeType::ReturnStatement);
+  info.inlinable = !info.recursive && !scan.declaresTypes && returnsLast &&
+                   scan.size <= options.maxSize &&
+                   scan.depth <= options.maxDepth;
+  info.expression =
+      info.inlinable && function.body.size() == 1 && scan.returns == 1 &&
+      static_cast<const ReturnStatement &>(*function.body[0]).returnValue;
+}
+
+const FunctionInfo *Inliner::inlinableCallee(const CallExpr &call) const {
+  if (call.caller->kind != NodeType::Identifier) {
+    return nullptr;
+  }
+  const Binding &binding =
+      static_cast<const IdentifierExpr &>(*call.caller).binding;
+  auto it = bySlot.find(binding.slot);
+  if (binding.scope != Binding::Scope::Global || it == bySlot.end()) {
+    return nullptr;
+  }
+  const FunctionInfo &info = functions[it->second];
+  if (!info.inlinable ||
+      call.args.size() > info.declaration->parameters.size()) {
+    return nullptr;
+  }
+  for (const string &name : info.globals) {
+    if (callerNames.count(name)) {
+      return nullptr;
+    }
+  }
+  return &info;
+}
+
+void Inliner::rewriteBlock(vector<unique_ptr<Stmt>> &body) {
+  vector<unique_ptr<Stmt>> rewritten;
+  rewritten.reserve(body.size());
+  for (auto &stmt : body) {
+    switch (stmt->kind) {
+    case NodeType::FunctionDeclaration:
+    case NodeType::StructDeclaration:
+      break;
+    case NodeType::IfStatement: {
+      auto &ifStmt = static_cast<IfStatement &>(*stmt);
+      inlineNested(ifStmt.condition);
+      rewriteBlock(ifStmt.ifBody);
+      rewriteBlock(ifStmt.elseBody);
+      break;
+    }
+    case NodeType::WhileLoop: {
+      auto &whileLoop = static_cast<WhileLoop &>(*stmt);
+      inlineNested(whileLoop.condition);
+      rewriteBlock(whileLoop.loopBody);
+      break;
+    }
+    default:
+      inlineNested(stmt);
+      if (expand(stmt, rewritten)) {
+        continue;
+      }
+      break;
+    }
+    rewritten.push_back(move(stmt));
+  }
+  body = move(rewritten);
+}
+
+// Replaces calls of expression functions inside the expression `slot` owns,
+// innermost first, when every argument is trivial.
+template <typename Slot> void Inliner::inlineNested(Slot &slot) {
+  forEachChildSlot(*slot, [this](auto &child) { inlineNested(child); });
+  if (slot->kind == NodeType::CallExpr) {
+    if (unique_ptr<Expr> copy =
+            inlineExpression(static_cast<CallExpr &>(*slot))) {
+      slot = move(copy);
+    }
+  }
+}
+
+unique_ptr<Expr> Inliner::inlineExpression(CallExpr &call) {
+  const FunctionInfo *callee = inlinableCallee(call);
+  if (!callee || !callee->expression) {
+    return nullptr;
+  }
+  for (const auto &arg : call.args) {
+    if (!isTrivial(*arg)) {
+      return nullptr;
+    }
+  }
+  const FunctionDeclaration &function = *callee->declaration;
+  for (bool assigned : callee->assigned) {
+    if (assigned) {
+      return nullptr;
+    }
+  }
+
+  NullLiteral missing("null");
+  missing.offset = call.offset;
+  Cloner cloner;
+  cloner.suffix = "#" + to_string(++copies);
+  for (size_t i = 0; i < function.parameters.size(); i++) {
+    cloner.substituted.emplace(static_cast<uint32_t>(i),
+                               i < call.args.size() ? call.args[i].get()
+                                                    : &missing);
+  }
+  const Stmt &value =
+      *static_cast<const ReturnStatement &>(*function.body[0]).returnValue;
+  summary.sites++;
+  return cloner.cloneExpr(static_cast<const Expr &>(value));
+}
+
+// Inlines the call `stmt` is made of, if it is one that can be, appending
+// the copy and what is left of `stmt` to `out`.
+bool Inliner::expand(unique_ptr<Stmt> &stmt, vector<unique_ptr<Stmt>> &out) {
+  // Where the call's result goes.
+  unique_ptr<Expr> *resultSlot = nullptr;
+  unique_ptr<Stmt> *returnSlot = nullptr;
+  CallExpr *call = nullptr;
+  auto isCall = [](const Stmt *node) {
+    return node && node->kind == NodeType::CallExpr;
+  };
+  switch (stmt->kind) {
+  case NodeType::VarDeclaration: {
+    auto &varDecl = static_cast<VarDeclaration &>(*stmt);
+    if (isCall(varDecl.value.get())) {
+      resultSlot = &varDecl.value;
+    }
+    break;
+  }
+  case NodeType::AssignmentExpr: {
+    auto &assignment = static_cast<AssignmentExpr &>(*stmt);
+    if (assignment.assigne->kind == NodeType::Identifier &&
+        isCall(assignment.value.get())) {
+      resultSlot = &assignment.value;
+    }
+    break;
+  }
+  case NodeType::ReturnStatement: {
+    auto &returnStmt = static_cast<ReturnStatement &>(*stmt);
+    if (isCall(returnStmt.returnValue.get())) {
+      returnSlot = &returnStmt.returnValue;
+    }
+    break;
+  }
+  case NodeType::CallExpr:
+    call = static_cast<CallExpr *>(stmt.get());
+    break;
+  default:
+    break;
+  }
+  if (resultSlot) {
+    call = static_cast<CallExpr *>(resultSlot->get());
+  } else if (returnSlot) {
+    call = static_cast<CallExpr *>(returnSlot->get());
+  }
+  const FunctionInfo *callee = call ? inlinableCallee(*call) : nullptr;
+  if (!callee) {
+    return false;
+  }
+  const FunctionDeclaration &function = *callee->declaration;
+
+  Cloner cloner;
+  cloner.suffix = "#" + to_string(++copies);
+  for (size_t i = 0; i < function.parameters.size(); i++) {
+    bool passed = i < call->args.size();
+    if (passed && !callee->assigned[i] && isTrivial(*call->args[i])) {
+      cloner.substituted.emplace(static_cast<uint32_t>(i),
+                                 call->args[i].get());
+      continue;
+    }
+    auto parameter = make_unique<VarDeclaration>(
+        false, function.parameters[i] + cloner.suffix,
+        passed ? move(call->args[i]) : nullptr);
+    parameter->offset = call->offset;
+    out.push_back(move(parameter));
+  }
+
+  unique_ptr<Expr> result;
+  for (const Stmt *bodyStmt : function.body) {
+    if (bodyStmt->kind != NodeType::ReturnStatement) {
+      out.push_back(cloner.clone(*bodyStmt));
+    } else if (auto &value =
+                   static_cast<const ReturnStatement &>(*bodyStmt).returnValue) {
+      result = cloner.cloneExpr(static_cast<const Expr &>(*value));
+    }
+  }
+  if (!result) {
+    result = make_unique<NullLiteral>("null");
+    result->offset = call->offset;
+  }
+
+  summary.sites++;
+  if (resultSlot) {
+    *resultSlot = move(result);
+  } else if (returnSlot) {
+    *returnSlot = move(result);
+  } else {
+    // A call made for its effects: whatever the result was computed from
+    // has run by now, so only an expression that could do more stays.
+    switch (result->kind) {
+    case NodeType::NumericLiteral:
+    case NodeType::FloatLiteral:
+    case NodeType::StrLiteral:
+    case NodeType::Null:
+    case NodeType::Identifier:
+      return true;
+    default:
+      out.push_back(move(result));
+      return true;
+    }
+  }
+  out.push_back(move(stmt));
+  return true;
+}
+
+void Inliner::run(Program &program) {
+  collect(program);
+  for (size_t i = 0; i < functions.size(); i++) {
+    if (functions[i].index < 0) {
+      connect(i);
+    }
+  }
+
+  for (size_t function : order) {
+    FunctionInfo &info = functions[function];
+    FunctionDeclaration &declaration = *info.declaration;
+
+    DeclaredNames declared;
+    for (const string &parameter : declaration.parameters) {
+      declared.names.insert(parameter);
+    }
+    for (const Stmt *stmt : declaration.body) {
+      declared.visit(*stmt);
+    }
+    callerNames = move(declared.names);
+
+    // The body is a vector of raw pointers; own it while rewriting.
+    vector<unique_ptr<Stmt>> body;
+    for (Stmt *stmt : declaration.body) {
+      body.emplace_back(stmt);
+    }
+    declaration.body.clear();
+    rewriteBlock(body);
+    for (auto &stmt : body) {
+      declaration.body.push_back(stmt.release());
+    }
+    finish(info);
+  }
+
+  // Top-level code: its own `let`s are globals the callees see as well, so
+  // only those of nested blocks can shadow anything.
+  DeclaredNames declared;
+  for (const auto &stmt : program.body) {
+    if (stmt->kind == NodeType::IfStatement ||
+        stmt->kind == NodeType::WhileLoop) {
+      declared.visit(*stmt);
+    }
+  }
+  callerNames = move(declared.names);
+  rewriteBlock(program.body);
+
+  if (summary.sites > 0) {
+    summary.folded = foldConstants(program);
+  }
+}
+
+} // namespace
+
+InlineSummary inlineCalls(Program &program, const InlineOptions &options) {
+  Inliner inliner(options);
+  inliner.run(program);
+  return inliner.summary;
+}
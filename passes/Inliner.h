@@ -0,0 +1,63 @@
+#ifndef INLINER_H
+#define INLINER_H
+
+#include "../ast/AST.h"
+
+class InlineOptions {
+public:
+  // Largest callee body, counted in AST nodes, that is copied into callers.
+  size_t maxSize = 32;
+  // Deepest callee body, in levels of the tree, that is copied. Bodies are
+  // measured after their own calls are inlined, so a copy adds at most this
+  // many levels to the tree it lands in, however large maxSize is: the
+  // passes after inlining recurse once per level, and the trees they get
+  // stay about as shallow as the analysis depth limit left them; see
+  // checkTreeDepth.
+  size_t maxDepth = 64;
+};
+
+class InlineSummary {
+public:
+  // Call sites replaced by the callee's body.
+  size_t sites = 0;
+  // Nodes constant folding simplified afterwards.
+  size_t folded = 0;
+};
+
+// Replaces calls of small functions with a copy of the function's body, then
+// folds constants over the result. Needs the bindings of a resolveNames()
+// run that found no errors, and leaves them stale wherever it changed the
+// tree: run resolveNames() and the passes after it again if any site was
+// inlined.
+//
+// A function is inlined when it is not recursive, directly or through other
+// functions, declares no functions or structs, has no `return` other than
+// its last statement, and its body is at most `maxSize` nodes and `maxDepth`
+// levels. Calls of it
+// are inlined where they make up a whole statement: `f(a);`, `return f(a);`,
+// `let x = f(a);` and `x = f(a);`. The copy is placed in front of that
+// statement:
+//
+//   let y = f(a, 2);          let x#1 = a;
+//                      =>     let t#1 = x#1 * 2;
+//   func f(x, k) {            let y = t#1 + 1;
+//     let t = x * k;
+//     return t + 1;
+//   }
+//
+// Every parameter and local of the copy is renamed with a `#n` suffix the
+// lexer can never produce, so it cannot clash with the caller's names. A
+// parameter that is never assigned and receives a trivial argument, a
+// literal or a local of the caller, is replaced by it, which is what lets
+// folding finish the job. A function whose body is just `return e;` is also
+// inlined where the call is part of a larger expression, such as a loop
+// condition, provided every argument is trivial: the call becomes a copy of
+// `e`. A call is left
+// alone when it passes more arguments than the function takes (an error at
+// run time), or when one of the function's globals is shadowed by a local
+// of the caller. Callees are inlined into before their callers, so chains of
+// small helpers collapse completely.
+InlineSummary inlineCalls(Program &program,
+                          const InlineOptions &options = InlineOptions());
+
+#endif
@@ -0,0 +1,842 @@
+#include "LoopOptimizer.h"
+#include "../ast/Visitor.h"
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+uint64_t bindingKey(const Binding &binding) {
+  return static_cast<uint64_t>(binding.scope) << 32 | binding.slot;
+}
+
+bool isIdentifier(const Stmt &node, const Binding &binding) {
+  if (node.kind != NodeType::Identifier) {
+    return false;
+  }
+  const Binding &other = static_cast<const IdentifierExpr &>(node).binding;
+  return other.resolved() && bindingKey(other) == bindingKey(binding);
+}
+
+// What calling a function or struct of the program can do, by global slot.
+class CallEffects {
+public:
+  void collect(Program &program);
+
+  // A call of a pure function (see LoopOptimizer.h).
+  bool isPure(const CallExpr &call) const;
+  // A call that may write memory or print: neither pure nor constructing an
+  // instance whose field initializers make no calls.
+  bool hasEffects(const CallExpr &call) const;
+  // Global slots that always hold the same function or struct.
+  bool isDeclaration(const Binding &binding) const {
+    return binding.scope == Binding::Scope::Global &&
+           (functions.count(binding.slot) || quietStructs.count(binding.slot));
+  }
+
+private:
+  class FunctionInfo {
+  public:
+    bool pure = true;
+    vector<uint32_t> callees;
+  };
+  unordered_map<uint32_t, FunctionInfo> functions;
+  // Struct slot to whether its field initializers are free of calls.
+  unordered_map<uint32_t, bool> quietStructs;
+
+  const Binding *callee(const CallExpr &call) const {
+    if (call.caller->kind != NodeType::Identifier) {
+      return nullptr;
+    }
+    const Binding &binding =
+        static_cast<const IdentifierExpr &>(*call.caller).binding;
+    return binding.scope == Binding::Scope::Global ? &binding : nullptr;
+  }
+};
+
+void CallEffects::collect(Program &program) {
+  class Declarations : public ConstASTVisitor<Declarations> {
+  public:
+    CallEffects &effects;
+    Declarations(CallEffects &effects) : effects(effects) {}
+
+    bool visitFunctionDeclaration(const FunctionDeclaration &funcDecl) {
+      effects.functions.emplace(funcDecl.binding.slot, FunctionInfo());
+      return visitChildren(funcDecl);
+    }
+    bool visitStructDeclaration(const StructDeclaration &structDecl) {
+      class Calls : public ConstASTVisitor<Calls> {
+      public:
+        bool found = false;
+        bool visitCallExpr(const CallExpr &) {
+          found = true;
+          return false;
+        }
+      };
+      Calls calls;
+      calls.visit(structDecl);
+      effects.quietStructs.emplace(structDecl.binding.slot, !calls.found);
+      return true;
+    }
+  };
+
+  // Decides everything about one body except the purity of its callees.
+  class BodyScan : public ConstASTVisitor<BodyScan> {
+  public:
+    const CallEffects &effects;
+    FunctionInfo &info;
+    BodyScan(const CallEffects &effects, FunctionInfo &info)
+        : effects(effects), info(info) {}
+
+    bool impure() {
+      info.pure = false;
+      return false;
+    }
+    bool visitFunctionDeclaration(const FunctionDeclaration &) {
+      return impure();
+    }
+    bool visitStructDeclaration(const StructDeclaration &) { return impure(); }
+    bool visitWhileLoop(const WhileLoop &) { return impure(); }
+    bool visitMemberAccessExpr(const MemberAccessExpr &) { return impure(); }
+    bool visitIndexExpr(const IndexExpr &) { return impure(); }
+    // Each evaluation makes a new array, so two calls are not alike.
+    bool visitArrayLiteral(const ArrayLiteral &) { return impure(); }
+    bool visitIdentifier(const IdentifierExpr &identifier) {
+      return identifier.binding.scope == Binding::Scope::Local ||
+             effects.isDeclaration(identifier.binding) || impure();
+    }
+    bool visitAssignmentExpr(const AssignmentExpr &assignmentExpr) {
+      const Expr &target = *assignmentExpr.assigne;
+      if (target.kind != NodeType::Identifier ||
+          static_cast<const IdentifierExpr &>(target).binding.scope !=
+              Binding::Scope::Local) {
+        return impure();
+      }
+      return visit(*assignmentExpr.value);
+    }
+    bool visitCallExpr(const CallExpr &callExpr) {
+      const Binding *binding = effects.callee(callExpr);
+      if (!binding || !effects.functions.count(binding->slot)) {
+        return impure();
+      }
+      info.callees.push_back(binding->slot);
+      for (const auto &arg : callExpr.args) {
+        if (!visit(*arg)) {
+          return false;
+        }
+      }
+      return true;
+    }
+  };
+
+  class Bodies : public ConstASTVisitor<Bodies> {
+  public:
+    CallEffects &effects;
+    Bodies(CallEffects &effects) : effects(effects) {}
+
+    bool visitFunctionDeclaration(const FunctionDeclaration &funcDecl) {
+      BodyScan scan(effects, effects.functions.at(funcDecl.binding.slot));
+      for (const Stmt *stmt : funcDecl.body) {
+        if (!scan.visit(*stmt)) {
+          break;
+        }
+      }
+      return visitChildren(funcDecl);
+    }
+  };
+
+  Declarations(*this).visit(program);
+  Bodies(*this).visit(program);
+
+  // A function calling an impure one is impure; what is left once that
+  // stops spreading is pure, recursion included.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto &entry : functions) {
+      FunctionInfo &info = entry.second;
+      if (!info.pure) {
+        continue;
+      }
+      for (uint32_t callee : info.callees) {
+        if (!functions.at(callee).pure) {
+          info.pure = false;
+          changed = true;
+          break;
+        }
+      }
+    }
+  }
+}
+
+bool CallEffects::isPure(const CallExpr &call) const {
+  const Binding *binding = callee(call);
+  if (!binding) {
+    return false;
+  }
+  auto it = functions.find(binding->slot);
+  return it != functions.end() && it->second.pure;
+}
+
+bool CallEffects::hasEffects(const CallExpr &call) const {
+  if (isPure(call)) {
+    return false;
+  }
+  const Binding *binding = callee(call);
+  if (!binding) {
+    return true;
+  }
+  auto it = quietStructs.find(binding->slot);
+  return it == quietStructs.end() || !it->second;
+}
+
+// What a loop's condition and body change, not counting the functions and
+// structs declared inside it.
+class LoopFacts : public ConstASTVisitor<LoopFacts> {
+public:
+  const CallEffects &effects;
+  // How often each variable is assigned or declared.
+  unordered_map<uint64_t, size_t> assignments;
+  // Names of the fields assigned.
+  unordered_set<string> fields;
+  bool writesMemory = false;
+  bool assigns = false;
+
+  LoopFacts(const CallEffects &effects) : effects(effects) {}
+
+  bool visitFunctionDeclaration(const FunctionDeclaration &) { return true; }
+  bool visitStructDeclaration(const StructDeclaration &) { return true; }
+  bool visitVarDeclaration(const VarDeclaration &varDecl) {
+    assignments[bindingKey(varDecl.binding)]++;
+    return visitChildren(varDecl);
+  }
+  bool visitAssignmentExpr(const AssignmentExpr &assignmentExpr) {
+    const Expr &target = *assignmentExpr.assigne;
+    if (target.kind == NodeType::Identifier) {
+      assignments[bindingKey(
+          static_cast<const IdentifierExpr &>(target).binding)]++;
+    } else if (target.kind == NodeType::MemberAccessExpr) {
+      fields.insert(static_cast<const MemberAccessExpr &>(target).memberName);
+    }
+    assigns = true;
+    return visitChildren(assignmentExpr);
+  }
+  bool visitCallExpr(const CallExpr &callExpr) {
+    writesMemory = writesMemory || effects.hasEffects(callExpr);
+    return visitChildren(callExpr);
+  }
+};
+
+// The variable strength reduction rewrites products of.
+class Induction {
+public:
+  Binding binding;
+  int64_t start;
+  // Added by each iteration.
+  int64_t step;
+};
+
+// Products `i * k` sharing one running sum.
+class Product {
+public:
+  int64_t factor = 0;
+  string name;
+  // Where they appear, in evaluation order.
+  vector<unique_ptr<Expr> *> slots = {};
+  // How many products a run of the body evaluates, roughly: one per slot,
+  // two for a slot inside a nested loop.
+  size_t uses = 0;
+  // Offset of the first one certain to be evaluated on every iteration, if
+  // any; the update of the sum reports overflow there.
+  bool anticipated = false;
+  uint32_t offset = 0;
+};
+
+// Rewrites one loop, whose inner loops are already done.
+class LoopRewriter {
+public:
+  LoopRewriter(const CallEffects &effects, WhileLoop &loop,
+               size_t &temporaries)
+      : effects(effects), loop(loop), facts(effects),
+        temporaries(temporaries) {}
+
+  LoopSummary summary;
+
+  // Appends the loop, and whatever now runs in front of it, to `out`, which
+  // holds the statements before it in the same block.
+  void run(unique_ptr<Stmt> loopStmt, vector<unique_ptr<Stmt>> &out);
+
+private:
+  const CallEffects &effects;
+  WhileLoop &loop;
+  LoopFacts facts;
+  size_t &temporaries;
+  unordered_map<const Expr *, bool> invariants;
+
+  bool hoisting = false;
+  vector<unique_ptr<VarDeclaration>> hoisted;
+  bool hasInduction = false;
+  Induction induction;
+  vector<Product> products;
+  bool inCondition = false;
+  // Whether the code walked so far runs unconditionally and has had no
+  // effect outside the loop.
+  bool open = true;
+  size_t conditional = 0;
+  size_t nestedLoops = 0;
+
+  bool invariant(const Expr &expr);
+  bool findInduction(const vector<unique_ptr<Stmt>> &before);
+  Product *product(const Expr &expr);
+  bool anticipated() const { return open && conditional == 0; }
+
+  template <typename Slot> void walkExpr(Slot &slot);
+  void walkStmt(unique_ptr<Stmt> &slot);
+  void walkBlock(vector<unique_ptr<Stmt>> &body) {
+    for (auto &stmt : body) {
+      walkStmt(stmt);
+    }
+  }
+};
+
+bool LoopRewriter::invariant(const Expr &expr) {
+  auto it = invariants.find(&expr);
+  if (it != invariants.end()) {
+    return it->second;
+  }
+  bool result = false;
+  switch (expr.kind) {
+  case NodeType::NumericLiteral:
+  case NodeType::FloatLiteral:
+  case NodeType::StrLiteral:
+  case NodeType::Null:
+    result = true;
+    break;
+  case NodeType::Identifier: {
+    const Binding &binding = static_cast<const IdentifierExpr &>(expr).binding;
+    result = effects.isDeclaration(binding) ||
+             (binding.resolved() &&
+              !facts.assignments.count(bindingKey(binding)) &&
+              (binding.scope == Binding::Scope::Local || !facts.writesMemory));
+    break;
+  }
+  case NodeType::BinaryExpr: {
+    auto &binaryExpr = static_cast<const BinaryExpr &>(expr);
+    result = invariant(*binaryExpr.left) && invariant(*binaryExpr.right);
+    break;
+  }
+  case NodeType::LogicalExpr: {
+    auto &logicalExpr = static_cast<const LogicalExpr &>(expr);
+    result = invariant(*logicalExpr.left) && invariant(*logicalExpr.right);
+    break;
+  }
+  case NodeType::UnaryExpr:
+    result = invariant(*static_cast<const UnaryExpr &>(expr).right);
+    break;
+  case NodeType::MemberAccessExpr: {
+    auto &access = static_cast<const MemberAccessExpr &>(expr);
+    result = !facts.writesMemory && !facts.fields.count(access.memberName) &&
+             invariant(*access.object);
+    break;
+  }
+  case NodeType::CallExpr: {
+    auto &call = static_cast<const CallExpr &>(expr);
+    result = effects.isPure(call);
+    for (const auto &arg : call.args) {
+      result = result && invariant(*arg);
+    }
+    break;
+  }
+  default:
+    break;
+  }
+  invariants.emplace(&expr, result);
+  return result;
+}
+
+bool LoopRewriter::findInduction(const vector<unique_ptr<Stmt>> &before) {
+  if (loop.loopBody.empty() ||
+      loop.loopBody.back()->kind != NodeType::AssignmentExpr) {
+    return false;
+  }
+  auto &update = static_cast<const AssignmentExpr &>(*loop.loopBody.back());
+  if (update.assigne->kind != NodeType::Identifier ||
+      update.value->kind != NodeType::BinaryExpr) {
+    return false;
+  }
+  const Binding &binding =
+      static_cast<const IdentifierExpr &>(*update.assigne).binding;
+  auto &next = static_cast<const BinaryExpr &>(*update.value);
+  const Expr *step = nullptr;
+  if (isIdentifier(*next.left, binding)) {
+    step = next.right.get();
+  } else if (next.binaryOperator == "+" && isIdentifier(*next.right, binding)) {
+    step = next.left.get();
+  }
+  auto assigned = facts.assignments.find(bindingKey(binding));
+  if (!step || step->kind != NodeType::NumericLiteral ||
+      (next.binaryOperator != "+" && next.binaryOperator != "-") ||
+      assigned == facts.assignments.end() || assigned->second != 1) {
+    return false;
+  }
+  int64_t c = static_cast<const NumericLiteral &>(*step).value;
+  if (next.binaryOperator == "-" && __builtin_sub_overflow(0, c, &c)) {
+    return false;
+  }
+  bool global = binding.scope == Binding::Scope::Global;
+  if (global && facts.writesMemory) {
+    return false;
+  }
+
+  // The statement that sets the variable last before the loop, where
+  // nothing in between may call anything that could change a global.
+  for (auto stmt = before.rbegin(); stmt != before.rend(); ++stmt) {
+    LoopFacts between(effects);
+    between.visit(**stmt);
+    if (global && between.writesMemory) {
+      return false;
+    }
+    if (!between.assignments.count(bindingKey(binding))) {
+      continue;
+    }
+    const Stmt *value = nullptr;
+    if ((*stmt)->kind == NodeType::VarDeclaration) {
+      auto &varDecl = static_cast<const VarDeclaration &>(**stmt);
+      if (bindingKey(varDecl.binding) == bindingKey(binding)) {
+        value = varDecl.value.get();
+      }
+    } else if ((*stmt)->kind == NodeType::AssignmentExpr) {
+      auto &assignment = static_cast<const AssignmentExpr &>(**stmt);
+      if (isIdentifier(*assignment.assigne, binding)) {
+        value = assignment.value.get();
+      }
+    }
+    if (!value || value->kind != NodeType::NumericLiteral) {
+      return false;
+    }
+    induction.binding = binding;
+    induction.start = static_cast<const NumericLiteral &>(*value).value;
+    induction.step = c;
+    return true;
+  }
+  return false;
+}
+
+// The running sum `expr` can be replaced by, if it is a product of the
+// induction variable with an integer literal.
+Product *LoopRewriter::product(const Expr &expr) {
+  if (!hasInduction || inCondition || expr.kind != NodeType::BinaryExpr) {
+    return nullptr;
+  }
+  auto &binaryExpr = static_cast<const BinaryExpr &>(expr);
+  const Expr *factor = nullptr;
+  if (binaryExpr.binaryOperator != "*") {
+    return nullptr;
+  }
+  if (isIdentifier(*binaryExpr.left, induction.binding)) {
+    factor = binaryExpr.right.get();
+  } else if (isIdentifier(*binaryExpr.right, induction.binding)) {
+    factor = binaryExpr.left.get();
+  }
+  if (!factor || factor->kind != NodeType::NumericLiteral) {
+    return nullptr;
+  }
+  int64_t k = static_cast<const NumericLiteral &>(*factor).value;
+  for (Product &existing : products) {
+    if (existing.factor == k) {
+      return &existing;
+    }
+  }
+  products.push_back(Product{k, "#iv" + to_string(++temporaries)});
+  return &products.back();
+}
+
+// Walks in evaluation order, moving what can be moved as it goes.
+template <typename Slot> void LoopRewriter::walkExpr(Slot &slot) {
+  Expr &expr = static_cast<Expr &>(*slot);
+  bool candidate = expr.kind == NodeType::BinaryExpr ||
+                   expr.kind == NodeType::MemberAccessExpr ||
+                   expr.kind == NodeType::CallExpr;
+  if (candidate && invariant(expr)) {
+    // Its parts are just as invariant and have no effects, so there is
+    // nothing else to find inside.
+    if (hoisting && anticipated()) {
+      string name = "#inv" + to_string(++temporaries);
+      auto temporary = make_unique<IdentifierExpr>(name);
+      temporary->offset = expr.offset;
+      auto declaration = make_unique<VarDeclaration>(
+          true, name, unique_ptr<Expr>(static_cast<Expr *>(slot.release())));
+      declaration->offset = expr.offset;
+      hoisted.push_back(move(declaration));
+      slot = move(temporary);
+    }
+    return;
+  }
+  if constexpr (is_same<Slot, unique_ptr<Expr>>::value) {
+    if (Product *found = product(expr)) {
+      if (anticipated() && !found->anticipated) {
+        found->anticipated = true;
+        found->offset = expr.offset;
+      }
+      found->slots.push_back(&slot);
+      found->uses += nestedLoops > 0 ? 2 : 1;
+      return;
+    }
+  }
+
+  switch (expr.kind) {
+  case NodeType::AssignmentExpr: {
+    auto &assignment = static_cast<AssignmentExpr &>(expr);
+    if (assignment.assigne->kind == NodeType::MemberAccessExpr) {
+      walkExpr(static_cast<MemberAccessExpr &>(*assignment.assigne).object);
+      walkExpr(assignment.value);
+      open = false;
+    } else if (assignment.assigne->kind == NodeType::IndexExpr) {
+      auto &target = static_cast<IndexExpr &>(*assignment.assigne);
+      walkExpr(target.object);
+      walkExpr(target.index);
+      walkExpr(assignment.value);
+      open = false;
+    } else {
+      walkExpr(assignment.value);
+    }
+    break;
+  }
+  case NodeType::BinaryExpr: {
+    auto &binaryExpr = static_cast<BinaryExpr &>(expr);
+    walkExpr(binaryExpr.left);
+    walkExpr(binaryExpr.right);
+    break;
+  }
+  case NodeType::LogicalExpr: {
+    auto &logicalExpr = static_cast<LogicalExpr &>(expr);
+    walkExpr(logicalExpr.left);
+    conditional++;
+    walkExpr(logicalExpr.right);
+    conditional--;
+    break;
+  }
+  case NodeType::UnaryExpr:
+    walkExpr(static_cast<UnaryExpr &>(expr).right);
+    break;
+  case NodeType::MemberAccessExpr:
+    walkExpr(static_cast<MemberAccessExpr &>(expr).object);
+    break;
+  case NodeType::IndexExpr: {
+    auto &indexExpr = static_cast<IndexExpr &>(expr);
+    walkExpr(indexExpr.object);
+    walkExpr(indexExpr.index);
+    break;
+  }
+  case NodeType::ArrayLiteral:
+    for (auto &element : static_cast<ArrayLiteral &>(expr).elements) {
+      walkExpr(element);
+    }
+    break;
+  case NodeType::CallExpr: {
+    auto &call = static_cast<CallExpr &>(expr);
+    walkExpr(call.caller);
+    for (auto &arg : call.args) {
+      walkExpr(arg);
+    }
+    if (effects.hasEffects(call)) {
+      open = false;
+    }
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+void LoopRewriter::walkStmt(unique_ptr<Stmt> &slot) {
+  switch (slot->kind) {
+  case NodeType::VarDeclaration: {
+    auto &varDecl = static_cast<VarDeclaration &>(*slot);
+    if (varDecl.value) {
+      walkExpr(varDecl.value);
+    }
+    break;
+  }
+  case NodeType::IfStatement: {
+    auto &ifStmt = static_cast<IfStatement &>(*slot);
+    walkExpr(ifStmt.condition);
+    conditional++;
+    walkBlock(ifStmt.ifBody);
+    walkBlock(ifStmt.elseBody);
+    conditional--;
+    break;
+  }
+  case NodeType::WhileLoop: {
+    auto &whileLoop = static_cast<WhileLoop &>(*slot);
+    nestedLoops++;
+    walkExpr(whileLoop.condition);
+    conditional++;
+    walkBlock(whileLoop.loopBody);
+    conditional--;
+    nestedLoops--;
+    // It may never finish.
+    open = false;
+    break;
+  }
+  case NodeType::ReturnStatement: {
+    auto &returnStmt = static_cast<ReturnStatement &>(*slot);
+    if (returnStmt.returnValue) {
+      walkExpr(returnStmt.returnValue);
+    }
+    open = false;
+    break;
+  }
+  case NodeType::FunctionDeclaration:
+  case NodeType::StructDeclaration:
+  case NodeType::Error:
+    break;
+  default:
+    walkExpr(slot);
+    break;
+  }
+}
+
+// A copy of a condition that has no effects, for the guard.
+unique_ptr<Expr> cloneCondition(const Expr &expr) {
+  unique_ptr<Expr> copy;
+  switch (expr.kind) {
+  case NodeType::NumericLiteral:
+    copy = make_unique<NumericLiteral>(
+        static_cast<const NumericLiteral &>(expr).value);
+    break;
+  case NodeType::FloatLiteral:
+    copy = make_unique<class FloatLiteral>(
+        static_cast<const class FloatLiteral &>(expr).value);
+    break;
+  case NodeType::StrLiteral:
+    copy = make_unique<StrLiteral>(static_cast<const StrLiteral &>(expr).value);
+    break;
+  case NodeType::Null:
+    copy =
+        make_unique<NullLiteral>(static_cast<const NullLiteral &>(expr).value);
+    break;
+  case NodeType::Identifier: {
+    auto &node = static_cast<const IdentifierExpr &>(expr);
+    auto identifier = make_unique<IdentifierExpr>(node.symbol);
+    identifier->binding = node.binding;
+    copy = move(identifier);
+    break;
+  }
+  case NodeType::BinaryExpr: {
+    auto &node = static_cast<const BinaryExpr &>(expr);
+    copy = make_unique<BinaryExpr>(cloneCondition(*node.left),
+                                   cloneCondition(*node.right),
+                                   node.binaryOperator);
+    break;
+  }
+  case NodeType::LogicalExpr: {
+    auto &node = static_cast<const LogicalExpr &>(expr);
+    copy = make_unique<LogicalExpr>(cloneCondition(*node.left),
+                                    cloneCondition(*node.right),
+                                    node.logicalOperator);
+    break;
+  }
+  case NodeType::UnaryExpr: {
+    auto &node = static_cast<const UnaryExpr &>(expr);
+    copy = make_unique<UnaryExpr>(cloneCondition(*node.right), node.op);
+    break;
+  }
+  case NodeType::MemberAccessExpr: {
+    auto &node = static_cast<const MemberAccessExpr &>(expr);
+    auto access = make_unique<MemberAccessExpr>(cloneCondition(*node.object),
+                                                node.memberName);
+    access->fieldIndex = node.fieldIndex;
+    copy = move(access);
+    break;
+  }
+  case NodeType::CallExpr: {
+    auto &node = static_cast<const CallExpr &>(expr);
+    vector<unique_ptr<Expr>> args;
+    for (const auto &arg : node.args) {
+      args.push_back(cloneCondition(*arg));
+    }
+    copy = make_unique<CallExpr>(cloneCondition(*node.caller), move(args));
+    break;
+  }
+  case NodeType::ArrayLiteral: {
+    vector<unique_ptr<Expr>> elements;
+    for (const auto &element :
+         static_cast<const ArrayLiteral &>(expr).elements) {
+      elements.push_back(cloneCondition(*element));
+    }
+    copy = make_unique<ArrayLiteral>(move(elements));
+    break;
+  }
+  case NodeType::IndexExpr: {
+    auto &node = static_cast<const IndexExpr &>(expr);
+    copy = make_unique<IndexExpr>(cloneCondition(*node.object),
+                                  cloneCondition(*node.index));
+    break;
+  }
+  default:
+    // Assignments never reach a guard.
+    copy = make_unique<NullLiteral>("null");
+    break;
+  }
+  copy->offset = expr.offset;
+  return copy;
+}
+
+void LoopRewriter::run(unique_ptr<Stmt> loopStmt,
+                       vector<unique_ptr<Stmt>> &out) {
+  facts.visit(loop);
+  // The running sums would be shared by the iterations of a parallel loop.
+  hasInduction = !loop.parallel && findInduction(out);
+
+  // The guard evaluates the condition once more, which is only harmless
+  // when the condition assigns nothing and calls only pure functions.
+  LoopFacts condition(effects);
+  condition.visit(*loop.condition);
+  unique_ptr<Expr> guard;
+  if (!condition.assigns && !condition.writesMemory) {
+    class Calls : public ConstASTVisitor<Calls> {
+    public:
+      const CallEffects &effects;
+      bool impure = false;
+      Calls(const CallEffects &effects) : effects(effects) {}
+      bool visitCallExpr(const CallExpr &callExpr) {
+        impure = impure || !effects.isPure(callExpr);
+        return visitChildren(callExpr);
+      }
+    };
+    Calls calls(effects);
+    calls.visit(*loop.condition);
+    if (!calls.impure) {
+      guard = cloneCondition(*loop.condition);
+      hoisting = true;
+    }
+  }
+
+  inCondition = true;
+  walkExpr(loop.condition);
+  inCondition = false;
+  walkBlock(loop.loopBody);
+
+  vector<unique_ptr<Stmt>> updates;
+  for (Product &product : products) {
+    int64_t increment, first, start;
+    // The update costs as much as one product does here, so a single
+    // product evaluated once per iteration is not worth replacing.
+    if (!product.anticipated || product.uses < 2 ||
+        __builtin_mul_overflow(induction.step, product.factor, &increment) ||
+        __builtin_mul_overflow(induction.start, product.factor, &first) ||
+        __builtin_sub_overflow(first, increment, &start)) {
+      continue;
+    }
+    auto initial = make_unique<NumericLiteral>(start);
+    initial->offset = loop.offset;
+    auto declaration =
+        make_unique<VarDeclaration>(false, product.name, move(initial));
+    declaration->offset = loop.offset;
+    out.push_back(move(declaration));
+
+    auto sum = make_unique<IdentifierExpr>(product.name);
+    auto amount = make_unique<NumericLiteral>(increment);
+    sum->offset = amount->offset = product.offset;
+    auto next = make_unique<BinaryExpr>(move(sum), move(amount), "+");
+    next->offset = product.offset;
+    auto target = make_unique<IdentifierExpr>(product.name);
+    target->offset = product.offset;
+    auto update = make_unique<AssignmentExpr>(move(target), move(next));
+    update->offset = product.offset;
+    updates.push_back(move(update));
+
+    for (unique_ptr<Expr> *slot : product.slots) {
+      auto replacement = make_unique<IdentifierExpr>(product.name);
+      replacement->offset = (*slot)->offset;
+      *slot = move(replacement);
+      summary.reduced++;
+    }
+  }
+  if (!updates.empty()) {
+    for (auto &stmt : loop.loopBody) {
+      updates.push_back(move(stmt));
+    }
+    loop.loopBody = move(updates);
+  }
+
+  summary.hoisted = hoisted.size();
+  summary.loops = summary.hoisted > 0 || summary.reduced > 0;
+  if (hoisted.empty()) {
+    out.push_back(move(loopStmt));
+    return;
+  }
+  vector<unique_ptr<Stmt>> guarded;
+  for (auto &declaration : hoisted) {
+    guarded.push_back(move(declaration));
+  }
+  guarded.push_back(move(loopStmt));
+  auto ifStmt = make_unique<IfStatement>(move(guard), move(guarded));
+  ifStmt->offset = loop.offset;
+  out.push_back(move(ifStmt));
+}
+
+class LoopOptimizer {
+public:
+  LoopSummary summary;
+  CallEffects effects;
+
+  void optimizeBlock(vector<unique_ptr<Stmt>> &body);
+
+private:
+  // Numbers the names introduced.
+  size_t temporaries = 0;
+};
+
+void LoopOptimizer::optimizeBlock(vector<unique_ptr<Stmt>> &body) {
+  vector<unique_ptr<Stmt>> rewritten;
+  rewritten.reserve(body.size());
+  for (auto &stmt : body) {
+    switch (stmt->kind) {
+    case NodeType::FunctionDeclaration: {
+      // The body is a vector of raw pointers; own it while rewriting.
+      auto &funcDecl = static_cast<FunctionDeclaration &>(*stmt);
+      vector<unique_ptr<Stmt>> owned;
+      for (Stmt *bodyStmt : funcDecl.body) {
+        owned.emplace_back(bodyStmt);
+      }
+      funcDecl.body.clear();
+      optimizeBlock(owned);
+      for (auto &bodyStmt : owned) {
+        funcDecl.body.push_back(bodyStmt.release());
+      }
+      break;
+    }
+    case NodeType::IfStatement: {
+      auto &ifStmt = static_cast<IfStatement &>(*stmt);
+      optimizeBlock(ifStmt.ifBody);
+      optimizeBlock(ifStmt.elseBody);
+      break;
+    }
+    case NodeType::WhileLoop: {
+      auto &loop = static_cast<WhileLoop &>(*stmt);
+      optimizeBlock(loop.loopBody);
+      LoopRewriter rewriter(effects, loop, temporaries);
+      rewriter.run(move(stmt), rewritten);
+      summary.loops += rewriter.summary.loops;
+      summary.hoisted += rewriter.summary.hoisted;
+      summary.reduced += rewriter.summary.reduced;
+      continue;
+    }
+    default:
+      break;
+    }
+    rewritten.push_back(move(stmt));
+  }
+  body = move(rewritten);
+}
+
+} // namespace
+
+LoopSummary optimizeLoops(Program &program) {
+  LoopOptimizer optimizer;
+  optimizer.effects.collect(program);
+  optimizer.optimizeBlock(program.body);
+  return optimizer.summary;
+}
@@ -0,0 +1,73 @@
+#ifndef LOOP_OPTIMIZER_H
+#define LOOP_OPTIMIZER_H
+
+#include "../ast/AST.h"
+
+class LoopSummary {
+public:
+  // Loops the pass changed.
+  size_t loops = 0;
+  // Invariant expressions now computed once in front of their loop.
+  size_t hoisted = 0;
+  // Products of an induction variable replaced by a running sum.
+  size_t reduced = 0;
+};
+
+// Rewrites `while` loops so that work repeated by every iteration is done
+// once. Needs the bindings of a resolveNames() run that found no errors, and
+// leaves them stale wherever it changed the tree: run resolveNames() and the
+// passes after it again if any loop changed. Inner loops are rewritten
+// before the loops around them.
+//
+// Loop-invariant code motion: a binary operation, field read or call of a
+// pure function whose value cannot change while the loop runs is computed
+// once, into a constant declared in front of the loop. A local is invariant
+// when the loop never assigns it; a global or a field also needs the loop to
+// make no call that could write memory, and a field no assignment to any
+// field of that name. A pure function reads nothing but its parameters,
+// calls only pure functions and has no loop, so it always finishes and its
+// result depends on its arguments alone.
+//
+// The loop may run zero times and the expression may fail, so it is only
+// moved when the first iteration is certain to evaluate it before anything
+// with an effect outside the loop: a call that is not pure, a field or array
+// element store, a `return` or a nested loop. The copy is guarded by the
+// loop's condition, which must therefore be safe to evaluate twice:
+//
+//   while (i < n) {             if (i < n) {
+//     s = s + p.x * k;            const #inv1 = p.x * k;
+//     i = i + 1;          =>      while (i < n) {
+//   }                               s = s + #inv1;
+//                                   i = i + 1;
+//                                 }
+//                               }
+//
+// A program that fails still fails, with no effect lost or added, but when
+// another operation of the first iteration fails before the moved one would
+// have, the error reported is the moved expression's.
+//
+// Strength reduction: an induction variable is assigned only by the last
+// statement of the body, `i = i + c` or `i = i - c` with an integer literal
+// `c`, and set to an integer literal by the statement of the enclosing block
+// that last assigns it before the loop, so it always holds an integer. Each
+// product of it with an integer literal `k` becomes a variable declared in
+// front of the loop and advanced by `c * k` at the top of the body, provided
+// one such product is certain to be evaluated on every iteration in the
+// sense above: the running sum overflows exactly when the product would.
+// Updating the sum costs about what one multiplication does, so this only
+// happens when a run of the body evaluates more than one product, through
+// several of them or one inside a nested loop.
+// Products in the loop's own condition, and loops that are `parallel`, are
+// left alone.
+//
+// The names introduced start with `#`, which the lexer never produces.
+//
+// Like the other passes after the parser, this one recurses once per level
+// of the tree, so it relies on the depth limit CompilerContext::analyze
+// checks before any pass runs; see checkTreeDepth. Hoisting only makes
+// expressions shallower, and the guarding `if` adds one statement level
+// per loop changed, so the statements of a rewritten tree nest at most
+// twice as deep as before.
+LoopSummary optimizeLoops(Program &program);
+
+#endif
@@ -0,0 +1,244 @@
+#include "ParallelLoops.h"
+#include "../ast/Visitor.h"
+#include <algorithm>
+
+namespace {
+
+bool sameBinding(const Binding &a, const Binding &b) {
+  return a.scope == b.scope && a.slot == b.slot;
+}
+
+bool isVariable(const Expr &expr, const Binding &binding) {
+  return expr.kind == NodeType::Identifier &&
+         sameBinding(static_cast<const IdentifierExpr &>(expr).binding,
+                     binding);
+}
+
+// The variable of `i < n` or `i <= n`, or null.
+const IdentifierExpr *loopVariable(const Expr &condition) {
+  if (condition.kind != NodeType::BinaryExpr) {
+    return nullptr;
+  }
+  auto &binaryExpr = static_cast<const BinaryExpr &>(condition);
+  if ((binaryExpr.binaryOperator != "<" &&
+       binaryExpr.binaryOperator != "<=") ||
+      binaryExpr.left->kind != NodeType::Identifier) {
+    return nullptr;
+  }
+  return static_cast<const IdentifierExpr *>(binaryExpr.left.get());
+}
+
+// Whether `stmt` is `i = i + c` with a positive integer literal `c`.
+bool isStep(const Stmt &stmt, const Binding &variable) {
+  if (stmt.kind != NodeType::AssignmentExpr) {
+    return false;
+  }
+  auto &assignment = static_cast<const AssignmentExpr &>(stmt);
+  if (!isVariable(*assignment.assigne, variable) ||
+      assignment.value->kind != NodeType::BinaryExpr) {
+    return false;
+  }
+  auto &sum = static_cast<const BinaryExpr &>(*assignment.value);
+  return sum.binaryOperator == "+" && isVariable(*sum.left, variable) &&
+         sum.right->kind == NodeType::NumericLiteral &&
+         static_cast<const NumericLiteral &>(*sum.right).value > 0;
+}
+
+// Whether the indices `a` and `b` are the same variables and integer literals
+// combined by the same arithmetic, so that between assignments to those
+// variables they pick the same element.
+bool sameIndex(const Expr &a, const Expr &b) {
+  if (a.kind != b.kind) {
+    return false;
+  }
+  switch (a.kind) {
+  case NodeType::Identifier:
+    return sameBinding(static_cast<const IdentifierExpr &>(a).binding,
+                       static_cast<const IdentifierExpr &>(b).binding);
+  case NodeType::NumericLiteral:
+    return static_cast<const NumericLiteral &>(a).value ==
+           static_cast<const NumericLiteral &>(b).value;
+  case NodeType::BinaryExpr: {
+    auto &left = static_cast<const BinaryExpr &>(a);
+    auto &right = static_cast<const BinaryExpr &>(b);
+    return left.binaryOperator == right.binaryOperator &&
+           sameIndex(*left.left, *right.left) &&
+           sameIndex(*left.right, *right.right);
+  }
+  default:
+    return false;
+  }
+}
+
+class DeclarationCollector
+    : public ConstASTVisitor<DeclarationCollector> {
+public:
+  vector<Binding> bindings;
+
+  bool visitVarDeclaration(const VarDeclaration &varDecl) {
+    bindings.push_back(varDecl.binding);
+    return visitChildren(varDecl);
+  }
+  bool visitFunctionDeclaration(const FunctionDeclaration &) { return true; }
+  bool visitStructDeclaration(const StructDeclaration &) { return true; }
+};
+
+// Reports the assignments and returns in a parallel loop's body that break
+// its rules. Functions and structs declared there run in frames of their
+// own, and are checked as any other code they call is: at run time.
+class BodyChecker : public ConstASTVisitor<BodyChecker> {
+public:
+  BodyChecker(const vector<Binding> &declared, const Stmt *step,
+              const IdentifierExpr *variable, vector<AnalysisError> &errors)
+      : declared(declared), step(step), variable(variable), errors(errors) {}
+
+  bool visitAssignmentExpr(const AssignmentExpr &assignmentExpr) {
+    if (&assignmentExpr != step &&
+        assignmentExpr.assigne->kind == NodeType::Identifier) {
+      auto &target =
+          static_cast<const IdentifierExpr &>(*assignmentExpr.assigne);
+      if (isShared(target)) {
+        errors.emplace_back("Cannot assign to '" + target.symbol +
+                                "' inside a parallel loop: it is shared by "
+                                "all iterations",
+                            assignmentExpr.offset);
+      }
+    }
+    if (const IndexExpr *element = sharedElement(*assignmentExpr.assigne)) {
+      // The target is a store, not a read: walk only its parts.
+      stores.push_back(element);
+      return visit(*element->object) && visit(*element->index) &&
+             visit(*assignmentExpr.value);
+    }
+    return visitChildren(assignmentExpr);
+  }
+  bool visitIndexExpr(const IndexExpr &indexExpr) {
+    if (const IndexExpr *element = sharedElement(indexExpr)) {
+      reads.push_back(element);
+    }
+    return visitChildren(indexExpr);
+  }
+  bool visitReturnStatement(const ReturnStatement &returnStmt) {
+    errors.emplace_back("Cannot return from inside a parallel loop",
+                        returnStmt.offset);
+    return visitChildren(returnStmt);
+  }
+  bool visitFunctionDeclaration(const FunctionDeclaration &) { return true; }
+  bool visitStructDeclaration(const StructDeclaration &) { return true; }
+
+  // Reports the elements of shared arrays the body both reads and sets at
+  // an index other than the loop variable. Several iterations may pick the
+  // same element, and their updates would race.
+  void checkElements() {
+    for (const IndexExpr *store : stores) {
+      auto &array = static_cast<const IdentifierExpr &>(*store->object);
+      if (any_of(reads.begin(), reads.end(), [&](const IndexExpr *read) {
+            return isVariable(*read->object, array.binding) &&
+                   sameIndex(*read->index, *store->index);
+          })) {
+        errors.emplace_back(
+            "Cannot read and set the same element of '" + array.symbol +
+                "' inside a parallel loop unless its index is '" +
+                (variable ? variable->symbol : string("i")) +
+                "': iterations would race on it",
+            store->offset);
+      }
+    }
+  }
+
+private:
+  const vector<Binding> &declared;
+  const Stmt *step;
+  const IdentifierExpr *variable;
+  vector<AnalysisError> &errors;
+  // Elements of shared arrays indexed by something other than the loop
+  // variable, in source order.
+  vector<const IndexExpr *> reads;
+  vector<const IndexExpr *> stores;
+
+  bool isShared(const IdentifierExpr &identifier) const {
+    return none_of(declared.begin(), declared.end(),
+                   [&](const Binding &binding) {
+                     return sameBinding(binding, identifier.binding);
+                   });
+  }
+
+  // `expr` as `a[index]` with `a` a shared variable and `index` not the
+  // loop variable, or null.
+  const IndexExpr *sharedElement(const Expr &expr) const {
+    if (expr.kind != NodeType::IndexExpr) {
+      return nullptr;
+    }
+    auto &element = static_cast<const IndexExpr &>(expr);
+    if (element.object->kind != NodeType::Identifier ||
+        !isShared(static_cast<const IdentifierExpr &>(*element.object)) ||
+        (variable && isVariable(*element.index, variable->binding))) {
+      return nullptr;
+    }
+    return &element;
+  }
+};
+
+class ParallelChecker : public ConstASTVisitor<ParallelChecker> {
+public:
+  ParallelSummary summary;
+
+  bool visitWhileLoop(const WhileLoop &whileLoop) {
+    if (whileLoop.parallel) {
+      check(whileLoop);
+    }
+    return visitChildren(whileLoop);
+  }
+
+private:
+  void check(const WhileLoop &loop);
+};
+
+void ParallelChecker::check(const WhileLoop &loop) {
+  summary.loops++;
+  vector<Binding> declared = bodyDeclarations(loop);
+  const IdentifierExpr *variable = loopVariable(*loop.condition);
+  if (variable && any_of(declared.begin(), declared.end(),
+                         [&](const Binding &binding) {
+                           return sameBinding(binding, variable->binding);
+                         })) {
+    variable = nullptr;
+  }
+  if (!variable) {
+    summary.errors.emplace_back(
+        "The condition of a parallel loop must be 'i < n' or 'i <= n', "
+        "with 'i' declared outside the loop",
+        loop.condition->offset);
+  }
+  const Stmt *step = nullptr;
+  if (variable && !loop.loopBody.empty() &&
+      isStep(*loop.loopBody.back(), variable->binding)) {
+    step = loop.loopBody.back().get();
+  } else if (variable) {
+    summary.errors.emplace_back(
+        "A parallel loop must end with '" + variable->symbol + " = " +
+            variable->symbol + " + c', where c is a positive integer literal",
+        loop.loopBody.empty() ? loop.offset : loop.loopBody.back()->offset);
+  }
+  BodyChecker checker(declared, step, variable, summary.errors);
+  for (const auto &stmt : loop.loopBody) {
+    checker.visit(*stmt);
+  }
+  checker.checkElements();
+}
+
+} // namespace
+
+vector<Binding> bodyDeclarations(const WhileLoop &loop) {
+  DeclarationCollector collector;
+  for (const auto &stmt : loop.loopBody) {
+    collector.visit(*stmt);
+  }
+  return move(collector.bindings);
+}
+
+ParallelSummary checkParallelLoops(const Program &program) {
+  ParallelChecker checker;
+  checker.visit(program);
+  return move(checker.summary);
+}
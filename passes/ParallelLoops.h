@@ -0,0 +1,53 @@
+#ifndef PARALLEL_LOOPS_H
+#define PARALLEL_LOOPS_H
+
+#include "../ast/AST.h"
+#include "AnalysisError.h"
+#include <vector>
+
+class ParallelSummary {
+public:
+  // `parallel while` loops in the program.
+  size_t loops = 0;
+  vector<AnalysisError> errors;
+};
+
+// Checks that every `parallel while` has the shape that lets its iterations
+// run at the same time, on a thread pool, in any order:
+//
+//   parallel while (i < n) {      `<=` works as well
+//     let x = i * i;              any statements but `return`
+//     squares[i] = x;
+//     i = i + 1;                  a positive integer literal step, last
+//   }
+//
+// `i` is declared outside the loop, and the loop's iterations are the values
+// it takes: from its value when the loop starts, by the step, while the
+// condition holds, with `n` evaluated just once. Both must be ints, which
+// the interpreter checks when the loop starts. The body other than its
+// last statement runs once for each of them, and afterwards `i` holds the
+// value that ends the loop, as it would have after an ordinary `while`.
+//
+// Iterations share nothing they can change. A variable declared in the body
+// is private to one iteration; every variable declared outside it, `i`
+// included, is shared by all of them and read-only, so assigning to one is
+// an error here. Memory reached through such a variable is read-only as
+// well, with one exception the interpreter checks as the loop runs: an
+// element of an array of ints may be set to an int, and one of an array of
+// floats to a float. Anything the body allocates itself, it may change.
+// Which of several stores to the same element wins is unspecified, as is
+// the order of lines printed by different iterations. An element the body
+// both reads and sets, as in `a[k] = a[k] + 1`, must be indexed by `i`
+// itself: at any other index several iterations could update it at once,
+// so that is an error here. A function the body
+// calls that assigns to a global fails at run time.
+//
+// A `parallel while` nested in another one runs its iterations one after
+// the other, on the thread that runs the outer iteration.
+ParallelSummary checkParallelLoops(const Program &program);
+
+// Bindings of the variables declared in the body of `loop`, outside the
+// functions and structs declared there.
+vector<Binding> bodyDeclarations(const WhileLoop &loop);
+
+#endif
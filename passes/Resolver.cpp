@@ -0,0 +1,296 @@
+#include "Resolver.h"
+#include "../ast/Visitor.h"
+#include <unordered_map>
+
+namespace {
+
+enum class SymbolKind { Variable, Constant, Function, Struct };
+
+class Symbol {
+public:
+  Binding binding;
+  SymbolKind kind;
+};
+
+using Scope = unordered_map<string, Symbol>;
+
+class Resolver : public ASTVisitor<Resolver> {
+public:
+  Resolution resolution;
+
+  void resolve(Program &program, const vector<string> &builtins);
+
+  bool visitVarDeclaration(VarDeclaration &varDecl);
+  bool visitFunctionDeclaration(FunctionDeclaration &funcDecl);
+  bool visitStructDeclaration(StructDeclaration &structDecl);
+  bool visitIfStatement(IfStatement &ifStmt);
+  bool visitWhileLoop(WhileLoop &whileLoop);
+  bool visitAssignmentExpr(AssignmentExpr &assignmentExpr);
+  bool visitCallExpr(CallExpr &callExpr);
+  bool visitIdentifier(IdentifierExpr &identifier);
+
+private:
+  Scope globals;
+  size_t builtinCount = 0;
+  // Block scopes of the code being resolved, innermost last. Inside a
+  // function the first one holds the parameters.
+  vector<Scope> blocks;
+  FunctionDeclaration *function = nullptr;
+  // Block scopes of the functions the current one is nested in; only
+  // consulted to explain why a name is out of reach.
+  vector<vector<Scope>> enclosing;
+
+  void hoist(Program &program);
+  void declareGlobal(const Node &node, const string &name, SymbolKind kind,
+                     Binding &binding);
+  void declareLocal(const Node &node, const string &name, SymbolKind kind,
+                    Binding &binding);
+  const Symbol *lookup(const string &name) const;
+  void resolveBlock(vector<unique_ptr<Stmt>> &body);
+  // Runs `body` with only the globals in scope, as function bodies and
+  // struct field initializers see them.
+  template <typename F> void inGlobalScope(F &&body);
+  void error(const string &message, const Node &node);
+};
+
+void Resolver::error(const string &message, const Node &node) {
+  resolution.errors.emplace_back(message, node.offset);
+}
+
+void Resolver::resolve(Program &program, const vector<string> &builtins) {
+  builtinCount = builtins.size();
+  for (const string &name : builtins) {
+    Binding binding;
+    declareGlobal(program, name, SymbolKind::Function, binding);
+  }
+  hoist(program);
+  for (auto &stmt : program.body) {
+    visit(*stmt);
+  }
+}
+
+// Gives every function, struct and top-level variable its global slot before
+// any use is resolved.
+void Resolver::hoist(Program &program) {
+  class Hoister : public ASTVisitor<Hoister> {
+  public:
+    Resolver &resolver;
+    Hoister(Resolver &resolver) : resolver(resolver) {}
+
+    bool visitFunctionDeclaration(FunctionDeclaration &funcDecl) {
+      resolver.declareGlobal(funcDecl, funcDecl.name, SymbolKind::Function,
+                             funcDecl.binding);
+      return visitChildren(funcDecl);
+    }
+    bool visitStructDeclaration(StructDeclaration &structDecl) {
+      resolver.declareGlobal(structDecl, structDecl.structName,
+                             SymbolKind::Struct, structDecl.binding);
+      return visitChildren(structDecl);
+    }
+  };
+
+  for (auto &stmt : program.body) {
+    if (stmt->kind == NodeType::VarDeclaration) {
+      auto &varDecl = static_cast<VarDeclaration &>(*stmt);
+      declareGlobal(varDecl, varDecl.identifier,
+                    varDecl.constant ? SymbolKind::Constant
+                                     : SymbolKind::Variable,
+                    varDecl.binding);
+    }
+  }
+  Hoister(*this).visit(program);
+}
+
+void Resolver::declareGlobal(const Node &node, const string &name,
+                             SymbolKind kind, Binding &binding) {
+  if (globals.count(name)) {
+    error("'" + name + "' is already declared", node);
+    return;
+  }
+  binding.scope = Binding::Scope::Global;
+  binding.slot = static_cast<uint32_t>(resolution.globals.size());
+  resolution.globals.push_back(name);
+  globals.emplace(name, Symbol{binding, kind});
+}
+
+void Resolver::declareLocal(const Node &node, const string &name,
+                            SymbolKind kind, Binding &binding) {
+  Scope &scope = blocks.back();
+  if (scope.count(name)) {
+    error("'" + name + "' is already declared in this scope", node);
+    return;
+  }
+  if (function) {
+    binding.scope = Binding::Scope::Local;
+    binding.slot = function->frameSize++;
+  } else {
+    // A block at the top level: the variable lives in a global slot of its
+    // own but is only visible inside the block.
+    binding.scope = Binding::Scope::Global;
+    binding.slot = static_cast<uint32_t>(resolution.globals.size());
+    resolution.globals.push_back(name);
+  }
+  scope.emplace(name, Symbol{binding, kind});
+}
+
+const Symbol *Resolver::lookup(const string &name) const {
+  for (auto scope = blocks.rbegin(); scope != blocks.rend(); ++scope) {
+    auto it = scope->find(name);
+    if (it != scope->end()) {
+      return &it->second;
+    }
+  }
+  auto it = globals.find(name);
+  return it == globals.end() ? nullptr : &it->second;
+}
+
+void Resolver::resolveBlock(vector<unique_ptr<Stmt>> &body) {
+  blocks.emplace_back();
+  for (auto &stmt : body) {
+    visit(*stmt);
+  }
+  blocks.pop_back();
+}
+
+template <typename F> void Resolver::inGlobalScope(F &&body) {
+  enclosing.push_back(move(blocks));
+  blocks.clear();
+  FunctionDeclaration *outer = function;
+  function = nullptr;
+  body();
+  function = outer;
+  blocks = move(enclosing.back());
+  enclosing.pop_back();
+}
+
+bool Resolver::visitVarDeclaration(VarDeclaration &varDecl) {
+  if (varDecl.value) {
+    visit(*varDecl.value);
+  }
+  // Top-level declarations were bound while hoisting.
+  if (function || !blocks.empty()) {
+    declareLocal(varDecl, varDecl.identifier,
+                 varDecl.constant ? SymbolKind::Constant
+                                  : SymbolKind::Variable,
+                 varDecl.binding);
+  }
+  return true;
+}
+
+bool Resolver::visitFunctionDeclaration(FunctionDeclaration &funcDecl) {
+  inGlobalScope([&] {
+    function = &funcDecl;
+    function->frameSize = 0;
+    blocks.emplace_back();
+    for (const string &parameter : funcDecl.parameters) {
+      Binding binding;
+      declareLocal(funcDecl, parameter, SymbolKind::Variable, binding);
+    }
+    for (Stmt *stmt : funcDecl.body) {
+      visit(*stmt);
+    }
+  });
+  return true;
+}
+
+// Field declarations are not variables; only their initializers, which run
+// when an instance is constructed, refer to names.
+bool Resolver::visitStructDeclaration(StructDeclaration &structDecl) {
+  inGlobalScope([&] {
+    for (auto &field : structDecl.structBody) {
+      if (field->kind == NodeType::VarDeclaration) {
+        auto &varDecl = static_cast<VarDeclaration &>(*field);
+        if (varDecl.value) {
+          visit(*varDecl.value);
+        }
+      }
+    }
+  });
+  return true;
+}
+
+bool Resolver::visitIfStatement(IfStatement &ifStmt) {
+  visit(*ifStmt.condition);
+  resolveBlock(ifStmt.ifBody);
+  resolveBlock(ifStmt.elseBody);
+  return true;
+}
+
+bool Resolver::visitWhileLoop(WhileLoop &whileLoop) {
+  visit(*whileLoop.condition);
+  resolveBlock(whileLoop.loopBody);
+  return true;
+}
+
+bool Resolver::visitAssignmentExpr(AssignmentExpr &assignmentExpr) {
+  visit(*assignmentExpr.value);
+  Expr &target = *assignmentExpr.assigne;
+  visit(target);
+  if (target.kind == NodeType::Identifier) {
+    const string &name = static_cast<IdentifierExpr &>(target).symbol;
+    const Symbol *symbol = lookup(name);
+    if (!symbol) {
+      return true;
+    }
+    switch (symbol->kind) {
+    case SymbolKind::Constant:
+      error("Cannot assign to constant '" + name + "'", target);
+      break;
+    case SymbolKind::Function:
+      error("Cannot assign to function '" + name + "'", target);
+      break;
+    case SymbolKind::Struct:
+      error("Cannot assign to struct '" + name + "'", target);
+      break;
+    case SymbolKind::Variable:
+      break;
+    }
+  } else if (target.kind != NodeType::MemberAccessExpr &&
+             target.kind != NodeType::IndexExpr) {
+    error("Invalid assignment target", target);
+  }
+  return true;
+}
+
+// Builtins can be neither assigned nor redeclared, so a caller that resolves
+// to one of their slots names that builtin for good.
+bool Resolver::visitCallExpr(CallExpr &callExpr) {
+  visitChildren(callExpr);
+  callExpr.builtin = -1;
+  if (callExpr.caller->kind == NodeType::Identifier) {
+    const Binding &binding =
+        static_cast<const IdentifierExpr &>(*callExpr.caller).binding;
+    if (binding.scope == Binding::Scope::Global &&
+        binding.slot < builtinCount) {
+      callExpr.builtin = static_cast<int32_t>(binding.slot);
+    }
+  }
+  return true;
+}
+
+bool Resolver::visitIdentifier(IdentifierExpr &identifier) {
+  if (const Symbol *symbol = lookup(identifier.symbol)) {
+    identifier.binding = symbol->binding;
+    return true;
+  }
+  for (const vector<Scope> &outer : enclosing) {
+    for (const Scope &scope : outer) {
+      if (scope.count(identifier.symbol)) {
+        error("Cannot use '" + identifier.symbol +
+                  "' here: it is a local of an enclosing function",
+              identifier);
+        return true;
+      }
+    }
+  }
+  error("Undefined name '" + identifier.symbol + "'", identifier);
+  return true;
+}
+
+} // namespace
+
+Resolution resolveNames(Program &program, const vector<string> &builtins) {
+  Resolver resolver;
+  resolver.resolve(program, builtins);
+  return move(resolver.resolution);
+}
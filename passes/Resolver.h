@@ -0,0 +1,36 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include "../ast/AST.h"
+#include "AnalysisError.h"
+#include <vector>
+
+// Binds every declaration and every identifier use of a program to a slot,
+// writing the result into the nodes' `binding` fields. The scoping rules:
+//
+//  - Functions and structs are global wherever they are declared, and visible
+//    before their declaration. A function body sees its parameters, its own
+//    locals and the globals, never the locals of an enclosing function.
+//  - Top-level `let`/`const` are globals, visible to every function; they
+//    hold null until their declaration runs.
+//  - Anything else declared in a block is visible from its declaration to the
+//    end of the block and may shadow outer names, but not a name declared
+//    earlier in the same block.
+//  - Every declaration gets a slot of its own, so a function's frame has one
+//    slot per parameter and per local.
+//
+// Assigning to a constant, function or struct is an error, as is using a
+// name that resolves to nothing. `builtins` are functions a runtime
+// provides; they take global slots 0..n-1, in order. A call whose caller is
+// the name of one gets its slot as CallExpr::builtin, binding the call to it.
+class Resolution {
+public:
+  // Name of each global slot, in slot order.
+  vector<string> globals;
+  vector<AnalysisError> errors;
+};
+
+Resolution resolveNames(Program &program,
+                        const vector<string> &builtins = {});
+
+#endif
@@ -0,0 +1,274 @@
+#include "StructLayout.h"
+#include "../ast/Visitor.h"
+#include <map>
+
+int32_t StructLayout::indexOf(const string &name) const {
+  for (const FieldLayout &field : fields) {
+    if (field.name == name) {
+      return static_cast<int32_t>(field.index);
+    }
+  }
+  return -1;
+}
+
+void LayoutTable::add(StructLayout layout) {
+  if (layout.declaration->binding.resolved()) {
+    bySlot.emplace(layout.declaration->binding.slot, structs.size());
+  }
+  structs.push_back(move(layout));
+}
+
+const StructLayout *LayoutTable::forSlot(uint32_t slot) const {
+  auto it = bySlot.find(slot);
+  return it == bySlot.end() ? nullptr : &structs[it->second];
+}
+
+const StructLayout *
+LayoutTable::forDeclaration(const StructDeclaration &decl) const {
+  for (const StructLayout &layout : structs) {
+    if (layout.declaration == &decl) {
+      return &layout;
+    }
+  }
+  return nullptr;
+}
+
+namespace {
+
+// A variable: the function whose frame holds it, or nullptr for a global,
+// and its slot.
+using Variable = pair<const FunctionDeclaration *, uint32_t>;
+
+// An expression together with the function it appears in, which is what
+// its bindings are relative to.
+template <typename T> class Site {
+public:
+  T *node;
+  const FunctionDeclaration *owner;
+};
+
+class Store {
+public:
+  Variable variable;
+  // nullptr for a declaration without a value.
+  Site<const Expr> value;
+};
+
+// Gathers the structs, every write to a variable and every member access.
+class Collector : public ASTVisitor<Collector> {
+public:
+  vector<StructDeclaration *> structs;
+  vector<Store> stores;
+  vector<Site<MemberAccessExpr>> accesses;
+  vector<Site<const CallExpr>> calls;
+
+  bool visitFunctionDeclaration(FunctionDeclaration &funcDecl) {
+    const FunctionDeclaration *outer = owner;
+    owner = &funcDecl;
+    visitChildren(funcDecl);
+    owner = outer;
+    return true;
+  }
+  bool visitStructDeclaration(StructDeclaration &structDecl) {
+    structs.push_back(&structDecl);
+    // Field initializers run outside any function.
+    const FunctionDeclaration *outer = owner;
+    owner = nullptr;
+    for (auto &field : structDecl.structBody) {
+      if (field->kind == NodeType::VarDeclaration) {
+        auto &varDecl = static_cast<VarDeclaration &>(*field);
+        if (varDecl.value) {
+          visit(*varDecl.value);
+        }
+      }
+    }
+    owner = outer;
+    return true;
+  }
+  bool visitVarDeclaration(VarDeclaration &varDecl) {
+    if (varDecl.binding.resolved()) {
+      stores.push_back(
+          {variable(varDecl.binding), {varDecl.value.get(), owner}});
+    }
+    return visitChildren(varDecl);
+  }
+  bool visitAssignmentExpr(AssignmentExpr &assignmentExpr) {
+    if (assignmentExpr.assigne->kind == NodeType::Identifier) {
+      auto &target = static_cast<IdentifierExpr &>(*assignmentExpr.assigne);
+      if (target.binding.resolved()) {
+        stores.push_back(
+            {variable(target.binding), {assignmentExpr.value.get(), owner}});
+      }
+    }
+    return visitChildren(assignmentExpr);
+  }
+  bool visitMemberAccessExpr(MemberAccessExpr &memberAccessExpr) {
+    accesses.push_back({&memberAccessExpr, owner});
+    return visitChildren(memberAccessExpr);
+  }
+  bool visitCallExpr(CallExpr &callExpr) {
+    calls.push_back({&callExpr, owner});
+    return visitChildren(callExpr);
+  }
+
+  Variable variable(const Binding &binding) const {
+    return {binding.scope == Binding::Scope::Local ? owner : nullptr,
+            binding.slot};
+  }
+
+private:
+  const FunctionDeclaration *owner = nullptr;
+};
+
+class LayoutBuilder {
+public:
+  LayoutTable table;
+
+  void build(Program &program);
+
+private:
+  Collector collector;
+  // Index into table.structs of the struct each known variable holds.
+  map<Variable, size_t> known;
+
+  void layOut(const StructDeclaration &decl);
+  void inferVariables();
+  // Index of the struct `site` evaluates to an instance of, or -1.
+  long typeOf(Site<const Expr> site) const;
+  long constructed(Site<const Expr> site) const;
+};
+
+void LayoutBuilder::build(Program &program) {
+  collector.visit(program);
+  for (const StructDeclaration *decl : collector.structs) {
+    layOut(*decl);
+  }
+  inferVariables();
+
+  for (const auto &access : collector.accesses) {
+    MemberAccessExpr &node = *access.node;
+    node.fieldIndex = -1;
+    table.memberAccesses++;
+    long type = typeOf({node.object.get(), access.owner});
+    if (type < 0) {
+      continue;
+    }
+    const StructLayout &layout = table.structs[type];
+    node.fieldIndex = layout.indexOf(node.memberName);
+    if (node.fieldIndex < 0) {
+      table.errors.emplace_back("Struct '" + layout.name + "' has no field '" +
+                                    node.memberName + "'",
+                                node.offset);
+    } else {
+      table.resolvedAccesses++;
+    }
+  }
+
+  for (const auto &call : collector.calls) {
+    long type = constructed({call.node, call.owner});
+    if (type >= 0 &&
+        call.node->args.size() > table.structs[type].fields.size()) {
+      const StructLayout &layout = table.structs[type];
+      table.errors.emplace_back(
+          "Struct '" + layout.name + "' has " +
+              to_string(layout.fields.size()) + " fields but " +
+              to_string(call.node->args.size()) + " arguments were given",
+          call.node->offset);
+    }
+  }
+}
+
+void LayoutBuilder::layOut(const StructDeclaration &decl) {
+  StructLayout layout{decl.structName, &decl, {}, 0};
+  for (const auto &field : decl.structBody) {
+    if (field->kind != NodeType::VarDeclaration) {
+      continue;
+    }
+    auto &varDecl = static_cast<const VarDeclaration &>(*field);
+    if (layout.indexOf(varDecl.identifier) >= 0) {
+      table.errors.emplace_back("Field '" + varDecl.identifier +
+                                    "' is already declared in struct '" +
+                                    decl.structName + "'",
+                                varDecl.offset);
+      continue;
+    }
+    uint32_t index = static_cast<uint32_t>(layout.fields.size());
+    layout.fields.push_back({varDecl.identifier, index, index * FieldSize,
+                             varDecl.constant, &varDecl});
+  }
+  layout.size = static_cast<uint32_t>(layout.fields.size()) * FieldSize;
+  table.add(move(layout));
+}
+
+// Starts with nothing known and marks a variable once all of its stores
+// have one and the same type, until nothing changes. Facts only ever get
+// added, so this terminates, and variables that only feed each other stay
+// unknown.
+void LayoutBuilder::inferVariables() {
+  map<Variable, vector<Site<const Expr>>> storesOf;
+  for (const Store &store : collector.stores) {
+    storesOf[store.variable].push_back(store.value);
+  }
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (const auto &entry : storesOf) {
+      if (known.count(entry.first)) {
+        continue;
+      }
+      long type = -1;
+      for (const auto &value : entry.second) {
+        long valueType = value.node ? typeOf(value) : -1;
+        if (valueType < 0 || (type >= 0 && valueType != type)) {
+          type = -1;
+          break;
+        }
+        type = valueType;
+      }
+      if (type >= 0) {
+        known.emplace(entry.first, static_cast<size_t>(type));
+        changed = true;
+      }
+    }
+  }
+}
+
+long LayoutBuilder::constructed(Site<const Expr> site) const {
+  if (site.node->kind != NodeType::CallExpr) {
+    return -1;
+  }
+  const Expr &caller = *static_cast<const CallExpr &>(*site.node).caller;
+  if (caller.kind != NodeType::Identifier) {
+    return -1;
+  }
+  const Binding &binding = static_cast<const IdentifierExpr &>(caller).binding;
+  if (binding.scope != Binding::Scope::Global) {
+    return -1;
+  }
+  const StructLayout *layout = table.forSlot(binding.slot);
+  return layout ? layout - table.structs.data() : -1;
+}
+
+long LayoutBuilder::typeOf(Site<const Expr> site) const {
+  if (site.node->kind == NodeType::Identifier) {
+    const Binding &binding =
+        static_cast<const IdentifierExpr &>(*site.node).binding;
+    if (!binding.resolved()) {
+      return -1;
+    }
+    Variable variable{
+        binding.scope == Binding::Scope::Local ? site.owner : nullptr,
+        binding.slot};
+    auto it = known.find(variable);
+    return it == known.end() ? -1 : static_cast<long>(it->second);
+  }
+  return constructed(site);
+}
+
+} // namespace
+
+LayoutTable computeLayouts(Program &program) {
+  LayoutBuilder builder;
+  builder.build(program);
+  return move(builder.table);
+}
@@ -0,0 +1,67 @@
+#ifndef STRUCT_LAYOUT_H
+#define STRUCT_LAYOUT_H
+
+#include "../ast/AST.h"
+#include "AnalysisError.h"
+#include "Resolver.h"
+#include <unordered_map>
+#include <vector>
+
+// Every field is one tagged runtime value wide.
+constexpr uint32_t FieldSize = 16;
+
+class FieldLayout {
+public:
+  string name;
+  uint32_t index;
+  // Byte offset of the field from the start of the instance.
+  uint32_t offset;
+  bool constant;
+  // The declaration, whose value (if any) initializes the field when a
+  // constructor call leaves it out.
+  const VarDeclaration *declaration;
+};
+
+// Fixed layout of one struct: its fields in declaration order.
+class StructLayout {
+public:
+  string name;
+  const StructDeclaration *declaration;
+  vector<FieldLayout> fields;
+  // Bytes of one instance.
+  uint32_t size;
+
+  // Index of the field called `name`, or -1.
+  int32_t indexOf(const string &name) const;
+};
+
+class LayoutTable {
+public:
+  vector<StructLayout> structs;
+  // Member accesses rewritten to a field index, and all of them.
+  size_t resolvedAccesses = 0;
+  size_t memberAccesses = 0;
+  vector<AnalysisError> errors;
+
+  void add(StructLayout layout);
+  // The layout of the struct bound to global `slot`, or nullptr.
+  const StructLayout *forSlot(uint32_t slot) const;
+  const StructLayout *forDeclaration(const StructDeclaration &decl) const;
+
+private:
+  unordered_map<uint32_t, size_t> bySlot;
+};
+
+// Lays out every struct and sets MemberAccessExpr::fieldIndex wherever the
+// object is provably an instance of a single struct. Needs the bindings
+// resolveNames() writes.
+//
+// Calling a struct constructs an instance: `P(a, b)` fills the fields of P
+// in declaration order, and fields without an argument take their
+// initializer, or null. A variable is known to hold a P when it is declared
+// with a value of type P and every assignment to it is of type P too, where
+// constructor calls of P and variables known to hold a P have type P.
+// Parameters, fields and call results are never known.
+LayoutTable computeLayouts(Program &program);
+
+#endif
@@ -0,0 +1,35 @@
+#include "TailCalls.h"
+#include "../ast/Visitor.h"
+
+namespace {
+
+class TailCallMarker : public ASTVisitor<TailCallMarker> {
+public:
+  size_t marked = 0;
+
+  bool visitFunctionDeclaration(FunctionDeclaration &funcDecl) {
+    functionDepth++;
+    bool result = visitChildren(funcDecl);
+    functionDepth--;
+    return result;
+  }
+  bool visitReturnStatement(ReturnStatement &returnStmt) {
+    const Stmt *value = returnStmt.returnValue.get();
+    returnStmt.tailCall =
+        functionDepth > 0 && value && value->kind == NodeType::CallExpr &&
+        static_cast<const CallExpr *>(value)->builtin < 0;
+    marked += returnStmt.tailCall;
+    return visitChildren(returnStmt);
+  }
+
+private:
+  size_t functionDepth = 0;
+};
+
+} // namespace
+
+size_t markTailCalls(Program &program) {
+  TailCallMarker marker;
+  marker.visit(program);
+  return marker.marked;
+}
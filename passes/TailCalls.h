@@ -0,0 +1,15 @@
+#ifndef TAIL_CALLS_H
+#define TAIL_CALLS_H
+
+#include "../ast/AST.h"
+
+// Sets ReturnStatement::tailCall on every `return f(...);` inside a
+// function, unless the call is bound to a builtin, and returns how many
+// there are. The interpreter runs such a call, when `f` turns out to be a
+// function, in the frame of the function returning it, so a chain of tail
+// calls takes constant stack however long it gets; see
+// Interpreter::tailCall. Top-level returns are left alone:
+// there is no frame there to reuse.
+size_t markTailCalls(Program &program);
+
+#endif
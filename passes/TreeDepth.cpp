@@ -0,0 +1,26 @@
+#include "TreeDepth.h"
+#include "../ast/Visitor.h"
+
+vector<AnalysisError> checkTreeDepth(const Program &program, size_t limit) {
+  // A node still to be looked at and its level; the program is level 1.
+  struct Pending {
+    const Stmt *node;
+    size_t level;
+  };
+
+  vector<Pending> stack{{&program, 1}};
+  while (!stack.empty()) {
+    Pending next = stack.back();
+    stack.pop_back();
+    if (next.level > limit) {
+      return {AnalysisError("Program nests deeper than the limit of " +
+                                to_string(limit) + " levels for analysis.",
+                            next.node->offset)};
+    }
+    forEachChild(*next.node, [&](const Stmt &child) {
+      stack.push_back({&child, next.level + 1});
+      return true;
+    });
+  }
+  return {};
+}
@@ -0,0 +1,20 @@
+#ifndef TREE_DEPTH_H
+#define TREE_DEPTH_H
+
+#include "../ast/AST.h"
+#include "AnalysisError.h"
+#include <vector>
+
+// Reports the first node found more than `limit` levels below `program`,
+// or nothing. Walks the tree from an explicit stack, so it is safe on any
+// tree the parser builds.
+//
+// The passes CompilerContext::analyze runs, and the interpreter and the IR
+// lowering after them, recurse once per level of the tree. The parser's
+// nesting limit bounds blocks, parentheses and unary operators, but not
+// operator, member and call chains, which it builds with loops and which
+// are as deep as they are long; this check is what keeps those passes on
+// the stack.
+vector<AnalysisError> checkTreeDepth(const Program &program, size_t limit);
+
+#endif
@@ -0,0 +1,374 @@
+#include "Builtins.h"
+#include "Interpreter.h"
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace {
+
+// Conversions between values and the C++ types native functions take and
+// return. An argument type says which values it accepts, and what to call
+// them when a value is not one of those; a result type how it becomes a
+// value.
+template <typename T> class Marshal;
+
+// Any number, int or float, left as it is.
+class Number {
+public:
+  Value value;
+};
+
+double asDouble(Value value) {
+  return value.type == ValueType::Int ? static_cast<double>(value.integer)
+                                      : value.number;
+}
+
+template <> class Marshal<Value> {
+public:
+  static bool accepts(Value) { return true; }
+  static Value from(Value value) { return value; }
+  static Value to(Interpreter &, Value value) { return value; }
+};
+
+template <> class Marshal<Number> {
+public:
+  static constexpr const char *expected = "a number";
+  static bool accepts(Value value) { return value.isNumber(); }
+  static Number from(Value value) { return Number{value}; }
+};
+
+template <> class Marshal<int64_t> {
+public:
+  static constexpr const char *expected = "an int";
+  static bool accepts(Value value) { return value.type == ValueType::Int; }
+  static int64_t from(Value value) { return value.integer; }
+  static Value to(Interpreter &, int64_t value) {
+    return Value::fromInt(value);
+  }
+};
+
+// Ints convert.
+template <> class Marshal<double> {
+public:
+  static constexpr const char *expected = "a number";
+  static bool accepts(Value value) { return value.isNumber(); }
+  static double from(Value value) { return asDouble(value); }
+  static Value to(Interpreter &, double value) {
+    return Value::fromFloat(value);
+  }
+};
+
+template <> class Marshal<bool> {
+public:
+  static Value to(Interpreter &, bool value) { return Value::fromBool(value); }
+};
+
+// Points into the heap, so it is only good until the next allocation: the
+// native function must be done with it before it makes one.
+template <> class Marshal<string_view> {
+public:
+  static constexpr const char *expected = "a string";
+  static bool accepts(Value value) { return value.type == ValueType::String; }
+  static string_view from(Value value) { return value.asString()->view(); }
+};
+
+template <> class Marshal<string> {
+public:
+  static Value to(Interpreter &interpreter, const string &value) {
+    return interpreter.makeString(value);
+  }
+};
+
+// Null when empty.
+template <typename T> class Marshal<optional<T>> {
+public:
+  static Value to(Interpreter &interpreter, const optional<T> &value) {
+    return value ? Marshal<T>::to(interpreter, *value) : Value();
+  }
+};
+
+template <typename T> T argument(const Value *args, size_t index) {
+  if constexpr (!is_same_v<T, Value>) {
+    if (!Marshal<T>::accepts(args[index])) {
+      throw BuiltinError("takes " + string(Marshal<T>::expected) +
+                         " as argument " + to_string(index + 1) + ", not " +
+                         typeName(args[index]));
+    }
+  }
+  return Marshal<T>::from(args[index]);
+}
+
+void checkArity(size_t arity, size_t count) {
+  if (count != arity) {
+    string expected = arity == 0   ? "no arguments"
+                      : arity == 1 ? "1 argument"
+                                   : to_string(arity) + " arguments";
+    throw BuiltinError("takes " + expected + ", not " + to_string(count));
+  }
+}
+
+// Calls a native function returning R and taking Params. Everything but the
+// arity check and the type tests is resolved at compile time; the arguments
+// convert left to right, so the first one that does not fit is reported.
+template <typename R, typename... Params> class Marshalled {
+public:
+  template <typename F>
+  static Value call(Interpreter &interpreter, F function, const Value *args,
+                    size_t count) {
+    checkArity(sizeof...(Params), count);
+    return invoke(interpreter, function, args,
+                  index_sequence_for<Params...>());
+  }
+
+private:
+  template <typename F, size_t... I>
+  static Value invoke(Interpreter &interpreter, F function,
+                      [[maybe_unused]] const Value *args,
+                      index_sequence<I...>) {
+    tuple<decay_t<Params>...> values{argument<decay_t<Params>>(args, I)...};
+    if constexpr (is_void_v<R>) {
+      apply(function, move(values));
+      return Value();
+    } else {
+      return Marshal<decay_t<R>>::to(interpreter,
+                                     apply(function, move(values)));
+    }
+  }
+};
+
+// A native function may take the interpreter as its first parameter; the
+// rest are its TL parameters.
+template <typename R, typename... Params>
+class Marshalled<R, Interpreter &, Params...> {
+public:
+  template <typename F>
+  static Value call(Interpreter &interpreter, F function, const Value *args,
+                    size_t count) {
+    return Marshalled<R, Params...>::call(
+        interpreter,
+        [&interpreter, function](Params... params) {
+          return function(interpreter, params...);
+        },
+        args, count);
+  }
+};
+
+// The BuiltinFunction that calls `Function`.
+template <auto Function> class Native;
+
+template <typename R, typename... Params, R (*Function)(Params...)>
+class Native<Function> {
+public:
+  static Value call(Interpreter &interpreter, const Value *args,
+                    size_t count) {
+    return Marshalled<R, Params...>::call(interpreter, Function, args, count);
+  }
+};
+
+template <auto Function> constexpr Builtin native(const char *name) {
+  return Builtin{name, Native<Function>::call};
+}
+
+Value printBuiltin(Interpreter &interpreter, const Value *args, size_t count) {
+  string line;
+  for (size_t i = 0; i < count; i++) {
+    if (i > 0) {
+      line += ' ';
+    }
+    line += interpreter.toString(args[i]);
+  }
+  line += '\n';
+  interpreter.write(line);
+  return Value();
+}
+
+optional<string> readLineBuiltin(Interpreter &interpreter) {
+  string line;
+  if (!interpreter.readLine(line)) {
+    return nullopt;
+  }
+  return line;
+}
+
+Value lenBuiltin(Interpreter &, const Value *args, size_t count) {
+  if (count == 1 && args[0].type == ValueType::Array) {
+    return Value::fromInt(args[0].asArray()->length);
+  }
+  if (count == 1 && args[0].type == ValueType::String) {
+    return Value::fromInt(args[0].asString()->length);
+  }
+  throw BuiltinError("takes one array or string");
+}
+
+string strBuiltin(Interpreter &interpreter, Value value) {
+  return interpreter.toString(value);
+}
+
+[[noreturn]] void cannotConvert(Value value, const char *type) {
+  throw BuiltinError("cannot convert " + typeName(value) + " to " + type);
+}
+
+int64_t intBuiltin(Value value) {
+  switch (value.type) {
+  case ValueType::Int:
+    return value.integer;
+  case ValueType::Float:
+    // -2^63 and 2^63 are exact as doubles, and doubles that large have no
+    // fraction, so this is exactly the range that truncates to an int.
+    if (!(value.number >= -0x1p63 && value.number < 0x1p63)) {
+      throw BuiltinError("cannot convert " + to_string(value.number) +
+                         " to an int");
+    }
+    return static_cast<int64_t>(value.number);
+  case ValueType::String: {
+    string_view text = value.asString()->view();
+    int64_t result;
+    from_chars_result parsed =
+        from_chars(text.data(), text.data() + text.size(), result);
+    if (text.empty() || parsed.ec != errc() ||
+        parsed.ptr != text.data() + text.size()) {
+      throw BuiltinError("cannot convert '" + string(text) + "' to an int");
+    }
+    return result;
+  }
+  default:
+    cannotConvert(value, "an int");
+  }
+}
+
+double floatBuiltin(Value value) {
+  switch (value.type) {
+  case ValueType::Int:
+  case ValueType::Float:
+    return asDouble(value);
+  case ValueType::String: {
+    string_view text = value.asString()->view();
+    double result;
+    from_chars_result parsed =
+        from_chars(text.data(), text.data() + text.size(), result);
+    if (text.empty() || parsed.ec != errc() ||
+        parsed.ptr != text.data() + text.size()) {
+      throw BuiltinError("cannot convert '" + string(text) + "' to a float");
+    }
+    return result;
+  }
+  default:
+    cannotConvert(value, "a float");
+  }
+}
+
+double sqrtBuiltin(double x) { return sqrt(x); }
+double powBuiltin(double x, double y) { return pow(x, y); }
+double sinBuiltin(double x) { return sin(x); }
+double cosBuiltin(double x) { return cos(x); }
+double expBuiltin(double x) { return exp(x); }
+double logBuiltin(double x) { return log(x); }
+double floorBuiltin(double x) { return floor(x); }
+double ceilBuiltin(double x) { return ceil(x); }
+
+Value absBuiltin(Number x) {
+  if (x.value.type == ValueType::Float) {
+    return Value::fromFloat(fabs(x.value.number));
+  }
+  if (x.value.integer == numeric_limits<int64_t>::min()) {
+    throw RuntimeError("Integer overflow");
+  }
+  return Value::fromInt(x.value.integer < 0 ? -x.value.integer
+                                            : x.value.integer);
+}
+
+// Whether a < b, comparing ints exactly.
+bool less(Value a, Value b) {
+  if (a.type == ValueType::Int && b.type == ValueType::Int) {
+    return a.integer < b.integer;
+  }
+  return asDouble(a) < asDouble(b);
+}
+
+Value minBuiltin(Number a, Number b) {
+  return less(b.value, a.value) ? b.value : a.value;
+}
+
+Value maxBuiltin(Number a, Number b) {
+  return less(a.value, b.value) ? b.value : a.value;
+}
+
+string substrBuiltin(string_view text, int64_t start, int64_t length) {
+  if (start < 0 || length < 0 ||
+      static_cast<uint64_t>(start) > text.size() ||
+      static_cast<uint64_t>(length) > text.size() - start) {
+    throw BuiltinError("range of " + to_string(length) + " from " +
+                       to_string(start) + " is out of bounds for length " +
+                       to_string(text.size()));
+  }
+  return string(text.substr(start, length));
+}
+
+int64_t findBuiltin(string_view text, string_view part) {
+  size_t index = text.find(part);
+  return index == string_view::npos ? -1 : static_cast<int64_t>(index);
+}
+
+string upperBuiltin(string_view text) {
+  string result(text);
+  for (char &c : result) {
+    c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+  }
+  return result;
+}
+
+string lowerBuiltin(string_view text) {
+  string result(text);
+  for (char &c : result) {
+    c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+  }
+  return result;
+}
+
+double clockBuiltin() {
+  return chrono::duration<double>(
+             chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+int64_t timeBuiltin() {
+  return chrono::duration_cast<chrono::seconds>(
+             chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+} // namespace
+
+const Builtin builtins[] = {
+    {"print", printBuiltin},
+    native<readLineBuiltin>("readLine"),
+    {"len", lenBuiltin},
+    native<strBuiltin>("str"),
+    native<intBuiltin>("int"),
+    native<floatBuiltin>("float"),
+    native<sqrtBuiltin>("sqrt"),
+    native<powBuiltin>("pow"),
+    native<sinBuiltin>("sin"),
+    native<cosBuiltin>("cos"),
+    native<expBuiltin>("exp"),
+    native<logBuiltin>("log"),
+    native<floorBuiltin>("floor"),
+    native<ceilBuiltin>("ceil"),
+    native<absBuiltin>("abs"),
+    native<minBuiltin>("min"),
+    native<maxBuiltin>("max"),
+    native<substrBuiltin>("substr"),
+    native<findBuiltin>("find"),
+    native<upperBuiltin>("upper"),
+    native<lowerBuiltin>("lower"),
+    native<clockBuiltin>("clock"),
+    native<timeBuiltin>("time"),
+};
+
+const size_t builtinCount = sizeof(builtins) / sizeof(builtins[0]);
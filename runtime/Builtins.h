@@ -0,0 +1,52 @@
+#ifndef BUILTINS_H
+#define BUILTINS_H
+
+#include "Value.h"
+#include <stdexcept>
+#include <string>
+
+class Interpreter;
+
+// A function implemented in C++. Gets its arguments as a contiguous run of
+// values and returns the call's result.
+using BuiltinFunction = Value (*)(Interpreter &interpreter, const Value *args,
+                                  size_t count);
+
+class Builtin {
+public:
+  const char *name;
+  BuiltinFunction function;
+};
+
+// Thrown by a builtin its arguments do not suit. The interpreter reports it
+// as a RuntimeError at the call, after the builtin's name:
+// `sqrt() takes a number as argument 1, not string`.
+class BuiltinError : public runtime_error {
+public:
+  BuiltinError(const string &message) : runtime_error(message) {}
+};
+
+// Every builtin, in the order of Interpreter::builtinNames(): a builtin's
+// index here is its global slot, and the CallExpr::builtin of the calls
+// bound to it.
+//
+//   print(...)           writes its arguments and a newline
+//   readLine()           next line of input, or null at its end
+//   len(a)               length of an array or string
+//   str(x)               x as print writes it
+//   int(x), float(x)     number from a number or string
+//   sqrt pow sin cos exp log floor ceil
+//                        the C++ functions, on floats
+//   abs(x), min(a, b), max(a, b)
+//                        keep the type of the number they return
+//   substr(s, start, length), find(s, part), upper(s), lower(s)
+//                        on bytes; find returns -1 when there is no match
+//   clock()              seconds on a monotonic clock, as a float
+//   time()               seconds since the Unix epoch, as an int
+//
+// Most of them are plain C++ functions bound through templates that convert
+// the arguments and the result at compile time; see Builtins.cpp.
+extern const Builtin builtins[];
+extern const size_t builtinCount;
+
+#endif
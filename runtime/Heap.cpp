@@ -0,0 +1,297 @@
+#include "Heap.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace {
+
+// A moved nursery object keeps the address of its copy right after its
+// header, so every object takes at least this much room there.
+constexpr size_t minObjectBytes = sizeof(Object) + sizeof(Object *);
+
+size_t alignedSize(size_t bytes) {
+  return max((bytes + 7) & ~size_t(7), minObjectBytes);
+}
+
+size_t objectSize(const Object *object) {
+  switch (object->kind) {
+  case ObjectKind::String:
+    return StringObject::sizeFor(object->length);
+  case ObjectKind::Instance:
+    return StructObject::sizeFor(object->length);
+  default:
+    return ArrayObject::sizeFor(object->kind, object->length);
+  }
+}
+
+// Calls `visit` on each range of values in `object` that may point into the
+// heap. An array's `moved` link is passed as a value of its own and written
+// back, so the collector can update it like any other.
+template <typename F> void forEachReference(Object *object, F &&visit) {
+  switch (object->kind) {
+  case ObjectKind::String:
+    return;
+  case ObjectKind::Instance: {
+    auto *instance = static_cast<StructObject *>(object);
+    visit(instance->fields(), instance->fields() + instance->length);
+    return;
+  }
+  default: {
+    auto *array = static_cast<ArrayObject *>(object);
+    if (array->moved) {
+      Value moved = Value::fromArray(array->moved);
+      visit(&moved, &moved + 1);
+      array->moved = moved.asArray();
+    }
+    if (array->kind == ObjectKind::ValueArray) {
+      visit(array->values(), array->values() + array->length);
+    }
+    return;
+  }
+  }
+}
+
+Object *&forwardingAddress(Object *object) {
+  return *reinterpret_cast<Object **>(object + 1);
+}
+
+void *allocateBlock(size_t bytes) {
+  void *block = malloc(bytes);
+  if (!block) {
+    throw bad_alloc();
+  }
+  return block;
+}
+
+[[noreturn]] void limitExceeded(size_t limit) {
+  throw HeapLimitError("Out of memory: live objects exceed the heap limit of " +
+                       to_string(limit) + " bytes");
+}
+
+} // namespace
+
+Heap::Heap(HeapOptions options, function<void(const RootRange &)> roots)
+    : options(options), roots(move(roots)),
+      nursery(static_cast<char *>(
+          allocateBlock(max(options.nurseryBytes, minObjectBytes)))),
+      nurseryTop(nursery), nurseryEnd(nursery + options.nurseryBytes),
+      nextMajor(options.minMajorBytes),
+      newFlags(options.isolated ? Owned : 0) {}
+
+Heap::~Heap() {
+  for (Object *object : oldObjects) {
+    free(object);
+  }
+  free(nursery);
+}
+
+void *Heap::allocate(size_t bytes) {
+  heapStats.allocations++;
+  heapStats.bytesAllocated += bytes;
+  bytes = alignedSize(bytes);
+  if (bytes > options.nurseryBytes / 4) {
+    if (heapStats.oldBytes + bytes > nextMajor || overLimit(bytes)) {
+      collectGarbage(true);
+    }
+    if (overLimit(bytes)) {
+      limitExceeded(options.maxHeapBytes);
+    }
+    return allocateOld(bytes);
+  }
+  if (static_cast<size_t>(nurseryEnd - nurseryTop) < bytes) {
+    collectGarbage(false);
+  }
+  void *memory = nurseryTop;
+  nurseryTop += bytes;
+  return memory;
+}
+
+void *Heap::allocateOld(size_t bytes) {
+  auto *object = static_cast<Object *>(allocateBlock(bytes));
+  oldObjects.push_back(object);
+  heapStats.oldBytes += bytes;
+  heapStats.peakOldBytes = max(heapStats.peakOldBytes, heapStats.oldBytes);
+  return object;
+}
+
+bool Heap::overLimit(size_t extra) const {
+  return options.maxHeapBytes &&
+         heapStats.oldBytes + extra > options.maxHeapBytes;
+}
+
+void Heap::collect() { collectGarbage(true); }
+
+void Heap::clear() {
+  for (Object *object : oldObjects) {
+    free(object);
+  }
+  oldObjects.clear();
+  remembered.clear();
+  nurseryTop = nursery;
+  nextMajor = options.minMajorBytes;
+  heapStats = HeapStats();
+}
+
+// A full collection also runs when the old space has doubled since the last
+// one, or when it is over the limit. Throws HeapLimitError if it still is
+// afterwards.
+void Heap::collectGarbage(bool full) {
+  auto start = chrono::steady_clock::now();
+  minorCollection();
+  if (full || heapStats.oldBytes >= nextMajor || overLimit(0)) {
+    majorCollection();
+  }
+  auto end = chrono::steady_clock::now();
+  long long ns =
+      chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+  heapStats.pauseNs += ns;
+  heapStats.maxPauseNs = max(heapStats.maxPauseNs, ns);
+  if (overLimit(0)) {
+    limitExceeded(options.maxHeapBytes);
+  }
+}
+
+// Moves the nursery object `value` points to, if any, into the old space
+// and points `value` at the copy.
+void Heap::evacuate(Value &value) {
+  if (!value.isObject() || !isYoung(value.object)) {
+    return;
+  }
+  Object *object = value.object;
+  if (object->flags & Forwarded) {
+    value.object = forwardingAddress(object);
+    return;
+  }
+  if (value.type == ValueType::Array && value.asArray()->moved) {
+    // Every reference to a nursery object passes through here, so all of
+    // them can point straight at the boxed elements and let the forwarding
+    // array die.
+    value.object = value.asArray()->moved;
+    evacuate(value);
+    return;
+  }
+  size_t bytes = alignedSize(objectSize(object));
+  auto *copy = static_cast<Object *>(allocateOld(bytes));
+  memcpy(static_cast<void *>(copy), object, bytes);
+  copy->flags = newFlags;
+  heapStats.bytesPromoted += bytes;
+  if (copy->kind != ObjectKind::String) {
+    pending.push_back(copy);
+  }
+  object->flags |= Forwarded;
+  forwardingAddress(object) = copy;
+  value.object = copy;
+}
+
+// Every survivor is promoted: the nursery is emptied as a whole, so nothing
+// has to track the ages of the objects in it.
+void Heap::minorCollection() {
+  heapStats.minorCollections++;
+  auto evacuateRange = [this](Value *begin, Value *end) {
+    for (Value *value = begin; value < end; value++) {
+      evacuate(*value);
+    }
+  };
+  roots(evacuateRange);
+  for (Object *object : remembered) {
+    object->flags &= ~Remembered;
+    forEachReference(object, evacuateRange);
+  }
+  remembered.clear();
+  while (!pending.empty()) {
+    Object *object = pending.back();
+    pending.pop_back();
+    forEachReference(object, evacuateRange);
+  }
+  nurseryTop = nursery;
+}
+
+// Instances in frames are never marked: their fields sit among the value
+// stack's slots and are reached as roots.
+void Heap::mark(Value value) {
+  if (!value.isObject()) {
+    return;
+  }
+  Object *object = value.object;
+  if (object->inFrame || (object->flags & Marked) ||
+      (options.isolated && !(object->flags & Owned))) {
+    return;
+  }
+  object->flags |= Marked;
+  if (object->kind != ObjectKind::String) {
+    pending.push_back(object);
+  }
+}
+
+// Runs right after a minor collection, so every live object is old.
+void Heap::majorCollection() {
+  heapStats.majorCollections++;
+  auto markRange = [this](Value *begin, Value *end) {
+    for (Value *value = begin; value < end; value++) {
+      mark(*value);
+    }
+  };
+  roots(markRange);
+  while (!pending.empty()) {
+    Object *object = pending.back();
+    pending.pop_back();
+    forEachReference(object, markRange);
+  }
+
+  size_t live = 0;
+  size_t kept = 0;
+  for (Object *object : oldObjects) {
+    if (object->flags & Marked) {
+      object->flags &= ~Marked;
+      live += alignedSize(objectSize(object));
+      oldObjects[kept++] = object;
+    } else {
+      free(object);
+    }
+  }
+  oldObjects.resize(kept);
+  heapStats.oldBytes = live;
+  nextMajor = max(options.minMajorBytes, live * 2);
+}
+
+StringObject *Heap::newString(string_view text) {
+  auto *string = new (allocate(StringObject::sizeFor(text.size())))
+      StringObject();
+  string->kind = ObjectKind::String;
+  string->flags = newFlags;
+  string->length = static_cast<uint32_t>(text.size());
+  memcpy(string->chars(), text.data(), text.size());
+  return string;
+}
+
+StructObject *Heap::newInstance(const StructLayout &layout) {
+  size_t fieldCount = layout.fields.size();
+  auto *instance =
+      new (allocate(StructObject::sizeFor(fieldCount))) StructObject();
+  instance->kind = ObjectKind::Instance;
+  instance->flags = newFlags;
+  instance->length = static_cast<uint32_t>(fieldCount);
+  instance->layout = &layout;
+  for (size_t i = 0; i < fieldCount; i++) {
+    new (&instance->fields()[i]) Value();
+  }
+  return instance;
+}
+
+ArrayObject *Heap::newArray(ObjectKind kind, uint32_t length) {
+  auto *array =
+      new (allocate(ArrayObject::sizeFor(kind, length))) ArrayObject();
+  array->kind = kind;
+  array->flags = newFlags;
+  array->length = length;
+  if (kind == ObjectKind::ValueArray) {
+    for (uint32_t i = 0; i < length; i++) {
+      new (&array->values()[i]) Value();
+    }
+  } else {
+    memset(array->ints(), 0, length * sizeof(int64_t));
+  }
+  return array;
+}
@@ -0,0 +1,142 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+#include "Value.h"
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+// Thrown when a collection cannot bring the heap back under its limit.
+class HeapLimitError : public runtime_error {
+public:
+  HeapLimitError(const string &message) : runtime_error(message) {}
+};
+
+class HeapOptions {
+public:
+  // Size of the nursery new objects are bump allocated in. Objects larger
+  // than a quarter of it go straight to the old space.
+  size_t nurseryBytes = 1 << 20;
+  // Most bytes the old space may hold after a full collection; 0 for no
+  // limit.
+  size_t maxHeapBytes = 0;
+  // Old space size below which no full collection is started.
+  size_t minMajorBytes = 4 << 20;
+  // Whether the heap belongs to a worker running iterations of a parallel
+  // loop. Such a heap tags what it allocates, for owns(), and its
+  // collections pass over the objects of other heaps its roots lead to
+  // without touching them, so those can be read by several workers at once.
+  bool isolated = false;
+};
+
+class HeapStats {
+public:
+  size_t allocations = 0;
+  size_t bytesAllocated = 0;
+  // Nursery collections, and full collections of both generations.
+  size_t minorCollections = 0;
+  size_t majorCollections = 0;
+  // Bytes copied out of the nursery into the old space.
+  size_t bytesPromoted = 0;
+  // Old space bytes now, and the most it ever held.
+  size_t oldBytes = 0;
+  size_t peakOldBytes = 0;
+  // Time spent collecting, in total and in the longest single pause.
+  long long pauseNs = 0;
+  long long maxPauseNs = 0;
+};
+
+// Reports a range of values outside the heap that may refer into it. The
+// collector rewrites them in place when it moves what they point to.
+using RootRange = function<void(Value *begin, Value *end)>;
+
+// Owns every string, struct instance and array a run creates, and frees
+// those the run can no longer reach. Collection is precise: the only
+// references into the heap are the values the root scanner reports, plus
+// those held in heap objects themselves.
+//
+// Objects start out in the nursery, a block they are bump allocated in. When
+// it fills up, a minor collection copies the objects still reachable into
+// the old space and empties it; everything else in the nursery is garbage,
+// freed without being looked at, so the cost of a minor collection is that
+// of the survivors. The old space is collected by mark and sweep, when it
+// has doubled since the last full collection. Values in old objects that
+// point into the nursery are found through a remembered set, which
+// writeBarrier() maintains: it must be called on every store into a field
+// of an instance, or an element of an array, that may already be old.
+//
+// Any allocation may collect, so callers must keep every value they still
+// need in a root (the interpreter keeps them on its value stack) and re-read
+// object pointers after allocating.
+class Heap {
+public:
+  Heap(HeapOptions options, function<void(const RootRange &)> roots);
+  ~Heap();
+  Heap(const Heap &) = delete;
+  Heap &operator=(const Heap &) = delete;
+
+  StringObject *newString(string_view text);
+  // An instance of `layout` with every field null.
+  StructObject *newInstance(const StructLayout &layout);
+  // An array of `kind` with `length` elements, all 0, 0.0 or null.
+  ArrayObject *newArray(ObjectKind kind, uint32_t length);
+
+  // Records that `value` was stored into `object`: a field of an instance,
+  // an element of a ValueArray, or the `moved` link of an array.
+  void writeBarrier(Object *object, Value value) {
+    if (value.isObject() && isYoung(value.object) && !isYoung(object) &&
+        !object->inFrame && !(object->flags & Remembered)) {
+      object->flags |= Remembered;
+      remembered.push_back(object);
+    }
+  }
+
+  // Runs a full collection now.
+  void collect();
+  // Frees every object, and starts the stats over. Whatever still points
+  // into the heap must not be used again.
+  void clear();
+  // Whether `object` was allocated by this heap. Only isolated heaps can
+  // tell.
+  bool owns(const Object *object) const { return object->flags & Owned; }
+
+  const HeapStats &stats() const { return heapStats; }
+
+private:
+  // Bits of Object::flags.
+  enum : uint8_t { Marked = 1, Remembered = 2, Forwarded = 4, Owned = 8 };
+
+  HeapOptions options;
+  function<void(const RootRange &)> roots;
+  HeapStats heapStats;
+
+  char *nursery;
+  char *nurseryTop;
+  char *nurseryEnd;
+  vector<Object *> oldObjects;
+  // Old objects that may hold nursery pointers.
+  vector<Object *> remembered;
+  // Old space size that starts the next full collection.
+  size_t nextMajor;
+  // Promoted or marked objects whose references are still to be scanned.
+  vector<Object *> pending;
+  // Flags of a new object.
+  uint8_t newFlags;
+
+  bool isYoung(const Object *object) const {
+    auto *address = reinterpret_cast<const char *>(object);
+    return address >= nursery && address < nurseryEnd;
+  }
+
+  void *allocate(size_t bytes);
+  void *allocateOld(size_t bytes);
+  bool overLimit(size_t extra) const;
+  void collectGarbage(bool full);
+  void minorCollection();
+  void majorCollection();
+  void evacuate(Value &value);
+  void mark(Value value);
+};
+
+#endif
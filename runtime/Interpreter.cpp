@@ -0,0 +1,1459 @@
+#include "Interpreter.h"
+#include "../ast/Visitor.h"
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <new>
+
+namespace {
+
+// How deep toString() follows instances held in fields; also what keeps a
+// cycle of instances from printing forever.
+constexpr int maxPrintDepth = 4;
+
+// Iterations of a parallel loop may store into the unboxed elements of an
+// array they share while others read them, so workers access elements
+// through relaxed atomics: a plain load or store on the usual targets, but
+// a race then leaves the value some iteration stored rather than undefined
+// behavior.
+template <typename T> T loadElement(const T *element, bool atomic) {
+  if (!atomic) {
+    return *element;
+  }
+  T value;
+  __atomic_load(element, &value, __ATOMIC_RELAXED);
+  return value;
+}
+
+template <typename T> void writeElement(T *element, T value, bool atomic) {
+  if (!atomic) {
+    *element = value;
+    return;
+  }
+  __atomic_store(element, &value, __ATOMIC_RELAXED);
+}
+
+[[noreturn]] void overflow(uint32_t offset) {
+  throw RuntimeError("Integer overflow", offset);
+}
+
+double asDouble(Value value) {
+  return value.type == ValueType::Int ? static_cast<double>(value.integer)
+                                      : value.number;
+}
+
+BinaryOp decodeOperator(const BinaryExpr &binaryExpr) {
+  static const pair<const char *, BinaryOp> operators[] = {
+      {"+", BinaryOp::Add}, {"-", BinaryOp::Sub},  {"*", BinaryOp::Mul},
+      {"/", BinaryOp::Div}, {"%", BinaryOp::Mod},  {"<", BinaryOp::Lt},
+      {"<=", BinaryOp::Le}, {">", BinaryOp::Gt},   {">=", BinaryOp::Ge},
+      {"==", BinaryOp::Eq}, {"!=", BinaryOp::Ne},
+  };
+  for (const auto &entry : operators) {
+    if (binaryExpr.binaryOperator == entry.first) {
+      return entry.second;
+    }
+  }
+  throw RuntimeError("Unknown operator '" + binaryExpr.binaryOperator + "'",
+                     binaryExpr.offset);
+}
+
+bool isFloatPair(Value left, Value right) {
+  return left.isNumber() && right.isNumber() &&
+         (left.type == ValueType::Float || right.type == ValueType::Float);
+}
+
+void addStats(RuntimeStats &total, const RuntimeStats &part) {
+  total.frameInstances += part.frameInstances;
+  total.calls += part.calls;
+  total.tailCalls += part.tailCalls;
+  total.fieldCacheHits += part.fieldCacheHits;
+  total.fieldCacheMisses += part.fieldCacheMisses;
+  total.callCacheHits += part.callCacheHits;
+  total.callCacheMisses += part.callCacheMisses;
+  total.quickenedSites += part.quickenedSites;
+  total.deoptimizedSites += part.deoptimizedSites;
+}
+
+// Old space sizes are the parent's alone: what a worker keeps is freed when
+// its loop ends.
+void addHeapStats(HeapStats &total, const HeapStats &part) {
+  total.allocations += part.allocations;
+  total.bytesAllocated += part.bytesAllocated;
+  total.minorCollections += part.minorCollections;
+  total.majorCollections += part.majorCollections;
+  total.bytesPromoted += part.bytesPromoted;
+  total.pauseNs += part.pauseNs;
+  total.maxPauseNs = max(total.maxPauseNs, part.maxPauseNs);
+}
+
+} // namespace
+
+// The first iteration of a parallel loop that failed, as far as the workers
+// have got, and its error.
+class ParallelFailure {
+public:
+  explicit ParallelFailure(uint64_t count) : iteration(count) {}
+
+  atomic<uint64_t> iteration;
+  string message;
+  uint32_t offset = 0;
+
+  void record(uint64_t failed, const RuntimeError &error) {
+    lock_guard<mutex> guard(lock);
+    if (failed < iteration) {
+      iteration = failed;
+      message = error.what();
+      offset = error.offset;
+    }
+  }
+
+private:
+  mutex lock;
+};
+
+bool isTruthy(Value value) {
+  switch (value.type) {
+  case ValueType::Null:
+    return false;
+  case ValueType::Bool:
+    return value.boolean;
+  case ValueType::Int:
+    return value.integer != 0;
+  case ValueType::Float:
+    return value.number != 0;
+  case ValueType::String:
+    return value.asString()->length != 0;
+  default:
+    return true;
+  }
+}
+
+string typeName(Value value) {
+  switch (value.type) {
+  case ValueType::Null:
+    return "null";
+  case ValueType::Bool:
+    return "bool";
+  case ValueType::Int:
+    return "int";
+  case ValueType::Float:
+    return "float";
+  case ValueType::String:
+    return "string";
+  case ValueType::Instance:
+    return "struct " + value.asInstance()->layout->name;
+  case ValueType::Array:
+    return "array";
+  case ValueType::Function:
+  case ValueType::Builtin:
+    return "function";
+  case ValueType::Struct:
+    return "struct type";
+  }
+  return "unknown";
+}
+
+vector<string> Interpreter::builtinNames() {
+  vector<string> names;
+  for (size_t i = 0; i < builtinCount; i++) {
+    names.push_back(builtins[i].name);
+  }
+  return names;
+}
+
+Interpreter::Interpreter(const CompileResult &program, ostream &out,
+                         InterpreterOptions options)
+    : program(program), out(out), options(options),
+      heap(options.heap,
+           [this](const RootRange &visit) { scanRoots(visit); }),
+      stack(new Value[options.stackSlots]),
+      stackEnd(stack.get() + options.stackSlots), sp(stack.get()),
+      fp(stack.get()) {
+  if (!program.analysis) {
+    throw RuntimeError("The program has not been analyzed");
+  }
+  if (!program.ok()) {
+    throw RuntimeError("Cannot run a program with errors");
+  }
+  const ProgramAnalysis &analysis = *program.analysis;
+  globals.resize(analysis.names.globals.size());
+  fieldCaches.resize(analysis.caches.memberSites);
+  callCaches.resize(analysis.caches.callSites);
+  binarySites.resize(analysis.caches.binarySites);
+  for (size_t i = 0; i < builtinCount; i++) {
+    if (i >= globals.size() || analysis.names.globals[i] != builtins[i].name) {
+      throw RuntimeError(
+          "The program was not analyzed with the interpreter's builtins");
+    }
+    globals[i] = Value::fromBuiltin(&builtins[i]);
+  }
+
+  // Functions and structs are bound before any code runs, which is what
+  // lets them be used ahead of their declaration.
+  class Binder : public ConstASTVisitor<Binder> {
+  public:
+    Interpreter &interpreter;
+    const LayoutTable &layouts;
+    Binder(Interpreter &interpreter, const LayoutTable &layouts)
+        : interpreter(interpreter), layouts(layouts) {}
+
+    bool visitFunctionDeclaration(const FunctionDeclaration &funcDecl) {
+      interpreter.globals[funcDecl.binding.slot] =
+          Value::fromFunction(&funcDecl);
+      return visitChildren(funcDecl);
+    }
+    bool visitStructDeclaration(const StructDeclaration &structDecl) {
+      interpreter.globals[structDecl.binding.slot] =
+          Value::fromStruct(layouts.forDeclaration(structDecl));
+      return visitChildren(structDecl);
+    }
+  };
+  Binder(*this, analysis.layouts).visit(*program.program);
+}
+
+Interpreter::~Interpreter() = default;
+
+const RuntimeStats &Interpreter::stats() {
+  runtimeStats.heap = heap.stats();
+  addHeapStats(runtimeStats.heap, workerHeaps);
+  if (pool) {
+    runtimeStats.steals = pool->steals();
+  }
+  return runtimeStats;
+}
+
+void Interpreter::write(const string &text) {
+  if (sharedOutput) {
+    lock_guard<mutex> guard(*sharedOutput);
+    out << text;
+  } else {
+    out << text;
+  }
+}
+
+bool Interpreter::readLine(string &line) {
+  if (!options.input) {
+    return false;
+  }
+  if (sharedOutput) {
+    lock_guard<mutex> guard(*sharedOutput);
+    return static_cast<bool>(getline(*options.input, line));
+  }
+  return static_cast<bool>(getline(*options.input, line));
+}
+
+Value Interpreter::run() {
+  char base;
+  nativeStackBase = &base;
+  sp = fp = stack.get();
+  callDepth = 0;
+  if (options.profiler) {
+    options.profiler->start();
+  }
+  for (const auto &stmt : program.program->body) {
+    if (exec(*stmt) == Completion::Return) {
+      return pop();
+    }
+  }
+  return Value();
+}
+
+inline void Interpreter::push(Value value) {
+  if (sp == stackEnd) {
+    throw RuntimeError("Stack overflow");
+  }
+  *sp++ = value;
+}
+
+inline Value Interpreter::load(const Binding &binding) const {
+  return binding.scope == Binding::Scope::Local ? fp[binding.slot]
+                                                : globals[binding.slot];
+}
+
+inline void Interpreter::store(const Binding &binding, Value value) {
+  if (binding.scope == Binding::Scope::Local) {
+    fp[binding.slot] = value;
+  } else {
+    globals[binding.slot] = value;
+  }
+}
+
+void Interpreter::scanRoots(const RootRange &visit) {
+  visit(globals.data(), globals.data() + globals.size());
+  visit(stack.get(), sp);
+  for (auto &entry : literals) {
+    visit(&entry.second, &entry.second + 1);
+  }
+}
+
+StringObject *Interpreter::newString(string_view text, uint32_t offset) {
+  try {
+    return heap.newString(text);
+  } catch (const HeapLimitError &e) {
+    throw RuntimeError(e.what(), offset);
+  }
+}
+
+StructObject *Interpreter::newInstance(const StructLayout &layout,
+                                       uint32_t offset) {
+  try {
+    return heap.newInstance(layout);
+  } catch (const HeapLimitError &e) {
+    throw RuntimeError(e.what(), offset);
+  }
+}
+
+ArrayObject *Interpreter::newArray(ObjectKind kind, uint32_t length,
+                                   uint32_t offset) {
+  try {
+    return heap.newArray(kind, length);
+  } catch (const HeapLimitError &e) {
+    throw RuntimeError(e.what(), offset);
+  }
+}
+
+StringObject *Interpreter::literal(const StrLiteral &strLit) {
+  auto it = literals.find(&strLit);
+  if (it != literals.end()) {
+    return it->second.asString();
+  }
+  StringObject *string = newString(strLit.value, strLit.offset);
+  literals.emplace(&strLit, Value::fromString(string));
+  return string;
+}
+
+Interpreter::Completion Interpreter::execBlock(
+    const vector<unique_ptr<Stmt>> &body) {
+  for (const auto &stmt : body) {
+    Completion completion = exec(*stmt);
+    if (completion != Completion::Normal) {
+      return completion;
+    }
+  }
+  return Completion::Normal;
+}
+
+// Statements leave the stack as they found it, except that a completed
+// `return` leaves its value on top.
+Interpreter::Completion Interpreter::exec(const Stmt &stmt) {
+  switch (stmt.kind) {
+  case NodeType::VarDeclaration: {
+    auto &varDecl = static_cast<const VarDeclaration &>(stmt);
+    if (varDecl.value) {
+      eval(*varDecl.value);
+      store(varDecl.binding, pop());
+    } else {
+      store(varDecl.binding, Value());
+    }
+    return Completion::Normal;
+  }
+  case NodeType::FunctionDeclaration:
+  case NodeType::StructDeclaration:
+    return Completion::Normal;
+  case NodeType::IfStatement: {
+    auto &ifStmt = static_cast<const IfStatement &>(stmt);
+    eval(*ifStmt.condition);
+    return execBlock(isTruthy(pop()) ? ifStmt.ifBody : ifStmt.elseBody);
+  }
+  case NodeType::WhileLoop: {
+    auto &whileLoop = static_cast<const WhileLoop &>(stmt);
+    // A worker runs the parallel loops nested in its iterations itself.
+    if (whileLoop.parallel && !region) {
+      runParallel(whileLoop);
+      return Completion::Normal;
+    }
+    while (true) {
+      eval(*whileLoop.condition);
+      if (!isTruthy(pop())) {
+        return Completion::Normal;
+      }
+      if (options.profiler) {
+        options.profiler->tick(whileLoop.offset);
+      }
+      Completion completion = execBlock(whileLoop.loopBody);
+      if (completion != Completion::Normal) {
+        return completion;
+      }
+    }
+  }
+  case NodeType::ReturnStatement: {
+    auto &returnStmt = static_cast<const ReturnStatement &>(stmt);
+    if (returnStmt.tailCall) {
+      return tailCall(static_cast<const CallExpr &>(*returnStmt.returnValue));
+    }
+    if (returnStmt.returnValue) {
+      eval(static_cast<const Expr &>(*returnStmt.returnValue));
+    } else {
+      push(Value());
+    }
+    return Completion::Return;
+  }
+  case NodeType::Program:
+  case NodeType::Error:
+    throw RuntimeError("Cannot run a statement that failed to parse",
+                       stmt.offset);
+  default:
+    eval(static_cast<const Expr &>(stmt));
+    sp--;
+    return Completion::Normal;
+  }
+}
+
+// Iteration k of the loop, for k from 0 to count - 1, runs the body but its
+// final `i = i + c` with `i` set to start + k * c. Once they are all done,
+// `i` gets the value that ends the loop, computed as that final statement
+// would have, overflow included.
+void Interpreter::runParallel(const WhileLoop &loop) {
+  const ParallelPlan &plan = parallelPlan(loop);
+  Value start = load(plan.variable);
+  if (start.type != ValueType::Int) {
+    throw RuntimeError(
+        "The variable of a parallel loop must hold an int, not " +
+            typeName(start),
+        loop.condition->offset);
+  }
+  eval(*plan.bound);
+  Value bound = pop();
+  if (bound.type != ValueType::Int) {
+    throw RuntimeError("The bound of a parallel loop must be an int, not " +
+                           typeName(bound),
+                       plan.bound->offset);
+  }
+  if (options.profiler) {
+    options.profiler->tick(loop.offset);
+  }
+  __int128 span = static_cast<__int128>(bound.integer) - start.integer +
+                  (plan.inclusive ? 1 : 0);
+  uint64_t count =
+      span > 0 ? static_cast<uint64_t>((span + plan.step - 1) / plan.step) : 0;
+  if (count > 0) {
+    if (!pool) {
+      startWorkers();
+    }
+    for (size_t i = 0; i < workers.size(); i++) {
+      workers[i]->enterRegion(*this, plan, i == 0);
+    }
+    ParallelFailure failure(count);
+    RangeBody body = [&](size_t worker, uint64_t begin, uint64_t end) {
+      workers[worker]->runIterations(loop, start.integer, begin, end,
+                                     failure);
+    };
+    try {
+      pool->run(count, body);
+    } catch (...) {
+      for (auto &worker : workers) {
+        worker->leaveRegion(*this);
+      }
+      throw;
+    }
+    for (auto &worker : workers) {
+      worker->leaveRegion(*this);
+    }
+    runtimeStats.parallelLoops++;
+    if (failure.iteration < count) {
+      throw RuntimeError(failure.message, failure.offset);
+    }
+    runtimeStats.parallelIterations += count;
+  }
+  __int128 last = start.integer + static_cast<__int128>(count) * plan.step;
+  if (last > INT64_MAX) {
+    overflow(plan.stepOffset);
+  }
+  store(plan.variable, Value::fromInt(static_cast<int64_t>(last)));
+}
+
+const ParallelPlan &Interpreter::parallelPlan(const WhileLoop &loop) {
+  auto it = parallelPlans.find(&loop);
+  if (it != parallelPlans.end()) {
+    return it->second;
+  }
+  auto &condition = static_cast<const BinaryExpr &>(*loop.condition);
+  auto &update = static_cast<const AssignmentExpr &>(*loop.loopBody.back());
+  auto &sum = static_cast<const BinaryExpr &>(*update.value);
+  ParallelPlan plan;
+  plan.variable = static_cast<const IdentifierExpr &>(*condition.left).binding;
+  plan.bound = condition.right.get();
+  plan.inclusive = condition.binaryOperator == "<=";
+  plan.step = static_cast<const NumericLiteral &>(*sum.right).value;
+  plan.stepOffset = sum.offset;
+  plan.privateGlobals.resize(globals.size());
+  for (const Binding &binding : bodyDeclarations(loop)) {
+    if (binding.scope == Binding::Scope::Global) {
+      plan.privateGlobals[binding.slot] = true;
+    }
+  }
+  return parallelPlans.emplace(&loop, move(plan)).first->second;
+}
+
+void Interpreter::startWorkers() {
+  size_t count = options.workers;
+  if (count == 0) {
+    count = max(thread::hardware_concurrency(), 1u);
+  }
+  InterpreterOptions workerOptions = options;
+  workerOptions.heap.isolated = true;
+  workerOptions.profiler = nullptr;
+  workerOptions.workers = 1;
+  for (size_t i = 0; i < count; i++) {
+    workers.push_back(make_unique<Interpreter>(program, out, workerOptions));
+    workers.back()->sharedOutput = &outputLock;
+  }
+  pool = make_unique<WorkerPool>(count);
+}
+
+// Worker 0 runs on the parent's thread, so it goes on measuring the native
+// stack from where the parent does; the others start measuring with their
+// first range.
+void Interpreter::enterRegion(const Interpreter &parent,
+                             const ParallelPlan &plan, bool sameThread) {
+  copy(parent.globals.begin(), parent.globals.end(), globals.begin());
+  fp = stack.get();
+  sp = copy(parent.fp, parent.sp, fp);
+  callDepth = parent.callDepth;
+  nativeStackBase = sameThread ? parent.nativeStackBase : nullptr;
+  region = &plan;
+}
+
+// Nothing outside the worker refers to what it allocated, so it can all go.
+void Interpreter::leaveRegion(Interpreter &parent) {
+  addStats(parent.runtimeStats, runtimeStats);
+  addHeapStats(parent.workerHeaps, heap.stats());
+  runtimeStats = RuntimeStats();
+  literals.clear();
+  heap.clear();
+  sp = fp = stack.get();
+  region = nullptr;
+}
+
+// A failed iteration leaves the frame wherever it was, so it is put back
+// before the next one. Iterations after one that failed are skipped: their
+// errors would not be reported anyway.
+void Interpreter::runIterations(const WhileLoop &loop, int64_t start,
+                                uint64_t begin, uint64_t end,
+                                ParallelFailure &failure) {
+  char base;
+  if (!nativeStackBase) {
+    nativeStackBase = &base;
+  }
+  const Binding &variable = region->variable;
+  uint64_t step = static_cast<uint64_t>(region->step);
+  size_t statements = loop.loopBody.size() - 1;
+  Value *frame = fp;
+  Value *frameEnd = sp;
+  size_t depth = callDepth;
+  for (uint64_t k = begin; k < end; k++) {
+    if (k >= failure.iteration.load(memory_order_relaxed)) {
+      return;
+    }
+    // Unsigned, so that it wraps around to the right value when the
+    // distance from a negative start does not fit an int64_t.
+    store(variable,
+          Value::fromInt(static_cast<int64_t>(
+              static_cast<uint64_t>(start) + k * step)));
+    try {
+      for (size_t i = 0; i < statements; i++) {
+        exec(*loop.loopBody[i]);
+      }
+    } catch (const RuntimeError &e) {
+      failure.record(k, e);
+      fp = frame;
+      sp = frameEnd;
+      callDepth = depth;
+      return;
+    }
+  }
+}
+
+// A worker's own instances live in its heap or in frames on its stack.
+bool Interpreter::isPrivate(const Object *object) const {
+  if (object->inFrame) {
+    auto *slot = reinterpret_cast<const Value *>(object);
+    return slot >= stack.get() && slot < stackEnd;
+  }
+  return heap.owns(object);
+}
+
+// Pushes exactly one value: the result of `expr`.
+void Interpreter::eval(const Expr &expr) {
+  switch (expr.kind) {
+  case NodeType::NumericLiteral:
+    push(Value::fromInt(static_cast<const NumericLiteral &>(expr).value));
+    return;
+  case NodeType::FloatLiteral:
+    push(
+        Value::fromFloat(static_cast<const class FloatLiteral &>(expr).value));
+    return;
+  case NodeType::StrLiteral:
+    push(Value::fromString(literal(static_cast<const StrLiteral &>(expr))));
+    return;
+  case NodeType::Null:
+    push(Value());
+    return;
+  case NodeType::Identifier:
+    push(load(static_cast<const IdentifierExpr &>(expr).binding));
+    return;
+  case NodeType::BinaryExpr:
+    evalBinary(static_cast<const BinaryExpr &>(expr));
+    return;
+  case NodeType::LogicalExpr:
+    evalLogical(static_cast<const LogicalExpr &>(expr));
+    return;
+  case NodeType::UnaryExpr:
+    evalUnary(static_cast<const UnaryExpr &>(expr));
+    return;
+  case NodeType::AssignmentExpr:
+    evalAssignment(static_cast<const AssignmentExpr &>(expr));
+    return;
+  case NodeType::CallExpr:
+    evalCall(static_cast<const CallExpr &>(expr));
+    return;
+  case NodeType::MemberAccessExpr:
+    evalMember(static_cast<const MemberAccessExpr &>(expr));
+    return;
+  case NodeType::ArrayLiteral:
+    evalArray(static_cast<const ArrayLiteral &>(expr));
+    return;
+  case NodeType::IndexExpr:
+    evalIndex(static_cast<const IndexExpr &>(expr));
+    return;
+  default:
+    throw RuntimeError("Cannot evaluate " + NodeTypeToString(expr.kind),
+                       expr.offset);
+  }
+}
+
+// Variables and integer literals, the most common operands, are pushed
+// without a trip through eval().
+inline void Interpreter::evalOperand(const Expr &expr) {
+  if (expr.kind == NodeType::Identifier) {
+    push(load(static_cast<const IdentifierExpr &>(expr).binding));
+  } else if (expr.kind == NodeType::NumericLiteral) {
+    push(Value::fromInt(static_cast<const NumericLiteral &>(expr).value));
+  } else {
+    eval(expr);
+  }
+}
+
+void Interpreter::evalBinary(const BinaryExpr &binaryExpr) {
+  evalOperand(*binaryExpr.left);
+  evalOperand(*binaryExpr.right);
+  Value left = sp[-2];
+  Value right = sp[-1];
+  uint32_t offset = binaryExpr.offset;
+  if (!options.quickening) {
+    sp[-2] = binary(decodeOperator(binaryExpr), left, right, offset);
+    sp--;
+    return;
+  }
+  BinarySite &site = binarySites[binaryExpr.cacheSlot];
+  switch (site.kind) {
+  case BinaryKind::Int:
+    if (left.type == ValueType::Int && right.type == ValueType::Int) {
+      sp[-2] = intBinary(site.op, left.integer, right.integer, offset);
+      sp--;
+      return;
+    }
+    break;
+  case BinaryKind::Float:
+    if (isFloatPair(left, right)) {
+      sp[-2] = floatBinary(site.op, asDouble(left), asDouble(right), offset);
+      sp--;
+      return;
+    }
+    break;
+  case BinaryKind::Concat:
+    if (left.type == ValueType::String || right.type == ValueType::String) {
+      sp[-2] = concat(left, right, offset);
+      sp--;
+      return;
+    }
+    break;
+  case BinaryKind::Unseen:
+  case BinaryKind::Generic:
+    break;
+  }
+  if (site.kind != BinaryKind::Generic) {
+    quicken(site, binaryExpr, left, right);
+  }
+  sp[-2] = binary(site.op, left, right, offset);
+  sp--;
+}
+
+// Specializes an unseen site to its operands, or gives up on a specialized
+// one whose operands no longer fit.
+void Interpreter::quicken(BinarySite &site, const BinaryExpr &binaryExpr,
+                          Value left, Value right) {
+  if (site.kind != BinaryKind::Unseen) {
+    site.kind = BinaryKind::Generic;
+    runtimeStats.deoptimizedSites++;
+    return;
+  }
+  site.op = decodeOperator(binaryExpr);
+  if (site.op == BinaryOp::Add && (left.type == ValueType::String ||
+                                   right.type == ValueType::String)) {
+    site.kind = BinaryKind::Concat;
+  } else if (left.type == ValueType::Int && right.type == ValueType::Int) {
+    site.kind = BinaryKind::Int;
+  } else if (isFloatPair(left, right)) {
+    site.kind = BinaryKind::Float;
+  } else {
+    site.kind = BinaryKind::Generic;
+    return;
+  }
+  runtimeStats.quickenedSites++;
+}
+
+Value Interpreter::binary(BinaryOp op, Value left, Value right,
+                          uint32_t offset) {
+  if (op == BinaryOp::Eq) {
+    return Value::fromBool(equal(left, right));
+  }
+  if (op == BinaryOp::Ne) {
+    return Value::fromBool(!equal(left, right));
+  }
+  if (op == BinaryOp::Add &&
+      (left.type == ValueType::String || right.type == ValueType::String)) {
+    return concat(left, right, offset);
+  }
+  if (left.type == ValueType::Int && right.type == ValueType::Int) {
+    return intBinary(op, left.integer, right.integer, offset);
+  }
+  if (left.isNumber() && right.isNumber()) {
+    return floatBinary(op, asDouble(left), asDouble(right), offset);
+  }
+  if (left.type == ValueType::String && right.type == ValueType::String &&
+      op >= BinaryOp::Lt && op <= BinaryOp::Ge) {
+    int order = left.asString()->view().compare(right.asString()->view());
+    switch (op) {
+    case BinaryOp::Lt:
+      return Value::fromBool(order < 0);
+    case BinaryOp::Le:
+      return Value::fromBool(order <= 0);
+    case BinaryOp::Gt:
+      return Value::fromBool(order > 0);
+    default:
+      return Value::fromBool(order >= 0);
+    }
+  }
+  static const char *const spellings[] = {"+", "-", "*",  "/", "%",  "<",
+                                          "<=", ">", ">=", "==", "!="};
+  throw RuntimeError("Cannot apply '" +
+                         string(spellings[static_cast<int>(op)]) + "' to " +
+                         typeName(left) + " and " + typeName(right),
+                     offset);
+}
+
+Value Interpreter::intBinary(BinaryOp op, int64_t l, int64_t r,
+                             uint32_t offset) const {
+  int64_t result;
+  switch (op) {
+  case BinaryOp::Add:
+    if (__builtin_add_overflow(l, r, &result)) {
+      overflow(offset);
+    }
+    return Value::fromInt(result);
+  case BinaryOp::Sub:
+    if (__builtin_sub_overflow(l, r, &result)) {
+      overflow(offset);
+    }
+    return Value::fromInt(result);
+  case BinaryOp::Mul:
+    if (__builtin_mul_overflow(l, r, &result)) {
+      overflow(offset);
+    }
+    return Value::fromInt(result);
+  case BinaryOp::Div:
+    if (r == 0) {
+      throw RuntimeError("Division by zero", offset);
+    }
+    if (l == INT64_MIN && r == -1) {
+      overflow(offset);
+    }
+    return Value::fromInt(l / r);
+  case BinaryOp::Mod:
+    if (r == 0) {
+      throw RuntimeError("Division by zero", offset);
+    }
+    return Value::fromInt(r == -1 ? 0 : l % r);
+  case BinaryOp::Lt:
+    return Value::fromBool(l < r);
+  case BinaryOp::Le:
+    return Value::fromBool(l <= r);
+  case BinaryOp::Gt:
+    return Value::fromBool(l > r);
+  case BinaryOp::Ge:
+    return Value::fromBool(l >= r);
+  case BinaryOp::Eq:
+    return Value::fromBool(l == r);
+  case BinaryOp::Ne:
+    return Value::fromBool(l != r);
+  }
+  return Value();
+}
+
+Value Interpreter::floatBinary(BinaryOp op, double l, double r,
+                               uint32_t offset) const {
+  switch (op) {
+  case BinaryOp::Add:
+    return Value::fromFloat(l + r);
+  case BinaryOp::Sub:
+    return Value::fromFloat(l - r);
+  case BinaryOp::Mul:
+    return Value::fromFloat(l * r);
+  case BinaryOp::Div:
+    if (r == 0) {
+      throw RuntimeError("Division by zero", offset);
+    }
+    return Value::fromFloat(l / r);
+  case BinaryOp::Mod:
+    if (r == 0) {
+      throw RuntimeError("Division by zero", offset);
+    }
+    return Value::fromFloat(fmod(l, r));
+  case BinaryOp::Lt:
+    return Value::fromBool(l < r);
+  case BinaryOp::Le:
+    return Value::fromBool(l <= r);
+  case BinaryOp::Gt:
+    return Value::fromBool(l > r);
+  case BinaryOp::Ge:
+    return Value::fromBool(l >= r);
+  case BinaryOp::Eq:
+    return Value::fromBool(l == r);
+  case BinaryOp::Ne:
+    return Value::fromBool(l != r);
+  }
+  return Value();
+}
+
+Value Interpreter::concat(Value left, Value right, uint32_t offset) {
+  string text;
+  appendString(text, left, 0);
+  appendString(text, right, 0);
+  if (text.size() > UINT32_MAX) {
+    throw RuntimeError("String is too long", offset);
+  }
+  return Value::fromString(newString(text, offset));
+}
+
+bool Interpreter::equal(Value left, Value right) const {
+  if (left.isNumber() && right.isNumber()) {
+    if (left.type == ValueType::Int && right.type == ValueType::Int) {
+      return left.integer == right.integer;
+    }
+    return asDouble(left) == asDouble(right);
+  }
+  if (left.type != right.type) {
+    return false;
+  }
+  switch (left.type) {
+  case ValueType::Null:
+    return true;
+  case ValueType::Bool:
+    return left.boolean == right.boolean;
+  case ValueType::String:
+    return left.asString()->view() == right.asString()->view();
+  case ValueType::Instance:
+    return left.object == right.object;
+  case ValueType::Array:
+    return left.asArray()->target() == right.asArray()->target();
+  case ValueType::Function:
+    return left.function == right.function;
+  case ValueType::Struct:
+    return left.layout == right.layout;
+  case ValueType::Builtin:
+    return left.builtin == right.builtin;
+  default:
+    return false;
+  }
+}
+
+void Interpreter::evalLogical(const LogicalExpr &logicalExpr) {
+  eval(*logicalExpr.left);
+  bool left = isTruthy(sp[-1]);
+  bool isAnd = logicalExpr.logicalOperator == "&&";
+  if (isAnd ? !left : left) {
+    sp[-1] = Value::fromBool(left);
+    return;
+  }
+  sp--;
+  eval(*logicalExpr.right);
+  sp[-1] = Value::fromBool(isTruthy(sp[-1]));
+}
+
+void Interpreter::evalUnary(const UnaryExpr &unaryExpr) {
+  eval(*unaryExpr.right);
+  Value operand = sp[-1];
+  if (unaryExpr.op == "!") {
+    sp[-1] = Value::fromBool(!isTruthy(operand));
+  } else if (operand.type == ValueType::Int) {
+    if (operand.integer == INT64_MIN) {
+      overflow(unaryExpr.offset);
+    }
+    sp[-1] = Value::fromInt(-operand.integer);
+  } else if (operand.type == ValueType::Float) {
+    sp[-1] = Value::fromFloat(-operand.number);
+  } else {
+    throw RuntimeError("Cannot apply '" + unaryExpr.op + "' to " +
+                           typeName(operand),
+                       unaryExpr.offset);
+  }
+}
+
+void Interpreter::evalAssignment(const AssignmentExpr &assignmentExpr) {
+  const Expr &target = *assignmentExpr.assigne;
+  if (target.kind == NodeType::Identifier) {
+    const Binding &binding = static_cast<const IdentifierExpr &>(target).binding;
+    if (binding.scope == Binding::Scope::Global && region &&
+        !region->privateGlobals[binding.slot]) {
+      throw RuntimeError("Cannot assign to global '" +
+                             program.analysis->names.globals[binding.slot] +
+                             "' inside a parallel loop: it is shared by all "
+                             "iterations",
+                         assignmentExpr.offset);
+    }
+    eval(*assignmentExpr.value);
+    store(binding, sp[-1]);
+    return;
+  }
+  if (target.kind == NodeType::IndexExpr) {
+    auto &indexExpr = static_cast<const IndexExpr &>(target);
+    eval(*indexExpr.object);
+    evalOperand(*indexExpr.index);
+    eval(*assignmentExpr.value);
+    uint32_t index = elementIndex(sp[-3], sp[-2], indexExpr.offset);
+    storeElement(sp - 3, index, sp[-1], indexExpr.offset);
+    sp[-3] = sp[-1];
+    sp -= 2;
+    return;
+  }
+  auto &access = static_cast<const MemberAccessExpr &>(target);
+  eval(*access.object);
+  eval(*assignmentExpr.value);
+  Value *slot = field(sp[-2], access);
+  if (region && !isPrivate(sp[-2].asInstance())) {
+    throw RuntimeError("Cannot assign to field '" + access.memberName +
+                           "' of an instance shared by the iterations of a "
+                           "parallel loop",
+                       access.offset);
+  }
+  const StructLayout &layout = *sp[-2].asInstance()->layout;
+  if (layout.fields[slot - sp[-2].asInstance()->fields()].constant) {
+    throw RuntimeError("Cannot assign to constant field '" +
+                           access.memberName + "' of struct '" + layout.name +
+                           "'",
+                       access.offset);
+  }
+  *slot = sp[-1];
+  heap.writeBarrier(sp[-2].asInstance(), sp[-1]);
+  sp[-2] = sp[-1];
+  sp--;
+}
+
+void Interpreter::evalMember(const MemberAccessExpr &memberAccessExpr) {
+  eval(*memberAccessExpr.object);
+  sp[-1] = *field(sp[-1], memberAccessExpr);
+}
+
+Value *Interpreter::field(Value object, const MemberAccessExpr &access) {
+  if (object.type != ValueType::Instance) {
+    throw RuntimeError("Cannot access field '" + access.memberName + "' of " +
+                           typeName(object),
+                       access.offset);
+  }
+  StructObject *instance = object.asInstance();
+  int32_t index = access.fieldIndex;
+  if (index >= 0) {
+    return &instance->fields()[index];
+  }
+  const StructLayout *layout = instance->layout;
+  FieldCache *cache = nullptr;
+  if (options.inlineCaches) {
+    cache = &fieldCaches[access.cacheSlot];
+    for (uint32_t i = 0; i < cache->size; i++) {
+      if (cache->layouts[i] == layout) {
+        runtimeStats.fieldCacheHits++;
+        return &instance->fields()[cache->indices[i]];
+      }
+    }
+    runtimeStats.fieldCacheMisses++;
+  }
+  index = layout->indexOf(access.memberName);
+  if (index < 0) {
+    throw RuntimeError("Struct '" + layout->name + "' has no field '" +
+                           access.memberName + "'",
+                       access.offset);
+  }
+  // A site that has seen more layouts than the cache holds keeps the ones
+  // it saw first and looks the others up every time.
+  if (cache && cache->size < FieldCache::ways) {
+    cache->layouts[cache->size] = layout;
+    cache->indices[cache->size] = index;
+    cache->size++;
+  }
+  return &instance->fields()[index];
+}
+
+// The elements are evaluated onto the stack, where they stay reachable
+// while the array is allocated.
+void Interpreter::evalArray(const ArrayLiteral &arrayLiteral) {
+  Value *elements = sp;
+  bool ints = true;
+  bool floats = true;
+  for (const auto &element : arrayLiteral.elements) {
+    evalOperand(*element);
+    ints = ints && sp[-1].type == ValueType::Int;
+    floats = floats && sp[-1].type == ValueType::Float;
+  }
+  uint32_t length = static_cast<uint32_t>(sp - elements);
+  ObjectKind kind = ints     ? ObjectKind::IntArray
+                    : floats ? ObjectKind::FloatArray
+                             : ObjectKind::ValueArray;
+  ArrayObject *array = newArray(kind, length, arrayLiteral.offset);
+  for (uint32_t i = 0; i < length; i++) {
+    switch (kind) {
+    case ObjectKind::IntArray:
+      array->ints()[i] = elements[i].integer;
+      break;
+    case ObjectKind::FloatArray:
+      array->floats()[i] = elements[i].number;
+      break;
+    default:
+      // A large array starts out old.
+      array->values()[i] = elements[i];
+      heap.writeBarrier(array, elements[i]);
+      break;
+    }
+  }
+  sp = elements;
+  push(Value::fromArray(array));
+}
+
+void Interpreter::evalIndex(const IndexExpr &indexExpr) {
+  eval(*indexExpr.object);
+  evalOperand(*indexExpr.index);
+  uint32_t index = elementIndex(sp[-2], sp[-1], indexExpr.offset);
+  ArrayObject *array = sp[-2].asArray()->target();
+  switch (array->kind) {
+  case ObjectKind::IntArray:
+    sp[-2] = Value::fromInt(loadElement(&array->ints()[index], region));
+    break;
+  case ObjectKind::FloatArray:
+    sp[-2] = Value::fromFloat(loadElement(&array->floats()[index], region));
+    break;
+  default:
+    sp[-2] = array->values()[index];
+    break;
+  }
+  sp--;
+}
+
+uint32_t Interpreter::elementIndex(Value array, Value index,
+                                   uint32_t offset) const {
+  if (array.type != ValueType::Array) {
+    throw RuntimeError("Cannot index " + typeName(array), offset);
+  }
+  if (index.type != ValueType::Int) {
+    throw RuntimeError("Array index must be an int, not " + typeName(index),
+                       offset);
+  }
+  uint32_t length = array.asArray()->length;
+  if (index.integer < 0 || index.integer >= length) {
+    throw RuntimeError("Index " + to_string(index.integer) +
+                           " is out of bounds for an array of length " +
+                           to_string(length),
+                       offset);
+  }
+  return static_cast<uint32_t>(index.integer);
+}
+
+// Unboxed elements take a value of their own type as it is. Anything else
+// boxes them first, which allocates, so the array is passed by its slot and
+// `value` must be a root as well. Only the first kind of store can go into
+// an array a worker does not own.
+void Interpreter::storeElement(Value *slot, uint32_t index, const Value &value,
+                               uint32_t offset) {
+  ArrayObject *array = slot->asArray()->target();
+  if (array->kind == ObjectKind::IntArray && value.type == ValueType::Int) {
+    writeElement(&array->ints()[index], value.integer, region);
+    return;
+  }
+  if (array->kind == ObjectKind::FloatArray &&
+      value.type == ValueType::Float) {
+    writeElement(&array->floats()[index], value.number, region);
+    return;
+  }
+  if (region && !isPrivate(array)) {
+    throw RuntimeError("Cannot store " + typeName(value) +
+                           " into an array shared by the iterations of a "
+                           "parallel loop",
+                       offset);
+  }
+  if (array->kind != ObjectKind::ValueArray) {
+    array = boxElements(slot, offset);
+  }
+  array->values()[index] = value;
+  heap.writeBarrier(array, value);
+}
+
+ArrayObject *Interpreter::boxElements(Value *slot, uint32_t offset) {
+  uint32_t length = slot->asArray()->length;
+  ArrayObject *boxed = newArray(ObjectKind::ValueArray, length, offset);
+  ArrayObject *array = slot->asArray();
+  Value *values = boxed->values();
+  if (array->kind == ObjectKind::IntArray) {
+    for (uint32_t i = 0; i < length; i++) {
+      values[i] = Value::fromInt(array->ints()[i]);
+    }
+  } else {
+    for (uint32_t i = 0; i < length; i++) {
+      values[i] = Value::fromFloat(array->floats()[i]);
+    }
+  }
+  array->moved = boxed;
+  heap.writeBarrier(array, Value::fromArray(boxed));
+  return boxed;
+}
+
+void Interpreter::evalCall(const CallExpr &callExpr) {
+  if (callExpr.builtin >= 0) {
+    callBound(callExpr);
+    return;
+  }
+  Value *callee = sp;
+  size_t argc = evalCallOperands(callExpr);
+  call(callee, argc, callExpr);
+}
+
+size_t Interpreter::evalCallOperands(const CallExpr &callExpr) {
+  eval(*callExpr.caller);
+  for (const auto &arg : callExpr.args) {
+    eval(*arg);
+  }
+  return callExpr.args.size();
+}
+
+void Interpreter::call(Value *callee, size_t argc, const CallExpr &callExpr) {
+  checkCall(*callee, argc, callExpr);
+  switch (callee->type) {
+  case ValueType::Function:
+    invoke(*callee->function, callee, argc, callExpr);
+    return;
+  case ValueType::Struct:
+    construct(*callee->layout, callee, argc, callExpr);
+    return;
+  default:
+    *callee = callBuiltin(*callee->builtin, callee + 1, argc,
+                          callExpr.offset);
+    sp = callee + 1;
+    return;
+  }
+}
+
+// A builtin cannot be reassigned or shadowed by another global, so the
+// binding holds for the whole run, and the arguments need no callee slot
+// in front of them.
+void Interpreter::callBound(const CallExpr &callExpr) {
+  Value *args = sp;
+  for (const auto &arg : callExpr.args) {
+    eval(*arg);
+  }
+  Value result = callBuiltin(builtins[callExpr.builtin], args,
+                             callExpr.args.size(), callExpr.offset);
+  sp = args;
+  push(result);
+}
+
+Value Interpreter::callBuiltin(const Builtin &builtin, const Value *args,
+                               size_t argc, uint32_t offset) {
+  try {
+    return builtin.function(*this, args, argc);
+  } catch (RuntimeError &e) {
+    // Builtins do not know where they were called from.
+    if (e.offset == 0) {
+      e.offset = offset;
+    }
+    throw;
+  } catch (const BuiltinError &e) {
+    throw RuntimeError(string(builtin.name) + "() " + e.what(), offset);
+  }
+}
+
+// `return f(...)` inside a function. When `f` is a function, its arguments
+// replace the running function's and invoke() runs it in the same frame, so
+// the native stack and the value stack stay where they are. Any instance
+// the frame held is dead by then: escape analysis counts passing one to a
+// call as an escape.
+Interpreter::Completion Interpreter::tailCall(const CallExpr &callExpr) {
+  Value *callee = sp;
+  size_t argc = evalCallOperands(callExpr);
+  if (callee->type != ValueType::Function) {
+    call(callee, argc, callExpr);
+    return Completion::Return;
+  }
+  checkCall(*callee, argc, callExpr);
+  fp[-1] = *callee;
+  copy(callee + 1, callee + 1 + argc, fp);
+  sp = fp + argc;
+  tailArgc = argc;
+  tailSite = &callExpr;
+  runtimeStats.tailCalls++;
+  return Completion::TailCall;
+}
+
+void Interpreter::checkCall(Value callee, size_t argc, const CallExpr &call) {
+  if (!options.inlineCaches) {
+    checkCallee(callee, argc, call);
+    return;
+  }
+  CallCache &cache = callCaches[call.cacheSlot];
+  if ((callee.type == ValueType::Function &&
+       callee.function == cache.function) ||
+      (callee.type == ValueType::Struct && callee.layout == cache.layout)) {
+    runtimeStats.callCacheHits++;
+    return;
+  }
+  runtimeStats.callCacheMisses++;
+  checkCallee(callee, argc, call);
+  if (callee.type == ValueType::Function) {
+    cache = CallCache{callee.function, nullptr};
+  } else if (callee.type == ValueType::Struct) {
+    cache = CallCache{nullptr, callee.layout};
+  }
+}
+
+void Interpreter::checkCallee(Value callee, size_t argc,
+                              const CallExpr &call) const {
+  switch (callee.type) {
+  case ValueType::Function: {
+    const FunctionDeclaration &function = *callee.function;
+    size_t parameters = function.parameters.size();
+    if (argc > parameters) {
+      throw RuntimeError("Function '" + function.name + "' takes " +
+                             to_string(parameters) + " arguments but " +
+                             to_string(argc) + " were given",
+                         call.offset);
+    }
+    return;
+  }
+  case ValueType::Struct: {
+    const StructLayout &layout = *callee.layout;
+    size_t fieldCount = layout.fields.size();
+    if (argc > fieldCount) {
+      throw RuntimeError("Struct '" + layout.name + "' has " +
+                             to_string(fieldCount) + " fields but " +
+                             to_string(argc) + " arguments were given",
+                         call.offset);
+    }
+    return;
+  }
+  case ValueType::Builtin:
+    return;
+  default:
+    throw RuntimeError("Cannot call a value of type " + typeName(callee),
+                       call.offset);
+  }
+}
+
+// The arguments already sit where the parameters belong: the frame starts
+// right after the callee's slot. Tail calls the body makes run in the same
+// frame, one after the other, until one returns normally.
+void Interpreter::invoke(const FunctionDeclaration &function, Value *callee,
+                         size_t argc, const CallExpr &call) {
+  char here;
+  if (callDepth >= options.maxCallDepth ||
+      static_cast<size_t>(nativeStackBase - &here) >
+          options.nativeStackBytes) {
+    throw RuntimeError("Maximum call depth of " + to_string(callDepth) +
+                           " exceeded",
+                       call.offset);
+  }
+  Value *frame = callee + 1;
+  Value *callerFp = fp;
+  const FunctionDeclaration *running = &function;
+  const CallExpr *site = &call;
+  Completion completion;
+  callDepth++;
+  if (options.profiler) {
+    options.profiler->enter(running, call.offset);
+  }
+  while (true) {
+    Value *frameEnd = frame + running->frameSize;
+    if (frameEnd > stackEnd) {
+      throw RuntimeError("Stack overflow", site->offset);
+    }
+    for (Value *slot = frame + argc; slot < frameEnd; slot++) {
+      *slot = Value();
+    }
+    fp = frame;
+    sp = frameEnd;
+    runtimeStats.calls++;
+    if (options.profiler) {
+      options.profiler->tick(running->offset);
+    }
+    completion = Completion::Normal;
+    for (const Stmt *stmt : running->body) {
+      completion = exec(*stmt);
+      if (completion != Completion::Normal) {
+        break;
+      }
+    }
+    if (completion != Completion::TailCall) {
+      break;
+    }
+    running = callee->function;
+    argc = tailArgc;
+    site = tailSite;
+    if (options.profiler) {
+      options.profiler->replace(running);
+    }
+  }
+  if (options.profiler) {
+    options.profiler->leave();
+  }
+  Value result = completion == Completion::Return ? sp[-1] : Value();
+  callDepth--;
+  fp = callerFp;
+  *callee = result;
+  sp = callee + 1;
+}
+
+void Interpreter::construct(const StructLayout &layout, Value *callee,
+                            size_t argc, const CallExpr &call) {
+  size_t fieldCount = layout.fields.size();
+  StructObject *instance;
+  if (call.frameSlot >= 0) {
+    instance = new (fp + call.frameSlot) StructObject();
+    instance->kind = ObjectKind::Instance;
+    instance->inFrame = true;
+    instance->length = static_cast<uint32_t>(fieldCount);
+    instance->layout = &layout;
+    runtimeStats.frameInstances++;
+  } else {
+    instance = newInstance(layout, call.offset);
+  }
+  // An instance too large for the nursery starts out old, so its stores
+  // need the write barrier like any other.
+  Value *fields = instance->fields();
+  for (size_t i = 0; i < argc; i++) {
+    fields[i] = callee[1 + i];
+    heap.writeBarrier(instance, fields[i]);
+  }
+  *callee = Value::fromInstance(instance);
+  sp = callee + 1;
+  for (size_t i = argc; i < fieldCount; i++) {
+    const VarDeclaration *declaration = layout.fields[i].declaration;
+    if (declaration->value) {
+      eval(*declaration->value);
+      instance = callee->asInstance();
+      instance->fields()[i] = pop();
+      heap.writeBarrier(instance, instance->fields()[i]);
+    } else {
+      callee->asInstance()->fields()[i] = Value();
+    }
+  }
+}
+
+string Interpreter::toString(Value value) const {
+  string text;
+  appendString(text, value, 0);
+  return text;
+}
+
+void Interpreter::appendString(string &text, Value value, int depth) const {
+  switch (value.type) {
+  case ValueType::Null:
+    text += "null";
+    return;
+  case ValueType::Bool:
+    text += value.boolean ? "true" : "false";
+    return;
+  case ValueType::Int: {
+    char buffer[24];
+    to_chars_result result =
+        to_chars(buffer, buffer + sizeof(buffer), value.integer);
+    text.append(buffer, result.ptr);
+    return;
+  }
+  case ValueType::Float: {
+    if (isnan(value.number)) {
+      text += "nan";
+      return;
+    }
+    if (isinf(value.number)) {
+      text += value.number < 0 ? "-inf" : "inf";
+      return;
+    }
+    char buffer[32];
+    to_chars_result result =
+        to_chars(buffer, buffer + sizeof(buffer), value.number);
+    string_view digits(buffer, result.ptr - buffer);
+    text += digits;
+    // Keep floats recognizable as floats: 2.0, not 2.
+    if (digits.find_first_of(".e") == string_view::npos) {
+      text += ".0";
+    }
+    return;
+  }
+  case ValueType::String:
+    text += value.asString()->view();
+    return;
+  case ValueType::Instance: {
+    const StructObject *instance = value.asInstance();
+    text += instance->layout->name;
+    if (depth >= maxPrintDepth) {
+      text += "(...)";
+      return;
+    }
+    text += '(';
+    for (uint32_t i = 0; i < instance->length; i++) {
+      if (i > 0) {
+        text += ", ";
+      }
+      appendString(text, instance->fields()[i], depth + 1);
+    }
+    text += ')';
+    return;
+  }
+  case ValueType::Array: {
+    ArrayObject *array = value.asArray()->target();
+    if (depth >= maxPrintDepth) {
+      text += "[...]";
+      return;
+    }
+    text += '[';
+    for (uint32_t i = 0; i < array->length; i++) {
+      if (i > 0) {
+        text += ", ";
+      }
+      switch (array->kind) {
+      case ObjectKind::IntArray:
+        appendString(text,
+                     Value::fromInt(loadElement(&array->ints()[i], region)),
+                     depth + 1);
+        break;
+      case ObjectKind::FloatArray:
+        appendString(
+            text, Value::fromFloat(loadElement(&array->floats()[i], region)),
+            depth + 1);
+        break;
+      default:
+        appendString(text, array->values()[i], depth + 1);
+        break;
+      }
+    }
+    text += ']';
+    return;
+  }
+  case ValueType::Function:
+    text += "<func " + value.function->name + ">";
+    return;
+  case ValueType::Struct:
+    text += "<struct " + value.layout->name + ">";
+    return;
+  case ValueType::Builtin:
+    text += string("<builtin ") + value.builtin->name + ">";
+    return;
+  }
+}
@@ -0,0 +1,329 @@
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include "../compiler/Compiler.h"
+#include "Builtins.h"
+#include "Heap.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include "Value.h"
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+class Interpreter;
+class ParallelFailure;
+
+class RuntimeError : public runtime_error {
+public:
+  RuntimeError(const string &message, uint32_t offset = 0)
+      : runtime_error(message), offset(offset) {}
+  uint32_t offset;
+};
+
+class RuntimeStats {
+public:
+  HeapStats heap;
+  // Struct instances placed in a frame instead of the heap.
+  size_t frameInstances = 0;
+  size_t calls = 0;
+  // Calls that reused the frame of the function returning them.
+  size_t tailCalls = 0;
+  // Lookups the inline caches answered, and those they had to pass on.
+  size_t fieldCacheHits = 0;
+  size_t fieldCacheMisses = 0;
+  size_t callCacheHits = 0;
+  size_t callCacheMisses = 0;
+  // Binary expressions specialized on their first run, and those later
+  // deoptimized.
+  size_t quickenedSites = 0;
+  size_t deoptimizedSites = 0;
+  // Parallel loops run on the worker pool, and the iterations they ran.
+  size_t parallelLoops = 0;
+  size_t parallelIterations = 0;
+  // Ranges of iterations one worker took from another's share.
+  size_t steals = 0;
+};
+
+// Inline cache of a member access the analysis could not resolve: the
+// layouts of the instances it has seen, up to `ways` of them, and the
+// field's index in each.
+class FieldCache {
+public:
+  static constexpr uint32_t ways = 4;
+  const StructLayout *layouts[ways];
+  int32_t indices[ways];
+  uint32_t size = 0;
+};
+
+// The operators of BinaryExpr, decoded from their spelling.
+enum class BinaryOp : uint8_t {
+  Add,
+  Sub,
+  Mul,
+  Div,
+  Mod,
+  Lt,
+  Le,
+  Gt,
+  Ge,
+  Eq,
+  Ne,
+};
+
+// What a binary expression has been specialized to after its first run,
+// by the operand types it saw. A specialized site checks that its operands
+// still have those types and then skips straight to the operation; the
+// first run that finds other types deoptimizes it to Generic for good.
+enum class BinaryKind : uint8_t {
+  Unseen,
+  // Two ints.
+  Int,
+  // Two numbers, at least one a float.
+  Float,
+  // `+` with a string operand.
+  Concat,
+  Generic,
+};
+
+class BinarySite {
+public:
+  BinaryKind kind = BinaryKind::Unseen;
+  BinaryOp op;
+};
+
+// Inline cache of a call: the function or struct it last called, whose
+// arity has been checked against the call's arguments.
+class CallCache {
+public:
+  const FunctionDeclaration *function = nullptr;
+  const StructLayout *layout = nullptr;
+};
+
+// What running a parallel loop needs to know about it, worked out the first
+// time it runs from the shape passes/ParallelLoops.h checked.
+class ParallelPlan {
+public:
+  // The loop variable, `i` in `i < n`, and `n`.
+  Binding variable;
+  const Expr *bound;
+  bool inclusive;
+  // `c` in the final `i = i + c`, and where that addition is.
+  int64_t step;
+  uint32_t stepOffset;
+  // Indexed by global slot: whether the body declares the global, which
+  // makes it private to an iteration rather than shared.
+  vector<bool> privateGlobals;
+};
+
+class InterpreterOptions {
+public:
+  // Slots of the value stack that holds every frame and temporary.
+  size_t stackSlots = 1 << 18;
+  // Deepest nesting of calls before the run fails. Tail calls replace the
+  // call they are made from, so they do not nest.
+  size_t maxCallDepth = 5000;
+  // Native stack a run may use. Tree walking recurses, so this is what
+  // actually bounds deep recursion in TL code; keep it well below the
+  // thread's stack size.
+  size_t nativeStackBytes = 4 << 20;
+  HeapOptions heap;
+  // Whether member accesses and calls use their inline caches.
+  bool inlineCaches = true;
+  // Whether binary expressions specialize themselves to the operand types
+  // they see.
+  bool quickening = true;
+  // Told about every call and loop iteration when set. Not owned.
+  Profiler *profiler = nullptr;
+  // Threads that run the iterations of parallel loops, the one calling
+  // run() included; 0 for one per hardware thread. With 1 they run on the
+  // calling thread, by the same rules.
+  size_t workers = 0;
+  // What readLine() reads; none when null. Not owned.
+  istream *input = nullptr;
+};
+
+// Runs an analyzed program by walking its tree. Every frame and every
+// intermediate value lives on one value stack, so the values a run can
+// still reach are exactly the globals plus the live part of that stack;
+// those, and the interned string literals, are the heap's roots.
+//
+// Arrays have a fixed length, set by their literal, and are indexed from 0;
+// indexing out of bounds fails. `len(a)` is the length.
+//
+// Numbers follow constant folding: integer operations stay integers
+// (division truncates) and fail on overflow, and a float operand makes the
+// result a float. `+` with a string operand concatenates. Comparisons and
+// `!`, `&&`, `||` produce booleans, where null, false, 0 and "" are false.
+//
+// A `parallel while` runs on a pool of worker interpreters, each with a
+// value stack, heap and caches of its own, started the first time one runs.
+// A worker starts from copies of the globals and of the running frame, so
+// what the iterations declare stays private to them, and reads whatever
+// else they reach in the heap of the interpreter that started it, which
+// sits idle until the loop is done. Stores into anything that is not the
+// worker's own fail, but for the unboxed array elements the loop's rules
+// allow, and anything the worker allocated is freed when the loop ends:
+// none of it can be reachable from outside. When iterations fail, the loop
+// reports the error of the first of them in loop order; the iterations
+// after that one may or may not have run.
+class Interpreter {
+public:
+  // `program` must have been analyzed, with builtinNames() declared, and be
+  // free of errors. It must outlive the interpreter.
+  Interpreter(const CompileResult &program, ostream &out,
+              InterpreterOptions options = InterpreterOptions());
+
+  // Names of the builtins, to declare before analysis.
+  static vector<string> builtinNames();
+
+  ~Interpreter();
+
+  // Runs the top-level code and returns the value of a top-level `return`,
+  // or null. Throws RuntimeError.
+  Value run();
+
+  const RuntimeStats &stats();
+  string toString(Value value) const;
+  // Writes program output. Workers of parallel loops take turns.
+  void write(const string &text);
+  // Reads a line of input into `line`, without its newline; false at the
+  // end of the input. Workers of parallel loops take turns.
+  bool readLine(string &line);
+  // A new string for a builtin to return. Like any allocation it may
+  // collect, moving what the builtin's arguments point to.
+  Value makeString(string_view text) {
+    return Value::fromString(newString(text, 0));
+  }
+
+private:
+  // How a statement finished. TailCall means the running function's frame
+  // now holds the callee in its callee slot and `tailArgc` arguments, for
+  // invoke() to run in its place.
+  enum class Completion { Normal, Return, TailCall };
+
+  const CompileResult &program;
+  ostream &out;
+  InterpreterOptions options;
+  Heap heap;
+  RuntimeStats runtimeStats;
+
+  vector<Value> globals;
+  unique_ptr<Value[]> stack;
+  Value *stackEnd;
+  // Next free slot, and the first slot of the running function's frame.
+  Value *sp;
+  Value *fp;
+  size_t callDepth = 0;
+  size_t tailArgc = 0;
+  const CallExpr *tailSite = nullptr;
+  // Address near the bottom of the native stack used by run().
+  const char *nativeStackBase = nullptr;
+  // Strings of the literals evaluated so far; roots, so they hold Values
+  // the collector can update.
+  unordered_map<const StrLiteral *, Value> literals;
+  // Indexed by the sites' cacheSlot.
+  vector<FieldCache> fieldCaches;
+  vector<CallCache> callCaches;
+  vector<BinarySite> binarySites;
+
+  // Started by the first parallel loop; worker i runs on thread i of the
+  // pool.
+  unique_ptr<WorkerPool> pool;
+  vector<unique_ptr<Interpreter>> workers;
+  unordered_map<const WhileLoop *, ParallelPlan> parallelPlans;
+  // What the workers allocated, over the loops they have finished.
+  HeapStats workerHeaps;
+  mutex outputLock;
+  // In a worker: the loop it runs iterations of, and the lock its output
+  // takes. Null in the interpreter that started it.
+  const ParallelPlan *region = nullptr;
+  mutex *sharedOutput = nullptr;
+
+  void push(Value value);
+  Value pop() { return *--sp; }
+  Value load(const Binding &binding) const;
+  void store(const Binding &binding, Value value);
+
+  Completion exec(const Stmt &stmt);
+  Completion execBlock(const vector<unique_ptr<Stmt>> &body);
+  void runParallel(const WhileLoop &loop);
+  const ParallelPlan &parallelPlan(const WhileLoop &loop);
+  void startWorkers();
+  // In a worker: takes on the globals and running frame of `parent` to run
+  // iterations of `plan`, and afterwards hands back its stats and frees
+  // what it allocated.
+  void enterRegion(const Interpreter &parent, const ParallelPlan &plan,
+                   bool sameThread);
+  void leaveRegion(Interpreter &parent);
+  // In a worker: runs iterations [begin, end) of the loop, whose variable
+  // starts at `start`.
+  void runIterations(const WhileLoop &loop, int64_t start, uint64_t begin,
+                     uint64_t end, ParallelFailure &failure);
+  // Whether a worker may store into `object`.
+  bool isPrivate(const Object *object) const;
+  void eval(const Expr &expr);
+  void evalOperand(const Expr &expr);
+  void evalBinary(const BinaryExpr &binaryExpr);
+  void evalLogical(const LogicalExpr &logicalExpr);
+  void evalUnary(const UnaryExpr &unaryExpr);
+  void evalAssignment(const AssignmentExpr &assignmentExpr);
+  void evalCall(const CallExpr &callExpr);
+  // Pushes the callee and the arguments of `callExpr`; returns how many
+  // arguments there are.
+  size_t evalCallOperands(const CallExpr &callExpr);
+  void call(Value *callee, size_t argc, const CallExpr &callExpr);
+  // The call of a builtin the analysis bound it to: pushes the arguments
+  // and calls it directly, without loading or checking a callee.
+  void callBound(const CallExpr &callExpr);
+  Value callBuiltin(const Builtin &builtin, const Value *args, size_t argc,
+                    uint32_t offset);
+  Completion tailCall(const CallExpr &callExpr);
+  void evalMember(const MemberAccessExpr &memberAccessExpr);
+  void evalArray(const ArrayLiteral &arrayLiteral);
+  void evalIndex(const IndexExpr &indexExpr);
+
+  // Fails unless `callee` can be called with `argc` arguments. Skipped for
+  // the callee the call's inline cache holds, which passed before.
+  void checkCall(Value callee, size_t argc, const CallExpr &call);
+  void checkCallee(Value callee, size_t argc, const CallExpr &call) const;
+  // Each takes the callee's slot; the arguments follow it on the stack and
+  // have passed checkCall(). They leave the result in the callee's slot and
+  // pop everything above.
+  void invoke(const FunctionDeclaration &function, Value *callee,
+              size_t argc, const CallExpr &call);
+  void construct(const StructLayout &layout, Value *callee, size_t argc,
+                 const CallExpr &call);
+
+  Value *field(Value object, const MemberAccessExpr &access);
+  // Fails at `offset` unless `array` is an array and `index` one of its
+  // indices.
+  uint32_t elementIndex(Value array, Value index, uint32_t offset) const;
+  void storeElement(Value *slot, uint32_t index, const Value &value,
+                    uint32_t offset);
+  // Copies the unboxed elements of the array in `slot` into a ValueArray
+  // the array forwards to, and returns that.
+  ArrayObject *boxElements(Value *slot, uint32_t offset);
+  void quicken(BinarySite &site, const BinaryExpr &binaryExpr, Value left,
+               Value right);
+  Value binary(BinaryOp op, Value left, Value right, uint32_t offset);
+  Value intBinary(BinaryOp op, int64_t l, int64_t r, uint32_t offset) const;
+  Value floatBinary(BinaryOp op, double l, double r, uint32_t offset) const;
+  Value concat(Value left, Value right, uint32_t offset);
+  bool equal(Value left, Value right) const;
+  StringObject *literal(const StrLiteral &strLit);
+  // Allocate on the heap, failing at `offset` if it is full.
+  StringObject *newString(string_view text, uint32_t offset);
+  StructObject *newInstance(const StructLayout &layout, uint32_t offset);
+  ArrayObject *newArray(ObjectKind kind, uint32_t length, uint32_t offset);
+  void scanRoots(const RootRange &visit);
+  void appendString(string &out, Value value, int depth) const;
+};
+
+bool isTruthy(Value value);
+string typeName(Value value);
+
+#endif
@@ -0,0 +1,165 @@
+#include "Parallel.h"
+#include <algorithm>
+
+namespace {
+
+// Ranges each worker's share is split into, about, when they are taken:
+// enough for stealing to even out uneven iterations, few enough that taking
+// one costs little next to running it.
+constexpr uint64_t rangesPerWorker = 16;
+
+} // namespace
+
+WorkerPool::WorkerPool(size_t workers)
+    : workers(max<size_t>(workers, 1)), queues(new Queue[this->workers]) {
+  for (size_t worker = 1; worker < this->workers; worker++) {
+    threads.emplace_back([this, worker] { threadMain(worker); });
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    lock_guard<mutex> guard(lock);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (thread &thread : threads) {
+    thread.join();
+  }
+}
+
+void WorkerPool::run(uint64_t count, const RangeBody &rangeBody) {
+  if (count == 0) {
+    return;
+  }
+  uint64_t share = count / workers;
+  uint64_t extra = count % workers;
+  uint64_t begin = 0;
+  for (size_t worker = 0; worker < workers; worker++) {
+    uint64_t end = begin + share + (worker < extra);
+    if (end > begin) {
+      queues[worker].ranges.push_back(IterationRange{begin, end});
+    }
+    begin = end;
+  }
+  body = &rangeBody;
+  grain = max<uint64_t>(share / rangesPerWorker, 1);
+  remaining = count;
+  failed = false;
+  {
+    lock_guard<mutex> guard(lock);
+    error = nullptr;
+    busy = threads.size();
+    generation++;
+  }
+  wake.notify_all();
+  work(0);
+  exception_ptr thrown;
+  {
+    unique_lock<mutex> guard(lock);
+    done.wait(guard, [this] { return busy == 0; });
+    thrown = error;
+  }
+  body = nullptr;
+  if (thrown) {
+    rethrow_exception(thrown);
+  }
+}
+
+void WorkerPool::threadMain(size_t worker) {
+  uint64_t seen = 0;
+  while (true) {
+    {
+      unique_lock<mutex> guard(lock);
+      wake.wait(guard, [&] { return stopping || generation != seen; });
+      if (stopping) {
+        return;
+      }
+      seen = generation;
+    }
+    work(worker);
+    lock_guard<mutex> guard(lock);
+    if (--busy == 0) {
+      done.notify_one();
+    }
+  }
+}
+
+// Runs ranges until every iteration is accounted for. A worker splits a
+// range all the way down to the grain before it runs any of it, so ranges
+// only ever appear while others are being taken. One with nothing to take
+// sleeps until a worker pushes a range or the last iteration is done,
+// rather than keep a core busy while the longest range runs.
+void WorkerPool::work(size_t worker) {
+  Queue &own = queues[worker];
+  IterationRange range;
+  while (remaining.load(memory_order_acquire) > 0) {
+    uint64_t seen = pushes.load(memory_order_acquire);
+    if (!take(worker, range)) {
+      unique_lock<mutex> guard(idleLock);
+      idle.wait(guard, [&] {
+        return pushes.load(memory_order_acquire) != seen ||
+               remaining.load(memory_order_acquire) == 0;
+      });
+      continue;
+    }
+    bool split = false;
+    while (range.end - range.begin > grain) {
+      uint64_t middle = range.begin + (range.end - range.begin) / 2;
+      lock_guard<mutex> guard(own.lock);
+      own.ranges.push_back(IterationRange{middle, range.end});
+      range.end = middle;
+      split = true;
+    }
+    if (split) {
+      pushes.fetch_add(1, memory_order_release);
+      wakeIdle();
+    }
+    if (!failed.load(memory_order_relaxed)) {
+      try {
+        (*body)(worker, range.begin, range.end);
+      } catch (...) {
+        lock_guard<mutex> guard(lock);
+        if (!error) {
+          error = current_exception();
+        }
+        failed = true;
+      }
+    }
+    uint64_t size = range.end - range.begin;
+    if (remaining.fetch_sub(size, memory_order_acq_rel) == size) {
+      wakeIdle();
+    }
+  }
+}
+
+// Called after changing what sleeping workers wait for. A worker holds
+// their lock from testing that to sleeping, so taking it here first means
+// none can have seen the old state and still be on its way to sleep.
+void WorkerPool::wakeIdle() {
+  { lock_guard<mutex> guard(idleLock); }
+  idle.notify_all();
+}
+
+bool WorkerPool::take(size_t worker, IterationRange &range) {
+  {
+    Queue &own = queues[worker];
+    lock_guard<mutex> guard(own.lock);
+    if (!own.ranges.empty()) {
+      range = own.ranges.back();
+      own.ranges.pop_back();
+      return true;
+    }
+  }
+  for (size_t i = 1; i < workers; i++) {
+    Queue &victim = queues[(worker + i) % workers];
+    lock_guard<mutex> guard(victim.lock);
+    if (!victim.ranges.empty()) {
+      range = victim.ranges.front();
+      victim.ranges.pop_front();
+      stealCount++;
+      return true;
+    }
+  }
+  return false;
+}
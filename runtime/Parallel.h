@@ -0,0 +1,97 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// Consecutive loop iterations, [begin, end).
+class IterationRange {
+public:
+  uint64_t begin;
+  uint64_t end;
+};
+
+// Calls body(worker, begin, end) on one range of iterations.
+using RangeBody = function<void(size_t worker, uint64_t begin, uint64_t end)>;
+
+// Runs the iterations of a loop on a fixed set of worker threads by work
+// stealing. Every worker has a deque of ranges. It takes ranges from the
+// back of its own, and splits one larger than the grain in halves, pushing
+// the upper half back and going on with the lower, so what it leaves
+// behind is a few large ranges at the front. A worker whose deque is empty
+// steals from the front of another's, where the largest range is. The
+// iterations start out split evenly across the deques: when they cost about
+// the same there is next to no stealing, and when they do not, the workers
+// that run out early take over the rest of the others' share.
+//
+// The thread that calls run() is worker 0 and works as well; the pool's
+// own threads sleep between runs. Within a run, a worker that finds nothing
+// to take sleeps too, until another splits a range or the run is over.
+class WorkerPool {
+public:
+  // `workers` counts the calling thread, so a pool of one starts no thread.
+  explicit WorkerPool(size_t workers);
+  ~WorkerPool();
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  size_t size() const { return workers; }
+  // Calls `body` on disjoint ranges that together cover [0, count), each on
+  // the thread of the worker it is given, and returns once all are done.
+  // When a call throws, the ranges not started yet are skipped and the
+  // first exception is rethrown here.
+  void run(uint64_t count, const RangeBody &body);
+  // Ranges taken from another worker's deque, in all runs so far.
+  size_t steals() const { return stealCount; }
+
+private:
+  class Queue {
+  public:
+    mutex lock;
+    deque<IterationRange> ranges;
+  };
+
+  size_t workers;
+  unique_ptr<Queue[]> queues;
+  vector<thread> threads;
+
+  // Guards the fields below it; `wake` and `done` wait on it.
+  mutex lock;
+  condition_variable wake;
+  condition_variable done;
+  uint64_t generation = 0;
+  // Threads still working on the current run.
+  size_t busy = 0;
+  bool stopping = false;
+  exception_ptr error;
+
+  // Set up by run() before the threads wake.
+  const RangeBody *body = nullptr;
+  uint64_t grain = 1;
+  // Iterations not run or skipped yet; the run is over at 0.
+  atomic<uint64_t> remaining{0};
+  atomic<bool> failed{false};
+  atomic<size_t> stealCount{0};
+  // Bumped whenever a worker pushes ranges onto its deque. Workers with
+  // nothing to take wait on `idle` for it to change, or for `remaining` to
+  // reach 0.
+  atomic<uint64_t> pushes{0};
+  mutex idleLock;
+  condition_variable idle;
+
+  void threadMain(size_t worker);
+  void work(size_t worker);
+  bool take(size_t worker, IterationRange &range);
+  void wakeIdle();
+};
+
+#endif
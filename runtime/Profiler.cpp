@@ -0,0 +1,91 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <iomanip>
+#include <unordered_map>
+
+Profiler::Profiler(ProfilerOptions options) : options(options) {
+  countdown = nextGap();
+  start();
+}
+
+void Profiler::start() {
+  stack.assign(1, Frame{nullptr, 0});
+  last = chrono::steady_clock::now();
+}
+
+// Uniform in [interval / 2, interval * 3 / 2). A fixed gap would keep
+// landing on the same phase of a loop that ticks periodically, and never
+// see the functions in between.
+size_t Profiler::nextGap() {
+  random ^= random << 13;
+  random ^= random >> 17;
+  random ^= random << 5;
+  size_t interval = max<size_t>(options.interval, 2);
+  return interval / 2 + random % interval;
+}
+
+void Profiler::sample(uint32_t offset) {
+  countdown = nextGap();
+  auto now = chrono::steady_clock::now();
+  stack.back().offset = offset;
+  stacks[stack] +=
+      chrono::duration_cast<chrono::nanoseconds>(now - last).count();
+  last = now;
+  sampleCount++;
+}
+
+string Profiler::frameName(const Frame &frame, const LineTable &lines) {
+  return (frame.function ? frame.function->name : string("<main>")) + ":" +
+         to_string(lines.locate(frame.offset).line);
+}
+
+// Stacks that differ only in offsets on the same lines print the same, so
+// they are merged first.
+void Profiler::writeFolded(ostream &out, const LineTable &lines) const {
+  map<string, long long> folded;
+  for (const auto &entry : stacks) {
+    string names;
+    for (const Frame &frame : entry.first) {
+      if (!names.empty()) {
+        names += ';';
+      }
+      names += frameName(frame, lines);
+    }
+    folded[names] += entry.second;
+  }
+  for (const auto &entry : folded) {
+    out << entry.first << ' ' << entry.second / 1000 << '\n';
+  }
+}
+
+void Profiler::writeSummary(ostream &out, const LineTable &lines,
+                            size_t top) const {
+  // Self time of the innermost frame: per function, and per line.
+  unordered_map<string, long long> functions;
+  unordered_map<string, long long> lineTimes;
+  long long total = 0;
+  for (const auto &entry : stacks) {
+    const Frame &leaf = entry.first.back();
+    functions[leaf.function ? leaf.function->name : "<main>"] += entry.second;
+    lineTimes[frameName(leaf, lines)] += entry.second;
+    total += entry.second;
+  }
+
+  auto print = [&](const char *title,
+                   const unordered_map<string, long long> &times) {
+    vector<pair<string, long long>> sorted(times.begin(), times.end());
+    sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) {
+      return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    out << title << '\n';
+    for (size_t i = 0; i < sorted.size() && i < top; i++) {
+      double share = total > 0 ? 100.0 * sorted[i].second / total : 0.0;
+      out << "  " << fixed << setprecision(1) << setw(5) << share << "%  "
+          << sorted[i].first << '\n';
+    }
+  };
+  out << "profile: " << sampleCount << " samples, " << total / 1000
+      << " us\n";
+  print("self time by function:", functions);
+  print("self time by line:", lineTimes);
+}
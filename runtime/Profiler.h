@@ -0,0 +1,86 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "../ast/AST.h"
+#include "../lexer/LineTable.h"
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <vector>
+
+class ProfilerOptions {
+public:
+  // Average ticks between two samples. Every call and every loop iteration
+  // is a tick.
+  size_t interval = 1000;
+};
+
+// A sampling profiler the interpreter drives. Rather than a timer signal
+// it counts ticks, and about every `interval` ticks records the TL call
+// stack together with the time since the previous sample, which attributes
+// the run's time to functions and lines about in proportion to the ticks
+// spent there. Between samples it costs a countdown per tick and a push and pop
+// per call; an interpreter without a profiler only tests for one.
+//
+// Each frame of a recorded stack is a function and a source offset: where
+// the function called the next frame, or, for the innermost one, the loop
+// or function entry that ticked. Top-level code is the function `<main>`.
+class Profiler {
+public:
+  Profiler(ProfilerOptions options = ProfilerOptions());
+
+  // Starts a run with an empty stack in `<main>`.
+  void start();
+  // The running function calls `function` at `offset`.
+  void enter(const FunctionDeclaration *function, uint32_t offset) {
+    stack.back().offset = offset;
+    stack.push_back(Frame{function, function->offset});
+  }
+  void leave() { stack.pop_back(); }
+  // The running function tail calls `function`, which takes its place.
+  void replace(const FunctionDeclaration *function) {
+    stack.back() = Frame{function, function->offset};
+  }
+  void tick(uint32_t offset) {
+    if (--countdown == 0) {
+      sample(offset);
+    }
+  }
+
+  size_t samples() const { return sampleCount; }
+  // One line per distinct stack, `<main>:3;fib:2;fib:4 <microseconds>`,
+  // the folded format flame graph tools read. Lines are 1-based.
+  void writeFolded(ostream &out, const LineTable &lines) const;
+  // The functions and lines with the most time, up to `top` of each.
+  void writeSummary(ostream &out, const LineTable &lines,
+                    size_t top = 10) const;
+
+private:
+  class Frame {
+  public:
+    // Null for top-level code.
+    const FunctionDeclaration *function;
+    uint32_t offset;
+
+    bool operator<(const Frame &other) const {
+      return function != other.function ? function < other.function
+                                         : offset < other.offset;
+    }
+  };
+
+  ProfilerOptions options;
+  size_t countdown;
+  // State of the generator that varies the gaps between samples.
+  uint32_t random = 2463534242u;
+  size_t sampleCount = 0;
+  vector<Frame> stack;
+  chrono::steady_clock::time_point last;
+  // Nanoseconds attributed to each stack seen.
+  map<vector<Frame>, long long> stacks;
+
+  void sample(uint32_t offset);
+  size_t nextGap();
+  static string frameName(const Frame &frame, const LineTable &lines);
+};
+
+#endif
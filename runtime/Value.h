@@ -0,0 +1,232 @@
+#ifndef VALUE_H
+#define VALUE_H
+
+#include "../ast/AST.h"
+#include "../passes/StructLayout.h"
+#include <cstdint>
+#include <string_view>
+
+class ArrayObject;
+class Builtin;
+class Object;
+class StringObject;
+class StructObject;
+
+enum class ValueType : uint8_t {
+  Null,
+  Bool,
+  Int,
+  Float,
+  String,
+  Instance,
+  Array,
+  Function,
+  Struct,
+  Builtin,
+};
+
+// A runtime value: a type tag and an immediate or a pointer. Strings, struct
+// instances and arrays point to objects; functions, structs and builtins point
+// to their (immutable) definitions.
+class Value {
+public:
+  ValueType type;
+  union {
+    bool boolean;
+    int64_t integer;
+    double number;
+    Object *object;
+    const FunctionDeclaration *function;
+    const StructLayout *layout;
+    const Builtin *builtin;
+  };
+
+  Value() : type(ValueType::Null), integer(0) {}
+
+  static Value fromBool(bool value);
+  static Value fromInt(int64_t value);
+  static Value fromFloat(double value);
+  static Value fromString(StringObject *string);
+  static Value fromInstance(StructObject *instance);
+  static Value fromArray(ArrayObject *array);
+  static Value fromFunction(const FunctionDeclaration *function);
+  static Value fromStruct(const StructLayout *layout);
+  static Value fromBuiltin(const Builtin *builtin);
+
+  bool isNull() const { return type == ValueType::Null; }
+  bool isNumber() const {
+    return type == ValueType::Int || type == ValueType::Float;
+  }
+  // True for the values that point into the heap.
+  bool isObject() const {
+    return type == ValueType::String || type == ValueType::Instance ||
+           type == ValueType::Array;
+  }
+  StringObject *asString() const;
+  StructObject *asInstance() const;
+  ArrayObject *asArray() const;
+};
+
+static_assert(sizeof(Value) == FieldSize,
+              "struct layouts assume one field is one Value");
+
+// Arrays come in one kind per element representation: ints and floats are
+// stored unboxed, anything else as Values.
+enum class ObjectKind : uint8_t {
+  String,
+  Instance,
+  IntArray,
+  FloatArray,
+  ValueArray,
+};
+
+// Header shared by everything a Value can point to. The first byte is a
+// ValueType::Null tag, so an instance placed among the value stack's slots
+// reads as null to code that scans the stack as values.
+class Object {
+public:
+  ValueType cellTag = ValueType::Null;
+  ObjectKind kind;
+  // True for instances living in a frame rather than the heap.
+  bool inFrame = false;
+  // Collector state, owned by the Heap.
+  uint8_t flags = 0;
+  // Bytes of a string, fields of an instance, elements of an array.
+  uint32_t length;
+};
+
+// The characters follow the header; they are not NUL-terminated.
+class StringObject : public Object {
+public:
+  const char *chars() const {
+    return reinterpret_cast<const char *>(this + 1);
+  }
+  char *chars() { return reinterpret_cast<char *>(this + 1); }
+  string_view view() const { return string_view(chars(), length); }
+
+  static size_t sizeFor(size_t length) {
+    return sizeof(StringObject) + length;
+  }
+};
+
+// The fields follow the header, one Value each, in layout order.
+class StructObject : public Object {
+public:
+  const StructLayout *layout;
+
+  Value *fields() { return reinterpret_cast<Value *>(this + 1); }
+  const Value *fields() const {
+    return reinterpret_cast<const Value *>(this + 1);
+  }
+
+  static size_t sizeFor(size_t fieldCount) {
+    return sizeof(StructObject) + fieldCount * sizeof(Value);
+  }
+};
+
+static_assert(sizeof(StructObject) == sizeof(Value),
+              "an instance header takes exactly one value slot");
+
+// The elements follow the header, contiguous: an int64_t or a double each
+// for the unboxed kinds, a Value each for ValueArray. The length is fixed.
+// An array literal whose elements are all ints, or all floats, makes an
+// unboxed array; when a store brings in a value the elements cannot hold,
+// they are copied once into a new ValueArray, which the array forwards to
+// from then on.
+class ArrayObject : public Object {
+public:
+  // The ValueArray holding the elements, when they have been boxed.
+  ArrayObject *moved = nullptr;
+
+  // The array whose elements are the current ones.
+  ArrayObject *target() { return moved ? moved : this; }
+  int64_t *ints() { return reinterpret_cast<int64_t *>(this + 1); }
+  double *floats() { return reinterpret_cast<double *>(this + 1); }
+  Value *values() { return reinterpret_cast<Value *>(this + 1); }
+  const Value *values() const {
+    return reinterpret_cast<const Value *>(this + 1);
+  }
+
+  static size_t sizeFor(ObjectKind kind, size_t length) {
+    return sizeof(ArrayObject) +
+           length * (kind == ObjectKind::ValueArray ? sizeof(Value)
+                                                    : sizeof(int64_t));
+  }
+};
+
+inline Value Value::fromBool(bool value) {
+  Value result;
+  result.type = ValueType::Bool;
+  result.boolean = value;
+  return result;
+}
+
+inline Value Value::fromInt(int64_t value) {
+  Value result;
+  result.type = ValueType::Int;
+  result.integer = value;
+  return result;
+}
+
+inline Value Value::fromFloat(double value) {
+  Value result;
+  result.type = ValueType::Float;
+  result.number = value;
+  return result;
+}
+
+inline Value Value::fromString(StringObject *string) {
+  Value result;
+  result.type = ValueType::String;
+  result.object = string;
+  return result;
+}
+
+inline Value Value::fromInstance(StructObject *instance) {
+  Value result;
+  result.type = ValueType::Instance;
+  result.object = instance;
+  return result;
+}
+
+inline Value Value::fromArray(ArrayObject *array) {
+  Value result;
+  result.type = ValueType::Array;
+  result.object = array;
+  return result;
+}
+
+inline Value Value::fromFunction(const FunctionDeclaration *function) {
+  Value result;
+  result.type = ValueType::Function;
+  result.function = function;
+  return result;
+}
+
+inline Value Value::fromStruct(const StructLayout *layout) {
+  Value result;
+  result.type = ValueType::Struct;
+  result.layout = layout;
+  return result;
+}
+
+inline Value Value::fromBuiltin(const Builtin *builtin) {
+  Value result;
+  result.type = ValueType::Builtin;
+  result.builtin = builtin;
+  return result;
+}
+
+inline StringObject *Value::asString() const {
+  return static_cast<StringObject *>(object);
+}
+
+inline StructObject *Value::asInstance() const {
+  return static_cast<StructObject *>(object);
+}
+
+inline ArrayObject *Value::asArray() const {
+  return static_cast<ArrayObject *>(object);
+}
+
+#endif
@@ -39,11 +39,11 @@ app.post('/saveToFile', (req, res) => {
 
 
 app.get('/runcpp', (req, res) => {
-    const cppFilePath = path.join(__dirname, 'main.cpp'); // Path to your C++ file
-    const exeFilePath = path.join(__dirname, 'main'); // Compiled executable path
+    const buildDir = path.join(__dirname, 'build'); // CMake build directory
+    const exeFilePath = path.join(buildDir, 'tlc'); // Compiled executable path
     
-    // Compile the C++ program (assuming it's already compiled)
-    exec(`g++ ${cppFilePath} -o ${exeFilePath}`, (error, stdout, stderr) => {
+    // Configure and build the compiler (a no-op when it is up to date)
+    exec(`cmake -S ${__dirname} -B ${buildDir} -DCMAKE_BUILD_TYPE=Release && cmake --build ${buildDir} --target tlc-cli`, (error, stdout, stderr) => {
       if (error) {
         console.error('Compilation error:', error.message);
         res.status(500).send('Compilation error');
@@ -0,0 +1,18 @@
+#!/bin/sh
+# Builds an instrumented tlc, trains it on the benchmark corpus and rebuilds
+# it with the collected profiles.
+#
+# Usage: scripts/pgo.sh [build-dir] [extra cmake args...]
+set -e
+
+SOURCE_DIR=$(cd "$(dirname "$0")/.." && pwd)
+BUILD_DIR=${1:-build-pgo}
+[ $# -gt 0 ] && shift
+
+rm -rf "$BUILD_DIR/pgo-profiles"
+cmake -S "$SOURCE_DIR" -B "$BUILD_DIR" -DCMAKE_BUILD_TYPE=Release -DTLC_PGO=GENERATE "$@"
+cmake --build "$BUILD_DIR" -j
+cmake --build "$BUILD_DIR" --target pgo-train
+
+cmake -S "$SOURCE_DIR" -B "$BUILD_DIR" -DTLC_PGO=USE "$@"
+cmake --build "$BUILD_DIR" -j --clean-first
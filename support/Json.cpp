@@ -0,0 +1,478 @@
+#include "Json.h"
+#include <cctype>
+#include <charconv>
+#include <cmath>
+
+JsonValue JsonValue::array() {
+  JsonValue value;
+  value.type = Kind::Array;
+  return value;
+}
+
+JsonValue JsonValue::object() {
+  JsonValue value;
+  value.type = Kind::Object;
+  return value;
+}
+
+JsonValue JsonValue::raw(string json) {
+  JsonValue value;
+  value.type = Kind::Raw;
+  value.text = move(json);
+  return value;
+}
+
+void JsonValue::expect(Kind kind, const char *name) const {
+  if (type != kind) {
+    throw JsonError(string("JSON value is not ") + name);
+  }
+}
+
+bool JsonValue::asBool() const {
+  expect(Kind::Bool, "a boolean");
+  return boolean;
+}
+
+double JsonValue::asNumber() const {
+  expect(Kind::Number, "a number");
+  return number;
+}
+
+int64_t JsonValue::asInt() const {
+  expect(Kind::Number, "a number");
+  return static_cast<int64_t>(number);
+}
+
+const string &JsonValue::asString() const {
+  expect(Kind::String, "a string");
+  return text;
+}
+
+const vector<JsonValue> &JsonValue::items() const {
+  expect(Kind::Array, "an array");
+  return elements;
+}
+
+void JsonValue::push(JsonValue value) {
+  expect(Kind::Array, "an array");
+  elements.push_back(move(value));
+}
+
+const vector<pair<string, JsonValue>> &JsonValue::members() const {
+  expect(Kind::Object, "an object");
+  return fields;
+}
+
+const JsonValue &JsonValue::get(const string &key) const {
+  static const JsonValue missing;
+  if (type != Kind::Object) {
+    return missing;
+  }
+  for (const auto &field : fields) {
+    if (field.first == key) {
+      return field.second;
+    }
+  }
+  return missing;
+}
+
+bool JsonValue::has(const string &key) const {
+  if (type != Kind::Object) {
+    return false;
+  }
+  for (const auto &field : fields) {
+    if (field.first == key) {
+      return true;
+    }
+  }
+  return false;
+}
+
+JsonValue &JsonValue::set(const string &key, JsonValue value) {
+  expect(Kind::Object, "an object");
+  for (auto &field : fields) {
+    if (field.first == key) {
+      field.second = move(value);
+      return field.second;
+    }
+  }
+  fields.emplace_back(key, move(value));
+  return fields.back().second;
+}
+
+namespace {
+
+class JsonParser {
+public:
+  JsonParser(string_view text, size_t maxDepth)
+      : text(text), maxDepth(maxDepth) {}
+
+  JsonValue parseDocument() {
+    JsonValue value = parseValue(0);
+    skipWhitespace();
+    if (pos != text.size()) {
+      fail("Unexpected data after JSON value");
+    }
+    return value;
+  }
+
+private:
+  string_view text;
+  size_t maxDepth;
+  size_t pos = 0;
+
+  [[noreturn]] void fail(const string &message) {
+    throw JsonError(message, pos);
+  }
+
+  void skipWhitespace() {
+    while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' ||
+                                 text[pos] == '\n' || text[pos] == '\r')) {
+      pos++;
+    }
+  }
+
+  bool consume(char c) {
+    skipWhitespace();
+    if (pos < text.size() && text[pos] == c) {
+      pos++;
+      return true;
+    }
+    return false;
+  }
+
+  void expect(char c) {
+    if (!consume(c)) {
+      fail(string("Expected '") + c + "' in JSON");
+    }
+  }
+
+  void keyword(string_view word) {
+    if (text.substr(pos, word.size()) != word) {
+      fail("Invalid JSON literal");
+    }
+    pos += word.size();
+  }
+
+  JsonValue parseValue(size_t depth);
+  JsonValue parseNumber();
+  string parseString();
+  void appendUtf8(string &out, uint32_t codePoint);
+  uint32_t parseHex4();
+};
+
+JsonValue JsonParser::parseValue(size_t depth) {
+  if (depth >= maxDepth) {
+    fail("JSON nesting is too deep");
+  }
+  skipWhitespace();
+  if (pos >= text.size()) {
+    fail("Unexpected end of JSON");
+  }
+  switch (text[pos]) {
+  case '{': {
+    pos++;
+    JsonValue object = JsonValue::object();
+    if (consume('}')) {
+      return object;
+    }
+    do {
+      skipWhitespace();
+      if (pos >= text.size() || text[pos] != '"') {
+        fail("Expected a string key in JSON object");
+      }
+      string key = parseString();
+      expect(':');
+      object.set(key, parseValue(depth + 1));
+    } while (consume(','));
+    expect('}');
+    return object;
+  }
+  case '[': {
+    pos++;
+    JsonValue array = JsonValue::array();
+    if (consume(']')) {
+      return array;
+    }
+    do {
+      array.push(parseValue(depth + 1));
+    } while (consume(','));
+    expect(']');
+    return array;
+  }
+  case '"':
+    return JsonValue(parseString());
+  case 't':
+    keyword("true");
+    return JsonValue(true);
+  case 'f':
+    keyword("false");
+    return JsonValue(false);
+  case 'n':
+    keyword("null");
+    return JsonValue();
+  default:
+    return parseNumber();
+  }
+}
+
+JsonValue JsonParser::parseNumber() {
+  size_t start = pos;
+  if (pos < text.size() && text[pos] == '-') {
+    pos++;
+  }
+  while (pos < text.size() &&
+         (isdigit(static_cast<unsigned char>(text[pos])) || text[pos] == '.' ||
+          text[pos] == 'e' || text[pos] == 'E' || text[pos] == '+' ||
+          text[pos] == '-')) {
+    pos++;
+  }
+  double value = 0;
+  const char *first = text.data() + start;
+  const char *last = text.data() + pos;
+  from_chars_result result = from_chars(first, last, value);
+  if (first == last || result.ec != errc() || result.ptr != last) {
+    pos = start;
+    fail("Invalid JSON number");
+  }
+  return JsonValue(value);
+}
+
+uint32_t JsonParser::parseHex4() {
+  if (pos + 4 > text.size()) {
+    fail("Truncated \\u escape in JSON string");
+  }
+  uint32_t value = 0;
+  from_chars_result result =
+      from_chars(text.data() + pos, text.data() + pos + 4, value, 16);
+  if (result.ec != errc() || result.ptr != text.data() + pos + 4) {
+    fail("Invalid \\u escape in JSON string");
+  }
+  pos += 4;
+  return value;
+}
+
+void JsonParser::appendUtf8(string &out, uint32_t codePoint) {
+  if (codePoint < 0x80) {
+    out += static_cast<char>(codePoint);
+  } else if (codePoint < 0x800) {
+    out += static_cast<char>(0xC0 | (codePoint >> 6));
+    out += static_cast<char>(0x80 | (codePoint & 0x3F));
+  } else if (codePoint < 0x10000) {
+    out += static_cast<char>(0xE0 | (codePoint >> 12));
+    out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (codePoint & 0x3F));
+  } else {
+    out += static_cast<char>(0xF0 | (codePoint >> 18));
+    out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+    out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (codePoint & 0x3F));
+  }
+}
+
+string JsonParser::parseString() {
+  pos++; // Opening quote
+  string out;
+  while (true) {
+    size_t run = pos;
+    while (pos < text.size() && text[pos] != '"' && text[pos] != '\\') {
+      pos++;
+    }
+    out.append(text.data() + run, pos - run);
+    if (pos >= text.size()) {
+      fail("Unterminated JSON string");
+    }
+    if (text[pos++] == '"') {
+      return out;
+    }
+    if (pos >= text.size()) {
+      fail("Unterminated JSON string");
+    }
+    char escape = text[pos++];
+    switch (escape) {
+    case '"':
+    case '\\':
+    case '/':
+      out += escape;
+      break;
+    case 'b':
+      out += '\b';
+      break;
+    case 'f':
+      out += '\f';
+      break;
+    case 'n':
+      out += '\n';
+      break;
+    case 'r':
+      out += '\r';
+      break;
+    case 't':
+      out += '\t';
+      break;
+    case 'u': {
+      uint32_t codePoint = parseHex4();
+      // A high surrogate followed by a low one encodes a single code point.
+      if (codePoint >= 0xD800 && codePoint < 0xDC00 &&
+          text.substr(pos, 2) == "\\u") {
+        pos += 2;
+        uint32_t low = parseHex4();
+        if (low >= 0xDC00 && low < 0xE000) {
+          codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+        } else {
+          appendUtf8(out, codePoint);
+          codePoint = low;
+        }
+      }
+      appendUtf8(out, codePoint);
+      break;
+    }
+    default:
+      fail("Invalid escape in JSON string");
+    }
+  }
+}
+
+// Length of the well-formed UTF-8 sequence starting at `i`, or 0.
+size_t utf8SequenceLength(const string &value, size_t i) {
+  unsigned char lead = static_cast<unsigned char>(value[i]);
+  size_t length = lead < 0x80   ? 1
+                  : lead < 0xC2 ? 0
+                  : lead < 0xE0 ? 2
+                  : lead < 0xF0 ? 3
+                  : lead < 0xF5 ? 4
+                                : 0;
+  if (length == 0 || i + length > value.size()) {
+    return 0;
+  }
+  for (size_t k = 1; k < length; k++) {
+    if ((static_cast<unsigned char>(value[i + k]) & 0xC0) != 0x80) {
+      return 0;
+    }
+  }
+  return length;
+}
+
+// Strings are written as UTF-8; bytes that are not valid UTF-8 become
+// U+FFFD so the output is always valid JSON.
+void writeString(const string &value, string &out) {
+  static const char hex[] = "0123456789abcdef";
+  out += '"';
+  for (size_t i = 0; i < value.size(); i++) {
+    char c = value[i];
+    if (static_cast<unsigned char>(c) >= 0x80) {
+      size_t length = utf8SequenceLength(value, i);
+      if (length == 0) {
+        out += "\xEF\xBF\xBD";
+      } else {
+        out.append(value, i, length);
+        i += length - 1;
+      }
+      continue;
+    }
+    switch (c) {
+    case '"':
+      out += "\\\"";
+      break;
+    case '\\':
+      out += "\\\\";
+      break;
+    case '\n':
+      out += "\\n";
+      break;
+    case '\r':
+      out += "\\r";
+      break;
+    case '\t':
+      out += "\\t";
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        out += "\\u00";
+        out += hex[(c >> 4) & 0xF];
+        out += hex[c & 0xF];
+      } else {
+        out += c;
+      }
+    }
+  }
+  out += '"';
+}
+
+void writeNumber(double value, string &out) {
+  char buffer[32];
+  to_chars_result result;
+  if (!isfinite(value)) {
+    // JSON has no spelling for these.
+    out += "null";
+    return;
+  }
+  if (value == static_cast<double>(static_cast<int64_t>(value)) &&
+      fabs(value) < 9007199254740992.0) {
+    result = to_chars(buffer, buffer + sizeof(buffer),
+                      static_cast<int64_t>(value));
+  } else {
+    result = to_chars(buffer, buffer + sizeof(buffer), value);
+  }
+  out.append(buffer, result.ptr);
+}
+
+} // namespace
+
+JsonValue parseJson(string_view text, size_t maxDepth) {
+  return JsonParser(text, maxDepth).parseDocument();
+}
+
+void writeJson(const JsonValue &value, string &out) {
+  switch (value.type) {
+  case JsonValue::Kind::Null:
+    out += "null";
+    break;
+  case JsonValue::Kind::Bool:
+    out += value.boolean ? "true" : "false";
+    break;
+  case JsonValue::Kind::Number:
+    writeNumber(value.number, out);
+    break;
+  case JsonValue::Kind::String:
+    writeString(value.text, out);
+    break;
+  case JsonValue::Kind::Raw:
+    out += value.text;
+    break;
+  case JsonValue::Kind::Array: {
+    out += '[';
+    bool first = true;
+    for (const JsonValue &item : value.elements) {
+      if (!first) {
+        out += ',';
+      }
+      first = false;
+      writeJson(item, out);
+    }
+    out += ']';
+    break;
+  }
+  case JsonValue::Kind::Object: {
+    out += '{';
+    bool first = true;
+    for (const auto &member : value.fields) {
+      if (!first) {
+        out += ',';
+      }
+      first = false;
+      writeString(member.first, out);
+      out += ':';
+      writeJson(member.second, out);
+    }
+    out += '}';
+    break;
+  }
+  }
+}
+
+string toJson(const JsonValue &value) {
+  string out;
+  writeJson(value, out);
+  return out;
+}
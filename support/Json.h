@@ -0,0 +1,98 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+using namespace std;
+
+class JsonError : public runtime_error {
+public:
+  JsonError(const string &message, size_t offset = 0)
+      : runtime_error(message), offset(offset) {}
+  size_t offset;
+};
+
+// A parsed or to-be-written JSON document. Objects keep their members in
+// insertion order, which is what the protocols built on top expect to see
+// when they echo or log messages.
+class JsonValue {
+public:
+  enum class Kind { Null, Bool, Number, String, Array, Object, Raw };
+
+  JsonValue() : type(Kind::Null) {}
+  JsonValue(nullptr_t) : type(Kind::Null) {}
+  JsonValue(bool value) : type(Kind::Bool), boolean(value) {}
+  JsonValue(double value) : type(Kind::Number), number(value) {}
+  JsonValue(int value) : type(Kind::Number), number(value) {}
+  JsonValue(int64_t value)
+      : type(Kind::Number), number(static_cast<double>(value)) {}
+  JsonValue(uint32_t value) : type(Kind::Number), number(value) {}
+  JsonValue(size_t value)
+      : type(Kind::Number), number(static_cast<double>(value)) {}
+  JsonValue(string value) : type(Kind::String), text(move(value)) {}
+  JsonValue(const char *value) : type(Kind::String), text(value) {}
+  JsonValue(const JsonValue &) = default;
+  JsonValue &operator=(const JsonValue &) = default;
+  // Spelled out so containers of values move rather than copy when they
+  // grow: the implicit noexcept deduction cannot see through the members
+  // that hold the still incomplete JsonValue.
+  JsonValue(JsonValue &&) noexcept = default;
+  JsonValue &operator=(JsonValue &&) noexcept = default;
+
+  static JsonValue array();
+  static JsonValue object();
+  // Already serialized JSON, written out verbatim. For large uniform
+  // payloads that would be wasteful to build value by value.
+  static JsonValue raw(string json);
+
+  Kind kind() const { return type; }
+  bool isNull() const { return type == Kind::Null; }
+  bool isNumber() const { return type == Kind::Number; }
+  bool isString() const { return type == Kind::String; }
+  bool isArray() const { return type == Kind::Array; }
+  bool isObject() const { return type == Kind::Object; }
+
+  // The accessors throw JsonError when the value has a different kind.
+  bool asBool() const;
+  double asNumber() const;
+  int64_t asInt() const;
+  const string &asString() const;
+
+  // Elements of an array.
+  const vector<JsonValue> &items() const;
+  void push(JsonValue value);
+
+  // Members of an object. get() returns a null value for a missing key;
+  // set() replaces an existing member.
+  const vector<pair<string, JsonValue>> &members() const;
+  const JsonValue &get(const string &key) const;
+  bool has(const string &key) const;
+  JsonValue &set(const string &key, JsonValue value);
+
+private:
+  Kind type;
+  bool boolean = false;
+  double number = 0;
+  string text;
+  vector<JsonValue> elements;
+  vector<pair<string, JsonValue>> fields;
+
+  void expect(Kind kind, const char *name) const;
+
+  friend void writeJson(const JsonValue &value, string &out);
+};
+
+// Parses one complete JSON document; anything but trailing whitespace after
+// it is an error. Nesting deeper than `maxDepth` is rejected rather than
+// recursed into.
+JsonValue parseJson(string_view text, size_t maxDepth = 512);
+
+// Appends the compact serialization of `value` to `out`.
+void writeJson(const JsonValue &value, string &out);
+string toJson(const JsonValue &value);
+
+#endif
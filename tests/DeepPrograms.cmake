@@ -0,0 +1,36 @@
+# Writes the programs that probe the nesting limits into DIR:
+#
+#   flat_chain.tl    `y + y + ...` with 1500 terms: past the parser's
+#                    nesting limit in length, but the parser builds chains
+#                    with a loop, and the tree is within the depth analysis
+#                    accepts
+#   deep_chain.tl    the same with 2500 terms, past that depth
+#   parens.tl        998 nested parentheses, the most the parser's limit of
+#                    1000 leaves room for in a declaration's value
+#   deep_parens.tl   999 nested parentheses, one too many
+#
+#   cmake -DDIR=<dir> -P DeepPrograms.cmake
+
+function(repeat text count out)
+  set(result "")
+  foreach(i RANGE 1 ${count})
+    string(APPEND result "${text}")
+  endforeach()
+  set(${out} "${result}" PARENT_SCOPE)
+endfunction()
+
+file(MAKE_DIRECTORY "${DIR}")
+
+repeat(" + y" 1500 terms)
+file(WRITE "${DIR}/flat_chain.tl" "let y = 1;\nlet x = y${terms};\nprint(x);\n")
+
+repeat(" + y" 2500 terms)
+file(WRITE "${DIR}/deep_chain.tl" "let y = 1;\nlet x = y${terms};\nprint(x);\n")
+
+repeat("(" 999 open)
+repeat(")" 999 close)
+file(WRITE "${DIR}/deep_parens.tl" "let x = ${open}1${close};\nprint(x);\n")
+
+repeat("(" 998 open)
+repeat(")" 998 close)
+file(WRITE "${DIR}/parens.tl" "let x = ${open}1${close};\nprint(x);\n")
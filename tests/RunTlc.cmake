@@ -0,0 +1,78 @@
+# Runs one tlc command and checks what it printed against golden files.
+#
+#   cmake -DTLC=<tlc> [-DPROGRAM=<file.tl>] [-DARGS=<options>]
+#         [-DEXPECTED=<file>] [-DEXPECTED_ERRORS=<file>] [-DERROR_MATCH=<regex>]
+#         [-DINPUT=<file>] [-DSTATUS=<code>] -DWORKDIR=<dir> -P RunTlc.cmake
+#
+# ARGS holds the options put before the program, separated by spaces;
+# without a program, tlc reads INPUT, as in batch mode. Standard output must
+# match EXPECTED, when given. Standard error must match EXPECTED_ERRORS, or
+# contain ERROR_MATCH, with the program's directory left out of the
+# positions tlc prints; either one means tlc must exit with 1, and neither
+# means it must exit with 0 and print nothing on standard error. STATUS,
+# when given, is the exit status expected instead.
+
+file(MAKE_DIRECTORY "${WORKDIR}")
+separate_arguments(command UNIX_COMMAND "${ARGS}")
+list(INSERT command 0 "${TLC}")
+if(PROGRAM)
+  list(APPEND command "${PROGRAM}")
+endif()
+if(NOT INPUT)
+  set(INPUT /dev/null)
+endif()
+
+execute_process(
+  COMMAND ${command}
+  WORKING_DIRECTORY "${WORKDIR}"
+  INPUT_FILE "${INPUT}"
+  OUTPUT_VARIABLE output
+  ERROR_VARIABLE errors
+  RESULT_VARIABLE status
+)
+if(PROGRAM)
+  get_filename_component(program_dir "${PROGRAM}" DIRECTORY)
+  string(REPLACE "${program_dir}/" "" errors "${errors}")
+endif()
+
+set(failed FALSE)
+if(EXPECTED_ERRORS OR ERROR_MATCH)
+  set(expected_status 1)
+else()
+  set(expected_status 0)
+endif()
+if(DEFINED STATUS)
+  set(expected_status ${STATUS})
+endif()
+if(NOT status STREQUAL expected_status)
+  message(SEND_ERROR "tlc exited with ${status}, expected ${expected_status}")
+  set(failed TRUE)
+endif()
+
+if(EXPECTED)
+  file(READ "${EXPECTED}" expected_output)
+  if(NOT output STREQUAL expected_output)
+    message(SEND_ERROR "Standard output differs from ${EXPECTED}")
+    set(failed TRUE)
+  endif()
+endif()
+
+if(EXPECTED_ERRORS)
+  file(READ "${EXPECTED_ERRORS}" expected_errors)
+  if(NOT errors STREQUAL expected_errors)
+    message(SEND_ERROR "Standard error differs from ${EXPECTED_ERRORS}")
+    set(failed TRUE)
+  endif()
+elseif(ERROR_MATCH)
+  if(NOT errors MATCHES "${ERROR_MATCH}")
+    message(SEND_ERROR "Standard error does not match '${ERROR_MATCH}'")
+    set(failed TRUE)
+  endif()
+elseif(NOT errors STREQUAL "")
+  message(SEND_ERROR "Unexpected output on standard error")
+  set(failed TRUE)
+endif()
+
+if(failed)
+  message("--- standard output\n${output}--- standard error\n${errors}")
+endif()
@@ -0,0 +1,118 @@
+// Checks that tokens are moved or borrowed after lexing, never copied, by
+// counting the heap allocations each stage makes. Every name in the program
+// is longer than the small string buffer, so each copy of a name's text is
+// one allocation of exactly `nameLength + 1` bytes, and the stages after
+// the lexer must make no more of them than the syntax tree keeps names.
+#include "ast/AST.h"
+#include "ast/Visitor.h"
+#include "compiler/Compiler.h"
+#include "lexer/Lexer.h"
+#include "parser/Parser.h"
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+constexpr size_t nameLength = 40;
+constexpr size_t declarations = 200;
+
+size_t allocations = 0;
+size_t nameAllocations = 0;
+
+// Zeroes the counters and returns what they held.
+pair<size_t, size_t> takeCounts() {
+  pair<size_t, size_t> counts{allocations, nameAllocations};
+  allocations = 0;
+  nameAllocations = 0;
+  return counts;
+}
+
+string name(size_t i) {
+  string digits = to_string(i);
+  return "name_" + string(nameLength - 5 - digits.size(), 'x') + digits;
+}
+
+// `let name_0 = 0;` and then `let name_i = name_{i-1};`.
+string program() {
+  string source = "let " + name(0) + " = 0;\n";
+  for (size_t i = 1; i < declarations; i++) {
+    source += "let " + name(i) + " = " + name(i - 1) + ";\n";
+  }
+  return source;
+}
+
+// Names the syntax tree owns a copy of.
+size_t namesIn(const Stmt &stmt) {
+  size_t names = 0;
+  if (stmt.kind == NodeType::VarDeclaration) {
+    names += static_cast<const VarDeclaration &>(stmt).identifier.size() ==
+             nameLength;
+  } else if (stmt.kind == NodeType::Identifier) {
+    names +=
+        static_cast<const IdentifierExpr &>(stmt).symbol.size() == nameLength;
+  }
+  forEachChild(stmt, [&names](const Stmt &child) {
+    names += namesIn(child);
+    return true;
+  });
+  return names;
+}
+
+int failures = 0;
+
+void expect(bool condition, const string &what, size_t got, size_t want) {
+  if (!condition) {
+    fprintf(stderr, "FAIL: %s: %zu, expected %zu\n", what.c_str(), got, want);
+    failures++;
+  }
+}
+
+} // namespace
+
+void *operator new(size_t size) {
+  allocations++;
+  nameAllocations += size == nameLength + 1;
+  if (void *pointer = malloc(size)) {
+    return pointer;
+  }
+  throw bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept { free(pointer); }
+
+void operator delete(void *pointer, size_t) noexcept { free(pointer); }
+
+int main() {
+  string source = program();
+  const size_t expectedNames = 2 * declarations - 1;
+
+  // Lexing makes the one copy of each name the tokens share; how many
+  // allocations that takes is up to the lexer.
+  takeCounts();
+  Lexer lex(source);
+  size_t lexed = takeCounts().second;
+
+  vector<Token> tokens = lex.takeTokens();
+  size_t taken = takeCounts().first;
+  expect(taken == 0, "allocations handing the tokens over", taken, 0);
+
+  Parser parser;
+  takeCounts();
+  unique_ptr<Program> ast = parser.produceAST(tokens);
+  size_t parsed = takeCounts().second;
+  size_t names = namesIn(*ast);
+  expect(names == expectedNames, "names in the tree", names, expectedNames);
+  expect(parsed == names, "name allocations while parsing", parsed, names);
+
+  // The whole pipeline: lexing, then one copy per name in the tree.
+  CompilerContext context;
+  takeCounts();
+  CompileResult result = context.compile(source);
+  size_t compiled = takeCounts().second;
+  expect(result.ok(), "diagnostics", result.diagnostics.size(), 0);
+  expect(compiled == lexed + names, "name allocations compiling", compiled,
+         lexed + names);
+
+  return failures == 0 ? 0 : 1;
+}